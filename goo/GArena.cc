@@ -0,0 +1,223 @@
+//========================================================================
+//
+// GArena.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include <limits.h>
+#include "gmem.h"
+#include "gmempp.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "GArena.h"
+
+//------------------------------------------------------------------------
+
+#define gArenaChunkSize    65536
+#define gArenaMaxBlockSize (gArenaChunkSize / 4)
+
+// The chunk reference count is one for the arena (except for chunks
+// holding a single oversize block), plus one for each live block.
+struct GArenaChunk {
+#if MULTITHREADED
+  GAtomicCounter refCnt;	// reference count
+#else
+  long refCnt;			// reference count
+#endif
+  int size;			// total size of the chunk
+  int used;			// number of bytes allocated so far
+  GArenaChunk *next;		// next chunk owned by the arena
+};
+
+// Each block is preceded by a header.  Heap blocks (allocated without
+// an arena) have offset = 0.
+struct GArenaBlockHdr {
+  Guint offset;			// offset from the start of the chunk to
+				//   this header
+  int size;			// size of the block, not including the
+				//   header
+};
+
+#define gArenaChunkHdrSize ((int)((sizeof(GArenaChunk) + 7) & ~7))
+#define gArenaBlockHdrSize ((int)sizeof(GArenaBlockHdr))
+
+static inline void decChunkRef(GArenaChunk *chunk) {
+#if MULTITHREADED
+  if (gAtomicDecrement(&chunk->refCnt) == 0) {
+#else
+  if (--chunk->refCnt == 0) {
+#endif
+    gfree(chunk);
+  }
+}
+
+//------------------------------------------------------------------------
+// GArena
+//------------------------------------------------------------------------
+
+GArena::GArena() {
+  chunks = cur = NULL;
+}
+
+GArena::~GArena() {
+  GArenaChunk *chunk, *next;
+
+  for (chunk = chunks; chunk; chunk = next) {
+    next = chunk->next;
+    decChunkRef(chunk);
+  }
+}
+
+void *GArena::alloc(int size) GMEM_EXCEP {
+  GArenaChunk *chunk;
+  GArenaBlockHdr *hdr;
+  int n;
+
+  if (size < 0 || size > INT_MAX - gArenaChunkHdrSize - 16) {
+    gMemError("Invalid memory allocation size");
+  }
+  if (size == 0) {
+    return NULL;
+  }
+  n = (gArenaBlockHdrSize + size + 7) & ~7;
+
+  // oversize blocks get their own chunk, which isn't referenced by
+  // the arena
+  if (n > gArenaMaxBlockSize) {
+    chunk = (GArenaChunk *)gmalloc(gArenaChunkHdrSize + n);
+    chunk->refCnt = 1;
+    chunk->size = chunk->used = gArenaChunkHdrSize + n;
+    chunk->next = NULL;
+    hdr = (GArenaBlockHdr *)((char *)chunk + gArenaChunkHdrSize);
+
+  } else {
+    if (!cur || cur->used + n > cur->size) {
+      nextChunk();
+    }
+    chunk = cur;
+    hdr = (GArenaBlockHdr *)((char *)chunk + chunk->used);
+    chunk->used += n;
+#if MULTITHREADED
+    gAtomicIncrement(&chunk->refCnt);
+#else
+    ++chunk->refCnt;
+#endif
+  }
+
+  hdr->offset = (Guint)((char *)hdr - (char *)chunk);
+  hdr->size = size;
+  return hdr + 1;
+}
+
+// Set up cur with an empty chunk.  A chunk whose refCnt is one is
+// only referenced by the arena, i.e., all of its blocks have been
+// freed -- since blocks are only allocated by the arena's thread, the
+// count can't increase behind our back.
+void GArena::nextChunk() {
+  GArenaChunk *chunk;
+
+  if (cur && cur->refCnt == 1) {
+    cur->used = gArenaChunkHdrSize;
+    return;
+  }
+  for (chunk = chunks; chunk; chunk = chunk->next) {
+    if (chunk->refCnt == 1) {
+      chunk->used = gArenaChunkHdrSize;
+      cur = chunk;
+      return;
+    }
+  }
+  chunk = (GArenaChunk *)gmalloc(gArenaChunkSize);
+  chunk->refCnt = 1;
+  chunk->size = gArenaChunkSize;
+  chunk->used = gArenaChunkHdrSize;
+  chunk->next = chunks;
+  chunks = chunk;
+  cur = chunk;
+}
+
+//------------------------------------------------------------------------
+
+void *gArenaAlloc(GArena *arena, int size) GMEM_EXCEP {
+  GArenaBlockHdr *hdr;
+
+  if (arena) {
+    return arena->alloc(size);
+  }
+  if (size < 0 || size > INT_MAX - gArenaBlockHdrSize) {
+    gMemError("Invalid memory allocation size");
+  }
+  if (size == 0) {
+    return NULL;
+  }
+  hdr = (GArenaBlockHdr *)gmalloc(gArenaBlockHdrSize + size);
+  hdr->offset = 0;
+  hdr->size = size;
+  return hdr + 1;
+}
+
+void *gArenaAllocn(GArena *arena, int nObjs, int objSize) GMEM_EXCEP {
+  if (nObjs == 0) {
+    return NULL;
+  }
+  if (objSize <= 0 || nObjs < 0 || nObjs >= INT_MAX / objSize) {
+    gMemError("Bogus memory allocation size");
+  }
+  return gArenaAlloc(arena, nObjs * objSize);
+}
+
+void *gArenaReallocn(GArena *arena, void *p, int nObjs, int objSize)
+  GMEM_EXCEP {
+  GArenaBlockHdr *hdr;
+  void *q;
+  int size;
+
+  if (nObjs == 0) {
+    gArenaFree(p);
+    return NULL;
+  }
+  if (objSize <= 0 || nObjs < 0 || nObjs >= INT_MAX / objSize) {
+    gMemError("Bogus memory allocation size");
+  }
+  size = nObjs * objSize;
+  if (!p) {
+    return gArenaAlloc(arena, size);
+  }
+  hdr = (GArenaBlockHdr *)p - 1;
+  if (!arena && hdr->offset == 0) {
+    if (size > INT_MAX - gArenaBlockHdrSize) {
+      gMemError("Invalid memory allocation size");
+    }
+    hdr = (GArenaBlockHdr *)grealloc(hdr, gArenaBlockHdrSize + size);
+    hdr->size = size;
+    return hdr + 1;
+  }
+  q = gArenaAlloc(arena, size);
+  memcpy(q, p, size < hdr->size ? size : hdr->size);
+  gArenaFree(p);
+  return q;
+}
+
+void gArenaFree(void *p) {
+  GArenaBlockHdr *hdr;
+
+  if (!p) {
+    return;
+  }
+  hdr = (GArenaBlockHdr *)p - 1;
+  if (hdr->offset == 0) {
+    gfree(hdr);
+  } else {
+    decChunkRef((GArenaChunk *)((char *)hdr - hdr->offset));
+  }
+}
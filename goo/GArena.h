@@ -0,0 +1,81 @@
+//========================================================================
+//
+// GArena.h
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef GARENA_H
+#define GARENA_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+#include "gmem.h"
+
+struct GArenaChunk;
+
+//------------------------------------------------------------------------
+// GArena
+//
+// A chunked allocator for large numbers of short-lived objects (e.g.,
+// the objects created while running a page's content stream).
+// Blocks are carved sequentially out of 64 KB chunks, and chunks
+// whose blocks have all been freed are reused.
+//
+// Blocks can be freed individually (from any thread), and they can
+// outlive the arena: each chunk is reference counted, and it is only
+// returned to the heap once the arena and all of the chunk's blocks
+// have been freed.
+//
+// Allocation from a GArena object is not thread-safe -- each arena
+// should only be used by one thread.
+//------------------------------------------------------------------------
+
+class GArena {
+public:
+
+  GArena();
+
+  // Release the arena.  Chunks that still contain live blocks are
+  // freed along with their last block.
+  ~GArena();
+
+  // Allocate a block of <size> bytes.
+  void *alloc(int size) GMEM_EXCEP;
+
+private:
+
+  void nextChunk();
+
+  GArenaChunk *chunks;		// all chunks owned by this arena
+  GArenaChunk *cur;		// chunk currently being allocated from
+};
+
+//------------------------------------------------------------------------
+
+// Allocate <size> bytes from <arena>, or from the heap if <arena> is
+// NULL.  Blocks allocated with this function (from either source)
+// must be freed with gArenaFree.
+extern void *gArenaAlloc(GArena *arena, int size) GMEM_EXCEP;
+
+// Same as gArenaAlloc, but takes an object count and size, with an
+// overflow check (like gmallocn).
+extern void *gArenaAllocn(GArena *arena, int nObjs, int objSize) GMEM_EXCEP;
+
+// Resize a block allocated with gArenaAlloc (or NULL).  If the block
+// needs to move, the new block is allocated from <arena> (or the
+// heap, if <arena> is NULL).
+extern void *gArenaReallocn(GArena *arena, void *p, int nObjs, int objSize)
+  GMEM_EXCEP;
+
+// Free a block allocated with gArenaAlloc.  This checks for and
+// ignores NULL pointers.
+extern void gArenaFree(void *p);
+
+#endif
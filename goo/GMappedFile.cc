@@ -0,0 +1,122 @@
+//========================================================================
+//
+// GMappedFile.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <io.h>
+#elif HAVE_MMAP
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+#include "gmempp.h"
+#include "GMappedFile.h"
+
+//------------------------------------------------------------------------
+// GMappedFile
+//------------------------------------------------------------------------
+
+GMappedFile *GMappedFile::map(FILE *f) {
+#if defined(_WIN32)
+  HANDLE file, mappingA;
+  LARGE_INTEGER fileSize;
+  GMappedFile *mf;
+  char *dataA;
+
+  file = (HANDLE)_get_osfhandle(_fileno(f));
+  if (file == INVALID_HANDLE_VALUE ||
+      !GetFileSizeEx(file, &fileSize) ||
+      fileSize.QuadPart <= 0 ||
+      (ULONGLONG)fileSize.QuadPart > (ULONGLONG)(size_t)-1) {
+    return NULL;
+  }
+  if (!(mappingA = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL))) {
+    return NULL;
+  }
+  if (!(dataA = (char *)MapViewOfFile(mappingA, FILE_MAP_READ, 0, 0, 0))) {
+    CloseHandle(mappingA);
+    return NULL;
+  }
+  mf = new GMappedFile(dataA, (GFileOffset)fileSize.QuadPart);
+  mf->mapping = mappingA;
+  return mf;
+#elif HAVE_MMAP
+  struct stat st;
+  void *p;
+
+  if (fstat(fileno(f), &st) != 0 ||
+      !S_ISREG(st.st_mode) ||
+      st.st_size <= 0 ||
+      (unsigned long long)st.st_size > (unsigned long long)(size_t)-1) {
+    return NULL;
+  }
+  p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  return new GMappedFile((char *)p, (GFileOffset)st.st_size);
+#else
+  return NULL;
+#endif
+}
+
+GMappedFile *GMappedFile::map(const char *path) {
+  GMappedFile *mf;
+  FILE *f;
+
+  if (!(f = openFile(path, "rb"))) {
+    return NULL;
+  }
+  mf = map(f);
+  fclose(f);
+  return mf;
+}
+
+GMappedFile::GMappedFile(char *dataA, GFileOffset sizeA) {
+  data = dataA;
+  size = sizeA;
+#ifdef _WIN32
+  mapping = NULL;
+#endif
+  refCnt = 1;
+}
+
+GMappedFile::~GMappedFile() {
+#if defined(_WIN32)
+  UnmapViewOfFile(data);
+  CloseHandle(mapping);
+#elif HAVE_MMAP
+  munmap(data, (size_t)size);
+#endif
+}
+
+GMappedFile *GMappedFile::copy() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCnt);
+#else
+  ++refCnt;
+#endif
+  return this;
+}
+
+void GMappedFile::free() {
+#if MULTITHREADED
+  if (gAtomicDecrement(&refCnt) == 0) {
+#else
+  if (--refCnt == 0) {
+#endif
+    delete this;
+  }
+}
@@ -0,0 +1,74 @@
+//========================================================================
+//
+// GMappedFile.h
+//
+// Read-only, reference-counted memory mapping of a file.
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef GMAPPEDFILE_H
+#define GMAPPEDFILE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <stdio.h>
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "gtypes.h"
+#include "gfile.h"
+
+//------------------------------------------------------------------------
+// GMappedFile
+//------------------------------------------------------------------------
+
+class GMappedFile {
+public:
+
+  // Map the entire contents of an open file.  The FILE is not
+  // needed after this returns (the mapping stays valid after the
+  // file is closed).  Returns NULL if the file can't be mapped --
+  // e.g., it is empty, it is not a regular file, it is too large for
+  // the address space, or memory mapping is not supported on this
+  // platform.
+  static GMappedFile *map(FILE *f);
+
+  // Map the entire contents of the file at <path>.  Returns NULL on
+  // failure.
+  static GMappedFile *map(const char *path);
+
+  // Add a reference, and return this.
+  GMappedFile *copy();
+
+  // Remove a reference.  The mapping is released when the last
+  // reference is removed.
+  void free();
+
+  // Accessors.
+  const char *getData() { return data; }
+  GFileOffset getSize() { return size; }
+
+private:
+
+  GMappedFile(char *dataA, GFileOffset sizeA);
+  ~GMappedFile();
+
+  char *data;			// start of the mapped region
+  GFileOffset size;		// size of the mapped region, in bytes
+#ifdef _WIN32
+  HANDLE mapping;		// file mapping object
+#endif
+#if MULTITHREADED
+  GAtomicCounter refCnt;
+#else
+  int refCnt;
+#endif
+};
+
+#endif
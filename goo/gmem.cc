@@ -16,6 +16,20 @@
 #  include <windows.h>
 #endif
 #include "gmem.h"
+#if MULTITHREADED
+#  include "GMutex.h"
+#endif
+
+static int gMemCounting = 0;
+static long gMemNAllocs = 0;
+static long gMemNReallocs = 0;
+static long gMemNFrees = 0;
+
+#if MULTITHREADED
+#  define gMemCount(n) if (gMemCounting) gAtomicIncrement(&n)
+#else
+#  define gMemCount(n) if (gMemCounting) ++n
+#endif
 
 #ifdef DEBUG_MEM
 
@@ -92,6 +106,7 @@ void *gmalloc(int size, int ignore) GMEM_EXCEP {
   if (size == 0) {
     return NULL;
   }
+  gMemCount(gMemNAllocs);
   size1 = gMemDataSize(size);
   if (!(mem = (char *)malloc(size1 + gMemHdrSize + gMemTrlSize))) {
     gMemError("Out of memory");
@@ -137,6 +152,7 @@ void *gmalloc(int size) GMEM_EXCEP {
   if (size == 0) {
     return NULL;
   }
+  gMemCount(gMemNAllocs);
   if (!(p = malloc(size))) {
     gMemError("Out of memory");
   }
@@ -177,13 +193,16 @@ void *grealloc(void *p, int size) GMEM_EXCEP {
   }
   if (size == 0) {
     if (p) {
+      gMemCount(gMemNFrees);
       free(p);
     }
     return NULL;
   }
   if (p) {
+    gMemCount(gMemNReallocs);
     q = realloc(p, size);
   } else {
+    gMemCount(gMemNAllocs);
     q = malloc(size);
   }
   if (!q) {
@@ -229,6 +248,7 @@ void gfree(void *p) {
   unsigned long *trl, *clr;
 
   if (p) {
+    gMemCount(gMemNFrees);
     hdr = (GMemHdr *)((char *)p - gMemHdrSize);
     gMemLock;
     if (hdr->magic == gMemMagic &&
@@ -264,6 +284,7 @@ void gfree(void *p) {
   }
 #else
   if (p) {
+    gMemCount(gMemNFrees);
     free(p);
   }
 #endif
@@ -305,6 +326,16 @@ void gMemReport(FILE *f) {
 }
 #endif
 
+void gMemSetCounting(int enable) {
+  gMemCounting = enable;
+}
+
+void gMemGetCounts(long *nAllocs, long *nReallocs, long *nFrees) {
+  *nAllocs = gMemNAllocs;
+  *nReallocs = gMemNReallocs;
+  *nFrees = gMemNFrees;
+}
+
 char *copyString(const char *s) {
   char *s1;
 
@@ -76,6 +76,15 @@ extern void gMemReport(FILE *f);
 #define gMemReport(f)
 #endif
 
+/*
+ * Allocation counting, for benchmarking.  Counting is disabled by
+ * default.  When enabled, each call to gmalloc/gmallocn, grealloc/
+ * greallocn, and gfree (with a non-NULL pointer) increments a
+ * counter.
+ */
+extern void gMemSetCounting(int enable);
+extern void gMemGetCounts(long *nAllocs, long *nReallocs, long *nFrees);
+
 /*
  * Allocate memory and copy a string into it.
  */
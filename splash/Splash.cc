@@ -29,6 +29,7 @@
 #include "SplashScreen.h"
 #include "SplashFont.h"
 #include "SplashGlyphBitmap.h"
+#include "SplashSIMD.h"
 #include "Splash.h"
 
 // the MSVC math.h doesn't define this
@@ -43,6 +44,11 @@
 #define bezierCircle ((SplashCoord)0.55228475)
 #define bezierCircle2 ((SplashCoord)(0.5 * 0.55228475))
 
+// number of pixels handled at a time by the vectorized pipe code --
+// the RGB8 color data for a block must be a multiple of
+// splashSIMDBlockBytes
+#define splashPipeBlockPixels 16
+
 // Divide a 16-bit value (in [0, 255*255]) by 255, returning an 8-bit result.
 static inline Guchar div255(int x) {
   return (Guchar)((x + (x >> 8) + 0x80) >> 8);
@@ -263,7 +269,8 @@ void Splash::pipeRun(SplashPipe *pipe, int x0, int x1, int y,
   Guchar shape, aSrc, aDest, alphaI, alphaIm1, alpha0, aResult;
   SplashColor cSrc, cDest, cBlend;
   Guchar shapeVal, cResult0, cResult1, cResult2, cResult3;
-  int cSrcStride, shapeStride, x, lastX, t;
+  int cSrcStride, shapeStride, x, lastX, t, blockX, lastIdx;
+  GBool useBlocks;
   SplashColorPtr destColorPtr;
   Guchar destColorMask;
   Guchar *destAlphaPtr;
@@ -345,8 +352,37 @@ void Splash::pipeRun(SplashPipe *pipe, int x0, int x1, int y,
     alpha0Ptr = NULL;
   }
 
+  // the vectorized code handles non-isolated groups being composited
+  // onto a backdrop which is not itself in a group
+  useBlocks = splashGetSIMDLevel() != splashSIMDNone &&
+              pipe->nonIsolatedGroup && !pipe->pattern && shapePtr &&
+              !softMaskPtr && !color0Ptr && !alpha0Ptr && destAlphaPtr &&
+              !state->blendFunc &&
+              (bitmap->mode == splashModeRGB8 ||
+	       bitmap->mode == splashModeBGR8);
+  blockX = x0;
+
   for (x = x0; x <= x1; ++x) {
 
+    //----- vectorized block
+    if (useBlocks && x >= blockX && x1 - x >= splashPipeBlockPixels - 1) {
+      if (pipeRunBlockRGB8(pipe, shapePtr2, cSrcPtr, cSrcStride,
+			   destColorPtr, destAlphaPtr,
+			   bitmap->mode == splashModeBGR8, gTrue, &lastIdx)) {
+	if (lastIdx >= 0) {
+	  lastX = x + lastIdx;
+	}
+	destColorPtr += 3 * splashPipeBlockPixels;
+	destAlphaPtr += splashPipeBlockPixels;
+	cSrcPtr += cSrcStride * splashPipeBlockPixels;
+	shapePtr2 += splashPipeBlockPixels;
+	x += splashPipeBlockPixels - 1;
+	continue;
+      }
+      // fall back to the per-pixel code for this block
+      blockX = x + splashPipeBlockPixels;
+    }
+
     //----- shape
 
     shape = *shapePtr2;
@@ -1177,7 +1213,8 @@ void Splash::pipeRunShapeRGB8(SplashPipe *pipe, int x0, int x1, int y,
   Guchar cResult0, cResult1, cResult2;
   SplashColorPtr destColorPtr;
   Guchar *destAlphaPtr;
-  int cSrcStride, x, lastX;
+  int cSrcStride, x, lastX, blockX, lastIdx;
+  GBool useBlocks;
 
   if (cSrcPtr) {
     cSrcStride = 3;
@@ -1202,8 +1239,30 @@ void Splash::pipeRunShapeRGB8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->width + x0];
 
+  useBlocks = splashGetSIMDLevel() != splashSIMDNone;
+  blockX = x0;
+
   for (x = x0; x <= x1; ++x) {
 
+    //----- vectorized block
+    if (useBlocks && x >= blockX && x1 - x >= splashPipeBlockPixels - 1) {
+      if (pipeRunBlockRGB8(pipe, shapePtr, cSrcPtr, cSrcStride,
+			   destColorPtr, destAlphaPtr, gFalse, gFalse,
+			   &lastIdx)) {
+	if (lastIdx >= 0) {
+	  lastX = x + lastIdx;
+	}
+	destColorPtr += 3 * splashPipeBlockPixels;
+	destAlphaPtr += splashPipeBlockPixels;
+	cSrcPtr += cSrcStride * splashPipeBlockPixels;
+	shapePtr += splashPipeBlockPixels;
+	x += splashPipeBlockPixels - 1;
+	continue;
+      }
+      // fall back to the per-pixel code for this block
+      blockX = x + splashPipeBlockPixels;
+    }
+
     //----- shape
     shape = *shapePtr;
     if (!shape) {
@@ -1283,7 +1342,8 @@ void Splash::pipeRunShapeBGR8(SplashPipe *pipe, int x0, int x1, int y,
   Guchar cResult0, cResult1, cResult2;
   SplashColorPtr destColorPtr;
   Guchar *destAlphaPtr;
-  int cSrcStride, x, lastX;
+  int cSrcStride, x, lastX, blockX, lastIdx;
+  GBool useBlocks;
 
   if (cSrcPtr) {
     cSrcStride = 3;
@@ -1308,8 +1368,30 @@ void Splash::pipeRunShapeBGR8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->width + x0];
 
+  useBlocks = splashGetSIMDLevel() != splashSIMDNone;
+  blockX = x0;
+
   for (x = x0; x <= x1; ++x) {
 
+    //----- vectorized block
+    if (useBlocks && x >= blockX && x1 - x >= splashPipeBlockPixels - 1) {
+      if (pipeRunBlockRGB8(pipe, shapePtr, cSrcPtr, cSrcStride,
+			   destColorPtr, destAlphaPtr, gTrue, gFalse,
+			   &lastIdx)) {
+	if (lastIdx >= 0) {
+	  lastX = x + lastIdx;
+	}
+	destColorPtr += 3 * splashPipeBlockPixels;
+	destAlphaPtr += splashPipeBlockPixels;
+	cSrcPtr += cSrcStride * splashPipeBlockPixels;
+	shapePtr += splashPipeBlockPixels;
+	x += splashPipeBlockPixels - 1;
+	continue;
+      }
+      // fall back to the per-pixel code for this block
+      blockX = x + splashPipeBlockPixels;
+    }
+
     //----- shape
     shape = *shapePtr;
     if (!shape) {
@@ -1680,7 +1762,8 @@ void Splash::pipeRunAARGB8(SplashPipe *pipe, int x0, int x1, int y,
   Guchar cResult0, cResult1, cResult2;
   SplashColorPtr destColorPtr;
   Guchar *destAlphaPtr;
-  int cSrcStride, x, lastX;
+  int cSrcStride, x, lastX, blockX, lastIdx;
+  GBool useBlocks;
 
   if (cSrcPtr) {
     cSrcStride = 3;
@@ -1705,8 +1788,30 @@ void Splash::pipeRunAARGB8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->width + x0];
 
+  useBlocks = splashGetSIMDLevel() != splashSIMDNone;
+  blockX = x0;
+
   for (x = x0; x <= x1; ++x) {
 
+    //----- vectorized block
+    if (useBlocks && x >= blockX && x1 - x >= splashPipeBlockPixels - 1) {
+      if (pipeRunBlockRGB8(pipe, shapePtr, cSrcPtr, cSrcStride,
+			   destColorPtr, destAlphaPtr, gFalse, gFalse,
+			   &lastIdx)) {
+	if (lastIdx >= 0) {
+	  lastX = x + lastIdx;
+	}
+	destColorPtr += 3 * splashPipeBlockPixels;
+	destAlphaPtr += splashPipeBlockPixels;
+	cSrcPtr += cSrcStride * splashPipeBlockPixels;
+	shapePtr += splashPipeBlockPixels;
+	x += splashPipeBlockPixels - 1;
+	continue;
+      }
+      // fall back to the per-pixel code for this block
+      blockX = x + splashPipeBlockPixels;
+    }
+
     //----- shape
     shape = *shapePtr;
     if (!shape) {
@@ -1774,7 +1879,8 @@ void Splash::pipeRunAABGR8(SplashPipe *pipe, int x0, int x1, int y,
   Guchar cResult0, cResult1, cResult2;
   SplashColorPtr destColorPtr;
   Guchar *destAlphaPtr;
-  int cSrcStride, x, lastX;
+  int cSrcStride, x, lastX, blockX, lastIdx;
+  GBool useBlocks;
 
   if (cSrcPtr) {
     cSrcStride = 3;
@@ -1799,8 +1905,30 @@ void Splash::pipeRunAABGR8(SplashPipe *pipe, int x0, int x1, int y,
   destColorPtr = &bitmap->data[y * bitmap->rowSize + 3 * x0];
   destAlphaPtr = &bitmap->alpha[y * bitmap->width + x0];
 
+  useBlocks = splashGetSIMDLevel() != splashSIMDNone;
+  blockX = x0;
+
   for (x = x0; x <= x1; ++x) {
 
+    //----- vectorized block
+    if (useBlocks && x >= blockX && x1 - x >= splashPipeBlockPixels - 1) {
+      if (pipeRunBlockRGB8(pipe, shapePtr, cSrcPtr, cSrcStride,
+			   destColorPtr, destAlphaPtr, gTrue, gFalse,
+			   &lastIdx)) {
+	if (lastIdx >= 0) {
+	  lastX = x + lastIdx;
+	}
+	destColorPtr += 3 * splashPipeBlockPixels;
+	destAlphaPtr += splashPipeBlockPixels;
+	cSrcPtr += cSrcStride * splashPipeBlockPixels;
+	shapePtr += splashPipeBlockPixels;
+	x += splashPipeBlockPixels - 1;
+	continue;
+      }
+      // fall back to the per-pixel code for this block
+      blockX = x + splashPipeBlockPixels;
+    }
+
     //----- shape
     shape = *shapePtr;
     if (!shape) {
@@ -1972,6 +2100,91 @@ void Splash::pipeRunAACMYK8(SplashPipe *pipe, int x0, int x1, int y,
 }
 #endif
 
+// Composite a block of splashPipeBlockPixels pixels in RGB8 or BGR8
+// mode with the vectorized kernels.  This handles the cases that
+// reduce to uniform arithmetic across the block: zero shape (nothing
+// to do), opaque source (copy), and opaque destination (source-over
+// blend, with the same integer arithmetic as the per-pixel code).
+// Returns false, without touching the destination, for anything
+// else.  Sets *<lastIdx> to the index of the last pixel with nonzero
+// shape, or -1 if there are none.
+GBool Splash::pipeRunBlockRGB8(SplashPipe *pipe, Guchar *shapePtr,
+			       SplashColorPtr cSrcPtr, int cSrcStride,
+			       SplashColorPtr destColorPtr,
+			       Guchar *destAlphaPtr,
+			       GBool bgr, GBool nonIsolated, int *lastIdx) {
+  Guchar srcBuf[3 * splashPipeBlockPixels];
+  Guchar alphaBuf[3 * splashPipeBlockPixels];
+  Guchar shape, shapeOr, shapeAnd, aDestAnd, aSrc;
+  SplashColorPtr p;
+  GBool opaqueSrc;
+  int i;
+
+  //----- shape
+  shapeOr = 0;
+  shapeAnd = 0xff;
+  *lastIdx = -1;
+  for (i = 0; i < splashPipeBlockPixels; ++i) {
+    shape = shapePtr[i];
+    if (shape) {
+      // the non-isolated group correction is a no-op only for full
+      // shape (on an opaque backdrop)
+      if (nonIsolated && shape != 255) {
+	return gFalse;
+      }
+      *lastIdx = i;
+    }
+    shapeOr |= shape;
+    shapeAnd &= shape;
+  }
+  if (!shapeOr) {
+    return gTrue;
+  }
+
+  //----- destination alpha
+  opaqueSrc = pipe->aInput == 255 && shapeAnd == 255;
+  if (!opaqueSrc) {
+    aDestAnd = 0xff;
+    for (i = 0; i < splashPipeBlockPixels; ++i) {
+      aDestAnd &= destAlphaPtr[i];
+    }
+    if (aDestAnd != 0xff) {
+      return gFalse;
+    }
+  }
+
+  //----- source color
+  for (i = 0, p = cSrcPtr; i < splashPipeBlockPixels; ++i, p += cSrcStride) {
+    if (bgr) {
+      srcBuf[3*i] = state->rgbTransferB[p[2]];
+      srcBuf[3*i + 1] = state->rgbTransferG[p[1]];
+      srcBuf[3*i + 2] = state->rgbTransferR[p[0]];
+    } else {
+      srcBuf[3*i] = state->rgbTransferR[p[0]];
+      srcBuf[3*i + 1] = state->rgbTransferG[p[1]];
+      srcBuf[3*i + 2] = state->rgbTransferB[p[2]];
+    }
+  }
+
+  //----- opaque source: aResult = 255, cResult = cSrc
+  if (opaqueSrc) {
+    memcpy(destColorPtr, srcBuf, 3 * splashPipeBlockPixels);
+    memset(destAlphaPtr, 0xff, splashPipeBlockPixels);
+    return gTrue;
+  }
+
+  //----- opaque destination: aResult = alphaI = 255
+  // (div255(255 * shape) = shape, so this also covers the shape-only
+  // pipes, where aSrc = shape)
+  for (i = 0; i < splashPipeBlockPixels; ++i) {
+    aSrc = div255(pipe->aInput * shapePtr[i]);
+    alphaBuf[3*i] = alphaBuf[3*i + 1] = alphaBuf[3*i + 2] = aSrc;
+  }
+  splashBlendOpaque(destColorPtr, srcBuf, alphaBuf,
+		    3 * splashPipeBlockPixels);
+  return gTrue;
+}
+
 
 //------------------------------------------------------------------------
 
@@ -3327,7 +3540,8 @@ void Splash::getImageBounds(SplashCoord xyMin, SplashCoord xyMax,
 // stroke adjustment behavior is changed.
 SplashError Splash::fillImageMask(SplashImageMaskSource src, void *srcData,
 				  int w, int h, SplashCoord *mat,
-				  GBool glyphMode, GBool interpolate) {
+				  GBool glyphMode, GBool interpolate,
+				  SplashImageMaskSpanSource spanSrc) {
   SplashBitmap *scaledMask;
   SplashClipResult clipRes;
   GBool minorAxisZero;
@@ -3377,8 +3591,8 @@ SplashError Splash::fillImageMask(SplashImageMaskSource src, void *srcData,
     if (clipRes != splashClipAllOutside) {
       scaledWidth = x1 - x0;
       scaledHeight = y1 - y0;
-      scaledMask = scaleMask(src, srcData, w, h, scaledWidth, scaledHeight,
-			     interpolate);
+      scaledMask = scaleMask(src, srcData, spanSrc, w, h,
+			     scaledWidth, scaledHeight, interpolate);
       blitMask(scaledMask, x0, y0, clipRes);
       delete scaledMask;
     }
@@ -3393,8 +3607,8 @@ SplashError Splash::fillImageMask(SplashImageMaskSource src, void *srcData,
     if (clipRes != splashClipAllOutside) {
       scaledWidth = x1 - x0;
       scaledHeight = y1 - y0;
-      scaledMask = scaleMask(src, srcData, w, h, scaledWidth, scaledHeight,
-			     interpolate);
+      scaledMask = scaleMask(src, srcData, spanSrc, w, h,
+			     scaledWidth, scaledHeight, interpolate);
       vertFlipImage(scaledMask, scaledWidth, scaledHeight, 1);
       blitMask(scaledMask, x0, y0, clipRes);
       delete scaledMask;
@@ -3410,8 +3624,8 @@ SplashError Splash::fillImageMask(SplashImageMaskSource src, void *srcData,
     if (clipRes != splashClipAllOutside) {
       scaledWidth = x1 - x0;
       scaledHeight = y1 - y0;
-      scaledMask = scaleMask(src, srcData, w, h, scaledWidth, scaledHeight,
-			     interpolate);
+      scaledMask = scaleMask(src, srcData, spanSrc, w, h,
+			     scaledWidth, scaledHeight, interpolate);
       horizFlipImage(scaledMask, scaledWidth, scaledHeight, 1);
       blitMask(scaledMask, x0, y0, clipRes);
       delete scaledMask;
@@ -3427,8 +3641,8 @@ SplashError Splash::fillImageMask(SplashImageMaskSource src, void *srcData,
     if (clipRes != splashClipAllOutside) {
       scaledWidth = x1 - x0;
       scaledHeight = y1 - y0;
-      scaledMask = scaleMask(src, srcData, w, h, scaledWidth, scaledHeight,
-			     interpolate);
+      scaledMask = scaleMask(src, srcData, spanSrc, w, h,
+			     scaledWidth, scaledHeight, interpolate);
       vertFlipImage(scaledMask, scaledWidth, scaledHeight, 1);
       horizFlipImage(scaledMask, scaledWidth, scaledHeight, 1);
       blitMask(scaledMask, x0, y0, clipRes);
@@ -3437,7 +3651,8 @@ SplashError Splash::fillImageMask(SplashImageMaskSource src, void *srcData,
 
   // all other cases
   } else {
-    arbitraryTransformMask(src, srcData, w, h, mat, glyphMode, interpolate);
+    arbitraryTransformMask(src, srcData, spanSrc, w, h, mat,
+			   glyphMode, interpolate);
   }
 
   return splashOk;
@@ -3611,6 +3826,7 @@ void Splash::upscaleMask(SplashImageMaskSource src, void *srcData,
 // The glyphMode flag is not currently used, but may be useful if the
 // stroke adjustment behavior is changed.
 void Splash::arbitraryTransformMask(SplashImageMaskSource src, void *srcData,
+				    SplashImageMaskSpanSource spanSrc,
 				    int srcWidth, int srcHeight,
 				    SplashCoord *mat, GBool glyphMode,
 				    GBool interpolate) {
@@ -3703,7 +3919,7 @@ void Splash::arbitraryTransformMask(SplashImageMaskSource src, void *srcData,
   ir11 = r00 / det;
 
   // scale the input image
-  scaledMask = scaleMask(src, srcData, srcWidth, srcHeight,
+  scaledMask = scaleMask(src, srcData, spanSrc, srcWidth, srcHeight,
 			 scaledWidth, scaledHeight, interpolate);
 
   // construct the three sections
@@ -3882,6 +4098,7 @@ void Splash::arbitraryTransformMask(SplashImageMaskSource src, void *srcData,
 
 // Scale an image mask into a SplashBitmap.
 SplashBitmap *Splash::scaleMask(SplashImageMaskSource src, void *srcData,
+				SplashImageMaskSpanSource spanSrc,
 				int srcWidth, int srcHeight,
 				int scaledWidth, int scaledHeight,
 				GBool interpolate) {
@@ -3891,10 +4108,10 @@ SplashBitmap *Splash::scaleMask(SplashImageMaskSource src, void *srcData,
 			  gFalse);
   if (scaledHeight < srcHeight) {
     if (scaledWidth < srcWidth) {
-      scaleMaskYdXd(src, srcData, srcWidth, srcHeight,
+      scaleMaskYdXd(src, srcData, spanSrc, srcWidth, srcHeight,
 		    scaledWidth, scaledHeight, dest);
     } else {
-      scaleMaskYdXu(src, srcData, srcWidth, srcHeight,
+      scaleMaskYdXu(src, srcData, spanSrc, srcWidth, srcHeight,
 		    scaledWidth, scaledHeight, dest);
     }
   } else {
@@ -3915,6 +4132,7 @@ SplashBitmap *Splash::scaleMask(SplashImageMaskSource src, void *srcData,
 }
 
 void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
+			   SplashImageMaskSpanSource spanSrc,
 			   int srcWidth, int srcHeight,
 			   int scaledWidth, int scaledHeight,
 			   SplashBitmap *dest) {
@@ -3922,8 +4140,9 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
   Guint *pixBuf;
   Guint pix;
   Guchar *destPtr;
+  int *boxStart, *srcBox, *spans;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, xx, d, d0, d1;
-  int i, j;
+  int nSpans, x0, x1, b0, b1, i, j;
 
   // Bresenham parameters for y scale
   yp = srcHeight / scaledHeight;
@@ -3937,6 +4156,30 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
   lineBuf = (Guchar *)gmalloc(srcWidth);
   pixBuf = (Guint *)gmallocn(srcWidth, sizeof(int));
 
+  // with a span source, the spans are added directly into per-box
+  // sums (in pixBuf): compute the x range of each box (boxStart), and
+  // the box containing each source pixel (srcBox)
+  boxStart = srcBox = NULL;
+  if (spanSrc) {
+    boxStart = (int *)gmallocn(scaledWidth + 1, sizeof(int));
+    srcBox = (int *)gmallocn(srcWidth, sizeof(int));
+    xt = 0;
+    xx = 0;
+    for (x = 0; x < scaledWidth; ++x) {
+      if ((xt += xq) >= scaledWidth) {
+	xt -= scaledWidth;
+	xStep = xp + 1;
+      } else {
+	xStep = xp;
+      }
+      boxStart[x] = xx;
+      for (i = 0; i < xStep; ++i) {
+	srcBox[xx++] = x;
+      }
+    }
+    boxStart[scaledWidth] = xx;
+  }
+
   // init y scale Bresenham
   yt = 0;
 
@@ -3952,11 +4195,33 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
     }
 
     // read rows from image
-    memset(pixBuf, 0, srcWidth * sizeof(int));
-    for (i = 0; i < yStep; ++i) {
-      (*src)(srcData, lineBuf);
-      for (j = 0; j < srcWidth; ++j) {
-	pixBuf[j] += lineBuf[j];
+    if (spanSrc) {
+      memset(pixBuf, 0, scaledWidth * sizeof(int));
+      for (i = 0; i < yStep; ++i) {
+	(*spanSrc)(srcData, &spans, &nSpans);
+	for (j = 0; j < nSpans; ++j) {
+	  x0 = spans[2*j];
+	  x1 = spans[2*j + 1];
+	  b0 = srcBox[x0];
+	  b1 = srcBox[x1 - 1];
+	  if (b0 == b1) {
+	    pixBuf[b0] += x1 - x0;
+	  } else {
+	    pixBuf[b0] += boxStart[b0 + 1] - x0;
+	    for (++b0; b0 < b1; ++b0) {
+	      pixBuf[b0] += boxStart[b0 + 1] - boxStart[b0];
+	    }
+	    pixBuf[b1] += x1 - boxStart[b1];
+	  }
+	}
+      }
+    } else {
+      memset(pixBuf, 0, srcWidth * sizeof(int));
+      for (i = 0; i < yStep; ++i) {
+	(*src)(srcData, lineBuf);
+	for (j = 0; j < srcWidth; ++j) {
+	  pixBuf[j] += lineBuf[j];
+	}
       }
     }
 
@@ -3979,9 +4244,13 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
       }
 
       // compute the final pixel
-      pix = 0;
-      for (i = 0; i < xStep; ++i) {
-	pix += pixBuf[xx++];
+      if (spanSrc) {
+	pix = pixBuf[x];
+      } else {
+	pix = 0;
+	for (i = 0; i < xStep; ++i) {
+	  pix += pixBuf[xx++];
+	}
       }
       // (255 * pix) / xStep * yStep
       pix = (pix * d) >> 23;
@@ -3991,11 +4260,14 @@ void Splash::scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
     }
   }
 
+  gfree(srcBox);
+  gfree(boxStart);
   gfree(pixBuf);
   gfree(lineBuf);
 }
 
 void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
+			   SplashImageMaskSpanSource spanSrc,
 			   int srcWidth, int srcHeight,
 			   int scaledWidth, int scaledHeight,
 			   SplashBitmap *dest) {
@@ -4003,8 +4275,9 @@ void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
   Guint *pixBuf;
   Guint pix;
   Guchar *destPtr;
+  int *spans;
   int yp, yq, xp, xq, yt, y, yStep, xt, x, xStep, d;
-  int i, j;
+  int nSpans, i, j;
 
   // Bresenham parameters for y scale
   yp = srcHeight / scaledHeight;
@@ -4016,7 +4289,7 @@ void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
 
   // allocate buffers
   lineBuf = (Guchar *)gmalloc(srcWidth);
-  pixBuf = (Guint *)gmallocn(srcWidth, sizeof(int));
+  pixBuf = (Guint *)gmallocn(srcWidth + 1, sizeof(int));
 
   // init y scale Bresenham
   yt = 0;
@@ -4032,12 +4305,27 @@ void Splash::scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
       yStep = yp;
     }
 
-    // read rows from image
-    memset(pixBuf, 0, srcWidth * sizeof(int));
-    for (i = 0; i < yStep; ++i) {
-      (*src)(srcData, lineBuf);
-      for (j = 0; j < srcWidth; ++j) {
-	pixBuf[j] += lineBuf[j];
+    // read rows from image -- with a span source, accumulate the
+    // differences at span boundaries, and then integrate
+    if (spanSrc) {
+      memset(pixBuf, 0, (srcWidth + 1) * sizeof(int));
+      for (i = 0; i < yStep; ++i) {
+	(*spanSrc)(srcData, &spans, &nSpans);
+	for (j = 0; j < nSpans; ++j) {
+	  ++pixBuf[spans[2*j]];
+	  --pixBuf[spans[2*j + 1]];
+	}
+      }
+      for (j = 1; j < srcWidth; ++j) {
+	pixBuf[j] += pixBuf[j - 1];
+      }
+    } else {
+      memset(pixBuf, 0, srcWidth * sizeof(int));
+      for (i = 0; i < yStep; ++i) {
+	(*src)(srcData, lineBuf);
+	for (j = 0; j < srcWidth; ++j) {
+	  pixBuf[j] += lineBuf[j];
+	}
       }
     }
 
@@ -6317,7 +6605,11 @@ void Splash::compositeBackground(SplashColorPtr color) {
 #if SPLASH_CMYK
   Guchar color3;
 #endif
-  int x, y, mask;
+  Guchar bgBuf[3 * splashPipeBlockPixels];
+  Guchar alphaBuf[3 * splashPipeBlockPixels];
+  Guchar alphaAnd;
+  GBool useBlocks;
+  int x, y, mask, i;
 
   switch (bitmap->mode) {
   case splashModeMono1:
@@ -6373,10 +6665,33 @@ void Splash::compositeBackground(SplashColorPtr color) {
     color0 = color[0];
     color1 = color[1];
     color2 = color[2];
+    useBlocks = splashGetSIMDLevel() != splashSIMDNone;
+    for (i = 0; i < splashPipeBlockPixels; ++i) {
+      bgBuf[3*i] = color0;
+      bgBuf[3*i + 1] = color1;
+      bgBuf[3*i + 2] = color2;
+    }
     for (y = 0; y < bitmap->height; ++y) {
       p = &bitmap->data[y * bitmap->rowSize];
       q = &bitmap->alpha[y * bitmap->width];
       for (x = 0; x < bitmap->width; ++x) {
+	// vectorized block -- div255(255 * c) = c, so the general
+	// formula also handles alpha = 0 and alpha = 255
+	if (useBlocks && bitmap->width - x >= splashPipeBlockPixels) {
+	  alphaAnd = 0xff;
+	  for (i = 0; i < splashPipeBlockPixels; ++i) {
+	    alphaAnd &= q[i];
+	    alphaBuf[3*i] = alphaBuf[3*i + 1] = alphaBuf[3*i + 2] = q[i];
+	  }
+	  if (alphaAnd != 0xff) {
+	    splashBlendBackground(p, bgBuf, alphaBuf,
+				  3 * splashPipeBlockPixels);
+	  }
+	  p += 3 * splashPipeBlockPixels;
+	  q += splashPipeBlockPixels;
+	  x += splashPipeBlockPixels - 1;
+	  continue;
+	}
 	alpha = *q++;
 	if (alpha == 0) {
 	  p[0] = color0;
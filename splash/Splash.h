@@ -36,6 +36,14 @@ struct SplashPipe;
 // exhausted, returns false.
 typedef GBool (*SplashImageMaskSource)(void *data, SplashColorPtr pixel);
 
+// Retrieves the next line of pixels in an image mask, as a list of
+// spans of set pixels: [(*<spans>)[0], (*<spans>)[1]),
+// [(*<spans>)[2], (*<spans>)[3]), etc., in increasing order, with
+// *<nSpans> spans.  All other pixels are clear.  If the image stream
+// is exhausted, sets *<nSpans> to zero and returns false.
+typedef GBool (*SplashImageMaskSpanSource)(void *data, int **spans,
+					   int *nSpans);
+
 // Retrieves the next line of pixels in an image.  Normally, fills in
 // *<line> and returns true.  If the image stream is exhausted,
 // returns false.
@@ -171,10 +179,13 @@ public:
   //    [x' y' 1] = [x y 1] * mat
   // Note that the Splash y axis points downward, and the image source
   // is assumed to produce pixels in raster order, starting from the
-  // top line.
+  // top line.  If <spanSrc> is non-NULL, it provides the same lines
+  // as <src> (sharing <srcData>), in run-length form -- each line is
+  // read from one or the other.
   SplashError fillImageMask(SplashImageMaskSource src, void *srcData,
 			    int w, int h, SplashCoord *mat,
-			    GBool glyphMode, GBool interpolate);
+			    GBool glyphMode, GBool interpolate,
+			    SplashImageMaskSpanSource spanSrc = NULL);
 
   // Draw an image.  This will read <h> lines of <w> pixels from
   // <src>, starting with the top line.  These pixels are assumed to
@@ -301,6 +312,10 @@ private:
   void pipeRunAACMYK8(SplashPipe *pipe, int x0, int x1, int y,
 		      Guchar *shapePtr, SplashColorPtr cSrcPtr);
 #endif
+  GBool pipeRunBlockRGB8(SplashPipe *pipe, Guchar *shapePtr,
+			 SplashColorPtr cSrcPtr, int cSrcStride,
+			 SplashColorPtr destColorPtr, Guchar *destAlphaPtr,
+			 GBool bgr, GBool nonIsolated, int *lastIdx);
   void transform(SplashCoord *matrix, SplashCoord xi, SplashCoord yi,
 		 SplashCoord *xo, SplashCoord *yo);
   void updateModX(int x);
@@ -330,18 +345,22 @@ private:
 		   SplashCoord *mat, GBool glyphMode,
 		   GBool interpolate);
   void arbitraryTransformMask(SplashImageMaskSource src, void *srcData,
+			      SplashImageMaskSpanSource spanSrc,
 			      int srcWidth, int srcHeight,
 			      SplashCoord *mat, GBool glyphMode,
 			      GBool interpolate);
   SplashBitmap *scaleMask(SplashImageMaskSource src, void *srcData,
+			  SplashImageMaskSpanSource spanSrc,
 			  int srcWidth, int srcHeight,
 			  int scaledWidth, int scaledHeight,
 			  GBool interpolate);
   void scaleMaskYdXd(SplashImageMaskSource src, void *srcData,
+		     SplashImageMaskSpanSource spanSrc,
 		     int srcWidth, int srcHeight,
 		     int scaledWidth, int scaledHeight,
 		     SplashBitmap *dest);
   void scaleMaskYdXu(SplashImageMaskSource src, void *srcData,
+		     SplashImageMaskSpanSource spanSrc,
 		     int srcWidth, int srcHeight,
 		     int scaledWidth, int scaledHeight,
 		     SplashBitmap *dest);
@@ -24,6 +24,32 @@
 
 //------------------------------------------------------------------------
 
+// Number of rows in each band of a clip mask.
+#define splashClipMaskBandHeight 16
+
+// A band of the clip mask is rasterized once this many spans have been
+// clipped (the slow way) in the band -- i.e., after roughly one fill
+// has covered the band.
+#define splashClipMaskMinHits splashClipMaskBandHeight
+
+// Max amount of memory used by the clip masks of a clip and all of the
+// saved clips in its prev chain (each of which can hold an AA and a
+// binary mask).  Past this, spans are clipped the slow way.
+#define splashClipMaskMaxBytes (32 * 1024 * 1024)
+
+//------------------------------------------------------------------------
+
+struct SplashClipMask {
+  Guchar **bands;		// mask bands (NULL if not rasterized yet)
+  int *hits;			// number of spans clipped in each band
+				//   (while it isn't rasterized)
+  int nBands;			// number of bands
+  int w;			// width of the mask
+  int nBytes;			// memory used by the rasterized bands
+};
+
+//------------------------------------------------------------------------
+
 // Compute x * y / 255, where x and y are in [0, 255].
 static inline Guchar mul255(Guchar x, Guchar y) {
   int z;
@@ -55,6 +81,7 @@ SplashClip::SplashClip(int hardXMinA, int hardYMinA,
   length = size = 0;
   isSimple = gTrue;
   prev = NULL;
+  mask = maskBinary = NULL;
   if ((w = hardXMax + 1) <= 0) {
     w = 1;
   }
@@ -84,6 +111,7 @@ SplashClip::SplashClip(SplashClip *clip) {
   length = size = 0;
   isSimple = clip->isSimple;
   prev = clip;
+  mask = maskBinary = NULL;
   if ((w = splashCeil(xMax)) <= 0) {
     w = 1;
   }
@@ -101,6 +129,7 @@ SplashClip::~SplashClip() {
   gfree(eo);
   gfree(scanners);
   gfree(buf);
+  freeMasks();
 }
 
 void SplashClip::grow(int nPaths) {
@@ -122,6 +151,7 @@ void SplashClip::resetToRect(SplashCoord x0, SplashCoord y0,
 			     SplashCoord x1, SplashCoord y1) {
   int w, i;
 
+  freeMasks();
   for (i = 0; i < length; ++i) {
     delete paths[i];
     delete scanners[i];
@@ -160,6 +190,7 @@ void SplashClip::resetToRect(SplashCoord x0, SplashCoord y0,
 
 SplashError SplashClip::clipToRect(SplashCoord x0, SplashCoord y0,
 				   SplashCoord x1, SplashCoord y1) {
+  freeMasks();
   if (x0 < x1) {
     if (x0 > xMin) {
       xMin = x0;
@@ -208,6 +239,7 @@ SplashError SplashClip::clipToPath(SplashPath *path, SplashCoord *matrix,
   SplashXPath *xPath;
   SplashCoord t;
 
+  freeMasks();
   xPath = new SplashXPath(path, matrix, flatness, gTrue,
 			  enablePathSimplification,
 			  strokeAdjust);
@@ -308,6 +340,7 @@ void SplashClip::clipSpan(Guchar *line, int y, int x0, int x1,
 			  SplashStrokeAdjustMode strokeAdjust) {
   SplashClip *clip;
   SplashCoord d;
+  Guchar *maskRow;
   int x0a, x1a, x0b, x1b, x, i;
 
   updateIntBounds(strokeAdjust);
@@ -378,6 +411,13 @@ void SplashClip::clipSpan(Guchar *line, int y, int x0, int x1,
 
   //--- clip to the paths
 
+  if ((maskRow = getMaskRow(y, gFalse))) {
+    for (x = x0a; x <= x1a; ++x) {
+      line[x] = mul255(line[x], maskRow[x - xMinI]);
+    }
+    return;
+  }
+
   for (clip = this; clip; clip = clip->prev) {
     for (i = 0; i < clip->length; ++i) {
       clip->scanners[i]->getSpan(buf, y, x0a, x1a, &x0b, &x1b);
@@ -397,6 +437,7 @@ void SplashClip::clipSpan(Guchar *line, int y, int x0, int x1,
 GBool SplashClip::clipSpanBinary(Guchar *line, int y, int x0, int x1,
 				 SplashStrokeAdjustMode strokeAdjust) {
   SplashClip *clip;
+  Guchar *maskRow;
   int x0a, x1a, x0b, x1b, x, i;
   Guchar any;
 
@@ -438,6 +479,14 @@ GBool SplashClip::clipSpanBinary(Guchar *line, int y, int x0, int x1,
   }
 
   any = 0;
+  if ((maskRow = getMaskRow(y, gTrue))) {
+    for (x = x0a; x <= x1a; ++x) {
+      line[x] &= maskRow[x - xMinI];
+      any |= line[x];
+    }
+    return any != 0;
+  }
+
   for (clip = this; clip; clip = clip->prev) {
     for (i = 0; i < clip->length; ++i) {
       clip->scanners[i]->getSpanBinary(buf, y, x0a, x1a, &x0b, &x1b);
@@ -519,3 +568,128 @@ void SplashClip::updateIntBounds(SplashStrokeAdjustMode strokeAdjust) {
   intBoundsValid = gTrue;
   intBoundsStrokeAdjust = strokeAdjust;
 }
+
+// Return row <y> of the (AA or binary) clip mask, or NULL if that part
+// of the mask hasn't been rasterized.  The returned row starts at
+// xMinI.  NB: this must only be called for non-simple clips, after
+// updateIntBounds.
+Guchar *SplashClip::getMaskRow(int y, GBool binary) {
+  SplashClipMask *m;
+  int band;
+
+  m = binary ? maskBinary : mask;
+  if (!m) {
+    m = new SplashClipMask;
+    m->w = xMaxI - xMinI + 1;
+    m->nBands = (yMaxI - yMinI + splashClipMaskBandHeight)
+                / splashClipMaskBandHeight;
+    m->bands = (Guchar **)gmallocn(m->nBands, sizeof(Guchar *));
+    m->hits = (int *)gmallocn(m->nBands, sizeof(int));
+    memset(m->bands, 0, m->nBands * sizeof(Guchar *));
+    memset(m->hits, 0, m->nBands * sizeof(int));
+    m->nBytes = 0;
+    if (binary) {
+      maskBinary = m;
+    } else {
+      mask = m;
+    }
+  }
+  band = (y - yMinI) / splashClipMaskBandHeight;
+  if (!m->bands[band]) {
+    if (++m->hits[band] <= splashClipMaskMinHits ||
+	m->w > (splashClipMaskMaxBytes - getMaskBytes())
+	       / splashClipMaskBandHeight) {
+      return NULL;
+    }
+    rasterizeMaskBand(m, band, binary);
+  }
+  return m->bands[band]
+         + (y - yMinI - band * splashClipMaskBandHeight) * m->w;
+}
+
+// Rasterize one band of a clip mask, by running each of the paths'
+// scanners over the full width of the clip region.
+void SplashClip::rasterizeMaskBand(SplashClipMask *m, int band,
+				   GBool binary) {
+  SplashClip *clip;
+  Guchar *p;
+  GBool empty;
+  int y, yEnd, x0b, x1b, x, i;
+
+  m->bands[band] = (Guchar *)gmallocn(splashClipMaskBandHeight, m->w);
+  m->nBytes += splashClipMaskBandHeight * m->w;
+  y = yMinI + band * splashClipMaskBandHeight;
+  yEnd = y + splashClipMaskBandHeight - 1;
+  if (yEnd > yMaxI) {
+    yEnd = yMaxI;
+  }
+  for (p = m->bands[band]; y <= yEnd; ++y, p += m->w) {
+    memset(p, 0xff, m->w);
+    empty = gFalse;
+    for (clip = this; clip && !empty; clip = clip->prev) {
+      for (i = 0; i < clip->length; ++i) {
+	if (binary) {
+	  clip->scanners[i]->getSpanBinary(buf, y, xMinI, xMaxI, &x0b, &x1b);
+	} else {
+	  clip->scanners[i]->getSpan(buf, y, xMinI, xMaxI, &x0b, &x1b);
+	}
+	if (x0b > x1b) {
+	  memset(p, 0, m->w);
+	  empty = gTrue;
+	  break;
+	}
+	if (xMinI < x0b) {
+	  memset(p, 0, x0b - xMinI);
+	}
+	if (binary) {
+	  for (x = x0b; x <= x1b; ++x) {
+	    p[x - xMinI] &= buf[x];
+	  }
+	} else {
+	  for (x = x0b; x <= x1b; ++x) {
+	    p[x - xMinI] = mul255(p[x - xMinI], buf[x]);
+	  }
+	}
+	if (x1b < xMaxI) {
+	  memset(p + (x1b - xMinI) + 1, 0, xMaxI - x1b);
+	}
+      }
+    }
+  }
+}
+
+// Return the memory used by the clip masks of this clip and the saved
+// clips in its prev chain.
+int SplashClip::getMaskBytes() {
+  SplashClip *clip;
+  int n;
+
+  n = 0;
+  for (clip = this; clip; clip = clip->prev) {
+    if (clip->mask) {
+      n += clip->mask->nBytes;
+    }
+    if (clip->maskBinary) {
+      n += clip->maskBinary->nBytes;
+    }
+  }
+  return n;
+}
+
+void SplashClip::freeMasks() {
+  SplashClipMask *m;
+  int i, j;
+
+  for (j = 0; j < 2; ++j) {
+    m = j ? maskBinary : mask;
+    if (m) {
+      for (i = 0; i < m->nBands; ++i) {
+	gfree(m->bands[i]);
+      }
+      gfree(m->bands);
+      gfree(m->hits);
+      delete m;
+    }
+  }
+  mask = maskBinary = NULL;
+}
@@ -22,6 +22,7 @@ class SplashPath;
 class SplashXPath;
 class SplashXPathScanner;
 class SplashBitmap;
+struct SplashClipMask;
 
 //------------------------------------------------------------------------
 
@@ -105,6 +106,10 @@ private:
   SplashClip(SplashClip *clip);
   void grow(int nPaths);
   void updateIntBounds(SplashStrokeAdjustMode strokeAdjust);
+  Guchar *getMaskRow(int y, GBool binary);
+  void rasterizeMaskBand(SplashClipMask *m, int band, GBool binary);
+  int getMaskBytes();
+  void freeMasks();
 
   int hardXMin, hardYMin,	// coordinates cannot fall outside of
       hardXMax, hardYMax;	//   [hardXMin, hardXMax), [hardYMin, hardYMax)
@@ -125,6 +130,14 @@ private:
   GBool isSimple;
   SplashClip *prev;
   Guchar *buf;
+
+  // Cached coverage of all the paths (including those in <prev>),
+  // covering [xMinI, xMaxI] x [yMinI, yMaxI], for clipSpan and
+  // clipSpanBinary.  These are rasterized lazily, in bands, and are
+  // discarded whenever the clip changes.  The masks of the whole prev
+  // chain share one memory limit.
+  SplashClipMask *mask;
+  SplashClipMask *maskBinary;
 };
 
 #endif
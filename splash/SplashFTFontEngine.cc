@@ -15,6 +15,8 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #ifndef _WIN32
 #  include <unistd.h>
 #endif
@@ -24,6 +26,7 @@
 #include "gfile.h"
 #include "FoFiTrueType.h"
 #include "FoFiType1C.h"
+#include "SplashFontFile.h"
 #include "SplashFTFontFile.h"
 #include "SplashFTFontEngine.h"
 #include FT_MODULE_H
@@ -39,15 +42,75 @@ extern "C" int unlink(char *filename);
 
 //------------------------------------------------------------------------
 
-static void fileWrite(void *stream, const char *data, int len) {
-  fwrite(data, 1, len, (FILE *)stream);
+// Converted font programs are written in the same form as the
+// original: a temporary file for file-based fonts, or a gmalloc'ed
+// buffer for in-memory fonts.
+struct SplashFTFontWriter {
+  GString *tmpFileName;
+  FILE *tmpFile;
+  char *buf;
+  int len;
+  int size;
+};
+
+static GBool openFontWriter(SplashFontSrc *src, SplashFTFontWriter *w) {
+  w->tmpFileName = NULL;
+  w->tmpFile = NULL;
+  w->buf = NULL;
+  w->len = w->size = 0;
+  if (src->isFile()) {
+    return openTempFile(&w->tmpFileName, &w->tmpFile, "wb", NULL);
+  }
+  return gTrue;
 }
 
-#if LOAD_FONTS_FROM_MEM
-static void gstringWrite(void *stream, const char *data, int len) {
-  ((GString *)stream)->append(data, len);
+static void fontWriterWrite(void *stream, const char *data, int len) {
+  SplashFTFontWriter *w;
+
+  w = (SplashFTFontWriter *)stream;
+  if (w->tmpFile) {
+    fwrite(data, 1, len, w->tmpFile);
+    return;
+  }
+  if (len > w->size - w->len) {
+    if (len > INT_MAX - w->len) {
+      return;
+    }
+    if (w->size == 0) {
+      w->size = 4096;
+    }
+    while (w->size < w->len + len) {
+      w->size = w->size <= INT_MAX / 2 ? 2 * w->size : INT_MAX;
+    }
+    w->buf = (char *)grealloc(w->buf, w->size);
+  }
+  memcpy(w->buf + w->len, data, len);
+  w->len += len;
+}
+
+// Finish writing, and return the new font source.
+static SplashFontSrc *closeFontWriter(SplashFTFontWriter *w) {
+  SplashFontSrc *src;
+
+  if (w->tmpFile) {
+    fclose(w->tmpFile);
+    src = SplashFontSrc::makeFile(w->tmpFileName->getCString(), gTrue);
+    delete w->tmpFileName;
+  } else {
+    src = SplashFontSrc::makeBuf(w->buf, w->len);
+  }
+  return src;
+}
+
+static FoFiTrueType *loadTrueType(SplashFontSrc *src, int fontNum,
+				  GBool allowHeadlessCFF) {
+  if (src->isFile()) {
+    return FoFiTrueType::load(src->getFileName(), fontNum, allowHeadlessCFF);
+  } else {
+    return FoFiTrueType::make(src->getBuf(), src->getLength(), fontNum,
+			      allowHeadlessCFF);
+  }
 }
-#endif
 
 //------------------------------------------------------------------------
 // SplashFTFontEngine
@@ -81,117 +144,55 @@ SplashFTFontEngine::~SplashFTFontEngine() {
 }
 
 SplashFontFile *SplashFTFontEngine::loadType1Font(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						  GString *fontBuf,
-#else
-						  char *fileName,
-						  GBool deleteFile,
-#endif
+						  SplashFontSrc *src,
 						  const char **enc) {
   return SplashFTFontFile::loadType1Font(this, idA, splashFontType1,
-#if LOAD_FONTS_FROM_MEM
-					 fontBuf,
-#else
-					 fileName, deleteFile,
-#endif
-					 enc);
+					 src, enc);
 }
 
 SplashFontFile *SplashFTFontEngine::loadType1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						   GString *fontBuf,
-#else
-						   char *fileName,
-						   GBool deleteFile,
-#endif
+						   SplashFontSrc *src,
 						   const char **enc) {
   return SplashFTFontFile::loadType1Font(this, idA, splashFontType1C,
-#if LOAD_FONTS_FROM_MEM
-					 fontBuf,
-#else
-					 fileName, deleteFile,
-#endif
-					 enc);
+					 src, enc);
 }
 
 SplashFontFile *SplashFTFontEngine::loadOpenTypeT1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-							GString *fontBuf,
-#else
-							char *fileName,
-							GBool deleteFile,
-#endif
+							SplashFontSrc *src,
 							const char **enc) {
   FoFiTrueType *ff;
-#if LOAD_FONTS_FROM_MEM
-  GString *fontBuf2;
-#else
-  GString *tmpFileName;
-  FILE *tmpFile;
-#endif
+  SplashFTFontWriter w;
+  SplashFontSrc *src2;
   SplashFontFile *ret;
 
-#if LOAD_FONTS_FROM_MEM
-  if (!(ff = FoFiTrueType::make(fontBuf->getCString(), fontBuf->getLength(),
-				0, gTrue))) {
-#else
-  if (!(ff = FoFiTrueType::load(fileName, 0, gTrue))) {
-#endif
+  if (!(ff = loadTrueType(src, 0, gTrue))) {
     return NULL;
   }
   if (ff->isHeadlessCFF()) {
-#if LOAD_FONTS_FROM_MEM
-    fontBuf2 = new GString();
-    ff->convertToType1(NULL, enc, gFalse, &gstringWrite, fontBuf2);
-    delete ff;
-    ret = SplashFTFontFile::loadType1Font(this, idA, splashFontType1,
-					  fontBuf2, enc);
-    if (ret) {
-      delete fontBuf;
-    } else {
-      delete fontBuf2;
-    }
-#else
-    tmpFileName = NULL;
-    if (!openTempFile(&tmpFileName, &tmpFile, "wb", NULL)) {
+    if (!openFontWriter(src, &w)) {
       delete ff;
       return NULL;
     }
-    ff->convertToType1(NULL, enc, gFalse, &fileWrite, tmpFile);
+    ff->convertToType1(NULL, enc, gFalse, &fontWriterWrite, &w);
     delete ff;
-    fclose(tmpFile);
+    src2 = closeFontWriter(&w);
     ret = SplashFTFontFile::loadType1Font(this, idA, splashFontType1,
-					  tmpFileName->getCString(),
-					  gTrue, enc);
+					  src2, enc);
     if (ret) {
-      if (deleteFile) {
-	unlink(fileName);
-      }
+      delete src;
     } else {
-      unlink(tmpFileName->getCString());
+      delete src2;
     }
-    delete tmpFileName;
-#endif
   } else {
     delete ff;
     ret = SplashFTFontFile::loadType1Font(this, idA, splashFontOpenTypeT1C,
-#if LOAD_FONTS_FROM_MEM
-					  fontBuf,
-#else
-					  fileName, deleteFile,
-#endif
-					  enc);
+					  src, enc);
   }
   return ret;
 }
 
 SplashFontFile *SplashFTFontEngine::loadCIDFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						GString *fontBuf,
-#else
-						char *fileName,
-						GBool deleteFile,
-#endif
+						SplashFontSrc *src,
 						int *codeToGID,
 						int codeToGIDLen) {
   FoFiType1C *ff;
@@ -206,24 +207,16 @@ SplashFontFile *SplashFTFontEngine::loadCIDFont(SplashFontFileID *idA,
   } else if (useCIDs) {
     cidToGIDMap = NULL;
     nCIDs = 0;
-#if LOAD_FONTS_FROM_MEM
-  } else if ((ff = FoFiType1C::make(fontBuf->getCString(),
-				    fontBuf->getLength()))) {
-#else
-  } else if ((ff = FoFiType1C::load(fileName))) {
-#endif
+  } else if ((ff = src->isFile()
+		     ? FoFiType1C::load(src->getFileName())
+		     : FoFiType1C::make(src->getBuf(), src->getLength()))) {
     cidToGIDMap = ff->getCIDToGIDMap(&nCIDs);
     delete ff;
   } else {
     cidToGIDMap = NULL;
     nCIDs = 0;
   }
-  ret = SplashFTFontFile::loadCIDFont(this, idA, splashFontCID,
-#if LOAD_FONTS_FROM_MEM
-				      fontBuf,
-#else
-				      fileName, deleteFile,
-#endif
+  ret = SplashFTFontFile::loadCIDFont(this, idA, splashFontCID, src,
 				      codeToGID ? codeToGID : cidToGIDMap,
 				      codeToGID ? codeToGIDLen : nCIDs);
   if (!ret) {
@@ -233,86 +226,50 @@ SplashFontFile *SplashFTFontEngine::loadCIDFont(SplashFontFileID *idA,
 }
 
 SplashFontFile *SplashFTFontEngine::loadOpenTypeCFFFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-							GString *fontBuf,
-#else
-							char *fileName,
-							GBool deleteFile,
-#endif
+							SplashFontSrc *src,
 							int *codeToGID,
 							int codeToGIDLen) {
   FoFiTrueType *ff;
-#if LOAD_FONTS_FROM_MEM
-  GString *fontBuf2;
-#else
-  GString *tmpFileName;
-  FILE *tmpFile;
-#endif
+  SplashFTFontWriter w;
+  SplashFontSrc *src2;
   char *cffStart;
   int cffLength;
   int *cidToGIDMap;
   int nCIDs;
   SplashFontFile *ret;
 
-#if LOAD_FONTS_FROM_MEM
-  if (!(ff = FoFiTrueType::make(fontBuf->getCString(), fontBuf->getLength(),
-				0, gTrue))) {
-#else
-  if (!(ff = FoFiTrueType::load(fileName, 0, gTrue))) {
-#endif
+  if (!(ff = loadTrueType(src, 0, gTrue))) {
     return NULL;
   }
   cidToGIDMap = NULL;
   nCIDs = 0;
   if (ff->isHeadlessCFF()) {
     if (!ff->getCFFBlock(&cffStart, &cffLength)) {
+      delete ff;
       return NULL;
     }
-#if LOAD_FONTS_FROM_MEM
-    fontBuf2 = new GString(cffStart, cffLength);
-    if (!useCIDs) {
-      cidToGIDMap = ff->getCIDToGIDMap(&nCIDs);
-    }
-    ret = SplashFTFontFile::loadCIDFont(this, idA, splashFontOpenTypeCFF,
-					fontBuf2, cidToGIDMap, nCIDs);
-    if (ret) {
-      delete fontBuf;
-    } else {
-      delete fontBuf2;
-    }
-#else
-    tmpFileName = NULL;
-    if (!openTempFile(&tmpFileName, &tmpFile, "wb", NULL)) {
+    if (!openFontWriter(src, &w)) {
       delete ff;
       return NULL;
     }
-    fwrite(cffStart, 1, cffLength, tmpFile);
-    fclose(tmpFile);
+    fontWriterWrite(&w, cffStart, cffLength);
+    src2 = closeFontWriter(&w);
     if (!useCIDs) {
       cidToGIDMap = ff->getCIDToGIDMap(&nCIDs);
     }
     ret = SplashFTFontFile::loadCIDFont(this, idA, splashFontOpenTypeCFF,
-					tmpFileName->getCString(), gTrue,
-					cidToGIDMap, nCIDs);
+					src2, cidToGIDMap, nCIDs);
     if (ret) {
-      if (deleteFile) {
-	unlink(fileName);
-      }
+      delete src;
     } else {
-      unlink(tmpFileName->getCString());
+      delete src2;
     }
-    delete tmpFileName;
-#endif
   } else {
     if (!codeToGID && !useCIDs && ff->isOpenTypeCFF()) {
       cidToGIDMap = ff->getCIDToGIDMap(&nCIDs);
     }
     ret = SplashFTFontFile::loadCIDFont(this, idA, splashFontOpenTypeCFF,
-#if LOAD_FONTS_FROM_MEM
-					fontBuf,
-#else
-					fileName, deleteFile,
-#endif
+					src,
 					codeToGID ? codeToGID : cidToGIDMap,
 					codeToGID ? codeToGIDLen : nCIDs);
   }
@@ -324,68 +281,32 @@ SplashFontFile *SplashFTFontEngine::loadOpenTypeCFFFont(SplashFontFileID *idA,
 }
 
 SplashFontFile *SplashFTFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						     GString *fontBuf,
-#else
-						     char *fileName,
-						     GBool deleteFile,
-#endif
+						     SplashFontSrc *src,
 						     int fontNum,
 						     int *codeToGID,
 						     int codeToGIDLen) {
   FoFiTrueType *ff;
-#if LOAD_FONTS_FROM_MEM
-  GString *fontBuf2;
-#else
-  GString *tmpFileName;
-  FILE *tmpFile;
-#endif
+  SplashFTFontWriter w;
+  SplashFontSrc *src2;
   SplashFontFile *ret;
 
-#if LOAD_FONTS_FROM_MEM
-  if (!(ff = FoFiTrueType::make(fontBuf->getCString(), fontBuf->getLength(),
-				fontNum))) {
-#else
-  if (!(ff = FoFiTrueType::load(fileName, fontNum))) {
-#endif
+  if (!(ff = loadTrueType(src, fontNum, gFalse))) {
     return NULL;
   }
-#if LOAD_FONTS_FROM_MEM
-  fontBuf2 = new GString;
-  ff->writeTTF(&gstringWrite, fontBuf2);
-#else
-  tmpFileName = NULL;
-  if (!openTempFile(&tmpFileName, &tmpFile, "wb", NULL)) {
+  if (!openFontWriter(src, &w)) {
     delete ff;
     return NULL;
   }
-  ff->writeTTF(&fileWrite, tmpFile);
-  fclose(tmpFile);
-#endif
+  ff->writeTTF(&fontWriterWrite, &w);
   delete ff;
+  src2 = closeFontWriter(&w);
   ret = SplashFTFontFile::loadTrueTypeFont(this, idA, splashFontTrueType,
-#if LOAD_FONTS_FROM_MEM
-					   fontBuf2,
-#else
-					   tmpFileName->getCString(), gTrue,
-#endif
-					   0, codeToGID, codeToGIDLen);
-#if LOAD_FONTS_FROM_MEM
-  if (ret) {
-    delete fontBuf;
-  } else {
-    delete fontBuf2;
-  }
-#else
+					   src2, 0, codeToGID, codeToGIDLen);
   if (ret) {
-    if (deleteFile) {
-      unlink(fileName);
-    }
+    delete src;
   } else {
-    unlink(tmpFileName->getCString());
+    delete src2;
   }
-  delete tmpFileName;
-#endif
   return ret;
 }
 
@@ -23,6 +23,7 @@
 class GString;
 
 class SplashFontFile;
+class SplashFontSrc;
 class SplashFontFileID;
 
 //------------------------------------------------------------------------
@@ -38,46 +39,22 @@ public:
 
   // Load fonts.
   SplashFontFile *loadType1Font(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				GString *fontBuf,
-#else
-				char *fileName, GBool deleteFile,
-#endif
+				SplashFontSrc *src,
 				const char **enc);
   SplashFontFile *loadType1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				 GString *fontBuf,
-#else
-				 char *fileName, GBool deleteFile,
-#endif
+				 SplashFontSrc *src,
 				 const char **enc);
   SplashFontFile *loadOpenTypeT1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				      GString *fontBuf,
-#else
-				      char *fileName, GBool deleteFile,
-#endif
+				      SplashFontSrc *src,
 				      const char **enc);
   SplashFontFile *loadCIDFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-			      GString *fontBuf,
-#else
-			      char *fileName, GBool deleteFile,
-#endif
+			      SplashFontSrc *src,
 			      int *codeToGID, int codeToGIDLen);
   SplashFontFile *loadOpenTypeCFFFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				      GString *fontBuf,
-#else
-				      char *fileName, GBool deleteFile,
-#endif
+				      SplashFontSrc *src,
 				      int *codeToGID, int codeToGIDLen);
   SplashFontFile *loadTrueTypeFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				   GString *fontBuf,
-#else
-				   char *fileName, GBool deleteFile,
-#endif
+				   SplashFontSrc *src,
 				   int fontNum,
 				   int *codeToGID, int codeToGIDLen);
 
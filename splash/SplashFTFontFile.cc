@@ -21,6 +21,18 @@
 #include "SplashFTFont.h"
 #include "SplashFTFontFile.h"
 
+//------------------------------------------------------------------------
+
+static FT_Error newFace(FT_Library lib, SplashFontSrc *src, int faceIndex,
+			FT_Face *face) {
+  if (src->isFile()) {
+    return FT_New_Face(lib, src->getFileName(), faceIndex, face);
+  } else {
+    return FT_New_Memory_Face(lib, (FT_Byte *)src->getBuf(),
+			      src->getLength(), faceIndex, face);
+  }
+}
+
 //------------------------------------------------------------------------
 // SplashFTFontFile
 //------------------------------------------------------------------------
@@ -28,24 +40,14 @@
 SplashFontFile *SplashFTFontFile::loadType1Font(SplashFTFontEngine *engineA,
 						SplashFontFileID *idA,
 						SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-						GString *fontBufA,
-#else
-						char *fileNameA,
-						GBool deleteFileA,
-#endif
+						SplashFontSrc *srcA,
 						const char **encA) {
   FT_Face faceA;
   int *codeToGIDA;
   const char *name;
   int i;
 
-#if LOAD_FONTS_FROM_MEM
-  if (FT_New_Memory_Face(engineA->lib, (FT_Byte *)fontBufA->getCString(),
-			 fontBufA->getLength(), 0, &faceA)) {
-#else
-  if (FT_New_Face(engineA->lib, fileNameA, 0, &faceA)) {
-#endif
+  if (newFace(engineA->lib, srcA, 0, &faceA)) {
     return NULL;
   }
   codeToGIDA = (int *)gmallocn(256, sizeof(int));
@@ -57,92 +59,52 @@ SplashFontFile *SplashFTFontFile::loadType1Font(SplashFTFontEngine *engineA,
   }
 
   return new SplashFTFontFile(engineA, idA, fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-			      fontBufA,
-#else
-			      fileNameA, deleteFileA,
-#endif
+			      srcA,
 			      faceA, codeToGIDA, 256);
 }
 
 SplashFontFile *SplashFTFontFile::loadCIDFont(SplashFTFontEngine *engineA,
 					      SplashFontFileID *idA,
 					      SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-					      GString *fontBufA,
-#else
-					      char *fileNameA,
-					      GBool deleteFileA,
-#endif
+					      SplashFontSrc *srcA,
 					      int *codeToGIDA,
 					      int codeToGIDLenA) {
   FT_Face faceA;
 
-#if LOAD_FONTS_FROM_MEM
-  if (FT_New_Memory_Face(engineA->lib, (FT_Byte *)fontBufA->getCString(),
-			 fontBufA->getLength(), 0, &faceA)) {
-#else
-  if (FT_New_Face(engineA->lib, fileNameA, 0, &faceA)) {
-#endif
+  if (newFace(engineA->lib, srcA, 0, &faceA)) {
     return NULL;
   }
 
   return new SplashFTFontFile(engineA, idA, fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-			      fontBufA,
-#else
-			      fileNameA, deleteFileA,
-#endif
+			      srcA,
 			      faceA, codeToGIDA, codeToGIDLenA);
 }
 
 SplashFontFile *SplashFTFontFile::loadTrueTypeFont(SplashFTFontEngine *engineA,
 						   SplashFontFileID *idA,
 						   SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-						   GString *fontBufA,
-#else
-						   char *fileNameA,
-						   GBool deleteFileA,
-#endif
+						   SplashFontSrc *srcA,
 						   int fontNum,
 						   int *codeToGIDA,
 						   int codeToGIDLenA) {
   FT_Face faceA;
 
-#if LOAD_FONTS_FROM_MEM
-  if (FT_New_Memory_Face(engineA->lib, (FT_Byte *)fontBufA->getCString(),
-			 fontBufA->getLength(), fontNum, &faceA)) {
-#else
-  if (FT_New_Face(engineA->lib, fileNameA, fontNum, &faceA)) {
-#endif
+  if (newFace(engineA->lib, srcA, fontNum, &faceA)) {
     return NULL;
   }
 
   return new SplashFTFontFile(engineA, idA, fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-			      fontBufA,
-#else
-			      fileNameA, deleteFileA,
-#endif
+			      srcA,
 			      faceA, codeToGIDA, codeToGIDLenA);
 }
 
 SplashFTFontFile::SplashFTFontFile(SplashFTFontEngine *engineA,
 				   SplashFontFileID *idA,
 				   SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-				   GString *fontBufA,
-#else
-				   char *fileNameA, GBool deleteFileA,
-#endif
+				   SplashFontSrc *srcA,
 				   FT_Face faceA,
 				   int *codeToGIDA, int codeToGIDLenA):
-#if LOAD_FONTS_FROM_MEM
-  SplashFontFile(idA, fontTypeA, fontBufA)
-#else
-  SplashFontFile(idA, fontTypeA, fileNameA, deleteFileA)
-#endif
+  SplashFontFile(idA, fontTypeA, srcA)
 {
   engine = engineA;
   face = faceA;
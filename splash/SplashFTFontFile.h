@@ -34,30 +34,17 @@ public:
   static SplashFontFile *loadType1Font(SplashFTFontEngine *engineA,
 				       SplashFontFileID *idA,
 				       SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-				       GString *fontBufA,
-#else
-				       char *fileNameA, GBool deleteFileA,
-#endif
+				       SplashFontSrc *srcA,
 				       const char **encA);
   static SplashFontFile *loadCIDFont(SplashFTFontEngine *engineA,
 				     SplashFontFileID *idA,
 				     SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-				     GString *fontBufA,
-#else
-				     char *fileNameA, GBool deleteFileA,
-#endif
+				     SplashFontSrc *srcA,
 				     int *codeToGIDA, int codeToGIDLenA);
   static SplashFontFile *loadTrueTypeFont(SplashFTFontEngine *engineA,
 					  SplashFontFileID *idA,
 					  SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-					  GString *fontBufA,
-#else
-					  char *fileNameA,
-					  GBool deleteFileA,
-#endif
+					  SplashFontSrc *srcA,
 					  int fontNum,
 					  int *codeToGIDA,
 					  int codeToGIDLenA);
@@ -74,11 +61,7 @@ private:
   SplashFTFontFile(SplashFTFontEngine *engineA,
 		   SplashFontFileID *idA,
 		   SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-		   GString *fontBufA,
-#else
-		   char *fileNameA, GBool deleteFileA,
-#endif
+		   SplashFontSrc *srcA,
 		   FT_Face faceA,
 		   int *codeToGIDA, int codeToGIDLenA);
 
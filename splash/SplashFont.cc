@@ -18,6 +18,7 @@
 #include "SplashMath.h"
 #include "SplashGlyphBitmap.h"
 #include "SplashFontFile.h"
+#include "SplashGlyphCache.h"
 #include "SplashFont.h"
 
 //------------------------------------------------------------------------
@@ -56,6 +57,8 @@ SplashFont::SplashFont(SplashFontFile *fontFileA, SplashCoord *matA,
 
   cache = NULL;
   cacheTags = NULL;
+  glyphCache = NULL;
+  glyphCacheFont = NULL;
 
   xMin = yMin = xMax = yMax = 0;
 }
@@ -103,6 +106,15 @@ SplashFont::~SplashFont() {
   }
 }
 
+void SplashFont::setGlyphCache(SplashGlyphCache *glyphCacheA) {
+  glyphCache = glyphCacheA;
+  if (glyphCache) {
+    glyphCacheFont = glyphCache->getFont(fontFile->getID(), mat, textMat, aa);
+  } else {
+    glyphCacheFont = NULL;
+  }
+}
+
 GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
 			   SplashGlyphBitmap *bitmap) {
   SplashGlyphBitmap bitmap2;
@@ -142,9 +154,15 @@ GBool SplashFont::getGlyph(int c, int xFrac, int yFrac,
     }
   }
 
-  // generate the glyph bitmap
-  if (!makeGlyph(c, xFrac, yFrac, &bitmap2)) {
-    return gFalse;
+  // check the shared glyph cache, or generate the glyph bitmap
+  if (!glyphCache ||
+      !glyphCache->getGlyph(glyphCacheFont, c, xFrac, yFrac, &bitmap2)) {
+    if (!makeGlyph(c, xFrac, yFrac, &bitmap2)) {
+      return gFalse;
+    }
+    if (glyphCache) {
+      glyphCache->addGlyph(glyphCacheFont, c, xFrac, yFrac, &bitmap2);
+    }
   }
 
   // if the glyph doesn't fit in the bounding box, return a temporary
@@ -21,8 +21,10 @@
 
 struct SplashGlyphBitmap;
 struct SplashFontCacheTag;
+struct SplashGlyphCacheFont;
 class SplashFontFile;
 class SplashPath;
+class SplashGlyphCache;
 
 //------------------------------------------------------------------------
 
@@ -49,6 +51,10 @@ public:
 
   virtual ~SplashFont();
 
+  // Attach a shared glyph cache, which is checked when a glyph isn't
+  // found in this font's own cache.
+  void setGlyphCache(SplashGlyphCache *glyphCacheA);
+
   SplashFontFile *getFontFile() { return fontFile; }
 
   // Return true if <this> matches the specified font file and matrix.
@@ -106,6 +112,9 @@ protected:
   int glyphSize;		// size of glyph bitmaps, in bytes
   int cacheSets;		// number of sets in cache
   int cacheAssoc;		// cache associativity (glyphs per set)
+  SplashGlyphCache *glyphCache;	// shared glyph cache (may be NULL)
+  SplashGlyphCacheFont *	// this font's handle in the shared cache
+    glyphCacheFont;
 };
 
 #endif
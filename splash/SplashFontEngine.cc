@@ -48,6 +48,7 @@ SplashFontEngine::SplashFontEngine(
   for (i = 0; i < splashFontCacheSize; ++i) {
     fontCache[i] = NULL;
   }
+  glyphCache = NULL;
 
 #if HAVE_FREETYPE_H
   if (enableFreeType) {
@@ -90,120 +91,58 @@ SplashFontFile *SplashFontEngine::getFontFile(SplashFontFileID *id) {
 }
 
 SplashFontFile *SplashFontEngine::loadType1Font(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						GString *fontBuf,
-#else
-						char *fileName,
-						GBool deleteFile,
-#endif
+						SplashFontSrc *src,
 						const char **enc) {
   SplashFontFile *fontFile;
 
   fontFile = NULL;
 #if HAVE_FREETYPE_H
   if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadType1Font(idA,
-#if LOAD_FONTS_FROM_MEM
-				       fontBuf,
-#else
-				       fileName, deleteFile,
-#endif
-				       enc);
+    fontFile = ftEngine->loadType1Font(idA, src, enc);
   }
 #endif
 
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
+  unlinkFontFile(fontFile, src);
 
   return fontFile;
 }
 
 SplashFontFile *SplashFontEngine::loadType1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						 GString *fontBuf,
-#else
-						 char *fileName,
-						 GBool deleteFile,
-#endif
+						 SplashFontSrc *src,
 						 const char **enc) {
   SplashFontFile *fontFile;
 
   fontFile = NULL;
 #if HAVE_FREETYPE_H
   if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadType1CFont(idA,
-#if LOAD_FONTS_FROM_MEM
-					fontBuf,
-#else
-					fileName, deleteFile,
-#endif
-					enc);
+    fontFile = ftEngine->loadType1CFont(idA, src, enc);
   }
 #endif
 
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
+  unlinkFontFile(fontFile, src);
 
   return fontFile;
 }
 
 SplashFontFile *SplashFontEngine::loadOpenTypeT1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						      GString *fontBuf,
-#else
-						      char *fileName,
-						      GBool deleteFile,
-#endif
+						      SplashFontSrc *src,
 						      const char **enc) {
   SplashFontFile *fontFile;
 
   fontFile = NULL;
 #if HAVE_FREETYPE_H
   if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadOpenTypeT1CFont(idA,
-#if LOAD_FONTS_FROM_MEM
-					     fontBuf,
-#else
-					     fileName, deleteFile,
-#endif
-					     enc);
+    fontFile = ftEngine->loadOpenTypeT1CFont(idA, src, enc);
   }
 #endif
 
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
+  unlinkFontFile(fontFile, src);
 
   return fontFile;
 }
 
 SplashFontFile *SplashFontEngine::loadCIDFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-					      GString *fontBuf,
-#else
-					      char *fileName,
-					      GBool deleteFile,
-#endif
+					      SplashFontSrc *src,
 					      int *codeToGID,
 					      int codeToGIDLen) {
   SplashFontFile *fontFile;
@@ -211,36 +150,17 @@ SplashFontFile *SplashFontEngine::loadCIDFont(SplashFontFileID *idA,
   fontFile = NULL;
 #if HAVE_FREETYPE_H
   if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadCIDFont(idA,
-#if LOAD_FONTS_FROM_MEM
-				     fontBuf,
-#else
-				     fileName, deleteFile,
-#endif
-				     codeToGID, codeToGIDLen);
+    fontFile = ftEngine->loadCIDFont(idA, src, codeToGID, codeToGIDLen);
   }
 #endif
 
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
+  unlinkFontFile(fontFile, src);
 
   return fontFile;
 }
 
 SplashFontFile *SplashFontEngine::loadOpenTypeCFFFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						      GString *fontBuf,
-#else
-						      char *fileName,
-						      GBool deleteFile,
-#endif
+						      SplashFontSrc *src,
 						      int *codeToGID,
 						      int codeToGIDLen) {
   SplashFontFile *fontFile;
@@ -248,36 +168,18 @@ SplashFontFile *SplashFontEngine::loadOpenTypeCFFFont(SplashFontFileID *idA,
   fontFile = NULL;
 #if HAVE_FREETYPE_H
   if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadOpenTypeCFFFont(idA,
-#if LOAD_FONTS_FROM_MEM
-					     fontBuf,
-#else
-					     fileName, deleteFile,
-#endif
+    fontFile = ftEngine->loadOpenTypeCFFFont(idA, src,
 					     codeToGID, codeToGIDLen);
   }
 #endif
 
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
+  unlinkFontFile(fontFile, src);
 
   return fontFile;
 }
 
 SplashFontFile *SplashFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-						   GString *fontBuf,
-#else
-						   char *fileName,
-						   GBool deleteFile,
-#endif
+						   SplashFontSrc *src,
 						   int fontNum,
 						   int *codeToGID,
 						   int codeToGIDLen,
@@ -287,12 +189,7 @@ SplashFontFile *SplashFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
   fontFile = NULL;
 #if HAVE_FREETYPE_H
   if (!fontFile && ftEngine) {
-    fontFile = ftEngine->loadTrueTypeFont(idA,
-#if LOAD_FONTS_FROM_MEM
-					  fontBuf,
-#else
-					  fileName, deleteFile,
-#endif
+    fontFile = ftEngine->loadTrueTypeFont(idA, src,
 					  fontNum, codeToGID, codeToGIDLen);
   }
 #endif
@@ -301,19 +198,28 @@ SplashFontFile *SplashFontEngine::loadTrueTypeFont(SplashFontFileID *idA,
     gfree(codeToGID);
   }
 
-#if !LOAD_FONTS_FROM_MEM && !defined(_WIN32)
-  // delete the (temporary) font file -- with Unix hard link
-  // semantics, this will remove the last link; otherwise it will
-  // return an error, leaving the file to be deleted later (if
-  // loadXYZFont failed, the file will always be deleted)
-  if (deleteFile) {
-    unlink(fontFile ? fontFile->fileName->getCString() : fileName);
-  }
-#endif
+  unlinkFontFile(fontFile, src);
 
   return fontFile;
 }
 
+// Delete the (temporary) font file, if any -- with Unix hard link
+// semantics, this will remove the last link; otherwise it will return
+// an error, leaving the file to be deleted later (if loadXYZFont
+// failed, the file will always be deleted when the caller deletes
+// the SplashFontSrc).  In-memory fonts don't need any cleanup here.
+void SplashFontEngine::unlinkFontFile(SplashFontFile *fontFile,
+				      SplashFontSrc *src) {
+#ifndef _WIN32
+  if (fontFile) {
+    src = fontFile->src;
+  }
+  if (src->isFile() && src->getDeleteFile()) {
+    unlink(src->getFileName());
+  }
+#endif
+}
+
 SplashFont *SplashFontEngine::getFont(SplashFontFile *fontFile,
 				      SplashCoord *textMat,
 				      SplashCoord *ctm) {
@@ -346,6 +252,9 @@ SplashFont *SplashFontEngine::getFont(SplashFontFile *fontFile,
     }
   }
   font = fontFile->makeFont(mat, textMat);
+  if (glyphCache) {
+    font->setGlyphCache(glyphCache);
+  }
   if (fontCache[splashFontCacheSize - 1]) {
     delete fontCache[splashFontCacheSize - 1];
   }
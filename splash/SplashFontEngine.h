@@ -22,8 +22,10 @@ class SplashFTFontEngine;
 class SplashDTFontEngine;
 class SplashDT4FontEngine;
 class SplashFontFile;
+class SplashFontSrc;
 class SplashFontFileID;
 class SplashFont;
+class SplashGlyphCache;
 
 //------------------------------------------------------------------------
 
@@ -50,52 +52,36 @@ public:
 
   ~SplashFontEngine();
 
+  // Set the shared glyph cache used by all fonts created by this
+  // engine (NULL to disable).  This does not take ownership of the
+  // cache.
+  void setGlyphCache(SplashGlyphCache *glyphCacheA)
+    { glyphCache = glyphCacheA; }
+
   // Get a font file from the cache.  Returns NULL if there is no
   // matching entry in the cache.
   SplashFontFile *getFontFile(SplashFontFileID *id);
 
-  // Load fonts - these create new SplashFontFile objects.
+  // Load fonts - these create new SplashFontFile objects.  On
+  // success, the SplashFontSrc is consumed (either owned by the new
+  // SplashFontFile, or deleted); on failure, it is left untouched.
   SplashFontFile *loadType1Font(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				GString *fontBuf,
-#else
-				char *fileName, GBool deleteFile,
-#endif
+				SplashFontSrc *src,
 				const char **enc);
   SplashFontFile *loadType1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				 GString *fontBuf,
-#else
-				 char *fileName, GBool deleteFile,
-#endif
+				 SplashFontSrc *src,
 				 const char **enc);
   SplashFontFile *loadOpenTypeT1CFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				      GString *fontBuf,
-#else
-				      char *fileName, GBool deleteFile,
-#endif
+				      SplashFontSrc *src,
 				      const char **enc);
   SplashFontFile *loadCIDFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-			      GString *fontBuf,
-#else
-			      char *fileName, GBool deleteFile,
-#endif
+			      SplashFontSrc *src,
 			      int *codeToGID, int codeToGIDLen);
   SplashFontFile *loadOpenTypeCFFFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				      GString *fontBuf,
-#else
-				      char *fileName, GBool deleteFile,
-#endif
+				      SplashFontSrc *src,
 				      int *codeToGID, int codeToGIDLen);
   SplashFontFile *loadTrueTypeFont(SplashFontFileID *idA,
-#if LOAD_FONTS_FROM_MEM
-				   GString *fontBuf,
-#else
-				   char *fileName, GBool deleteFile,
-#endif
+				   SplashFontSrc *src,
 				   int fontNum,
 				   int *codeToGID, int codeToGIDLen,
 				   char *fontName);
@@ -113,7 +99,10 @@ public:
 
 private:
 
+  void unlinkFontFile(SplashFontFile *fontFile, SplashFontSrc *src);
+
   SplashFont *fontCache[splashFontCacheSize];
+  SplashGlyphCache *glyphCache;
 
 #if HAVE_FREETYPE_H
   SplashFTFontEngine *ftEngine;
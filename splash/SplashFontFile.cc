@@ -16,8 +16,11 @@
 #ifndef _WIN32
 #  include <unistd.h>
 #endif
+#include <limits.h>
+#include "gmem.h"
 #include "gmempp.h"
 #include "GString.h"
+#include "GMappedFile.h"
 #include "SplashFontFile.h"
 #include "SplashFontFileID.h"
 
@@ -27,38 +30,83 @@ extern "C" int unlink(char *filename);
 #endif
 #endif
 
+//------------------------------------------------------------------------
+// SplashFontSrc
+//------------------------------------------------------------------------
+
+SplashFontSrc *SplashFontSrc::makeFile(char *fileNameA, GBool deleteFileA) {
+  SplashFontSrc *src;
+
+  src = new SplashFontSrc();
+  src->fileName = new GString(fileNameA);
+  src->deleteFile = deleteFileA;
+  return src;
+}
+
+SplashFontSrc *SplashFontSrc::makeBuf(char *bufA, int lenA) {
+  SplashFontSrc *src;
+
+  src = new SplashFontSrc();
+  src->buf = bufA;
+  src->len = lenA;
+  return src;
+}
+
+SplashFontSrc *SplashFontSrc::makeMappedFile(GMappedFile *mapA) {
+  SplashFontSrc *src;
+
+  if (mapA->getSize() > INT_MAX) {
+    mapA->free();
+    return NULL;
+  }
+  src = new SplashFontSrc();
+  src->buf = (char *)mapA->getData();
+  src->len = (int)mapA->getSize();
+  src->map = mapA;
+  return src;
+}
+
+SplashFontSrc::SplashFontSrc() {
+  fileName = NULL;
+  deleteFile = gFalse;
+  buf = NULL;
+  len = 0;
+  map = NULL;
+}
+
+SplashFontSrc::~SplashFontSrc() {
+  if (fileName) {
+    if (deleteFile) {
+      unlink(fileName->getCString());
+    }
+    delete fileName;
+  }
+  if (map) {
+    map->free();
+  } else {
+    gfree(buf);
+  }
+}
+
+char *SplashFontSrc::getFileName() {
+  return fileName->getCString();
+}
+
 //------------------------------------------------------------------------
 // SplashFontFile
 //------------------------------------------------------------------------
 
 SplashFontFile::SplashFontFile(SplashFontFileID *idA,
 			       SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-			       GString *fontBufA
-#else
-			       char *fileNameA, GBool deleteFileA
-#endif
-			       ) {
+			       SplashFontSrc *srcA) {
   id = idA;
   fontType = fontTypeA;
-#if LOAD_FONTS_FROM_MEM
-  fontBuf = fontBufA;
-#else
-  fileName = new GString(fileNameA);
-  deleteFile = deleteFileA;
-#endif
+  src = srcA;
   refCnt = 0;
 }
 
 SplashFontFile::~SplashFontFile() {
-#if LOAD_FONTS_FROM_MEM
-  delete fontBuf;
-#else
-  if (deleteFile) {
-    unlink(fileName->getCString());
-  }
-  delete fileName;
-#endif
+  delete src;
   delete id;
 }
 
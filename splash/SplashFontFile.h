@@ -23,6 +23,7 @@
 #endif
 
 class GString;
+class GMappedFile;
 class SplashFontEngine;
 class SplashFont;
 class SplashFontFileID;
@@ -41,6 +42,48 @@ enum SplashFontType {
 				//             fontCIDType2/fontCIDType2OT
 };
 
+//------------------------------------------------------------------------
+// SplashFontSrc
+//------------------------------------------------------------------------
+
+// The font program underlying a SplashFontFile.  This is either a
+// file or a block of memory -- the latter being a gmalloc'ed buffer
+// or a (shared, read-only) memory-mapped file.
+class SplashFontSrc {
+public:
+
+  // Font program in a file.  If <deleteFileA> is set, the file is
+  // deleted along with the SplashFontSrc.
+  static SplashFontSrc *makeFile(char *fileNameA, GBool deleteFileA);
+
+  // Font program in memory.  This takes ownership of <bufA>, which
+  // must have been allocated with gmalloc.
+  static SplashFontSrc *makeBuf(char *bufA, int lenA);
+
+  // Font program in a memory-mapped file.  This takes ownership of
+  // one reference to <mapA>.  Returns NULL if the file is too large.
+  static SplashFontSrc *makeMappedFile(GMappedFile *mapA);
+
+  ~SplashFontSrc();
+
+  GBool isFile() { return fileName != NULL; }
+  char *getFileName();
+  GBool getDeleteFile() { return deleteFile; }
+  char *getBuf() { return buf; }
+  int getLength() { return len; }
+
+private:
+
+  SplashFontSrc();
+
+  GString *fileName;		// file name (NULL for in-memory fonts)
+  GBool deleteFile;		// delete the file when done
+  char *buf;			// font data (for in-memory fonts)
+  int len;			// length of font data
+  GMappedFile *map;		// memory mapping that owns buf, or NULL
+				//   if buf was gmalloc'ed
+};
+
 //------------------------------------------------------------------------
 // SplashFontFile
 //------------------------------------------------------------------------
@@ -68,21 +111,11 @@ protected:
 
   SplashFontFile(SplashFontFileID *idA,
 		 SplashFontType fontTypeA,
-#if LOAD_FONTS_FROM_MEM
-		 GString *fontBufA
-#else
-		 char *fileNameA, GBool deleteFileA
-#endif
-		 );
+		 SplashFontSrc *srcA);
 
   SplashFontFileID *id;
   SplashFontType fontType;
-#if LOAD_FONTS_FROM_MEM
-  GString *fontBuf;
-#else
-  GString *fileName;
-  GBool deleteFile;
-#endif
+  SplashFontSrc *src;
 #if MULTITHREADED
   GAtomicCounter refCnt;
 #else
@@ -27,6 +27,13 @@ public:
   SplashFontFileID();
   virtual ~SplashFontFileID();
   virtual GBool matches(SplashFontFileID *id) = 0;
+
+  // Return a hash of this ID.  IDs which match each other must have
+  // the same hash value.
+  virtual Guint hash() = 0;
+
+  // Return a new copy of this ID.
+  virtual SplashFontFileID *copy() = 0;
 };
 
 #endif
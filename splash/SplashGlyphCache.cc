@@ -0,0 +1,365 @@
+//========================================================================
+//
+// SplashGlyphCache.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#include "GList.h"
+#include "SplashMath.h"
+#include "SplashGlyphBitmap.h"
+#include "SplashFontFileID.h"
+#include "SplashGlyphCache.h"
+
+#if MULTITHREADED
+#  define lockCache   gLockMutex(&mutex)
+#  define unlockCache gUnlockMutex(&mutex)
+#else
+#  define lockCache
+#  define unlockCache
+#endif
+
+//------------------------------------------------------------------------
+
+// initial number of hash buckets
+#define splashGlyphCacheInitHashSize 1024
+
+// initial number of font hash buckets
+#define splashGlyphCacheInitFontHashSize 64
+
+// glyphs larger than this fraction of the byte budget are not cached
+#define splashGlyphCacheMaxGlyphFraction 16
+
+//------------------------------------------------------------------------
+
+struct SplashGlyphCacheFont {
+  SplashFontFileID *id;
+  SplashCoord mat[4];
+  SplashCoord textMat[4];
+  GBool aa;
+  int idx;			// index in the fonts list, used for hashing
+  Guint idHash;			// hash of <id>
+  SplashGlyphCacheFont *hashNext; // next font in the same hash bucket
+};
+
+struct SplashGlyphCacheEntry {
+  SplashGlyphCacheFont *font;
+  int c;
+  short xFrac, yFrac;
+  int x, y, w, h;		// offset and size of glyph
+  GBool aa;
+  Guchar *data;
+  int dataSize;
+  SplashGlyphCacheEntry *hashNext; // next entry in the same hash bucket
+  SplashGlyphCacheEntry *prev;	// LRU list: previous (more recently used)
+  SplashGlyphCacheEntry *next;	// LRU list: next (less recently used)
+};
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+SplashGlyphCache::SplashGlyphCache(int maxBytesA) {
+  maxBytes = maxBytesA < 0 ? 0 : maxBytesA;
+  fonts = new GList();
+  hashSize = splashGlyphCacheInitHashSize;
+  hashTab = (SplashGlyphCacheEntry **)gmallocn(hashSize,
+					       sizeof(SplashGlyphCacheEntry *));
+  memset(hashTab, 0, hashSize * sizeof(SplashGlyphCacheEntry *));
+  fontHashSize = splashGlyphCacheInitFontHashSize;
+  fontHashTab = (SplashGlyphCacheFont **)
+		    gmallocn(fontHashSize, sizeof(SplashGlyphCacheFont *));
+  memset(fontHashTab, 0, fontHashSize * sizeof(SplashGlyphCacheFont *));
+  head = tail = NULL;
+  nGlyphs = 0;
+  nBytes = 0;
+  hits = misses = 0;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+SplashGlyphCache::~SplashGlyphCache() {
+  clear();
+  delete fonts;
+  gfree(fontHashTab);
+  gfree(hashTab);
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+SplashGlyphCacheFont *SplashGlyphCache::getFont(SplashFontFileID *id,
+						SplashCoord *mat,
+						SplashCoord *textMat,
+						GBool aa) {
+  SplashGlyphCacheFont *font;
+  Guint idHash;
+  int h, i;
+
+  idHash = id->hash();
+  lockCache;
+  h = (int)(idHash & (fontHashSize - 1));
+  for (font = fontHashTab[h]; font; font = font->hashNext) {
+    if (font->idHash == idHash &&
+	font->aa == aa &&
+	splashAbs(mat[0] - font->mat[0]) < 0.0001 &&
+	splashAbs(mat[1] - font->mat[1]) < 0.0001 &&
+	splashAbs(mat[2] - font->mat[2]) < 0.0001 &&
+	splashAbs(mat[3] - font->mat[3]) < 0.0001 &&
+	splashAbs(textMat[0] - font->textMat[0]) < 0.0001 &&
+	splashAbs(textMat[1] - font->textMat[1]) < 0.0001 &&
+	splashAbs(textMat[2] - font->textMat[2]) < 0.0001 &&
+	splashAbs(textMat[3] - font->textMat[3]) < 0.0001 &&
+	font->id->matches(id)) {
+      unlockCache;
+      return font;
+    }
+  }
+  font = (SplashGlyphCacheFont *)gmalloc(sizeof(SplashGlyphCacheFont));
+  font->id = id->copy();
+  for (i = 0; i < 4; ++i) {
+    font->mat[i] = mat[i];
+    font->textMat[i] = textMat[i];
+  }
+  font->aa = aa;
+  font->idx = fonts->getLength();
+  font->idHash = idHash;
+  font->hashNext = fontHashTab[h];
+  fontHashTab[h] = font;
+  fonts->append(font);
+  if (fonts->getLength() > 2 * fontHashSize) {
+    growFontHashTab();
+  }
+  unlockCache;
+  return font;
+}
+
+GBool SplashGlyphCache::getGlyph(SplashGlyphCacheFont *font,
+				 int c, int xFrac, int yFrac,
+				 SplashGlyphBitmap *bitmap) {
+  SplashGlyphCacheEntry *e;
+
+  lockCache;
+  for (e = hashTab[hash(font, c, xFrac, yFrac)]; e; e = e->hashNext) {
+    if (e->font == font && e->c == c &&
+	e->xFrac == xFrac && e->yFrac == yFrac) {
+      break;
+    }
+  }
+  if (!e) {
+    ++misses;
+    unlockCache;
+    return gFalse;
+  }
+  ++hits;
+
+  // move the entry to the front of the LRU list
+  if (e != head) {
+    e->prev->next = e->next;
+    if (e->next) {
+      e->next->prev = e->prev;
+    } else {
+      tail = e->prev;
+    }
+    e->prev = NULL;
+    e->next = head;
+    head->prev = e;
+    head = e;
+  }
+
+  bitmap->x = e->x;
+  bitmap->y = e->y;
+  bitmap->w = e->w;
+  bitmap->h = e->h;
+  bitmap->aa = e->aa;
+  bitmap->data = (Guchar *)gmalloc(e->dataSize);
+  memcpy(bitmap->data, e->data, e->dataSize);
+  bitmap->freeData = gTrue;
+  unlockCache;
+  return gTrue;
+}
+
+void SplashGlyphCache::addGlyph(SplashGlyphCacheFont *font,
+				int c, int xFrac, int yFrac,
+				SplashGlyphBitmap *bitmap) {
+  SplashGlyphCacheEntry *e;
+  int dataSize, h;
+
+  if (bitmap->aa) {
+    dataSize = bitmap->w * bitmap->h;
+  } else {
+    dataSize = ((bitmap->w + 7) >> 3) * bitmap->h;
+  }
+  if (dataSize + (int)sizeof(SplashGlyphCacheEntry) >
+      maxBytes / splashGlyphCacheMaxGlyphFraction) {
+    return;
+  }
+
+  lockCache;
+
+  // another thread may have added this glyph in the meantime
+  h = hash(font, c, xFrac, yFrac);
+  for (e = hashTab[h]; e; e = e->hashNext) {
+    if (e->font == font && e->c == c &&
+	e->xFrac == xFrac && e->yFrac == yFrac) {
+      unlockCache;
+      return;
+    }
+  }
+
+  // make room
+  while (tail &&
+	 nBytes + dataSize + (int)sizeof(SplashGlyphCacheEntry) > maxBytes) {
+    removeEntry(tail);
+  }
+
+  e = (SplashGlyphCacheEntry *)gmalloc(sizeof(SplashGlyphCacheEntry));
+  e->font = font;
+  e->c = c;
+  e->xFrac = (short)xFrac;
+  e->yFrac = (short)yFrac;
+  e->x = bitmap->x;
+  e->y = bitmap->y;
+  e->w = bitmap->w;
+  e->h = bitmap->h;
+  e->aa = bitmap->aa;
+  e->data = (Guchar *)gmalloc(dataSize);
+  memcpy(e->data, bitmap->data, dataSize);
+  e->dataSize = dataSize;
+  e->hashNext = hashTab[h];
+  hashTab[h] = e;
+  e->prev = NULL;
+  e->next = head;
+  if (head) {
+    head->prev = e;
+  } else {
+    tail = e;
+  }
+  head = e;
+  ++nGlyphs;
+  nBytes += dataSize + (int)sizeof(SplashGlyphCacheEntry);
+  if (nGlyphs > 2 * hashSize) {
+    growHashTab();
+  }
+
+  unlockCache;
+}
+
+void SplashGlyphCache::clear() {
+  SplashGlyphCacheFont *font;
+  SplashGlyphCacheEntry *e, *next;
+  int i;
+
+  lockCache;
+  for (e = head; e; e = next) {
+    next = e->next;
+    gfree(e->data);
+    gfree(e);
+  }
+  head = tail = NULL;
+  memset(hashTab, 0, hashSize * sizeof(SplashGlyphCacheEntry *));
+  nGlyphs = 0;
+  nBytes = 0;
+  for (i = 0; i < fonts->getLength(); ++i) {
+    font = (SplashGlyphCacheFont *)fonts->get(i);
+    delete font->id;
+    gfree(font);
+  }
+  delete fonts;
+  fonts = new GList();
+  memset(fontHashTab, 0, fontHashSize * sizeof(SplashGlyphCacheFont *));
+  unlockCache;
+}
+
+void SplashGlyphCache::getStats(SplashGlyphCacheStats *stats) {
+  lockCache;
+  stats->hits = hits;
+  stats->misses = misses;
+  stats->nGlyphs = nGlyphs;
+  stats->nBytes = nBytes;
+  stats->maxBytes = maxBytes;
+  unlockCache;
+}
+
+int SplashGlyphCache::hash(SplashGlyphCacheFont *font,
+			   int c, int xFrac, int yFrac) {
+  Guint h;
+
+  h = (Guint)font->idx * 0x9e3779b1;
+  h ^= (Guint)c * 0x85ebca6b;
+  h ^= (Guint)((xFrac << 4) | yFrac);
+  h ^= h >> 15;
+  return (int)(h & (hashSize - 1));
+}
+
+// Remove an entry (which must be in the cache) -- the caller must
+// hold the lock.
+void SplashGlyphCache::removeEntry(SplashGlyphCacheEntry *e) {
+  SplashGlyphCacheEntry **p;
+
+  for (p = &hashTab[hash(e->font, e->c, e->xFrac, e->yFrac)];
+       *p != e;
+       p = &(*p)->hashNext) ;
+  *p = e->hashNext;
+  if (e->prev) {
+    e->prev->next = e->next;
+  } else {
+    head = e->next;
+  }
+  if (e->next) {
+    e->next->prev = e->prev;
+  } else {
+    tail = e->prev;
+  }
+  --nGlyphs;
+  nBytes -= e->dataSize + (int)sizeof(SplashGlyphCacheEntry);
+  gfree(e->data);
+  gfree(e);
+}
+
+// Double the number of hash buckets -- the caller must hold the lock.
+void SplashGlyphCache::growHashTab() {
+  SplashGlyphCacheEntry *e;
+  int h;
+
+  hashSize *= 2;
+  gfree(hashTab);
+  hashTab = (SplashGlyphCacheEntry **)gmallocn(hashSize,
+					       sizeof(SplashGlyphCacheEntry *));
+  memset(hashTab, 0, hashSize * sizeof(SplashGlyphCacheEntry *));
+  for (e = head; e; e = e->next) {
+    h = hash(e->font, e->c, e->xFrac, e->yFrac);
+    e->hashNext = hashTab[h];
+    hashTab[h] = e;
+  }
+}
+
+// Double the number of font hash buckets -- the caller must hold the
+// lock.
+void SplashGlyphCache::growFontHashTab() {
+  SplashGlyphCacheFont *font;
+  int h, i;
+
+  fontHashSize *= 2;
+  gfree(fontHashTab);
+  fontHashTab = (SplashGlyphCacheFont **)
+		    gmallocn(fontHashSize, sizeof(SplashGlyphCacheFont *));
+  memset(fontHashTab, 0, fontHashSize * sizeof(SplashGlyphCacheFont *));
+  for (i = 0; i < fonts->getLength(); ++i) {
+    font = (SplashGlyphCacheFont *)fonts->get(i);
+    h = (int)(font->idHash & (fontHashSize - 1));
+    font->hashNext = fontHashTab[h];
+    fontHashTab[h] = font;
+  }
+}
@@ -0,0 +1,110 @@
+//========================================================================
+//
+// SplashGlyphCache.h
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef SPLASHGLYPHCACHE_H
+#define SPLASHGLYPHCACHE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+#include "SplashTypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+
+class GList;
+class SplashFontFileID;
+struct SplashGlyphBitmap;
+struct SplashGlyphCacheFont;
+struct SplashGlyphCacheEntry;
+
+//------------------------------------------------------------------------
+// SplashGlyphCacheStats
+//------------------------------------------------------------------------
+
+struct SplashGlyphCacheStats {
+  double hits;			// number of lookups that found a glyph
+  double misses;		// number of lookups that didn't
+  int nGlyphs;			// number of glyphs currently cached
+  int nBytes;			// current size of the cache, in bytes
+  int maxBytes;			// max size of the cache, in bytes
+};
+
+//------------------------------------------------------------------------
+// SplashGlyphCache
+//------------------------------------------------------------------------
+
+// A glyph bitmap cache which is shared by all of the scaled fonts
+// (SplashFont objects) of a document.  Glyphs are keyed by font file
+// ID, font matrix, glyph, and fractional offset, so the cache can be
+// shared by several font engines (e.g., one per rendering thread), as
+// long as they are rendering the same document with the same
+// settings.  The least recently used glyphs are dropped when the
+// total size exceeds the byte budget.
+class SplashGlyphCache {
+public:
+
+  // Create a cache holding at most <maxBytesA> bytes of glyph data.
+  SplashGlyphCache(int maxBytesA);
+
+  ~SplashGlyphCache();
+
+  // Return the handle for a scaled font, adding it to the cache if
+  // needed.  Handles remain valid until the cache is cleared or
+  // deleted.
+  SplashGlyphCacheFont *getFont(SplashFontFileID *id,
+				SplashCoord *mat, SplashCoord *textMat,
+				GBool aa);
+
+  // Look up glyph <c> at fractional offset (<xFrac>, <yFrac>) in
+  // <font>.  If it is cached, set <bitmap> to a (gmalloc'ed) copy of
+  // the glyph bitmap, and return true.
+  GBool getGlyph(SplashGlyphCacheFont *font, int c, int xFrac, int yFrac,
+		 SplashGlyphBitmap *bitmap);
+
+  // Add a copy of <bitmap> to the cache as glyph <c> at fractional
+  // offset (<xFrac>, <yFrac>) in <font>.
+  void addGlyph(SplashGlyphCacheFont *font, int c, int xFrac, int yFrac,
+		SplashGlyphBitmap *bitmap);
+
+  // Remove everything from the cache.  This must be called when
+  // switching to a different document.  Any previously returned
+  // font handles become invalid.
+  void clear();
+
+  void getStats(SplashGlyphCacheStats *stats);
+
+private:
+
+  int hash(SplashGlyphCacheFont *font, int c, int xFrac, int yFrac);
+  void removeEntry(SplashGlyphCacheEntry *e);
+  void growHashTab();
+  void growFontHashTab();
+
+  GList *fonts;			// [SplashGlyphCacheFont]
+  SplashGlyphCacheFont **fontHashTab; // font hash buckets, keyed by
+				//   font file ID
+  int fontHashSize;		// number of font hash buckets
+  SplashGlyphCacheEntry **hashTab; // hash buckets
+  int hashSize;			// number of hash buckets
+  SplashGlyphCacheEntry *head;	// most recently used entry
+  SplashGlyphCacheEntry *tail;	// least recently used entry
+  int nGlyphs;			// number of cached glyphs
+  int nBytes;			// current size of the cache
+  int maxBytes;			// max size of the cache
+  double hits, misses;		// lookup stats
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+#endif
@@ -0,0 +1,426 @@
+//========================================================================
+//
+// SplashSIMD.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include "SplashSIMD.h"
+
+// SSE2 is always available on 64-bit x86, and on 32-bit x86 when the
+// compiler has been told to use it.  AVX2 code is compiled with a
+// per-function target attribute, and only used if the CPU supports it.
+#if (defined(__GNUC__) && defined(__SSE2__)) || \
+    (defined(_WIN32) && (_M_IX86_FP == 2 || defined(_M_X64)))
+#  define SPLASH_SSE2 1
+#  include <emmintrin.h>
+#  if defined(__GNUC__) && \
+      (defined(__clang__) || __GNUC__ > 4 || \
+       (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#    define SPLASH_AVX2 1
+#    include <immintrin.h>
+#  endif
+#endif
+
+//------------------------------------------------------------------------
+// scalar
+//------------------------------------------------------------------------
+
+static inline Guchar div255(int x) {
+  return (Guchar)((x + (x >> 8) + 0x80) >> 8);
+}
+
+static void blendOpaqueScalar(Guchar *dest, Guchar *src, Guchar *alpha,
+			      int n) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    dest[i] = (Guchar)(((255 - alpha[i]) * dest[i] + alpha[i] * src[i])
+		       / 255);
+  }
+}
+
+static void blendBackgroundScalar(Guchar *dest, Guchar *bg, Guchar *alpha,
+				  int n) {
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    dest[i] = div255((255 - alpha[i]) * bg[i] + alpha[i] * dest[i]);
+  }
+}
+
+static void fillShadingRowScalar(Guchar *data, Guchar *alpha, int *idx,
+				 int w, Guchar *colors, int nComps) {
+  Guchar *color;
+  int x, i;
+
+  switch (nComps) {
+  case 1:
+    for (x = 0; x < w; ++x) {
+      if (idx[x] >= 0) {
+	data[x] = colors[idx[x]];
+	alpha[x] = 0xff;
+      }
+    }
+    break;
+  case 3:
+    for (x = 0; x < w; ++x, data += 3) {
+      if (idx[x] >= 0) {
+	color = colors + 3 * idx[x];
+	data[0] = color[0];
+	data[1] = color[1];
+	data[2] = color[2];
+	alpha[x] = 0xff;
+      }
+    }
+    break;
+  default:
+    for (x = 0; x < w; ++x, data += nComps) {
+      if (idx[x] >= 0) {
+	color = colors + nComps * idx[x];
+	for (i = 0; i < nComps; ++i) {
+	  data[i] = color[i];
+	}
+	alpha[x] = 0xff;
+      }
+    }
+    break;
+  }
+}
+
+//------------------------------------------------------------------------
+// SSE2
+//------------------------------------------------------------------------
+
+// All of the intermediate values fit in unsigned 16-bit lanes:
+// (255 - a) * d + a * s <= 255 * 255.  For t in [0, 255*255], t / 255
+// is exactly (t * 0x8081) >> 23, and div255(t) does not overflow.
+
+#if SPLASH_SSE2
+
+static void blendOpaqueSSE2(Guchar *dest, Guchar *src, Guchar *alpha,
+			    int n) {
+  __m128i zero, ones, mul, d, s, a, ia, lo, hi;
+  int i;
+
+  zero = _mm_setzero_si128();
+  ones = _mm_set1_epi8((char)0xff);
+  mul = _mm_set1_epi16((short)0x8081);
+  for (i = 0; i < n; i += 16) {
+    d = _mm_loadu_si128((__m128i *)(dest + i));
+    s = _mm_loadu_si128((__m128i *)(src + i));
+    a = _mm_loadu_si128((__m128i *)(alpha + i));
+    ia = _mm_xor_si128(a, ones);
+    lo = _mm_add_epi16(
+	     _mm_mullo_epi16(_mm_unpacklo_epi8(ia, zero),
+			     _mm_unpacklo_epi8(d, zero)),
+	     _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero),
+			     _mm_unpacklo_epi8(s, zero)));
+    hi = _mm_add_epi16(
+	     _mm_mullo_epi16(_mm_unpackhi_epi8(ia, zero),
+			     _mm_unpackhi_epi8(d, zero)),
+	     _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero),
+			     _mm_unpackhi_epi8(s, zero)));
+    lo = _mm_srli_epi16(_mm_mulhi_epu16(lo, mul), 7);
+    hi = _mm_srli_epi16(_mm_mulhi_epu16(hi, mul), 7);
+    _mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(lo, hi));
+  }
+}
+
+static void blendBackgroundSSE2(Guchar *dest, Guchar *bg, Guchar *alpha,
+				int n) {
+  __m128i zero, ones, round, d, b, a, ia, lo, hi;
+  int i;
+
+  zero = _mm_setzero_si128();
+  ones = _mm_set1_epi8((char)0xff);
+  round = _mm_set1_epi16(0x80);
+  for (i = 0; i < n; i += 16) {
+    d = _mm_loadu_si128((__m128i *)(dest + i));
+    b = _mm_loadu_si128((__m128i *)(bg + i));
+    a = _mm_loadu_si128((__m128i *)(alpha + i));
+    ia = _mm_xor_si128(a, ones);
+    lo = _mm_add_epi16(
+	     _mm_mullo_epi16(_mm_unpacklo_epi8(ia, zero),
+			     _mm_unpacklo_epi8(b, zero)),
+	     _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero),
+			     _mm_unpacklo_epi8(d, zero)));
+    hi = _mm_add_epi16(
+	     _mm_mullo_epi16(_mm_unpackhi_epi8(ia, zero),
+			     _mm_unpackhi_epi8(b, zero)),
+	     _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero),
+			     _mm_unpackhi_epi8(d, zero)));
+    lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)),
+				      round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)),
+				      round), 8);
+    _mm_storeu_si128((__m128i *)(dest + i), _mm_packus_epi16(lo, hi));
+  }
+}
+
+#endif // SPLASH_SSE2
+
+//------------------------------------------------------------------------
+// AVX2
+//------------------------------------------------------------------------
+
+// The 256-bit unpack and pack instructions work within 128-bit
+// lanes, so they keep the bytes in order, just like the SSE2 code.
+
+#if SPLASH_AVX2
+
+__attribute__((target("avx2")))
+static void blendOpaqueAVX2(Guchar *dest, Guchar *src, Guchar *alpha,
+			    int n) {
+  __m256i zero, ones, mul, d, s, a, ia, lo, hi;
+  int i;
+
+  zero = _mm256_setzero_si256();
+  ones = _mm256_set1_epi8((char)0xff);
+  mul = _mm256_set1_epi16((short)0x8081);
+  for (i = 0; i + 32 <= n; i += 32) {
+    d = _mm256_loadu_si256((__m256i *)(dest + i));
+    s = _mm256_loadu_si256((__m256i *)(src + i));
+    a = _mm256_loadu_si256((__m256i *)(alpha + i));
+    ia = _mm256_xor_si256(a, ones);
+    lo = _mm256_add_epi16(
+	     _mm256_mullo_epi16(_mm256_unpacklo_epi8(ia, zero),
+				_mm256_unpacklo_epi8(d, zero)),
+	     _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero),
+				_mm256_unpacklo_epi8(s, zero)));
+    hi = _mm256_add_epi16(
+	     _mm256_mullo_epi16(_mm256_unpackhi_epi8(ia, zero),
+				_mm256_unpackhi_epi8(d, zero)),
+	     _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero),
+				_mm256_unpackhi_epi8(s, zero)));
+    lo = _mm256_srli_epi16(_mm256_mulhi_epu16(lo, mul), 7);
+    hi = _mm256_srli_epi16(_mm256_mulhi_epu16(hi, mul), 7);
+    _mm256_storeu_si256((__m256i *)(dest + i), _mm256_packus_epi16(lo, hi));
+  }
+  if (i < n) {
+    blendOpaqueSSE2(dest + i, src + i, alpha + i, n - i);
+  }
+}
+
+__attribute__((target("avx2")))
+static void blendBackgroundAVX2(Guchar *dest, Guchar *bg, Guchar *alpha,
+				int n) {
+  __m256i zero, ones, round, d, b, a, ia, lo, hi;
+  int i;
+
+  zero = _mm256_setzero_si256();
+  ones = _mm256_set1_epi8((char)0xff);
+  round = _mm256_set1_epi16(0x80);
+  for (i = 0; i + 32 <= n; i += 32) {
+    d = _mm256_loadu_si256((__m256i *)(dest + i));
+    b = _mm256_loadu_si256((__m256i *)(bg + i));
+    a = _mm256_loadu_si256((__m256i *)(alpha + i));
+    ia = _mm256_xor_si256(a, ones);
+    lo = _mm256_add_epi16(
+	     _mm256_mullo_epi16(_mm256_unpacklo_epi8(ia, zero),
+				_mm256_unpacklo_epi8(b, zero)),
+	     _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero),
+				_mm256_unpacklo_epi8(d, zero)));
+    hi = _mm256_add_epi16(
+	     _mm256_mullo_epi16(_mm256_unpackhi_epi8(ia, zero),
+				_mm256_unpackhi_epi8(b, zero)),
+	     _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero),
+				_mm256_unpackhi_epi8(d, zero)));
+    lo = _mm256_srli_epi16(
+	     _mm256_add_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)),
+			      round), 8);
+    hi = _mm256_srli_epi16(
+	     _mm256_add_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)),
+			      round), 8);
+    _mm256_storeu_si256((__m256i *)(dest + i), _mm256_packus_epi16(lo, hi));
+  }
+  if (i < n) {
+    blendBackgroundSSE2(dest + i, bg + i, alpha + i, n - i);
+  }
+}
+
+// The shading row fill gathers one 32-bit word per pixel (the color
+// table entry plus whatever follows it), with the -1 indexes masked
+// off, then packs the entries together and merges them into the row
+// under the same mask.  Packing works within each 128-bit lane:
+// pixels 0-3 end up in the low lane, and pixels 4-7 in the high one.
+
+__attribute__((target("avx2")))
+static void fillShadingRowAVX2(Guchar *data, Guchar *alpha, int *idx,
+			       int w, Guchar *colors, int nComps) {
+  __m256i zero, minus1, pack1, pack3, vi, valid, c, m;
+  __m128i c0, c1, m0, m1, a, d;
+  Guchar *p;
+  int x;
+
+  zero = _mm256_setzero_si256();
+  minus1 = _mm256_set1_epi32(-1);
+  pack1 = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1,
+			   -1, -1, -1, -1, -1, -1, -1, -1,
+			   0, 4, 8, 12, -1, -1, -1, -1,
+			   -1, -1, -1, -1, -1, -1, -1, -1);
+  pack3 = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+			   10, 12, 13, 14, -1, -1, -1, -1,
+			   0, 1, 2, 4, 5, 6, 8, 9,
+			   10, 12, 13, 14, -1, -1, -1, -1);
+  x = 0;
+  switch (nComps) {
+  case 1:
+    for (; x + 8 <= w; x += 8) {
+      vi = _mm256_loadu_si256((__m256i *)(idx + x));
+      valid = _mm256_cmpgt_epi32(vi, minus1);
+      c = _mm256_mask_i32gather_epi32(zero, (const int *)colors, vi,
+				      valid, 1);
+      c = _mm256_shuffle_epi8(c, pack1);
+      m = _mm256_shuffle_epi8(valid, pack1);
+      c0 = _mm_unpacklo_epi32(_mm256_castsi256_si128(c),
+			      _mm256_extracti128_si256(c, 1));
+      m0 = _mm_unpacklo_epi32(_mm256_castsi256_si128(m),
+			      _mm256_extracti128_si256(m, 1));
+      d = _mm_loadl_epi64((__m128i *)(data + x));
+      _mm_storel_epi64((__m128i *)(data + x), _mm_blendv_epi8(d, c0, m0));
+      a = _mm_loadl_epi64((__m128i *)(alpha + x));
+      _mm_storel_epi64((__m128i *)(alpha + x), _mm_or_si128(a, m0));
+    }
+    break;
+  case 3:
+    for (; x + 8 <= w; x += 8) {
+      vi = _mm256_loadu_si256((__m256i *)(idx + x));
+      valid = _mm256_cmpgt_epi32(vi, minus1);
+      vi = _mm256_add_epi32(vi, _mm256_add_epi32(vi, vi));
+      c = _mm256_mask_i32gather_epi32(zero, (const int *)colors, vi,
+				      valid, 1);
+      // join the two 12-byte halves into 16 + 8 bytes
+      c = _mm256_shuffle_epi8(c, pack3);
+      m = _mm256_shuffle_epi8(valid, pack3);
+      c1 = _mm256_extracti128_si256(c, 1);
+      m1 = _mm256_extracti128_si256(m, 1);
+      c0 = _mm_or_si128(_mm256_castsi256_si128(c), _mm_slli_si128(c1, 12));
+      m0 = _mm_or_si128(_mm256_castsi256_si128(m), _mm_slli_si128(m1, 12));
+      c1 = _mm_srli_si128(c1, 4);
+      m1 = _mm_srli_si128(m1, 4);
+      p = data + 3 * x;
+      d = _mm_loadu_si128((__m128i *)p);
+      _mm_storeu_si128((__m128i *)p, _mm_blendv_epi8(d, c0, m0));
+      d = _mm_loadl_epi64((__m128i *)(p + 16));
+      _mm_storel_epi64((__m128i *)(p + 16), _mm_blendv_epi8(d, c1, m1));
+      m = _mm256_shuffle_epi8(valid, pack1);
+      m0 = _mm_unpacklo_epi32(_mm256_castsi256_si128(m),
+			      _mm256_extracti128_si256(m, 1));
+      a = _mm_loadl_epi64((__m128i *)(alpha + x));
+      _mm_storel_epi64((__m128i *)(alpha + x), _mm_or_si128(a, m0));
+    }
+    break;
+  case 4:
+    for (; x + 8 <= w; x += 8) {
+      vi = _mm256_loadu_si256((__m256i *)(idx + x));
+      valid = _mm256_cmpgt_epi32(vi, minus1);
+      c = _mm256_mask_i32gather_epi32(zero, (const int *)colors,
+				      _mm256_slli_epi32(vi, 2), valid, 1);
+      p = data + 4 * x;
+      _mm256_storeu_si256((__m256i *)p,
+			  _mm256_blendv_epi8(_mm256_loadu_si256((__m256i *)p),
+					     c, valid));
+      m = _mm256_shuffle_epi8(valid, pack1);
+      m0 = _mm_unpacklo_epi32(_mm256_castsi256_si128(m),
+			      _mm256_extracti128_si256(m, 1));
+      a = _mm_loadl_epi64((__m128i *)(alpha + x));
+      _mm_storel_epi64((__m128i *)(alpha + x), _mm_or_si128(a, m0));
+    }
+    break;
+  default:
+    break;
+  }
+  if (x < w) {
+    fillShadingRowScalar(data + x * nComps, alpha + x, idx + x, w - x,
+			 colors, nComps);
+  }
+}
+
+#endif // SPLASH_AVX2
+
+//------------------------------------------------------------------------
+// dispatch
+//------------------------------------------------------------------------
+
+static SplashSIMDLevel detectSIMDLevel() {
+#if SPLASH_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return splashSIMDAVX2;
+  }
+#endif
+#if SPLASH_SSE2
+  return splashSIMDSSE2;
+#else
+  return splashSIMDNone;
+#endif
+}
+
+static SplashSIMDLevel cpuLevel = detectSIMDLevel();
+static SplashSIMDLevel curLevel = cpuLevel;
+
+SplashSIMDLevel splashGetSIMDLevel() {
+  return curLevel;
+}
+
+void splashSetSIMDLevel(SplashSIMDLevel level) {
+  curLevel = level < cpuLevel ? level : cpuLevel;
+}
+
+void splashBlendOpaque(Guchar *dest, Guchar *src, Guchar *alpha, int n) {
+  switch (curLevel) {
+#if SPLASH_AVX2
+  case splashSIMDAVX2:
+    blendOpaqueAVX2(dest, src, alpha, n);
+    break;
+#endif
+#if SPLASH_SSE2
+  case splashSIMDSSE2:
+    blendOpaqueSSE2(dest, src, alpha, n);
+    break;
+#endif
+  default:
+    blendOpaqueScalar(dest, src, alpha, n);
+    break;
+  }
+}
+
+void splashBlendBackground(Guchar *dest, Guchar *bg, Guchar *alpha, int n) {
+  switch (curLevel) {
+#if SPLASH_AVX2
+  case splashSIMDAVX2:
+    blendBackgroundAVX2(dest, bg, alpha, n);
+    break;
+#endif
+#if SPLASH_SSE2
+  case splashSIMDSSE2:
+    blendBackgroundSSE2(dest, bg, alpha, n);
+    break;
+#endif
+  default:
+    blendBackgroundScalar(dest, bg, alpha, n);
+    break;
+  }
+}
+
+void splashFillShadingRow(Guchar *data, Guchar *alpha, int *idx, int w,
+			  Guchar *colors, int nComps) {
+  switch (curLevel) {
+#if SPLASH_AVX2
+  case splashSIMDAVX2:
+    fillShadingRowAVX2(data, alpha, idx, w, colors, nComps);
+    break;
+#endif
+  default:
+    fillShadingRowScalar(data, alpha, idx, w, colors, nComps);
+    break;
+  }
+}
@@ -0,0 +1,64 @@
+//========================================================================
+//
+// SplashSIMD.h
+//
+// Vectorized compositing and shading kernels, with the instruction set
+// chosen at run time.
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef SPLASHSIMD_H
+#define SPLASHSIMD_H
+
+#include <aconf.h>
+
+#include "gtypes.h"
+
+//------------------------------------------------------------------------
+
+enum SplashSIMDLevel {
+  splashSIMDNone,		// scalar code only
+  splashSIMDSSE2,
+  splashSIMDAVX2
+};
+
+// The kernels operate on runs of this many bytes.
+#define splashSIMDBlockBytes 16
+
+// Return the instruction set used by the kernels.  If this is
+// splashSIMDNone, callers should use their own scalar code.
+SplashSIMDLevel splashGetSIMDLevel();
+
+// Restrict the kernels to <level> (or to the best instruction set
+// supported by the CPU, if that is lower).  This is mostly useful for
+// testing, and must not be called while any rendering is in
+// progress.
+void splashSetSIMDLevel(SplashSIMDLevel level);
+
+// Source-over blend onto an opaque destination:
+//   dest[i] = ((255 - alpha[i]) * dest[i] + alpha[i] * src[i]) / 255
+// using the same (truncating) integer division as the scalar pipes.
+// <n> must be a multiple of splashSIMDBlockBytes.
+void splashBlendOpaque(Guchar *dest, Guchar *src, Guchar *alpha, int n);
+
+// Composite onto a background color:
+//   dest[i] = div255((255 - alpha[i]) * bg[i] + alpha[i] * dest[i])
+// <n> must be a multiple of splashSIMDBlockBytes.
+void splashBlendBackground(Guchar *dest, Guchar *bg, Guchar *alpha, int n);
+
+// Number of bytes that must follow the last entry of a shading color
+// table (the vector code reads whole 32-bit words).
+#define splashShadingColorsPad 3
+
+// Fill one row of a shading bitmap from a color table.  <idx>[x] is
+// the index of pixel x's color in <colors> (<nComps> bytes per
+// entry), or -1 if the pixel is outside the shading, in which case
+// the pixel is left unchanged.  Filled pixels get an alpha of 255.
+// Unlike the blend functions, this takes any <w>, and uses scalar
+// code when there is no vector version.
+void splashFillShadingRow(Guchar *data, Guchar *alpha, int *idx, int w,
+			  Guchar *colors, int nComps);
+
+#endif
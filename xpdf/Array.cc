@@ -14,8 +14,10 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
 #include "gmem.h"
 #include "gmempp.h"
+#include "GArena.h"
 #include "Object.h"
 #include "Array.h"
 
@@ -30,12 +32,22 @@ Array::Array(XRef *xrefA) {
   ref = 1;
 }
 
+Array::Array(XRef *xrefA, Object *elemsA, int lengthA, GArena *arena) {
+  xref = xrefA;
+  elems = (Object *)gArenaAllocn(arena, lengthA, sizeof(Object));
+  if (lengthA > 0) {
+    memcpy(elems, elemsA, lengthA * sizeof(Object));
+  }
+  size = length = lengthA;
+  ref = 1;
+}
+
 Array::~Array() {
   int i;
 
   for (i = 0; i < length; ++i)
     elems[i].free();
-  gfree(elems);
+  gArenaFree(elems);
 }
 
 void Array::add(Object *elem) {
@@ -45,7 +57,7 @@ void Array::add(Object *elem) {
     } else {
       size *= 2;
     }
-    elems = (Object *)greallocn(elems, size, sizeof(Object));
+    elems = (Object *)gArenaReallocn(NULL, elems, size, sizeof(Object));
   }
   elems[length] = *elem;
   ++length;
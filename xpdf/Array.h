@@ -21,6 +21,7 @@
 #include "Object.h"
 
 class XRef;
+class GArena;
 
 //------------------------------------------------------------------------
 // Array
@@ -32,6 +33,11 @@ public:
   // Constructor.
   Array(XRef *xrefA);
 
+  // Construct an array from the <lengthA> objects in <elemsA>.  The
+  // objects are moved (not copied) into the array, and the element
+  // storage is allocated from <arena>.
+  Array(XRef *xrefA, Object *elemsA, int lengthA, GArena *arena);
+
   // Destructor.
   ~Array();
 
@@ -57,7 +63,8 @@ public:
 private:
 
   XRef *xref;			// the xref table for this PDF file
-  Object *elems;		// array of elements
+  Object *elems;		// array of elements (allocated with
+				//   gArenaAlloc)
   int size;			// size of <elems> array
   int length;			// number of elements in array
 #if MULTITHREADED
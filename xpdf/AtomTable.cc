@@ -0,0 +1,168 @@
+//========================================================================
+//
+// AtomTable.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <stddef.h>
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "AtomTable.h"
+
+//------------------------------------------------------------------------
+
+#define atomTableSize 4096	// number of hash buckets (power of 2)
+#define atomMaxLen     127	// max length of an interned string
+#define atomMaxCount 65536	// max number of interned strings
+
+struct AtomEntry {
+  AtomEntry *next;
+  Guint hash;
+  int tag;
+  int len;
+  char str[1];			// the atom (NUL-terminated)
+};
+
+static AtomEntry * volatile atomTab[atomTableSize];
+#if MULTITHREADED
+static GAtomicCounter atomCount;
+#else
+static int atomCount;
+#endif
+
+static inline AtomEntry *getEntry(const char *atom) {
+  return (AtomEntry *)(atom - offsetof(AtomEntry, str));
+}
+
+// FNV-1a.
+static inline Guint hashChars(const char *s, int len) {
+  Guint h;
+  int i;
+
+  h = 2166136261U;
+  for (i = 0; i < len; ++i) {
+    h = (h ^ (s[i] & 0xff)) * 16777619U;
+  }
+  return h;
+}
+
+// Set *<p> to <newVal> if it is currently equal to <oldVal>.  Returns
+// true if *<p> was changed.
+static inline GBool swapBucket(AtomEntry * volatile *p,
+			       AtomEntry *oldVal, AtomEntry *newVal) {
+#if MULTITHREADED
+#  if defined(_WIN32)
+  return InterlockedCompareExchangePointer((PVOID volatile *)p,
+					   newVal, oldVal) == oldVal;
+#  else
+  return __sync_bool_compare_and_swap(p, oldVal, newVal);
+#  endif
+#else
+  if (*p != oldVal) {
+    return gFalse;
+  }
+  *p = newVal;
+  return gTrue;
+#endif
+}
+
+//------------------------------------------------------------------------
+// AtomTable
+//------------------------------------------------------------------------
+
+char *AtomTable::atomize(const char *s, int len) {
+  AtomEntry *head, *e, *newEntry;
+  Guint h;
+  int i;
+
+  if (len > atomMaxLen) {
+    return NULL;
+  }
+  h = hashChars(s, len);
+  i = (int)(h & (atomTableSize - 1));
+  newEntry = NULL;
+  while (1) {
+    head = atomTab[i];
+    for (e = head; e; e = e->next) {
+      if (e->hash == h && e->len == len && !memcmp(e->str, s, len)) {
+	gfree(newEntry);
+	return e->str;
+      }
+    }
+    if (!newEntry) {
+      if (atomCount >= atomMaxCount) {
+	return NULL;
+      }
+      newEntry = (AtomEntry *)gmalloc((int)sizeof(AtomEntry) + len);
+      newEntry->hash = h;
+      newEntry->tag = 0;
+      newEntry->len = len;
+      memcpy(newEntry->str, s, len);
+      newEntry->str[len] = '\0';
+    }
+    newEntry->next = head;
+    if (swapBucket(&atomTab[i], head, newEntry)) {
+#if MULTITHREADED
+      gAtomicIncrement(&atomCount);
+#else
+      ++atomCount;
+#endif
+      return newEntry->str;
+    }
+    // another thread added an atom to this bucket -- search again,
+    // in case it was this one
+  }
+}
+
+char *AtomTable::find(const char *s, int len, Guint h) {
+  AtomEntry *e;
+
+  for (e = atomTab[h & (atomTableSize - 1)]; e; e = e->next) {
+    if (e->hash == h && e->len == len && !memcmp(e->str, s, len)) {
+      return e->str;
+    }
+  }
+  return NULL;
+}
+
+Guint AtomTable::hash(const char *s, int len) {
+  return hashChars(s, len);
+}
+
+Guint AtomTable::getHash(const char *atom) {
+  return getEntry(atom)->hash;
+}
+
+int AtomTable::getTag(const char *atom) {
+  return getEntry(atom)->tag;
+}
+
+void AtomTable::setTag(const char *atom, int tag) {
+  getEntry(atom)->tag = tag;
+}
+
+void AtomTable::freeAll() {
+  AtomEntry *e, *next;
+  int i;
+
+  for (i = 0; i < atomTableSize; ++i) {
+    for (e = atomTab[i]; e; e = next) {
+      next = e->next;
+      gfree(e);
+    }
+    atomTab[i] = NULL;
+  }
+  atomCount = 0;
+}
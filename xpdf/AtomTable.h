@@ -0,0 +1,67 @@
+//========================================================================
+//
+// AtomTable.h
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef ATOMTABLE_H
+#define ATOMTABLE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+
+//------------------------------------------------------------------------
+// AtomTable
+//
+// A process-wide table of interned strings, used for name objects,
+// content stream operators, and dictionary keys.  An atom is a unique,
+// permanent copy of a string, so two atoms are equal if and only if
+// the pointers are equal.  Atoms must not be modified or freed.
+//
+// Lookups never block, and new atoms are added with an atomic
+// compare-and-swap, so the table can be used from any thread without
+// locking.  To bound the memory used, long strings, and new strings
+// once the table is full, are not interned -- atomize() returns NULL
+// for those, and the caller has to fall back to an allocated copy.
+//------------------------------------------------------------------------
+
+class AtomTable {
+public:
+
+  // Return the atom for the first <len> chars of <s>, adding it to
+  // the table if needed.  Returns NULL if the string can't be
+  // interned.
+  static char *atomize(const char *s, int len);
+
+  // Return the atom for the first <len> chars of <s>, or NULL if that
+  // string is not in the table.  <h> must be hash(s, len).  This never
+  // adds anything to the table.
+  static char *find(const char *s, int len, Guint h);
+
+  // Compute the hash value of the first <len> chars of <s>.
+  static Guint hash(const char *s, int len);
+
+  // Return the hash value of an atom -- this is the same as
+  // hash(atom, len), but doesn't need to look at the string.
+  static Guint getHash(const char *atom);
+
+  // Each atom has one integer tag, initially zero, which can be used
+  // to cache a lookup keyed by the atom (see Gfx::findOp).  Tags are
+  // written without locking, so every writer of a given atom's tag
+  // must store the same value.
+  static int getTag(const char *atom);
+  static void setTag(const char *atom, int tag);
+
+  // Free all of the atoms.  This must only be called when no atoms
+  // are in use -- the GlobalParams destructor calls it.
+  static void freeAll();
+};
+
+#endif
@@ -0,0 +1,279 @@
+//========================================================================
+//
+// ContentStreamCache.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <string.h>
+#include "gmem.h"
+#include "gmempp.h"
+#include "GString.h"
+#include "Object.h"
+#include "ContentStreamCache.h"
+
+//------------------------------------------------------------------------
+
+#define contentStreamCacheHashSize 256	// number of hash buckets
+
+// Per-entry overhead for an array or dictionary element.
+#define compiledContentElemSize ((int)sizeof(Object) + 8)
+
+// Approximate number of bytes used by <obj>, not including the Object
+// itself.
+static int objMemSize(Object *obj) {
+  Object obj2;
+  int n, i;
+
+  n = 0;
+  if (obj->isString()) {
+    n = obj->getString()->getLength();
+  } else if (obj->isArray()) {
+    for (i = 0; i < obj->arrayGetLength(); ++i) {
+      obj->arrayGetNF(i, &obj2);
+      n += compiledContentElemSize + objMemSize(&obj2);
+      obj2.free();
+    }
+  } else if (obj->isDict()) {
+    for (i = 0; i < obj->dictGetLength(); ++i) {
+      obj->dictGetValNF(i, &obj2);
+      n += compiledContentElemSize + objMemSize(&obj2);
+      obj2.free();
+    }
+  }
+  return n;
+}
+
+//------------------------------------------------------------------------
+// CompiledContent
+//------------------------------------------------------------------------
+
+CompiledContent::CompiledContent(int maxMemSizeA) {
+  objs = NULL;
+  offsets = NULL;
+  length = size = 0;
+  memSize = 0;
+  maxMemSize = maxMemSizeA;
+  ok = gTrue;
+  refCnt = 1;
+}
+
+CompiledContent::~CompiledContent() {
+  int i;
+
+  for (i = 0; i < length; ++i) {
+    objs[i].free();
+  }
+  gfree(objs);
+  gfree(offsets);
+}
+
+void CompiledContent::add(Object *obj, GFileOffset pos) {
+  if (!ok) {
+    return;
+  }
+  memSize += (int)sizeof(Object) + (int)sizeof(GFileOffset) +
+	     objMemSize(obj);
+  if (memSize > maxMemSize) {
+    fail();
+    return;
+  }
+  if (length == size) {
+    size = size ? 2 * size : 64;
+    objs = (Object *)greallocn(objs, size, sizeof(Object));
+    offsets = (GFileOffset *)greallocn(offsets, size, sizeof(GFileOffset));
+  }
+  offsets[length] = pos;
+  obj->copy(&objs[length++]);
+}
+
+void CompiledContent::fail() {
+  int i;
+
+  for (i = 0; i < length; ++i) {
+    objs[i].free();
+  }
+  gfree(objs);
+  objs = NULL;
+  gfree(offsets);
+  offsets = NULL;
+  length = size = 0;
+  memSize = 0;
+  ok = gFalse;
+}
+
+void CompiledContent::incRef() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCnt);
+#else
+  ++refCnt;
+#endif
+}
+
+void CompiledContent::decRef() {
+#if MULTITHREADED
+  if (gAtomicDecrement(&refCnt) == 0) {
+#else
+  if (--refCnt == 0) {
+#endif
+    delete this;
+  }
+}
+
+//------------------------------------------------------------------------
+// ContentStreamCache
+//------------------------------------------------------------------------
+
+struct ContentStreamCacheEntry {
+  int num;
+  int gen;
+  CompiledContent *content;
+  ContentStreamCacheEntry *hashNext;	// next entry in the same hash bucket
+  ContentStreamCacheEntry *prev;	// LRU list: previous (more recently
+					//   used)
+  ContentStreamCacheEntry *next;	// LRU list: next (less recently used)
+};
+
+static inline int contentStreamHash(int num, int gen) {
+  return (num ^ (gen << 4)) & (contentStreamCacheHashSize - 1);
+}
+
+ContentStreamCache::ContentStreamCache(int maxBytesA) {
+  maxBytes = maxBytesA < 0 ? 0 : maxBytesA;
+  nBytes = 0;
+  hashTab = (ContentStreamCacheEntry **)
+                gmallocn(contentStreamCacheHashSize,
+			 sizeof(ContentStreamCacheEntry *));
+  memset(hashTab, 0,
+	 contentStreamCacheHashSize * sizeof(ContentStreamCacheEntry *));
+  head = tail = NULL;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+ContentStreamCache::~ContentStreamCache() {
+  ContentStreamCacheEntry *e, *next;
+
+  for (e = head; e; e = next) {
+    next = e->next;
+    e->content->decRef();
+    gfree(e);
+  }
+  gfree(hashTab);
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+CompiledContent *ContentStreamCache::lookup(int num, int gen) {
+  ContentStreamCacheEntry *e;
+  CompiledContent *content;
+
+  if (!maxBytes) {
+    return NULL;
+  }
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  for (e = hashTab[contentStreamHash(num, gen)]; e; e = e->hashNext) {
+    if (e->num == num && e->gen == gen) {
+      break;
+    }
+  }
+  content = NULL;
+  if (e) {
+    // move the entry to the front of the LRU list
+    if (e != head) {
+      e->prev->next = e->next;
+      if (e->next) {
+	e->next->prev = e->prev;
+      } else {
+	tail = e->prev;
+      }
+      e->prev = NULL;
+      e->next = head;
+      head->prev = e;
+      head = e;
+    }
+    content = e->content;
+    content->incRef();
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return content;
+}
+
+void ContentStreamCache::add(int num, int gen, CompiledContent *content) {
+  ContentStreamCacheEntry *e;
+  int h;
+
+  if (!maxBytes || !content->isOk() ||
+      content->getMemSize() > getMaxEntrySize()) {
+    return;
+  }
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  // another thread may have added this stream in the meantime
+  h = contentStreamHash(num, gen);
+  for (e = hashTab[h]; e; e = e->hashNext) {
+    if (e->num == num && e->gen == gen) {
+      break;
+    }
+  }
+  if (!e) {
+    e = (ContentStreamCacheEntry *)gmalloc(sizeof(ContentStreamCacheEntry));
+    e->num = num;
+    e->gen = gen;
+    e->content = content;
+    content->incRef();
+    e->hashNext = hashTab[h];
+    hashTab[h] = e;
+    e->prev = NULL;
+    e->next = head;
+    if (head) {
+      head->prev = e;
+    } else {
+      tail = e;
+    }
+    head = e;
+    nBytes += content->getMemSize();
+    evict();
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
+// Remove least recently used entries until the cache is within its
+// budget.
+// NB: the mutex must be locked when calling this function.
+void ContentStreamCache::evict() {
+  ContentStreamCacheEntry *e, **p;
+
+  while (nBytes > maxBytes && tail) {
+    e = tail;
+    for (p = &hashTab[contentStreamHash(e->num, e->gen)];
+	 *p != e;
+	 p = &(*p)->hashNext) ;
+    *p = e->hashNext;
+    tail = e->prev;
+    if (tail) {
+      tail->next = NULL;
+    } else {
+      head = NULL;
+    }
+    nBytes -= e->content->getMemSize();
+    e->content->decRef();
+    gfree(e);
+  }
+}
@@ -0,0 +1,131 @@
+//========================================================================
+//
+// ContentStreamCache.h
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef CONTENTSTREAMCACHE_H
+#define CONTENTSTREAMCACHE_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+#include "Object.h"
+
+struct ContentStreamCacheEntry;
+
+//------------------------------------------------------------------------
+// CompiledContent
+//
+// A content stream which has been run through the Parser, stored as a
+// flat list of operands and operators.  Gfx can replay it without
+// touching the Lexer/Parser again.  Once it has been added to a
+// ContentStreamCache, a CompiledContent object is read-only, and can
+// be shared by multiple threads.
+//------------------------------------------------------------------------
+
+class CompiledContent {
+public:
+
+  // Create an empty list, which will give up (see fail()) if it grows
+  // beyond <maxMemSizeA> bytes.
+  CompiledContent(int maxMemSizeA);
+
+  // Append a copy of <obj> (an operand or a command), which was read
+  // from file offset <pos> in the content stream.
+  void add(Object *obj, GFileOffset pos);
+
+  // Discard the list -- this is used if the content stream can't be
+  // replayed (e.g., it contains an inline image, or parsing was
+  // aborted).
+  void fail();
+
+  // Returns false if fail() was called.
+  GBool isOk() { return ok; }
+
+  Object *getObjects() { return objs; }
+  GFileOffset *getOffsets() { return offsets; }
+  int getLength() { return length; }
+
+  // Approximate number of bytes used by the list.
+  int getMemSize() { return memSize; }
+
+  // Reference counting.
+  void incRef();
+  void decRef();
+
+private:
+
+  ~CompiledContent();
+
+  Object *objs;			// operands and commands, in stream order
+  GFileOffset *offsets;		// stream offset of each object in <objs>
+  int length;			// number of objects in <objs>
+  int size;			// size of the <objs> and <offsets> arrays
+  int memSize;			// approximate memory used
+  int maxMemSize;		// max value of <memSize>
+  GBool ok;			// false if the list was discarded
+#if MULTITHREADED
+  GAtomicCounter refCnt;
+#else
+  int refCnt;
+#endif
+};
+
+//------------------------------------------------------------------------
+// ContentStreamCache
+//
+// A cache of compiled content streams (Form XObjects, tiling pattern
+// cells, Type 3 glyphs), keyed by object number, with a byte budget
+// and least-recently-used eviction.  This is thread-safe.
+//------------------------------------------------------------------------
+
+class ContentStreamCache {
+public:
+
+  // Create a cache holding at most <maxBytesA> bytes of compiled
+  // content (zero disables caching).
+  ContentStreamCache(int maxBytesA);
+
+  ~ContentStreamCache();
+
+  // Returns false if caching is disabled.
+  GBool isEnabled() { return maxBytes > 0; }
+
+  // Max size of a single compiled content stream that will be
+  // accepted by add().
+  int getMaxEntrySize() { return maxBytes / 4; }
+
+  // Look up content stream <num, gen>.  If it is cached, add a
+  // reference to it (which the caller must release with decRef) and
+  // return it; otherwise return NULL.
+  CompiledContent *lookup(int num, int gen);
+
+  // Add <content> to the cache as content stream <num, gen>.  The
+  // cache takes its own reference to <content>.
+  void add(int num, int gen, CompiledContent *content);
+
+private:
+
+  void evict();
+
+  ContentStreamCacheEntry **hashTab;	// hash buckets
+  ContentStreamCacheEntry *head;	// most recently used entry
+  ContentStreamCacheEntry *tail;	// least recently used entry
+  int maxBytes;			// max total memSize of cached entries
+  int nBytes;			// current total memSize of cached entries
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+#endif
@@ -0,0 +1,496 @@
+//========================================================================
+//
+// DCTSIMD.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include "DCTSIMD.h"
+
+// SSE2 is always available on 64-bit x86, and on 32-bit x86 when the
+// compiler has been told to use it.  AVX2 code is compiled with a
+// per-function target attribute, and only used if the CPU supports it.
+#if (defined(__GNUC__) && defined(__SSE2__)) || \
+    (defined(_WIN32) && (_M_IX86_FP == 2 || defined(_M_X64)))
+#  define DCT_SSE2 1
+#  include <emmintrin.h>
+#  if defined(__GNUC__) && \
+      (defined(__clang__) || __GNUC__ > 4 || \
+       (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#    define DCT_AVX2 1
+#    include <immintrin.h>
+#  endif
+#endif
+
+//------------------------------------------------------------------------
+// common
+//------------------------------------------------------------------------
+
+// One 1-D inverse DCT, applied to eight vectors of 32-bit values.
+// This is the same sequence of operations as the row and column loops
+// in DCTStream::transformDataUnit (see the comments there); because
+// it uses only additions, subtractions, and arithmetic shifts, the
+// results are bit-for-bit identical.
+#define dctIDCT1D(x, ADD, SUB, SRA, V)					\
+  {									\
+    V v0, v1, v2, v3, v4, v5, v6, v7;					\
+    V t0, t1, t2, t3, t4, t5, t6, t7;					\
+    /* stage 4 */							\
+    v0 = x[0];								\
+    v1 = x[4];								\
+    v2 = x[2];								\
+    v3 = x[6];								\
+    v4 = SUB(x[1], x[7]);						\
+    v7 = ADD(x[1], x[7]);						\
+    v5 = x[3];								\
+    v6 = x[5];								\
+    /* stage 3 */							\
+    t0 = SUB(v0, v1);							\
+    v0 = ADD(v0, v1);							\
+    v1 = t0;								\
+    t0 = ADD(v2, SRA(v2, 5));						\
+    t1 = SRA(t0, 2);							\
+    t2 = ADD(t1, SRA(v2, 4));						\
+    t3 = SUB(t0, t1);							\
+    t4 = ADD(v3, SRA(v3, 5));						\
+    t5 = SRA(t4, 2);							\
+    t6 = ADD(t5, SRA(v3, 4));						\
+    t7 = SUB(t4, t5);							\
+    v2 = SUB(t2, t7);							\
+    v3 = ADD(t3, t6);							\
+    t0 = SUB(v4, v6);							\
+    v4 = ADD(v4, v6);							\
+    v6 = t0;								\
+    t0 = ADD(v7, v5);							\
+    v5 = SUB(v7, v5);							\
+    v7 = t0;								\
+    /* stage 2 */							\
+    t0 = SUB(v0, v3);							\
+    v0 = ADD(v0, v3);							\
+    v3 = t0;								\
+    t0 = SUB(v1, v2);							\
+    v1 = ADD(v1, v2);							\
+    v2 = t0;								\
+    t0 = SUB(SRA(v4, 9), v4);						\
+    t1 = SRA(v4, 1);							\
+    t2 = SUB(SRA(t0, 2), t0);						\
+    t3 = SUB(SRA(v7, 9), v7);						\
+    t4 = SRA(v7, 1);							\
+    t5 = SUB(SRA(t3, 2), t3);						\
+    v4 = SUB(t2, t4);							\
+    v7 = ADD(t1, t5);							\
+    t0 = SUB(SRA(v5, 3), SRA(v5, 7));					\
+    t1 = SUB(t0, SRA(v5, 11));						\
+    t2 = ADD(t0, SRA(t1, 1));						\
+    t3 = SUB(v5, t0);							\
+    t4 = SUB(SRA(v6, 3), SRA(v6, 7));					\
+    t5 = SUB(t4, SRA(v6, 11));						\
+    t6 = ADD(t4, SRA(t5, 1));						\
+    t7 = SUB(v6, t4);							\
+    v5 = SUB(t3, t6);							\
+    v6 = ADD(t2, t7);							\
+    /* stage 1 */							\
+    x[0] = ADD(v0, v7);							\
+    x[7] = SUB(v0, v7);							\
+    x[1] = ADD(v1, v6);							\
+    x[6] = SUB(v1, v6);							\
+    x[2] = ADD(v2, v5);							\
+    x[5] = SUB(v2, v5);							\
+    x[3] = ADD(v3, v4);							\
+    x[4] = SUB(v3, v4);							\
+  }
+
+// The scalar code computes dctClip(128 + (x >> 13)), i.e., a lookup
+// in a 1024-entry table indexed by (512 + (x >> 13)) & 1023.  Entry
+// m of that table is clip(m - 384), except for entry 1023, which is
+// zero.  The kernels compute m - 384 (or zero, for m = 1023), and let
+// the saturating packs do the clipping.
+
+#if DCT_SSE2
+
+// Shuffle masks for the YCbCr conversion: (de)interleaving sixteen
+// 3-byte pixels, and transposing 4x4 blocks of bytes.
+static __m128i split3Mask[3][3];	// [component][input block]
+static __m128i merge3Mask[3][3];	// [output block][component]
+static __m128i transpose4Mask;
+
+static void initShuffleMasks() {
+  Guchar split[3][3][16], merge[3][3][16], tr[16];
+  int comp, blk, i, j;
+
+  for (comp = 0; comp < 3; ++comp) {
+    for (blk = 0; blk < 3; ++blk) {
+      for (i = 0; i < 16; ++i) {
+	// byte i of component <comp> is at offset 3*i + comp
+	j = 3 * i + comp;
+	split[comp][blk][i] = (Guchar)(j / 16 == blk ? j % 16 : 0x80);
+	// byte i of output block <blk> is at offset 16*blk + i
+	j = 16 * blk + i;
+	merge[blk][comp][i] = (Guchar)(j % 3 == comp ? j / 3 : 0x80);
+      }
+    }
+  }
+  for (i = 0; i < 16; ++i) {
+    tr[i] = (Guchar)((i & 3) * 4 + (i >> 2));
+  }
+  for (comp = 0; comp < 3; ++comp) {
+    for (blk = 0; blk < 3; ++blk) {
+      split3Mask[comp][blk] = _mm_loadu_si128((__m128i *)split[comp][blk]);
+      merge3Mask[blk][comp] = _mm_loadu_si128((__m128i *)merge[blk][comp]);
+    }
+  }
+  transpose4Mask = _mm_loadu_si128((__m128i *)tr);
+}
+
+#endif // DCT_SSE2
+
+//------------------------------------------------------------------------
+// SSE2
+//------------------------------------------------------------------------
+
+#if DCT_SSE2
+
+#define sse2Add(a, b) _mm_add_epi32(a, b)
+#define sse2Sub(a, b) _mm_sub_epi32(a, b)
+#define sse2Sra(a, n) _mm_srai_epi32(a, n)
+
+// Transpose a 4x4 block of 32-bit values.
+static inline void transpose4x4SSE2(__m128i &r0, __m128i &r1,
+				    __m128i &r2, __m128i &r3) {
+  __m128i t0, t1, t2, t3;
+
+  t0 = _mm_unpacklo_epi32(r0, r1);
+  t1 = _mm_unpacklo_epi32(r2, r3);
+  t2 = _mm_unpackhi_epi32(r0, r1);
+  t3 = _mm_unpackhi_epi32(r2, r3);
+  r0 = _mm_unpacklo_epi64(t0, t1);
+  r1 = _mm_unpackhi_epi64(t0, t1);
+  r2 = _mm_unpacklo_epi64(t2, t3);
+  r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+static inline __m128i clipSSE2(__m128i x) {
+  __m128i m;
+
+  m = _mm_and_si128(_mm_add_epi32(_mm_srai_epi32(x, 13),
+				  _mm_set1_epi32(512)),
+		    _mm_set1_epi32(1023));
+  return _mm_andnot_si128(_mm_cmpeq_epi32(m, _mm_set1_epi32(1023)),
+			  _mm_sub_epi32(m, _mm_set1_epi32(384)));
+}
+
+// The data unit is handled as two 8x4 halves.  a[] holds columns
+// 0..7 of rows 0..3 (and then 4..7) for the row transform; b[] holds
+// rows 0..7 of columns 0..3 (and then 4..7) for the column transform.
+static void inverseTransformSSE2(int data[64], Guchar out[64]) {
+  __m128i a[8], b0[8], b1[8], lo, hi;
+  int g, i;
+
+  // inverse DCT on rows
+  for (g = 0; g < 8; g += 4) {
+    for (i = 0; i < 4; ++i) {
+      a[i] = _mm_loadu_si128((__m128i *)(data + (g + i) * 8));
+      a[i + 4] = _mm_loadu_si128((__m128i *)(data + (g + i) * 8 + 4));
+    }
+    transpose4x4SSE2(a[0], a[1], a[2], a[3]);
+    transpose4x4SSE2(a[4], a[5], a[6], a[7]);
+    dctIDCT1D(a, sse2Add, sse2Sub, sse2Sra, __m128i);
+    transpose4x4SSE2(a[0], a[1], a[2], a[3]);
+    transpose4x4SSE2(a[4], a[5], a[6], a[7]);
+    for (i = 0; i < 4; ++i) {
+      b0[g + i] = a[i];
+      b1[g + i] = a[i + 4];
+    }
+  }
+
+  // inverse DCT on columns
+  dctIDCT1D(b0, sse2Add, sse2Sub, sse2Sra, __m128i);
+  dctIDCT1D(b1, sse2Add, sse2Sub, sse2Sra, __m128i);
+
+  // convert to 8-bit integers
+  for (i = 0; i < 8; i += 2) {
+    lo = _mm_packs_epi32(clipSSE2(b0[i]), clipSSE2(b1[i]));
+    hi = _mm_packs_epi32(clipSSE2(b0[i + 1]), clipSSE2(b1[i + 1]));
+    _mm_storeu_si128((__m128i *)(out + i * 8), _mm_packus_epi16(lo, hi));
+  }
+}
+
+#endif // DCT_SSE2
+
+//------------------------------------------------------------------------
+// AVX2
+//------------------------------------------------------------------------
+
+#if DCT_AVX2
+
+#define avx2Add(a, b) _mm256_add_epi32(a, b)
+#define avx2Sub(a, b) _mm256_sub_epi32(a, b)
+#define avx2Sra(a, n) _mm256_srai_epi32(a, n)
+
+// Transpose an 8x8 block of 32-bit values.
+__attribute__((target("avx2")))
+static inline void transpose8x8AVX2(__m256i *r) {
+  __m256i t0, t1, t2, t3, t4, t5, t6, t7;
+  __m256i u0, u1, u2, u3, u4, u5, u6, u7;
+
+  t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+  t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+  t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+  t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+  t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+  t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+  t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+  t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+  u0 = _mm256_unpacklo_epi64(t0, t2);
+  u1 = _mm256_unpackhi_epi64(t0, t2);
+  u2 = _mm256_unpacklo_epi64(t1, t3);
+  u3 = _mm256_unpackhi_epi64(t1, t3);
+  u4 = _mm256_unpacklo_epi64(t4, t6);
+  u5 = _mm256_unpackhi_epi64(t4, t6);
+  u6 = _mm256_unpacklo_epi64(t5, t7);
+  u7 = _mm256_unpackhi_epi64(t5, t7);
+  r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+  r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+  r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+  r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+  r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+  r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+  r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+  r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i clipAVX2(__m256i x) {
+  __m256i m;
+
+  m = _mm256_and_si256(_mm256_add_epi32(_mm256_srai_epi32(x, 13),
+					_mm256_set1_epi32(512)),
+		       _mm256_set1_epi32(1023));
+  return _mm256_andnot_si256(_mm256_cmpeq_epi32(m, _mm256_set1_epi32(1023)),
+			     _mm256_sub_epi32(m, _mm256_set1_epi32(384)));
+}
+
+__attribute__((target("avx2")))
+static void inverseTransformAVX2(int data[64], Guchar out[64]) {
+  __m256i r[8], p0, p1;
+  int i;
+
+  for (i = 0; i < 8; ++i) {
+    r[i] = _mm256_loadu_si256((__m256i *)(data + i * 8));
+  }
+
+  // inverse DCT on rows
+  transpose8x8AVX2(r);
+  dctIDCT1D(r, avx2Add, avx2Sub, avx2Sra, __m256i);
+  transpose8x8AVX2(r);
+
+  // inverse DCT on columns
+  dctIDCT1D(r, avx2Add, avx2Sub, avx2Sra, __m256i);
+
+  // convert to 8-bit integers -- the packs work within 128-bit
+  // lanes, so the 64-bit pieces need to be put back in order
+  for (i = 0; i < 8; i += 4) {
+    p0 = _mm256_permute4x64_epi64(
+	     _mm256_packs_epi32(clipAVX2(r[i]), clipAVX2(r[i + 1])), 0xd8);
+    p1 = _mm256_permute4x64_epi64(
+	     _mm256_packs_epi32(clipAVX2(r[i + 2]), clipAVX2(r[i + 3])), 0xd8);
+    _mm256_storeu_si256((__m256i *)(out + i * 8),
+			_mm256_permute4x64_epi64(_mm256_packus_epi16(p0, p1),
+						 0xd8));
+  }
+}
+
+// Convert sixteen pixels from YCbCr to RGB.  The 16.16 fixed-point
+// products are split so that all of the multipliers fit in 16 bits:
+//   (91881 * cr + 32768) >> 16  = cr + ((26345 * cr + 32768) >> 16)
+//   (-22553 * cb - 46802 * cr + 32768) >> 16
+//                               = -cr + ((-22553 * cb + 18734 * cr
+//                                         + 32768) >> 16)
+//   (116130 * cb + 32768) >> 16 = 2 * cb + ((-14942 * cb + 32768) >> 16)
+// All of the results are in [-227, 480], so the saturating pack does
+// the same thing as dctClip.
+__attribute__((target("avx2")))
+static inline void ycbcrToRGBAVX2(__m128i &c0, __m128i &c1, __m128i &c2) {
+  __m256i y, cb, cr, lo, hi, round, offset, r, g, b;
+
+  offset = _mm256_set1_epi16(128);
+  round = _mm256_set1_epi32(32768);
+  y = _mm256_cvtepu8_epi16(c0);
+  cb = _mm256_sub_epi16(_mm256_cvtepu8_epi16(c1), offset);
+  cr = _mm256_sub_epi16(_mm256_cvtepu8_epi16(c2), offset);
+  lo = _mm256_unpacklo_epi16(cb, cr);
+  hi = _mm256_unpackhi_epi16(cb, cr);
+  r = _mm256_packs_epi32(
+	  _mm256_srai_epi32(_mm256_add_epi32(
+	      _mm256_madd_epi16(lo, _mm256_set1_epi32(26345 << 16)),
+	      round), 16),
+	  _mm256_srai_epi32(_mm256_add_epi32(
+	      _mm256_madd_epi16(hi, _mm256_set1_epi32(26345 << 16)),
+	      round), 16));
+  g = _mm256_packs_epi32(
+	  _mm256_srai_epi32(_mm256_add_epi32(
+	      _mm256_madd_epi16(lo, _mm256_set1_epi32((18734 << 16) |
+						      (-22553 & 0xffff))),
+	      round), 16),
+	  _mm256_srai_epi32(_mm256_add_epi32(
+	      _mm256_madd_epi16(hi, _mm256_set1_epi32((18734 << 16) |
+						      (-22553 & 0xffff))),
+	      round), 16));
+  b = _mm256_packs_epi32(
+	  _mm256_srai_epi32(_mm256_add_epi32(
+	      _mm256_madd_epi16(lo, _mm256_set1_epi32(-14942 & 0xffff)),
+	      round), 16),
+	  _mm256_srai_epi32(_mm256_add_epi32(
+	      _mm256_madd_epi16(hi, _mm256_set1_epi32(-14942 & 0xffff)),
+	      round), 16));
+  r = _mm256_add_epi16(_mm256_add_epi16(y, cr), r);
+  g = _mm256_sub_epi16(_mm256_add_epi16(y, g), cr);
+  b = _mm256_add_epi16(_mm256_add_epi16(y, _mm256_add_epi16(cb, cb)), b);
+  c0 = _mm_packus_epi16(_mm256_castsi256_si128(r),
+			_mm256_extracti128_si256(r, 1));
+  c1 = _mm_packus_epi16(_mm256_castsi256_si128(g),
+			_mm256_extracti128_si256(g, 1));
+  c2 = _mm_packus_epi16(_mm256_castsi256_si128(b),
+			_mm256_extracti128_si256(b, 1));
+}
+
+__attribute__((target("avx2")))
+static int convertYCbCrAVX2(Guchar *p, int n, int nComps) {
+  __m128i in0, in1, in2, c0, c1, c2, c3, t0, t1, t2, t3, ones;
+  int i;
+
+  if (nComps == 3) {
+    for (i = 0; i + 16 <= n; i += 16, p += 48) {
+      in0 = _mm_loadu_si128((__m128i *)p);
+      in1 = _mm_loadu_si128((__m128i *)(p + 16));
+      in2 = _mm_loadu_si128((__m128i *)(p + 32));
+      c0 = _mm_or_si128(
+	       _mm_or_si128(_mm_shuffle_epi8(in0, split3Mask[0][0]),
+			    _mm_shuffle_epi8(in1, split3Mask[0][1])),
+	       _mm_shuffle_epi8(in2, split3Mask[0][2]));
+      c1 = _mm_or_si128(
+	       _mm_or_si128(_mm_shuffle_epi8(in0, split3Mask[1][0]),
+			    _mm_shuffle_epi8(in1, split3Mask[1][1])),
+	       _mm_shuffle_epi8(in2, split3Mask[1][2]));
+      c2 = _mm_or_si128(
+	       _mm_or_si128(_mm_shuffle_epi8(in0, split3Mask[2][0]),
+			    _mm_shuffle_epi8(in1, split3Mask[2][1])),
+	       _mm_shuffle_epi8(in2, split3Mask[2][2]));
+      ycbcrToRGBAVX2(c0, c1, c2);
+      _mm_storeu_si128((__m128i *)p, _mm_or_si128(
+	  _mm_or_si128(_mm_shuffle_epi8(c0, merge3Mask[0][0]),
+		       _mm_shuffle_epi8(c1, merge3Mask[0][1])),
+	  _mm_shuffle_epi8(c2, merge3Mask[0][2])));
+      _mm_storeu_si128((__m128i *)(p + 16), _mm_or_si128(
+	  _mm_or_si128(_mm_shuffle_epi8(c0, merge3Mask[1][0]),
+		       _mm_shuffle_epi8(c1, merge3Mask[1][1])),
+	  _mm_shuffle_epi8(c2, merge3Mask[1][2])));
+      _mm_storeu_si128((__m128i *)(p + 32), _mm_or_si128(
+	  _mm_or_si128(_mm_shuffle_epi8(c0, merge3Mask[2][0]),
+		       _mm_shuffle_epi8(c1, merge3Mask[2][1])),
+	  _mm_shuffle_epi8(c2, merge3Mask[2][2])));
+    }
+    return i;
+  }
+
+  // YCbCrK: each 16-byte block holds four pixels -- transposing the
+  // bytes within each block, then transposing the 32-bit words across
+  // the four blocks, gives one register per component
+  ones = _mm_set1_epi8((char)0xff);
+  for (i = 0; i + 16 <= n; i += 16, p += 64) {
+    c0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)p), transpose4Mask);
+    c1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(p + 16)),
+			  transpose4Mask);
+    c2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(p + 32)),
+			  transpose4Mask);
+    c3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(p + 48)),
+			  transpose4Mask);
+    transpose4x4SSE2(c0, c1, c2, c3);
+    ycbcrToRGBAVX2(c0, c1, c2);
+    // 255 - x, for x in [0, 255]
+    t0 = _mm_xor_si128(c0, ones);
+    t1 = _mm_xor_si128(c1, ones);
+    t2 = _mm_xor_si128(c2, ones);
+    t3 = c3;
+    transpose4x4SSE2(t0, t1, t2, t3);
+    _mm_storeu_si128((__m128i *)p, _mm_shuffle_epi8(t0, transpose4Mask));
+    _mm_storeu_si128((__m128i *)(p + 16),
+		     _mm_shuffle_epi8(t1, transpose4Mask));
+    _mm_storeu_si128((__m128i *)(p + 32),
+		     _mm_shuffle_epi8(t2, transpose4Mask));
+    _mm_storeu_si128((__m128i *)(p + 48),
+		     _mm_shuffle_epi8(t3, transpose4Mask));
+  }
+  return i;
+}
+
+#endif // DCT_AVX2
+
+//------------------------------------------------------------------------
+// dispatch
+//------------------------------------------------------------------------
+
+static DCTSIMDLevel detectSIMDLevel() {
+#if DCT_SSE2
+  initShuffleMasks();
+#endif
+#if DCT_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return dctSIMDAVX2;
+  }
+#endif
+#if DCT_SSE2
+  return dctSIMDSSE2;
+#else
+  return dctSIMDNone;
+#endif
+}
+
+static DCTSIMDLevel cpuLevel = detectSIMDLevel();
+static DCTSIMDLevel curLevel = cpuLevel;
+
+DCTSIMDLevel dctGetSIMDLevel() {
+  return curLevel;
+}
+
+void dctSetSIMDLevel(DCTSIMDLevel level) {
+  curLevel = level < cpuLevel ? level : cpuLevel;
+}
+
+void dctInverseTransform(int data[64], Guchar out[64]) {
+  switch (curLevel) {
+#if DCT_AVX2
+  case dctSIMDAVX2:
+    inverseTransformAVX2(data, out);
+    break;
+#endif
+#if DCT_SSE2
+  case dctSIMDSSE2:
+    inverseTransformSSE2(data, out);
+    break;
+#endif
+  default:
+    break;
+  }
+}
+
+int dctConvertYCbCr(Guchar *p, int n, int nComps) {
+  switch (curLevel) {
+#if DCT_AVX2
+  case dctSIMDAVX2:
+    return convertYCbCrAVX2(p, n, nComps);
+#endif
+  default:
+    // the SSE2 instruction set has no byte shuffle, which makes the
+    // (de)interleaving too expensive to be worthwhile
+    return 0;
+  }
+}
@@ -0,0 +1,50 @@
+//========================================================================
+//
+// DCTSIMD.h
+//
+// Vectorized kernels for the built-in DCT decoder, with the
+// instruction set chosen at run time.
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef DCTSIMD_H
+#define DCTSIMD_H
+
+#include <aconf.h>
+
+#include "gtypes.h"
+
+//------------------------------------------------------------------------
+
+enum DCTSIMDLevel {
+  dctSIMDNone,			// scalar code only
+  dctSIMDSSE2,
+  dctSIMDAVX2
+};
+
+// Return the instruction set used by the kernels.  If this is
+// dctSIMDNone, callers should use their own scalar code.
+DCTSIMDLevel dctGetSIMDLevel();
+
+// Restrict the kernels to <level> (or to the best instruction set
+// supported by the CPU, if that is lower).  This is mostly useful for
+// testing, and must not be called while any stream is being decoded.
+void dctSetSIMDLevel(DCTSIMDLevel level);
+
+// Inverse DCT of one dequantized (and rounding-biased) data unit,
+// followed by level shifting and clipping to 8 bits.  This computes
+// exactly the same values as the scalar code in
+// DCTStream::transformDataUnit.  <data> is used as scratch space.
+// Must not be called if the SIMD level is dctSIMDNone.
+void dctInverseTransform(int data[64], Guchar out[64]);
+
+// Convert interleaved YCbCr (<nComps> = 3) or YCbCrK (<nComps> = 4)
+// pixels in place to RGB or CMYK, using the same fixed-point
+// arithmetic as DCTStream.  This handles a (possibly empty) leading
+// part of the <n> pixels, and returns the number of pixels converted
+// -- the caller is responsible for the rest.
+int dctConvertYCbCr(Guchar *p, int n, int nComps);
+
+#endif
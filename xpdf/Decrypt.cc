@@ -15,11 +15,16 @@
 #include <string.h>
 #include "gmem.h"
 #include "gmempp.h"
+#include "DecryptSIMD.h"
 #include "Decrypt.h"
 
+static void aesDecryptBlocks(DecryptAESState *s, Guchar *in, Guchar *out,
+			     int nBlocks);
 static void aes256KeyExpansion(DecryptAES256State *s,
 			       Guchar *objKey, int objKeyLen);
 static void aes256DecryptBlock(DecryptAES256State *s, Guchar *in, GBool last);
+static void aes256DecryptBlocks(DecryptAES256State *s, Guchar *in,
+				Guchar *out, int nBlocks);
 static void sha256(Guchar *msg, int msgLen, Guchar *hash);
 static void sha384(Guchar *msg, int msgLen, Guchar *hash);
 static void sha512(Guchar *msg, int msgLen, Guchar *hash);
@@ -215,9 +220,13 @@ void Decrypt::r6Hash(Guchar *key, int keyLen, const char *pwd, int pwdLen,
     for (j = 0; j < 16; ++j) {
       state128.cbc[j] = key[16+j];
     }
-    for (j = 0; j < n; j += 16) {
-      aesEncryptBlock(&state128, key1 + j);
-      memcpy(key1 + j, state128.buf, 16);
+    if (decryptGetSIMDLevel() != decryptSIMDNone) {
+      decryptAESCBCEncrypt(state128.w, 10, state128.cbc, key1, key1, n / 16);
+    } else {
+      for (j = 0; j < n; j += 16) {
+	aesEncryptBlock(&state128, key1 + j);
+	memcpy(key1 + j, state128.buf, 16);
+      }
     }
     k = 0;
     for (j = 0; j < 16; ++j) {
@@ -502,6 +511,97 @@ int DecryptStream::lookChar() {
   return c;
 }
 
+int DecryptStream::getBlock(char *blk, int size) {
+  Guchar in[16];
+  Guchar *p, *buf;
+  int *bufIdx;
+  GBool atEnd, lastBlock;
+  int n, nBlocks, nRead, i;
+
+  if (algo == cryptRC4) {
+    n = 0;
+    if (size > 0 && state.rc4.buf != EOF) {
+      blk[n++] = (char)state.rc4.buf;
+      state.rc4.buf = EOF;
+    }
+    nRead = str->getBlock(blk + n, size - n);
+    p = (Guchar *)blk + n;
+    for (i = 0; i < nRead; ++i) {
+      p[i] = rc4DecryptByte(state.rc4.state, &state.rc4.x, &state.rc4.y,
+			    p[i]);
+    }
+    return n + nRead;
+  }
+
+  if (algo == cryptAES) {
+    buf = state.aes.buf;
+    bufIdx = &state.aes.bufIdx;
+  } else {
+    buf = state.aes256.buf;
+    bufIdx = &state.aes256.bufIdx;
+  }
+  n = 0;
+  while (n < size) {
+
+    // copy out any previously decrypted bytes
+    if (*bufIdx < 16) {
+      i = 16 - *bufIdx;
+      if (i > size - n) {
+	i = size - n;
+      }
+      memcpy(blk + n, buf + *bufIdx, i);
+      *bufIdx += i;
+      n += i;
+      continue;
+    }
+
+    // decrypt whole blocks in place in the caller's buffer -- except
+    // for the last block in the stream, which goes through the state
+    // buffer so the padding can be removed
+    nBlocks = (size - n) / 16;
+    if (nBlocks > 0) {
+      p = (Guchar *)blk + n;
+      nRead = str->getBlock((char *)p, nBlocks * 16);
+      atEnd = nRead < nBlocks * 16 || str->lookChar() == EOF;
+      nBlocks = nRead / 16;
+      lastBlock = atEnd && nBlocks > 0 && nRead == nBlocks * 16;
+      if (lastBlock) {
+	--nBlocks;
+	memcpy(in, p + nBlocks * 16, 16);
+      }
+      if (algo == cryptAES) {
+	aesDecryptBlocks(&state.aes, p, p, nBlocks);
+      } else {
+	aes256DecryptBlocks(&state.aes256, p, p, nBlocks);
+      }
+      n += nBlocks * 16;
+      if (!lastBlock) {
+	if (atEnd) {
+	  break;
+	}
+	continue;
+      }
+
+    // fewer than 16 bytes wanted: read one block
+    } else {
+      if (str->getBlock((char *)in, 16) != 16) {
+	break;
+      }
+      lastBlock = str->lookChar() == EOF;
+    }
+
+    if (algo == cryptAES) {
+      aesDecryptBlock(&state.aes, in, lastBlock);
+    } else {
+      aes256DecryptBlock(&state.aes256, in, lastBlock);
+    }
+    if (*bufIdx == 16) {
+      break;
+    }
+  }
+  return n;
+}
+
 GBool DecryptStream::isBinary(GBool last) {
   return str->isBinary(last);
 }
@@ -783,6 +883,24 @@ static inline void addRoundKey(Guchar *state, Guint *w) {
   }
 }
 
+// Set up the output buffer for a decrypted block, removing the
+// padding if this is the last block.
+static void aesRemovePadding(Guchar *buf, int *bufIdx, GBool last) {
+  int n, i;
+
+  *bufIdx = 0;
+  if (last) {
+    n = buf[15];
+    if (n < 1 || n > 16) { // this should never happen
+      n = 16;
+    }
+    for (i = 15; i >= n; --i) {
+      buf[i] = buf[i-n];
+    }
+    *bufIdx = n;
+  }
+}
+
 void aesKeyExpansion(DecryptAESState *s,
 		     Guchar *objKey, int objKeyLen,
 		     GBool decrypt) {
@@ -846,7 +964,13 @@ void aesEncryptBlock(DecryptAESState *s, Guchar *in) {
 }
 
 void aesDecryptBlock(DecryptAESState *s, Guchar *in, GBool last) {
-  int c, round, n, i;
+  int c, round, i;
+
+  if (decryptGetSIMDLevel() != decryptSIMDNone) {
+    decryptAESCBCDecrypt(s->w, 10, s->cbc, in, s->buf, 1);
+    aesRemovePadding(s->buf, &s->bufIdx, last);
+    return;
+  }
 
   // initial state
   for (c = 0; c < 4; ++c) {
@@ -885,18 +1009,24 @@ void aesDecryptBlock(DecryptAESState *s, Guchar *in, GBool last) {
     s->cbc[i] = in[i];
   }
 
-  // remove padding
-  s->bufIdx = 0;
-  if (last) {
-    n = s->buf[15];
-    if (n < 1 || n > 16) { // this should never happen
-      n = 16;
-    }
-    for (i = 15; i >= n; --i) {
-      s->buf[i] = s->buf[i-n];
-    }
-    s->bufIdx = n;
+  aesRemovePadding(s->buf, &s->bufIdx, last);
+}
+
+// Decrypt <nBlocks> blocks, none of which is the last block in the
+// stream, from <in> to <out> (which may be the same buffer).
+static void aesDecryptBlocks(DecryptAESState *s, Guchar *in, Guchar *out,
+			     int nBlocks) {
+  int i;
+
+  if (decryptGetSIMDLevel() != decryptSIMDNone) {
+    decryptAESCBCDecrypt(s->w, 10, s->cbc, in, out, nBlocks);
+    return;
   }
+  for (i = 0; i < nBlocks; ++i) {
+    aesDecryptBlock(s, in + 16 * i, gFalse);
+    memcpy(out + 16 * i, s->buf, 16);
+  }
+  s->bufIdx = 16;
 }
 
 //------------------------------------------------------------------------
@@ -929,7 +1059,13 @@ static void aes256KeyExpansion(DecryptAES256State *s,
 }
 
 static void aes256DecryptBlock(DecryptAES256State *s, Guchar *in, GBool last) {
-  int c, round, n, i;
+  int c, round, i;
+
+  if (decryptGetSIMDLevel() != decryptSIMDNone) {
+    decryptAESCBCDecrypt(s->w, 14, s->cbc, in, s->buf, 1);
+    aesRemovePadding(s->buf, &s->bufIdx, last);
+    return;
+  }
 
   // initial state
   for (c = 0; c < 4; ++c) {
@@ -968,18 +1104,22 @@ static void aes256DecryptBlock(DecryptAES256State *s, Guchar *in, GBool last) {
     s->cbc[i] = in[i];
   }
 
-  // remove padding
-  s->bufIdx = 0;
-  if (last) {
-    n = s->buf[15];
-    if (n < 1 || n > 16) { // this should never happen
-      n = 16;
-    }
-    for (i = 15; i >= n; --i) {
-      s->buf[i] = s->buf[i-n];
-    }
-    s->bufIdx = n;
+  aesRemovePadding(s->buf, &s->bufIdx, last);
+}
+
+static void aes256DecryptBlocks(DecryptAES256State *s, Guchar *in,
+				Guchar *out, int nBlocks) {
+  int i;
+
+  if (decryptGetSIMDLevel() != decryptSIMDNone) {
+    decryptAESCBCDecrypt(s->w, 14, s->cbc, in, out, nBlocks);
+    return;
   }
+  for (i = 0; i < nBlocks; ++i) {
+    aes256DecryptBlock(s, in + 16 * i, gFalse);
+    memcpy(out + 16 * i, s->buf, 16);
+  }
+  s->bufIdx = 16;
 }
 
 //------------------------------------------------------------------------
@@ -1298,6 +1438,18 @@ static void sha256HashBlock(Guchar *blk, Guint *H) {
   H[7] += h;
 }
 
+static void sha256HashBlocks(Guchar *blk, int nBlocks, Guint *H) {
+  int i;
+
+  if (decryptGetSIMDLevel() == decryptSIMDAESSHA) {
+    decryptSHA256Blocks(H, sha256K, blk, nBlocks);
+    return;
+  }
+  for (i = 0; i < nBlocks; ++i) {
+    sha256HashBlock(blk + 64 * i, H);
+  }
+}
+
 static void sha256(Guchar *msg, int msgLen, Guchar *hash) {
   Guchar blk[64];
   Guint H[8];
@@ -1313,9 +1465,8 @@ static void sha256(Guchar *msg, int msgLen, Guchar *hash) {
   H[7] = 0x5be0cd19;
 
   blkLen = 0;
-  for (i = 0; i + 64 <= msgLen; i += 64) {
-    sha256HashBlock(msg + i, H);
-  }
+  i = msgLen & ~63;
+  sha256HashBlocks(msg, i >> 6, H);
   blkLen = msgLen - i;
   if (blkLen > 0) {
     memcpy(blk, msg + i, blkLen);
@@ -1327,7 +1478,7 @@ static void sha256(Guchar *msg, int msgLen, Guchar *hash) {
     while (blkLen < 64) {
       blk[blkLen++] = 0;
     }
-    sha256HashBlock(blk, H);
+    sha256HashBlocks(blk, 1, H);
     blkLen = 0;
   }
   while (blkLen < 56) {
@@ -1341,7 +1492,7 @@ static void sha256(Guchar *msg, int msgLen, Guchar *hash) {
   blk[61] = (Guchar)(msgLen >> 13);
   blk[62] = (Guchar)(msgLen >> 5);
   blk[63] = (Guchar)(msgLen << 3);
-  sha256HashBlock(blk, H);
+  sha256HashBlocks(blk, 1, H);
 
   // copy the output into the buffer (convert words to bytes)
   for (i = 0; i < 8; ++i) {
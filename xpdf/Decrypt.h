@@ -89,6 +89,7 @@ public:
   virtual void reset();
   virtual int getChar();
   virtual int lookChar();
+  virtual int getBlock(char *blk, int size);
   virtual GBool isBinary(GBool last);
   virtual Stream *getUndecodedStream() { return this; }
 
@@ -0,0 +1,239 @@
+//========================================================================
+//
+// DecryptSIMD.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include "DecryptSIMD.h"
+
+// The AES-NI and SHA code is compiled with per-function target
+// attributes, and only used if the CPU supports it.
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__clang__) || __GNUC__ > 4 || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define DECRYPT_AESNI 1
+#  include <cpuid.h>
+#  include <immintrin.h>
+#endif
+
+#if DECRYPT_AESNI
+
+//------------------------------------------------------------------------
+// AES
+//------------------------------------------------------------------------
+
+// The key schedule is stored as big-endian words; the AES
+// instructions want each round key as 16 bytes in memory order.
+__attribute__((target("aes,ssse3")))
+static inline void loadRoundKeys(Guint *w, int nRounds, __m128i *rk) {
+  __m128i bswap;
+  int i;
+
+  bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+		       4, 5, 6, 7, 0, 1, 2, 3);
+  for (i = 0; i <= nRounds; ++i) {
+    rk[i] = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)&w[4 * i]), bswap);
+  }
+}
+
+// CBC decryption has no dependency between blocks, so four blocks are
+// run through the pipeline at once.
+__attribute__((target("aes,ssse3")))
+static void aesCBCDecryptAESNI(Guint *w, int nRounds, Guchar *cbc,
+			       Guchar *in, Guchar *out, int nBlocks) {
+  __m128i rk[15];
+  __m128i prev, c0, c1, c2, c3, x0, x1, x2, x3;
+  int i, r;
+
+  loadRoundKeys(w, nRounds, rk);
+  prev = _mm_loadu_si128((__m128i *)cbc);
+  for (i = 0; i + 4 <= nBlocks; i += 4) {
+    c0 = _mm_loadu_si128((__m128i *)(in + 16 * i));
+    c1 = _mm_loadu_si128((__m128i *)(in + 16 * i + 16));
+    c2 = _mm_loadu_si128((__m128i *)(in + 16 * i + 32));
+    c3 = _mm_loadu_si128((__m128i *)(in + 16 * i + 48));
+    x0 = _mm_xor_si128(c0, rk[nRounds]);
+    x1 = _mm_xor_si128(c1, rk[nRounds]);
+    x2 = _mm_xor_si128(c2, rk[nRounds]);
+    x3 = _mm_xor_si128(c3, rk[nRounds]);
+    for (r = nRounds - 1; r >= 1; --r) {
+      x0 = _mm_aesdec_si128(x0, rk[r]);
+      x1 = _mm_aesdec_si128(x1, rk[r]);
+      x2 = _mm_aesdec_si128(x2, rk[r]);
+      x3 = _mm_aesdec_si128(x3, rk[r]);
+    }
+    x0 = _mm_aesdeclast_si128(x0, rk[0]);
+    x1 = _mm_aesdeclast_si128(x1, rk[0]);
+    x2 = _mm_aesdeclast_si128(x2, rk[0]);
+    x3 = _mm_aesdeclast_si128(x3, rk[0]);
+    _mm_storeu_si128((__m128i *)(out + 16 * i), _mm_xor_si128(x0, prev));
+    _mm_storeu_si128((__m128i *)(out + 16 * i + 16), _mm_xor_si128(x1, c0));
+    _mm_storeu_si128((__m128i *)(out + 16 * i + 32), _mm_xor_si128(x2, c1));
+    _mm_storeu_si128((__m128i *)(out + 16 * i + 48), _mm_xor_si128(x3, c2));
+    prev = c3;
+  }
+  for (; i < nBlocks; ++i) {
+    c0 = _mm_loadu_si128((__m128i *)(in + 16 * i));
+    x0 = _mm_xor_si128(c0, rk[nRounds]);
+    for (r = nRounds - 1; r >= 1; --r) {
+      x0 = _mm_aesdec_si128(x0, rk[r]);
+    }
+    x0 = _mm_aesdeclast_si128(x0, rk[0]);
+    _mm_storeu_si128((__m128i *)(out + 16 * i), _mm_xor_si128(x0, prev));
+    prev = c0;
+  }
+  _mm_storeu_si128((__m128i *)cbc, prev);
+}
+
+__attribute__((target("aes,ssse3")))
+static void aesCBCEncryptAESNI(Guint *w, int nRounds, Guchar *cbc,
+			       Guchar *in, Guchar *out, int nBlocks) {
+  __m128i rk[15];
+  __m128i x;
+  int i, r;
+
+  loadRoundKeys(w, nRounds, rk);
+  x = _mm_loadu_si128((__m128i *)cbc);
+  for (i = 0; i < nBlocks; ++i) {
+    x = _mm_xor_si128(x, _mm_loadu_si128((__m128i *)(in + 16 * i)));
+    x = _mm_xor_si128(x, rk[0]);
+    for (r = 1; r < nRounds; ++r) {
+      x = _mm_aesenc_si128(x, rk[r]);
+    }
+    x = _mm_aesenclast_si128(x, rk[nRounds]);
+    _mm_storeu_si128((__m128i *)(out + 16 * i), x);
+  }
+  _mm_storeu_si128((__m128i *)cbc, x);
+}
+
+//------------------------------------------------------------------------
+// SHA-256
+//------------------------------------------------------------------------
+
+// The SHA instructions keep the hash state as two vectors, ABEF and
+// CDGH, and do two rounds per sha256rnds2.  The message schedule is
+// computed four words at a time in m[0..3], interleaved with the
+// rounds.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256BlocksSHANI(Guint *H, const Guint *K,
+			      Guchar *blk, int nBlocks) {
+  __m128i state0, state1, save0, save1, m[4], x, t, bswap;
+  int b, i;
+
+  bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+		       4, 5, 6, 7, 0, 1, 2, 3);
+
+  // H[0..7] -> ABEF, CDGH
+  t = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&H[0]), 0xb1);
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&H[4]), 0x1b);
+  state0 = _mm_alignr_epi8(t, state1, 8);
+  state1 = _mm_blend_epi16(state1, t, 0xf0);
+
+  for (b = 0; b < nBlocks; ++b, blk += 64) {
+    save0 = state0;
+    save1 = state1;
+    for (i = 0; i < 16; ++i) {
+      if (i < 4) {
+	m[i] = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(blk + 16 * i)),
+				bswap);
+      }
+      x = _mm_add_epi32(m[i & 3], _mm_loadu_si128((__m128i *)&K[4 * i]));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, x);
+      if (i >= 3 && i < 15) {
+	t = _mm_alignr_epi8(m[i & 3], m[(i - 1) & 3], 4);
+	m[(i + 1) & 3] = _mm_add_epi32(m[(i + 1) & 3], t);
+	m[(i + 1) & 3] = _mm_sha256msg2_epu32(m[(i + 1) & 3], m[i & 3]);
+      }
+      x = _mm_shuffle_epi32(x, 0x0e);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, x);
+      if (i >= 1 && i < 13) {
+	m[(i - 1) & 3] = _mm_sha256msg1_epu32(m[(i - 1) & 3], m[i & 3]);
+      }
+    }
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+  }
+
+  // ABEF, CDGH -> H[0..7]
+  t = _mm_shuffle_epi32(state0, 0x1b);
+  state1 = _mm_shuffle_epi32(state1, 0xb1);
+  state0 = _mm_blend_epi16(t, state1, 0xf0);
+  state1 = _mm_alignr_epi8(state1, t, 8);
+  _mm_storeu_si128((__m128i *)&H[0], state0);
+  _mm_storeu_si128((__m128i *)&H[4], state1);
+}
+
+#endif // DECRYPT_AESNI
+
+//------------------------------------------------------------------------
+// dispatch
+//------------------------------------------------------------------------
+
+static DecryptSIMDLevel detectSIMDLevel() {
+#if DECRYPT_AESNI
+  unsigned int eax, ebx, ecx, edx;
+
+  // leaf 1: ECX bit 25 = AES, bit 9 = SSSE3, bit 19 = SSE4.1
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+      !(ecx & (1 << 25)) || !(ecx & (1 << 9))) {
+    return decryptSIMDNone;
+  }
+  if (!(ecx & (1 << 19)) || __get_cpuid_max(0, NULL) < 7) {
+    return decryptSIMDAES;
+  }
+  // leaf 7, subleaf 0: EBX bit 29 = SHA
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if (ebx & (1 << 29)) {
+    return decryptSIMDAESSHA;
+  }
+  return decryptSIMDAES;
+#else
+  return decryptSIMDNone;
+#endif
+}
+
+static DecryptSIMDLevel cpuLevel = detectSIMDLevel();
+static DecryptSIMDLevel curLevel = cpuLevel;
+
+DecryptSIMDLevel decryptGetSIMDLevel() {
+  return curLevel;
+}
+
+void decryptSetSIMDLevel(DecryptSIMDLevel level) {
+  curLevel = level < cpuLevel ? level : cpuLevel;
+}
+
+void decryptAESCBCDecrypt(Guint *w, int nRounds, Guchar *cbc,
+			  Guchar *in, Guchar *out, int nBlocks) {
+#if DECRYPT_AESNI
+  if (curLevel >= decryptSIMDAES) {
+    aesCBCDecryptAESNI(w, nRounds, cbc, in, out, nBlocks);
+  }
+#endif
+}
+
+void decryptAESCBCEncrypt(Guint *w, int nRounds, Guchar *cbc,
+			  Guchar *in, Guchar *out, int nBlocks) {
+#if DECRYPT_AESNI
+  if (curLevel >= decryptSIMDAES) {
+    aesCBCEncryptAESNI(w, nRounds, cbc, in, out, nBlocks);
+  }
+#endif
+}
+
+void decryptSHA256Blocks(Guint *H, const Guint *K,
+			 Guchar *blk, int nBlocks) {
+#if DECRYPT_AESNI
+  if (curLevel >= decryptSIMDAESSHA) {
+    sha256BlocksSHANI(H, K, blk, nBlocks);
+  }
+#endif
+}
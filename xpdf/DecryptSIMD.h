@@ -0,0 +1,61 @@
+//========================================================================
+//
+// DecryptSIMD.h
+//
+// Hardware-accelerated AES and SHA-256 kernels for Decrypt, with the
+// instruction set chosen at run time.
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef DECRYPTSIMD_H
+#define DECRYPTSIMD_H
+
+#include <aconf.h>
+
+#include "gtypes.h"
+
+//------------------------------------------------------------------------
+
+enum DecryptSIMDLevel {
+  decryptSIMDNone,		// scalar code only
+  decryptSIMDAES,		// AES-NI
+  decryptSIMDAESSHA		// AES-NI and the SHA extensions
+};
+
+// Return the instruction set used by the kernels.  If this is
+// decryptSIMDNone, callers should use their own scalar code.
+DecryptSIMDLevel decryptGetSIMDLevel();
+
+// Restrict the kernels to <level> (or to the best instruction set
+// supported by the CPU, if that is lower).  This is mostly useful for
+// testing, and must not be called while any stream is being
+// decrypted.
+void decryptSetSIMDLevel(DecryptSIMDLevel level);
+
+// AES-CBC decrypt <nBlocks> 16-byte blocks from <in> to <out> (which
+// may be the same buffer).  <w> is the key schedule for <nRounds>
+// rounds (10 or 14), in the form built by aesKeyExpansion with
+// decrypt = true, i.e., for the equivalent inverse cipher.  <cbc> is
+// the initialization vector, and is updated to the last ciphertext
+// block.  Must not be called if the SIMD level is decryptSIMDNone.
+void decryptAESCBCDecrypt(Guint *w, int nRounds, Guchar *cbc,
+			  Guchar *in, Guchar *out, int nBlocks);
+
+// AES-CBC encrypt <nBlocks> 16-byte blocks from <in> to <out> (which
+// may be the same buffer).  <w> is the (normal) key schedule for
+// <nRounds> rounds.  <cbc> is the initialization vector, and is
+// updated to the last ciphertext block.  Must not be called if the
+// SIMD level is decryptSIMDNone.
+void decryptAESCBCEncrypt(Guint *w, int nRounds, Guchar *cbc,
+			  Guchar *in, Guchar *out, int nBlocks);
+
+// Run the SHA-256 compression function on <nBlocks> 64-byte blocks,
+// updating the hash value <H>.  <K> is the table of 64 round
+// constants.  Must not be called unless the SIMD level is
+// decryptSIMDAESSHA.
+void decryptSHA256Blocks(Guint *H, const Guint *K,
+			 Guchar *blk, int nBlocks);
+
+#endif
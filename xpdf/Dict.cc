@@ -16,14 +16,18 @@
 #include <string.h>
 #include "gmem.h"
 #include "gmempp.h"
+#include "GArena.h"
 #include "Object.h"
+#include "AtomTable.h"
 #include "XRef.h"
 #include "Dict.h"
 
 //------------------------------------------------------------------------
 
 struct DictEntry {
-  char *key;
+  char *key;			// atom, or allocated string if ownKey
+  Guint hash;			// AtomTable::hash(key, strlen(key))
+  GBool ownKey;			// set if key is not an atom
   Object val;
   DictEntry *next;
 };
@@ -36,8 +40,20 @@ Dict::Dict(XRef *xrefA) {
   xref = xrefA;
   size = 8;
   length = 0;
-  entries = (DictEntry *)gmallocn(size, sizeof(DictEntry));
-  hashTab = (DictEntry **)gmallocn(2 * size - 1, sizeof(DictEntry *));
+  entries = (DictEntry *)gArenaAllocn(NULL, size, sizeof(DictEntry));
+  hashTab = (DictEntry **)gArenaAllocn(NULL, 2 * size - 1,
+				       sizeof(DictEntry *));
+  memset(hashTab, 0, (2 * size - 1) * sizeof(DictEntry *));
+  ref = 1;
+}
+
+Dict::Dict(XRef *xrefA, int sizeA, GArena *arena) {
+  xref = xrefA;
+  size = sizeA < 1 ? 1 : sizeA;
+  length = 0;
+  entries = (DictEntry *)gArenaAllocn(arena, size, sizeof(DictEntry));
+  hashTab = (DictEntry **)gArenaAllocn(arena, 2 * size - 1,
+				       sizeof(DictEntry *));
   memset(hashTab, 0, (2 * size - 1) * sizeof(DictEntry *));
   ref = 1;
 }
@@ -46,30 +62,52 @@ Dict::~Dict() {
   int i;
 
   for (i = 0; i < length; ++i) {
-    gfree(entries[i].key);
+    if (entries[i].ownKey) {
+      gfree(entries[i].key);
+    }
     entries[i].val.free();
   }
-  gfree(entries);
-  gfree(hashTab);
+  gArenaFree(entries);
+  gArenaFree(hashTab);
 }
 
 void Dict::add(char *key, Object *val) {
+  char *atom;
+
+  if ((atom = AtomTable::atomize(key, (int)strlen(key)))) {
+    gfree(key);
+    addEntry(atom, gFalse, AtomTable::getHash(atom), val);
+  } else {
+    addEntry(key, gTrue, AtomTable::hash(key, (int)strlen(key)), val);
+  }
+}
+
+void Dict::addAtom(char *key, Object *val) {
+  addEntry(key, gFalse, AtomTable::getHash(key), val);
+}
+
+void Dict::addEntry(char *key, GBool ownKey, Guint h, Object *val) {
   DictEntry *e;
-  int h;
+  int i;
 
-  if ((e = find(key))) {
+  if ((e = find(key, ownKey ? (char *)NULL : key, h))) {
     e->val.free();
     e->val = *val;
-    gfree(key);
+    if (ownKey) {
+      gfree(key);
+    }
   } else {
     if (length == size) {
       expand();
     }
-    h = hash(key);
-    entries[length].key = key;
-    entries[length].val = *val;
-    entries[length].next = hashTab[h];
-    hashTab[h] = &entries[length];
+    e = &entries[length];
+    e->key = key;
+    e->hash = h;
+    e->ownKey = ownKey;
+    e->val = *val;
+    i = (int)(h % (2 * size - 1));
+    e->next = hashTab[i];
+    hashTab[i] = e;
     ++length;
   }
 }
@@ -78,41 +116,43 @@ void Dict::expand() {
   int h, i;
 
   size *= 2;
-  entries = (DictEntry *)greallocn(entries, size, sizeof(DictEntry));
-  hashTab = (DictEntry **)greallocn(hashTab, 2 * size - 1,
-				    sizeof(DictEntry *));
+  entries = (DictEntry *)gArenaReallocn(NULL, entries, size,
+					 sizeof(DictEntry));
+  gArenaFree(hashTab);
+  hashTab = (DictEntry **)gArenaAllocn(NULL, 2 * size - 1,
+				       sizeof(DictEntry *));
   memset(hashTab, 0, (2 * size - 1) * sizeof(DictEntry *));
   for (i = 0; i < length; ++i) {
-    h = hash(entries[i].key);
+    h = (int)(entries[i].hash % (2 * size - 1));
     entries[i].next = hashTab[h];
     hashTab[h] = &entries[i];
   }
 }
 
 inline DictEntry *Dict::find(const char *key) {
+  Guint h;
+  int len;
+
+  len = (int)strlen(key);
+  h = AtomTable::hash(key, len);
+  return find(key, AtomTable::find(key, len, h), h);
+}
+
+// Find the entry for <key>.  <atom> is the atom for <key>, or NULL if
+// <key> isn't in the atom table; <h> is the hash value of <key>.
+// Entries with atom keys are compared by pointer, so only the
+// (rare) non-atom keys need a string comparison.
+inline DictEntry *Dict::find(const char *key, const char *atom, Guint h) {
   DictEntry *e;
-  int h;
 
-  h = hash(key);
-  for (e = hashTab[h]; e; e = e->next) {
-    if (!strcmp(key, e->key)) {
+  for (e = hashTab[h % (2 * size - 1)]; e; e = e->next) {
+    if (e->ownKey ? !strcmp(key, e->key) : e->key == atom) {
       return e;
     }
   }
   return NULL;
 }
 
-int Dict::hash(const char *key) {
-  const char *p;
-  unsigned int h;
-
-  h = 0;
-  for (p = key; *p; ++p) {
-    h = 17 * h + (int)(*p & 0xff);
-  }
-  return (int)(h % (2 * size - 1));
-}
-
 GBool Dict::is(const char *type) {
   DictEntry *e;
 
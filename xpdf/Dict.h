@@ -21,6 +21,7 @@
 #include "Object.h"
 
 struct DictEntry;
+class GArena;
 
 //------------------------------------------------------------------------
 // Dict
@@ -32,6 +33,10 @@ public:
   // Constructor.
   Dict(XRef *xrefA);
 
+  // Construct an empty dictionary with space for <sizeA> entries,
+  // allocated from <arena>.
+  Dict(XRef *xrefA, int sizeA, GArena *arena);
+
   // Destructor.
   ~Dict();
 
@@ -47,9 +52,13 @@ public:
   // Get number of entries.
   int getLength() { return length; }
 
-  // Add an entry.  NB: does not copy key.
+  // Add an entry.  NB: does not copy key -- <key> is either freed
+  // (if it is replaced by an atom) or owned by the Dict.
   void add(char *key, Object *val);
 
+  // Add an entry whose key is an atom (see AtomTable.h).
+  void addAtom(char *key, Object *val);
+
   // Check if dictionary is of specified type.
   GBool is(const char *type);
 
@@ -68,11 +77,16 @@ public:
   // parsed.
   void setXRef(XRef *xrefA) { xref = xrefA; }
 
+  // Get the xref pointer.
+  XRef *getXRef() { return xref; }
+
 private:
 
   XRef *xref;			// the xref table for this PDF file
-  DictEntry *entries;		// array of entries
-  DictEntry **hashTab;		// hash table pointers
+  DictEntry *entries;		// array of entries (allocated with
+				//   gArenaAlloc)
+  DictEntry **hashTab;		// hash table pointers (allocated with
+				//   gArenaAlloc)
   int size;			// size of <entries> array
   int length;			// number of entries in dictionary
 #if MULTITHREADED
@@ -81,9 +95,10 @@ private:
   int ref;			// reference count
 #endif
 
+  void addEntry(char *key, GBool ownKey, Guint h, Object *val);
   DictEntry *find(const char *key);
+  DictEntry *find(const char *key, const char *atom, Guint h);
   void expand();
-  int hash(const char *key);
 };
 
 #endif
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
 #include "gmem.h"
 #include "gmempp.h"
 #include "GList.h"
@@ -165,6 +166,14 @@ GBool Function::init(Dict *dict) {
   return gFalse;
 }
 
+void Function::transformN(double *in, double *out, int nVals) {
+  int i;
+
+  for (i = 0; i < nVals; ++i) {
+    transform(in + i * m, out + i * n);
+  }
+}
+
 //------------------------------------------------------------------------
 // IdentityFunction
 //------------------------------------------------------------------------
@@ -493,6 +502,48 @@ void SampledFunction::transform(double *in, double *out) {
   }
 }
 
+void SampledFunction::transformN(double *in, double *out, int nVals) {
+  double x, efrac0, efrac1, y;
+  double *s0, *s1;
+  int e, i, j;
+
+  // the general m-input case goes through the single-tuple code
+  if (m != 1) {
+    Function::transformN(in, out, nVals);
+    return;
+  }
+
+  // one-input functions (the common case for shadings): this is the
+  // same linear interpolation as transform(), done for a whole array
+  // of inputs
+  for (j = 0; j < nVals; ++j) {
+    x = (in[j] - domain[0][0]) * inputMul[0] + encode[0][0];
+    if (x < 0 || x != x) {
+      x = 0;
+    } else if (x > sampleSize[0] - 1) {
+      x = sampleSize[0] - 1;
+    }
+    e = (int)x;
+    if (e == sampleSize[0] - 1 && sampleSize[0] > 1) {
+      e = sampleSize[0] - 2;
+    }
+    efrac1 = x - e;
+    efrac0 = 1 - efrac1;
+    s0 = samples + e * n + idxOffset[0];
+    s1 = samples + e * n + idxOffset[1];
+    for (i = 0; i < n; ++i) {
+      y = (efrac0 * s0[i] + efrac1 * s1[i]) * (decode[i][1] - decode[i][0])
+	  + decode[i][0];
+      if (y < range[i][0]) {
+	y = range[i][0];
+      } else if (y > range[i][1]) {
+	y = range[i][1];
+      }
+      out[j * n + i] = y;
+    }
+  }
+}
+
 //------------------------------------------------------------------------
 // ExponentialFunction
 //------------------------------------------------------------------------
@@ -618,6 +669,35 @@ void ExponentialFunction::transform(double *in, double *out) {
   return;
 }
 
+void ExponentialFunction::transformN(double *in, double *out, int nVals) {
+  double x, p;
+  double *o;
+  int i, j;
+
+  for (j = 0; j < nVals; ++j) {
+    if (in[j] < domain[0][0]) {
+      x = domain[0][0];
+    } else if (in[j] > domain[0][1]) {
+      x = domain[0][1];
+    } else {
+      x = in[j];
+    }
+    // pow(x, 1) == x exactly, so skipping it doesn't change the result
+    p = (e == 1) ? x : pow(x, e);
+    o = out + j * n;
+    for (i = 0; i < n; ++i) {
+      o[i] = c0[i] + p * (c1[i] - c0[i]);
+      if (hasRange) {
+	if (o[i] < range[i][0]) {
+	  o[i] = range[i][0];
+	} else if (o[i] > range[i][1]) {
+	  o[i] = range[i][1];
+	}
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------
 // StitchingFunction
 //------------------------------------------------------------------------
@@ -782,6 +862,56 @@ void StitchingFunction::transform(double *in, double *out) {
   funcs[i]->transform(&x, out);
 }
 
+void StitchingFunction::transformN(double *in, double *out, int nVals) {
+  double buf[64];
+  double tmp[funcMaxOutputs];
+  double x;
+  int i, j, j0, i0;
+
+  // if the subfunctions don't match the Range array, their output
+  // tuples can't be packed directly into <out>
+  if (funcs[0]->getOutputSize() != n) {
+    for (j = 0; j < nVals; ++j) {
+      transform(in + j, tmp);
+      for (i = 0; i < n; ++i) {
+	out[j * n + i] = tmp[i];
+      }
+    }
+    return;
+  }
+
+  // map each input into its subfunction's domain, and hand off runs
+  // of inputs that use the same subfunction (typically the whole
+  // array, or a few long runs, for shadings) as a single batch
+  j0 = 0;
+  i0 = -1;
+  for (j = 0; j < nVals; ++j) {
+    if (in[j] < domain[0][0]) {
+      x = domain[0][0];
+    } else if (in[j] > domain[0][1]) {
+      x = domain[0][1];
+    } else {
+      x = in[j];
+    }
+    for (i = 0; i < k - 1; ++i) {
+      if (x < bounds[i+1]) {
+	break;
+      }
+    }
+    if (i != i0 || j - j0 == 64) {
+      if (j > j0) {
+	funcs[i0]->transformN(buf, out + j0 * n, j - j0);
+      }
+      j0 = j;
+      i0 = i;
+    }
+    buf[j - j0] = encode[2*i] + (x - bounds[i]) * scale[i];
+  }
+  if (nVals > j0) {
+    funcs[i0]->transformN(buf, out + j0 * n, nVals - j0);
+  }
+}
+
 //------------------------------------------------------------------------
 // PostScriptFunction
 //------------------------------------------------------------------------
@@ -834,6 +964,8 @@ void StitchingFunction::transform(double *in, double *out) {
 #define psOpPush     40
 #define psOpJ        41
 #define psOpJz       42
+// the select op is only used in compiled code (see PSRegOp)
+#define psOpSelect   43
 
 #define nPSOps (sizeof(psOpNames) / sizeof(const char *))
 
@@ -894,6 +1026,526 @@ struct PSCode {
 
 #define psStackSize 100
 
+// Compiled PostScript functions use a register form of the code: the
+// stack is resolved at compile time (dup/exch/pop/index/roll/copy
+// just rename registers), constant subexpressions are folded, and
+// if/ifelse are turned into select ops, so each op reads its operands
+// from, and writes its result to, fixed registers.  Each register
+// holds the values for a batch of up to psBatchSize input tuples, and
+// each op is run over the whole batch at once.
+struct PSRegOp {
+  int op;
+  int dst;			// destination register
+  int src[3];			// source registers
+};
+
+#define psBatchSize 32
+#define psMaxRegs   512
+
+struct PSCompiler {
+  PSCode *code;
+  PSRegOp *ops;
+  int nOps;
+  int opsSize;
+  int nRegs;
+  GBool isConst[psMaxRegs];
+  double constVal[psMaxRegs];
+};
+
+// Run <op> on a batch of <nVals> values.  This is used both to fold
+// constants at compile time and to run compiled code, and it computes
+// exactly what PostScriptFunction::exec() does.  The only exception
+// is integer division by zero (which would crash exec()) -- compiled
+// if/ifelse run both branches, so this can show up in the branch that
+// isn't used.
+static void psExecOp(int op, double *d, double *a, double *b, double *c,
+		     int nVals) {
+  double t;
+  int i, x, y;
+
+  switch (op) {
+  case psOpAbs:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = fabs(a[i]);
+    }
+    break;
+  case psOpAdd:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] + b[i];
+    }
+    break;
+  case psOpAnd:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = (int)a[i] & (int)b[i];
+    }
+    break;
+  case psOpAtan:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = atan2(a[i], b[i]);
+    }
+    break;
+  case psOpBitshift:
+    for (i = 0; i < nVals; ++i) {
+      x = (int)a[i];
+      y = (int)b[i];
+      if (y > 0) {
+	d[i] = x << y;
+      } else if (y < 0) {
+	d[i] = x >> -y;
+      } else {
+	d[i] = x;
+      }
+    }
+    break;
+  case psOpCeiling:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = ceil(a[i]);
+    }
+    break;
+  case psOpCos:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = cos(a[i]);
+    }
+    break;
+  case psOpCvi:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = (int)a[i];
+    }
+    break;
+  case psOpDiv:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] / b[i];
+    }
+    break;
+  case psOpEq:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] == b[i] ? 1 : 0;
+    }
+    break;
+  case psOpExp:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = pow(a[i], b[i]);
+    }
+    break;
+  case psOpFloor:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = floor(a[i]);
+    }
+    break;
+  case psOpGe:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] >= b[i] ? 1 : 0;
+    }
+    break;
+  case psOpGt:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] > b[i] ? 1 : 0;
+    }
+    break;
+  case psOpIdiv:
+    for (i = 0; i < nVals; ++i) {
+      x = (int)a[i];
+      y = (int)b[i];
+      d[i] = (y == 0 || (y == -1 && x == INT_MIN)) ? 0 : x / y;
+    }
+    break;
+  case psOpLe:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] <= b[i] ? 1 : 0;
+    }
+    break;
+  case psOpLn:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = log(a[i]);
+    }
+    break;
+  case psOpLog:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = log10(a[i]);
+    }
+    break;
+  case psOpLt:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] < b[i] ? 1 : 0;
+    }
+    break;
+  case psOpMod:
+    for (i = 0; i < nVals; ++i) {
+      x = (int)a[i];
+      y = (int)b[i];
+      d[i] = (y == 0 || (y == -1 && x == INT_MIN)) ? 0 : x % y;
+    }
+    break;
+  case psOpMul:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] * b[i];
+    }
+    break;
+  case psOpNe:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] != b[i] ? 1 : 0;
+    }
+    break;
+  case psOpNeg:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = -a[i];
+    }
+    break;
+  case psOpNot:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] == 0 ? 1 : 0;
+    }
+    break;
+  case psOpOr:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = (int)a[i] | (int)b[i];
+    }
+    break;
+  case psOpRound:
+    for (i = 0; i < nVals; ++i) {
+      t = a[i];
+      d[i] = (t >= 0) ? floor(t + 0.5) : ceil(t - 0.5);
+    }
+    break;
+  case psOpSin:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = sin(a[i]);
+    }
+    break;
+  case psOpSqrt:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = sqrt(a[i]);
+    }
+    break;
+  case psOpSub:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = a[i] - b[i];
+    }
+    break;
+  case psOpTruncate:
+    for (i = 0; i < nVals; ++i) {
+      t = a[i];
+      d[i] = (t >= 0) ? floor(t) : ceil(t);
+    }
+    break;
+  case psOpXor:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = (int)a[i] ^ (int)b[i];
+    }
+    break;
+  case psOpSelect:
+    for (i = 0; i < nVals; ++i) {
+      d[i] = ((int)a[i] != 0) ? b[i] : c[i];
+    }
+    break;
+  }
+}
+
+// Number of source operands used by <op> (only valid for ops that
+// can appear in compiled code).
+static int psNumSrcs(int op) {
+  switch (op) {
+  case psOpAbs:
+  case psOpCeiling:
+  case psOpCos:
+  case psOpCvi:
+  case psOpFloor:
+  case psOpLn:
+  case psOpLog:
+  case psOpNeg:
+  case psOpNot:
+  case psOpRound:
+  case psOpSin:
+  case psOpSqrt:
+  case psOpTruncate:
+    return 1;
+  case psOpSelect:
+    return 3;
+  default:
+    return 2;
+  }
+}
+
+// Allocate a new register.  Returns -1 if there are too many.
+static int psNewReg(PSCompiler *pc) {
+  if (pc->nRegs >= psMaxRegs) {
+    return -1;
+  }
+  pc->isConst[pc->nRegs] = gFalse;
+  return pc->nRegs++;
+}
+
+static int psConstReg(PSCompiler *pc, double x) {
+  int r;
+
+  if ((r = psNewReg(pc)) >= 0) {
+    pc->isConst[r] = gTrue;
+    pc->constVal[r] = x;
+  }
+  return r;
+}
+
+// Add <op> (with sources <a>, <b>, <c>) to the compiled code, and
+// return the destination register (or -1 on error).  If all of the
+// sources are constants, the op is evaluated immediately instead.
+static int psEmit(PSCompiler *pc, int op, int a, int b, int c) {
+  double x[3], y;
+  int src[3];
+  int nSrcs, r, i;
+
+  if (a < 0 || b < 0 || c < 0) {
+    return -1;
+  }
+  src[0] = a;
+  src[1] = b;
+  src[2] = c;
+  nSrcs = psNumSrcs(op);
+  for (i = 0; i < nSrcs; ++i) {
+    if (!pc->isConst[src[i]]) {
+      break;
+    }
+  }
+  if (i == nSrcs) {
+    for (i = 0; i < 3; ++i) {
+      x[i] = pc->constVal[src[i]];
+    }
+    psExecOp(op, &y, &x[0], &x[1], &x[2], 1);
+    return psConstReg(pc, y);
+  }
+  if ((r = psNewReg(pc)) < 0) {
+    return -1;
+  }
+  if (pc->nOps == pc->opsSize) {
+    pc->opsSize = pc->opsSize ? 2 * pc->opsSize : 16;
+    pc->ops = (PSRegOp *)greallocn(pc->ops, pc->opsSize, sizeof(PSRegOp));
+  }
+  pc->ops[pc->nOps].op = op;
+  pc->ops[pc->nOps].dst = r;
+  for (i = 0; i < 3; ++i) {
+    pc->ops[pc->nOps].src[i] = i < nSrcs ? src[i] : src[0];
+  }
+  ++pc->nOps;
+  return r;
+}
+
+// Compile code[start .. end-1], starting with the symbolic stack
+// <stk>/<depth> (which holds register numbers, bottom first).
+// Returns false if the code can't be compiled, i.e., if it would run
+// into an error, or if its stack layout depends on the input values
+// -- those functions are left to the interpreter.
+static GBool psCompileBlock(PSCompiler *pc, int start, int end,
+			    int *stk, int *depth) {
+  PSCode *c;
+  int stk2[psStackSize];
+  int tmp[psStackSize];
+  int ip, d, d2, r, nn, k, t, thenEnd, elseEnd, i;
+
+  d = *depth;
+  ip = start;
+  while (ip < end) {
+    c = &pc->code[ip];
+    switch (c->op) {
+    case psOpPush:
+    case psOpTrue:
+    case psOpFalse:
+      if (d >= psStackSize) {
+	return gFalse;
+      }
+      r = psConstReg(pc, c->op == psOpPush ? c->val.d
+		                            : c->op == psOpTrue ? 1 : 0);
+      if (r < 0) {
+	return gFalse;
+      }
+      stk[d++] = r;
+      break;
+    case psOpAbs:
+    case psOpCeiling:
+    case psOpCos:
+    case psOpCvi:
+    case psOpFloor:
+    case psOpLn:
+    case psOpLog:
+    case psOpNeg:
+    case psOpNot:
+    case psOpRound:
+    case psOpSin:
+    case psOpSqrt:
+    case psOpTruncate:
+      if (d < 1 || (r = psEmit(pc, c->op, stk[d-1], 0, 0)) < 0) {
+	return gFalse;
+      }
+      stk[d-1] = r;
+      break;
+    case psOpAdd:
+    case psOpAnd:
+    case psOpAtan:
+    case psOpBitshift:
+    case psOpDiv:
+    case psOpEq:
+    case psOpExp:
+    case psOpGe:
+    case psOpGt:
+    case psOpIdiv:
+    case psOpLe:
+    case psOpLt:
+    case psOpMod:
+    case psOpMul:
+    case psOpNe:
+    case psOpOr:
+    case psOpSub:
+    case psOpXor:
+      if (d < 2 || (r = psEmit(pc, c->op, stk[d-2], stk[d-1], 0)) < 0) {
+	return gFalse;
+      }
+      stk[d-2] = r;
+      --d;
+      break;
+    case psOpCvr:
+      if (d < 1) {
+	return gFalse;
+      }
+      break;
+    case psOpDup:
+      if (d < 1 || d >= psStackSize) {
+	return gFalse;
+      }
+      stk[d] = stk[d-1];
+      ++d;
+      break;
+    case psOpExch:
+      if (d < 2) {
+	return gFalse;
+      }
+      r = stk[d-1];
+      stk[d-1] = stk[d-2];
+      stk[d-2] = r;
+      break;
+    case psOpPop:
+      if (d < 1) {
+	return gFalse;
+      }
+      --d;
+      break;
+    case psOpCopy:
+      if (d < 1 || !pc->isConst[stk[d-1]]) {
+	return gFalse;
+      }
+      nn = (int)pc->constVal[stk[d-1]];
+      --d;
+      if (nn < 0 || nn > d || d + nn > psStackSize) {
+	return gFalse;
+      }
+      for (i = 0; i < nn; ++i) {
+	stk[d + i] = stk[d - nn + i];
+      }
+      d += nn;
+      break;
+    case psOpIndex:
+      if (d < 1 || !pc->isConst[stk[d-1]]) {
+	return gFalse;
+      }
+      k = (int)pc->constVal[stk[d-1]];
+      if (k < 0 || k + 1 >= d) {
+	return gFalse;
+      }
+      stk[d-1] = stk[d-2-k];
+      break;
+    case psOpRoll:
+      if (d < 2 || !pc->isConst[stk[d-1]] || !pc->isConst[stk[d-2]]) {
+	return gFalse;
+      }
+      k = (int)pc->constVal[stk[d-1]];
+      nn = (int)pc->constVal[stk[d-2]];
+      d -= 2;
+      if (nn <= 0 || nn > d) {
+	return gFalse;
+      }
+      if (k >= 0) {
+	k %= nn;
+      } else {
+	k = -k % nn;
+	if (k) {
+	  k = nn - k;
+	}
+      }
+      for (i = 0; i < nn; ++i) {
+	tmp[i] = stk[d - 1 - i];
+      }
+      for (i = 0; i < nn; ++i) {
+	stk[d - 1 - i] = tmp[(i + k) % nn];
+      }
+      break;
+    case psOpJz:
+      if (d < 1) {
+	return gFalse;
+      }
+      r = stk[--d];
+      // figure out whether this is an 'if' or an 'ifelse' -- in the
+      // latter case, the 'then' block ends with a j past the 'else'
+      // block (but the 'then' block of an 'if' can also end with the
+      // j from a nested ifelse whose 'else' block is empty, in which
+      // case the nested jz also jumps to t)
+      t = c->val.i;
+      if (t <= ip || t > end) {
+	return gFalse;
+      }
+      thenEnd = t;
+      elseEnd = -1;
+      if (t - 1 > ip && pc->code[t-1].op == psOpJ) {
+	for (i = ip + 1; i < t - 1; ++i) {
+	  if (pc->code[i].op == psOpJz && pc->code[i].val.i == t) {
+	    break;
+	  }
+	}
+	if (i == t - 1) {
+	  thenEnd = t - 1;
+	  elseEnd = pc->code[t-1].val.i;
+	  if (elseEnd < t || elseEnd > end) {
+	    return gFalse;
+	  }
+	}
+      }
+      if (pc->isConst[r]) {
+	if ((int)pc->constVal[r] != 0) {
+	  if (!psCompileBlock(pc, ip + 1, thenEnd, stk, &d)) {
+	    return gFalse;
+	  }
+	} else if (elseEnd >= 0) {
+	  if (!psCompileBlock(pc, t, elseEnd, stk, &d)) {
+	    return gFalse;
+	  }
+	}
+      } else {
+	memcpy(stk2, stk, d * sizeof(int));
+	d2 = d;
+	if (!psCompileBlock(pc, ip + 1, thenEnd, stk, &d)) {
+	  return gFalse;
+	}
+	if (elseEnd >= 0 && !psCompileBlock(pc, t, elseEnd, stk2, &d2)) {
+	  return gFalse;
+	}
+	if (d != d2) {
+	  return gFalse;
+	}
+	for (i = 0; i < d; ++i) {
+	  if (stk[i] != stk2[i]) {
+	    if ((stk[i] = psEmit(pc, psOpSelect, r, stk[i], stk2[i])) < 0) {
+	      return gFalse;
+	    }
+	  }
+	}
+      }
+      ip = elseEnd >= 0 ? elseEnd : t;
+      continue;
+    default:
+      return gFalse;
+    }
+    ++ip;
+  }
+  *depth = d;
+  return gTrue;
+}
+
 PostScriptFunction::PostScriptFunction(Object *funcObj, Dict *dict) {
   Stream *str;
   GList *tokens;
@@ -904,6 +1556,11 @@ PostScriptFunction::PostScriptFunction(Object *funcObj, Dict *dict) {
   codeString = NULL;
   code = NULL;
   codeSize = 0;
+  prog = NULL;
+  progLen = 0;
+  progIsFlat = gFalse;
+  nRegs = 0;
+  regs = NULL;
   ok = gFalse;
 
   //----- initialize the generic stuff
@@ -944,6 +1601,9 @@ PostScriptFunction::PostScriptFunction(Object *funcObj, Dict *dict) {
   }
   codeLen = codePtr;
 
+  //----- compile it
+  compile();
+
   //----- set up the cache
   for (i = 0; i < m; ++i) {
     in[i] = domain[i][0];
@@ -964,10 +1624,18 @@ PostScriptFunction::PostScriptFunction(PostScriptFunction *func) {
   codeString = func->codeString->copy();
   code = (PSCode *)gmallocn(codeSize, sizeof(PSCode));
   memcpy(code, func->code, codeSize * sizeof(PSCode));
+  if (prog) {
+    prog = (PSRegOp *)gmallocn(progLen, sizeof(PSRegOp));
+    memcpy(prog, func->prog, progLen * sizeof(PSRegOp));
+    regs = (double *)gmallocn(nRegs * psBatchSize, sizeof(double));
+    memcpy(regs, func->regs, nRegs * psBatchSize * sizeof(double));
+  }
 }
 
 PostScriptFunction::~PostScriptFunction() {
   gfree(code);
+  gfree(prog);
+  gfree(regs);
   if (codeString) {
     delete codeString;
   }
@@ -991,6 +1659,19 @@ void PostScriptFunction::transform(double *in, double *out) {
     return;
   }
 
+  // compiled code with if/ifelse runs both branches, so the
+  // interpreter is faster for a single tuple
+  if (prog && progIsFlat) {
+    execProg(in, out, 1);
+    for (i = 0; i < m; ++i) {
+      cacheIn[i] = in[i];
+    }
+    for (i = 0; i < n; ++i) {
+      cacheOut[i] = out[i];
+    }
+    return;
+  }
+
   for (i = 0; i < m; ++i) {
     stack[psStackSize - 1 - i] = in[i];
   }
@@ -1023,6 +1704,19 @@ void PostScriptFunction::transform(double *in, double *out) {
   }
 }
 
+void PostScriptFunction::transformN(double *in, double *out, int nVals) {
+  int i, nb;
+
+  if (!prog) {
+    Function::transformN(in, out, nVals);
+    return;
+  }
+  for (i = 0; i < nVals; i += nb) {
+    nb = nVals - i < psBatchSize ? nVals - i : psBatchSize;
+    execProg(in + i * m, out + i * n, nb);
+  }
+}
+
 GBool PostScriptFunction::parseCode(GList *tokens, int *tokPtr, int *codePtr) {
   GString *tok;
   char *p;
@@ -1206,6 +1900,127 @@ GString *PostScriptFunction::getToken(Stream *str) {
   return s;
 }
 
+// Convert the code to register form (see PSRegOp).  If this fails,
+// prog is left as NULL, and the function is run by exec().
+void PostScriptFunction::compile() {
+  PSCompiler *pc;
+  int stk[psStackSize];
+  GBool live[psMaxRegs];
+  int regMap[psMaxRegs];
+  int depth, nOps, nSrcs, i, j;
+
+  pc = (PSCompiler *)gmalloc(sizeof(PSCompiler));
+  pc->code = code;
+  pc->ops = NULL;
+  pc->nOps = pc->opsSize = 0;
+  pc->nRegs = 0;
+
+  // the inputs are in registers 0 .. m-1
+  for (i = 0; i < m; ++i) {
+    stk[i] = psNewReg(pc);
+  }
+  depth = m;
+  if (!psCompileBlock(pc, 0, codeLen, stk, &depth) || depth < n) {
+    gfree(pc->ops);
+    gfree(pc);
+    return;
+  }
+
+  // remove ops whose results are never used
+  memset(live, 0, sizeof(live));
+  for (i = 0; i < n; ++i) {
+    live[stk[depth - n + i]] = gTrue;
+  }
+  for (i = pc->nOps - 1; i >= 0; --i) {
+    if (live[pc->ops[i].dst]) {
+      nSrcs = psNumSrcs(pc->ops[i].op);
+      for (j = 0; j < nSrcs; ++j) {
+	live[pc->ops[i].src[j]] = gTrue;
+      }
+    } else {
+      pc->ops[i].op = -1;
+    }
+  }
+
+  // renumber the remaining registers
+  nRegs = 0;
+  for (i = 0; i < pc->nRegs; ++i) {
+    if (i < m || live[i]) {
+      regMap[i] = nRegs++;
+    }
+  }
+  for (i = 0; i < n; ++i) {
+    outRegs[i] = regMap[stk[depth - n + i]];
+  }
+  nOps = 0;
+  progIsFlat = gTrue;
+  for (i = 0; i < pc->nOps; ++i) {
+    if (pc->ops[i].op == psOpSelect) {
+      progIsFlat = gFalse;
+    }
+    if (pc->ops[i].op >= 0) {
+      nSrcs = psNumSrcs(pc->ops[i].op);
+      pc->ops[nOps].op = pc->ops[i].op;
+      pc->ops[nOps].dst = regMap[pc->ops[i].dst];
+      for (j = 0; j < 3; ++j) {
+	pc->ops[nOps].src[j] = regMap[pc->ops[i].src[j < nSrcs ? j : 0]];
+      }
+      ++nOps;
+    }
+  }
+  prog = pc->ops;
+  progLen = nOps;
+
+  // set up the register file -- constants are filled in once, since
+  // no op ever writes to a constant register
+  regs = (double *)gmallocn(nRegs * psBatchSize, sizeof(double));
+  for (i = m; i < pc->nRegs; ++i) {
+    if (live[i] && pc->isConst[i]) {
+      for (j = 0; j < psBatchSize; ++j) {
+	regs[regMap[i] * psBatchSize + j] = pc->constVal[i];
+      }
+    }
+  }
+
+  gfree(pc);
+}
+
+// Run the compiled code on <nVals> (at most psBatchSize) input
+// tuples.
+void PostScriptFunction::execProg(double *in, double *out, int nVals) {
+  PSRegOp *p;
+  double *r;
+  double x;
+  int i, j;
+
+  for (i = 0; i < m; ++i) {
+    r = regs + i * psBatchSize;
+    for (j = 0; j < nVals; ++j) {
+      r[j] = in[j * m + i];
+    }
+  }
+  for (i = 0, p = prog; i < progLen; ++i, ++p) {
+    psExecOp(p->op, regs + p->dst * psBatchSize,
+	     regs + p->src[0] * psBatchSize,
+	     regs + p->src[1] * psBatchSize,
+	     regs + p->src[2] * psBatchSize,
+	     nVals);
+  }
+  for (i = 0; i < n; ++i) {
+    r = regs + outRegs[i] * psBatchSize;
+    for (j = 0; j < nVals; ++j) {
+      x = r[j];
+      if (x < range[i][0]) {
+	out[j * n + i] = range[i][0];
+      } else if (x > range[i][1]) {
+	out[j * n + i] = range[i][1];
+      } else {
+	out[j * n + i] = x;
+      }
+    }
+  }
+}
+
 int PostScriptFunction::exec(double *stack, int sp0) {
   PSCode *c;
   double tmp[psStackSize];
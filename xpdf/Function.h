@@ -22,6 +22,7 @@ class GList;
 class Dict;
 class Stream;
 struct PSCode;
+struct PSRegOp;
 
 //------------------------------------------------------------------------
 // Function
@@ -67,6 +68,12 @@ public:
   // Transform an input tuple into an output tuple.
   virtual void transform(double *in, double *out) = 0;
 
+  // Transform <nVals> input tuples into <nVals> output tuples.  The
+  // tuples are packed, i.e., <in> holds nVals * m values, and <out>
+  // holds nVals * n values.  The default implementation just calls
+  // transform() for each tuple.
+  virtual void transformN(double *in, double *out, int nVals);
+
   virtual GBool isOk() = 0;
 
 protected:
@@ -108,6 +115,7 @@ public:
   virtual Function *copy() { return new SampledFunction(this); }
   virtual int getType() { return 0; }
   virtual void transform(double *in, double *out);
+  virtual void transformN(double *in, double *out, int nVals);
   virtual GBool isOk() { return ok; }
 
   int getSampleSize(int i) { return sampleSize[i]; }
@@ -150,6 +158,7 @@ public:
   virtual Function *copy() { return new ExponentialFunction(this); }
   virtual int getType() { return 2; }
   virtual void transform(double *in, double *out);
+  virtual void transformN(double *in, double *out, int nVals);
   virtual GBool isOk() { return ok; }
 
   double *getC0() { return c0; }
@@ -178,6 +187,7 @@ public:
   virtual Function *copy() { return new StitchingFunction(this); }
   virtual int getType() { return 3; }
   virtual void transform(double *in, double *out);
+  virtual void transformN(double *in, double *out, int nVals);
   virtual GBool isOk() { return ok; }
 
   int getNumFuncs() { return k; }
@@ -210,6 +220,7 @@ public:
   virtual Function *copy() { return new PostScriptFunction(this); }
   virtual int getType() { return 4; }
   virtual void transform(double *in, double *out);
+  virtual void transformN(double *in, double *out, int nVals);
   virtual GBool isOk() { return ok; }
 
   GString *getCodeString() { return codeString; }
@@ -223,11 +234,22 @@ private:
   void addCodeD(int *codePtr, int op, double x);
   GString *getToken(Stream *str);
   int exec(double *stack, int sp0);
+  void compile();
+  void execProg(double *in, double *out, int nVals);
 
   GString *codeString;
   PSCode *code;
   int codeLen;
   int codeSize;
+  PSRegOp *prog;		// compiled (register form) code, or NULL
+				//   if the code couldn't be compiled
+  int progLen;			// number of ops in <prog>
+  GBool progIsFlat;		// set if <prog> has no select ops, i.e.,
+				//   it's also faster than exec() for a
+				//   single tuple
+  int nRegs;			// number of registers used by <prog>
+  int outRegs[funcMaxOutputs];	// registers holding the outputs
+  double *regs;			// register file: nRegs * psBatchSize
   double cacheIn[funcMaxInputs];
   double cacheOut[funcMaxOutputs];
   GBool ok;
@@ -21,15 +21,18 @@
 #include "gmempp.h"
 #include "GString.h"
 #include "GList.h"
+#include "GArena.h"
 #include "GlobalParams.h"
 #include "CharTypes.h"
 #include "Object.h"
+#include "AtomTable.h"
 #include "PDFDoc.h"
 #include "Array.h"
 #include "Dict.h"
 #include "Stream.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include "ContentStreamCache.h"
 #include "GfxFont.h"
 #include "GfxState.h"
 #include "OutputDev.h"
@@ -504,13 +507,16 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, int pageNum, Dict *resDict,
   xref = doc->getXRef();
   subPage = gFalse;
   printCommands = globalParams->getPrintCommands();
+  initProfiler();
 
   // start the resource stack
   res = new GfxResources(xref, resDict, NULL);
 
   // initialize
   out = outA;
+  arena = new GArena();
   state = new GfxState(hDPI, vDPI, box, rotate, out->upsideDown());
+  state->setPathArena(arena);
   fontChanged = gFalse;
   clip = clipNone;
   ignoreUndef = 0;
@@ -524,6 +530,7 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, int pageNum, Dict *resDict,
   markedContentStack = new GList();
   ocState = gTrue;
   parser = NULL;
+  replayPos = -1;
   contentStreamStack = new GList();
   abortCheckCbk = abortCheckCbkA;
   abortCheckCbkData = abortCheckCbkDataA;
@@ -551,13 +558,16 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
   xref = doc->getXRef();
   subPage = gTrue;
   printCommands = globalParams->getPrintCommands();
+  initProfiler();
 
   // start the resource stack
   res = new GfxResources(xref, resDict, NULL);
 
   // initialize
   out = outA;
+  arena = new GArena();
   state = new GfxState(72, 72, box, 0, gFalse);
+  state->setPathArena(arena);
   fontChanged = gFalse;
   clip = clipNone;
   ignoreUndef = 0;
@@ -568,6 +578,7 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
   markedContentStack = new GList();
   ocState = gTrue;
   parser = NULL;
+  replayPos = -1;
   contentStreamStack = new GList();
   abortCheckCbk = abortCheckCbkA;
   abortCheckCbkData = abortCheckCbkDataA;
@@ -586,6 +597,8 @@ Gfx::Gfx(PDFDoc *docA, OutputDev *outA, Dict *resDict,
 }
 
 Gfx::~Gfx() {
+  int i;
+
   if (!subPage) {
     out->endPage();
   }
@@ -598,9 +611,36 @@ Gfx::~Gfx() {
   }
   deleteGList(markedContentStack, GfxMarkedContent);
   delete contentStreamStack;
+  if (profiler) {
+    for (i = 0; i < (int)numOps; ++i) {
+      profiler->addTotals(gfxProfileOp, opTab[i].name,
+			  profileOpCounts[i], profileOpTimes[i]);
+    }
+    gfree(profileOpCounts);
+    gfree(profileOpTimes);
+  }
+  delete arena;
+}
+
+void Gfx::initProfiler() {
+  int i;
+
+  if ((profiler = globalParams->getProfiler())) {
+    profileOpCounts = (int *)gmallocn(numOps, sizeof(int));
+    profileOpTimes = (double *)gmallocn(numOps, sizeof(double));
+    for (i = 0; i < (int)numOps; ++i) {
+      profileOpCounts[i] = 0;
+      profileOpTimes[i] = 0;
+    }
+  } else {
+    profileOpCounts = NULL;
+    profileOpTimes = NULL;
+  }
 }
 
 void Gfx::display(Object *objRef, GBool topLevel) {
+  ContentStreamCache *cache;
+  CompiledContent *compiled;
   Object obj1, obj2;
   int i;
 
@@ -637,10 +677,35 @@ void Gfx::display(Object *objRef, GBool topLevel) {
     obj1.free();
     return;
   }
-  parser = new Parser(xref, new Lexer(xref, &obj1), gFalse);
-  go(topLevel);
-  delete parser;
-  parser = NULL;
+
+  // forms, tiling patterns, and Type 3 glyphs are often drawn many
+  // times -- replay them from the content stream cache if they're
+  // there, otherwise compile them while parsing
+  compiled = NULL;
+  cache = doc->getContentStreamCache();
+  if (!topLevel && objRef->isRef() && cache && cache->isEnabled()) {
+    compiled = cache->lookup(objRef->getRefNum(), objRef->getRefGen());
+  }
+  if (compiled) {
+    parser = NULL;
+    goCompiled(compiled);
+  } else {
+    if (!topLevel && objRef->isRef() && cache && cache->isEnabled()) {
+      compiled = new CompiledContent(cache->getMaxEntrySize());
+    }
+    // compiled objects are long-lived, so they can't use the arena
+    parser = new Parser(xref, new Lexer(xref, &obj1), gFalse,
+			compiled ? (GArena *)NULL : arena);
+    go(topLevel, compiled);
+    delete parser;
+    parser = NULL;
+    if (compiled) {
+      cache->add(objRef->getRefNum(), objRef->getRefGen(), compiled);
+    }
+  }
+  if (compiled) {
+    compiled->decRef();
+  }
   contentStreamStack->del(contentStreamStack->getLength() - 1);
   obj1.free();
 }
@@ -680,7 +745,9 @@ GBool Gfx::checkForContentStreamLoop(Object *ref) {
   return gFalse;
 }
 
-void Gfx::go(GBool topLevel) {
+// Run the content stream from <parser>.  If <compiled> is non-NULL,
+// the objects are also saved there, for use by goCompiled.
+void Gfx::go(GBool topLevel, CompiledContent *compiled) {
   Object obj;
   Object args[maxArgs];
   GBool aborted;
@@ -707,6 +774,15 @@ void Gfx::go(GBool topLevel) {
 
     // got a command - execute it
     if (obj.isCmd()) {
+      if (compiled) {
+	// inline images are read directly from the parser, so they
+	// can't be replayed
+	if (obj.isCmd("BI")) {
+	  compiled->fail();
+	} else {
+	  compiled->add(&obj, getPos());
+	}
+      }
       if (printCommands) {
 	obj.print(stdout);
 	for (i = 0; i < numArgs; ++i) {
@@ -728,11 +804,17 @@ void Gfx::go(GBool topLevel) {
       if (errCount > contentStreamErrorLimit) {
 	error(errSyntaxError, -1,
 	      "Too many errors - giving up on this content stream");
+	if (compiled) {
+	  compiled->fail();
+	}
 	break;
       }
 
     // got an argument - save it
     } else if (numArgs < maxArgs) {
+      if (compiled) {
+	compiled->add(&obj, getPos());
+      }
       args[numArgs++] = obj;
 
     // too many arguments - something is wrong
@@ -751,6 +833,9 @@ void Gfx::go(GBool topLevel) {
     parser->getObj(&obj);
   }
   obj.free();
+  if (aborted && compiled) {
+    compiled->fail();
+  }
 
   // args at end with no command
   if (numArgs > 0) {
@@ -772,16 +857,89 @@ void Gfx::go(GBool topLevel) {
   }
 }
 
+// Replay a content stream compiled by go().
+void Gfx::goCompiled(CompiledContent *compiled) {
+  Object *objs;
+  GFileOffset *offsets;
+  GFileOffset oldReplayPos;
+  int n, start, numArgs, errCount, i, j;
+
+  objs = compiled->getObjects();
+  offsets = compiled->getOffsets();
+  n = compiled->getLength();
+  oldReplayPos = replayPos;
+  opCounter = 0;
+  errCount = 0;
+  start = 0;
+  for (i = 0; i < n; ++i) {
+
+    // check for an abort
+    ++opCounter;
+    if (abortCheckCbk && opCounter > 100) {
+      if ((*abortCheckCbk)(abortCheckCbkData)) {
+	replayPos = oldReplayPos;
+	return;
+      }
+      opCounter = 0;
+    }
+
+    // got a command - execute it (the preceding objects are its args)
+    if (objs[i].isCmd()) {
+      numArgs = i - start;
+      replayPos = offsets[i];
+      if (printCommands) {
+	objs[i].print(stdout);
+	for (j = start; j < i; ++j) {
+	  printf(" ");
+	  objs[j].print(stdout);
+	}
+	printf("\n");
+	fflush(stdout);
+      }
+      if (!execOp(&objs[i], objs + start, numArgs)) {
+	++errCount;
+      }
+      start = i + 1;
+
+      // check for too many errors
+      if (errCount > contentStreamErrorLimit) {
+	error(errSyntaxError, -1,
+	      "Too many errors - giving up on this content stream");
+	replayPos = oldReplayPos;
+	return;
+      }
+    }
+  }
+
+  // args at end with no command
+  if (start < n) {
+    replayPos = offsets[n - 1];
+    error(errSyntaxError, getPos(), "Leftover args in content stream");
+    if (printCommands) {
+      printf("%d leftovers:", n - start);
+      for (j = start; j < n; ++j) {
+	printf(" ");
+	objs[j].print(stdout);
+      }
+      printf("\n");
+      fflush(stdout);
+    }
+  }
+
+  replayPos = oldReplayPos;
+}
+
 // Returns true if successful, false on error.
 GBool Gfx::execOp(Object *cmd, Object args[], int numArgs) {
   Operator *op;
   char *name;
   Object *argPtr;
+  double t0, t1;
   int i;
 
   // find operator
   name = cmd->getCmd();
-  if (!(op = findOp(name))) {
+  if (!(op = findOp(cmd))) {
     if (ignoreUndef > 0) {
       return gTrue;
     }
@@ -823,13 +981,36 @@ GBool Gfx::execOp(Object *cmd, Object args[], int numArgs) {
   }
 
   // do it
-  (this->*op->func)(argPtr, numArgs);
+  if (profiler) {
+    t0 = GfxProfiler::getTime();
+    (this->*op->func)(argPtr, numArgs);
+    t1 = GfxProfiler::getTime();
+    if (profiler->getTracing()) {
+      profiler->addEvent(gfxProfileOp, op->name, t0, t1);
+    } else {
+      i = (int)(op - opTab);
+      ++profileOpCounts[i];
+      profileOpTimes[i] += t1 - t0;
+    }
+  } else {
+    (this->*op->func)(argPtr, numArgs);
+  }
 
   return gTrue;
 }
 
-Operator *Gfx::findOp(char *name) {
-  int a, b, m, cmp;
+// Command objects are almost always atoms (see AtomTable.h), so the
+// result of the search is cached in the atom's tag: zero means not
+// searched yet, -1 means unknown operator, and anything else is the
+// opTab index plus one.
+Operator *Gfx::findOp(Object *cmd) {
+  char *name;
+  int a, b, m, cmp, tag;
+
+  name = cmd->getCmd();
+  if (cmd->isAtom() && (tag = AtomTable::getTag(name)) != 0) {
+    return tag > 0 ? &opTab[tag - 1] : (Operator *)NULL;
+  }
 
   a = -1;
   b = numOps;
@@ -845,6 +1026,9 @@ Operator *Gfx::findOp(char *name) {
     else
       a = b = m;
   }
+  if (cmd->isAtom()) {
+    AtomTable::setTag(name, cmp == 0 ? a + 1 : -1);
+  }
   if (cmp != 0)
     return NULL;
   return &opTab[a];
@@ -866,7 +1050,7 @@ GBool Gfx::checkArg(Object *arg, TchkType type) {
 }
 
 GFileOffset Gfx::getPos() {
-  return parser ? parser->getPos() : -1;
+  return parser ? parser->getPos() : replayPos;
 }
 
 //------------------------------------------------------------------------
@@ -3939,6 +4123,7 @@ void Gfx::opXObject(Object args[], int numArgs) {
   char *name;
   Object obj1, obj2, obj3, refObj;
   GBool ocSaved, oc;
+  double t0;
 #if OPI_SUPPORT
   Object opiDict;
 #endif
@@ -3977,7 +4162,11 @@ void Gfx::opXObject(Object args[], int numArgs) {
     if (obj2.isName("Image")) {
       if (out->needNonText()) {
 	res->lookupXObjectNF(name, &refObj);
+	t0 = profiler ? GfxProfiler::getTime() : 0;
 	doImage(&refObj, obj1.getStream(), gFalse);
+	if (profiler) {
+	  profileXObject(gfxProfileImage, name, &refObj, t0);
+	}
 	refObj.free();
       }
     } else if (obj2.isName("Form")) {
@@ -3987,7 +4176,11 @@ void Gfx::opXObject(Object args[], int numArgs) {
 	  out->drawForm(refObj.getRef());
 	}
       } else {
+	t0 = profiler ? GfxProfiler::getTime() : 0;
 	doForm(&refObj, &obj1);
+	if (profiler) {
+	  profileXObject(gfxProfileXObject, name, &refObj, t0);
+	}
       }
       refObj.free();
     } else if (obj2.isName("PS")) {
@@ -4021,6 +4214,24 @@ void Gfx::opXObject(Object args[], int numArgs) {
   ocState = ocSaved;
 }
 
+// Add a profiler event for the XObject called <name>, which started
+// at time <t0>.
+void Gfx::profileXObject(GfxProfilerCategory cat, char *name, Object *ref,
+			 double t0) {
+  GString *s;
+  double t1;
+
+  t1 = GfxProfiler::getTime();
+  if (ref->isRef()) {
+    s = GString::format("/{0:s} ({1:d} {2:d} R)",
+			name, ref->getRefNum(), ref->getRefGen());
+  } else {
+    s = GString::format("/{0:s}", name);
+  }
+  profiler->addEvent(cat, s->getCString(), t0, t1);
+  delete s;
+}
+
 void Gfx::doImage(Object *ref, Stream *str, GBool inlineImg) {
   Dict *dict, *maskDict;
   int width, height;
@@ -4710,6 +4921,7 @@ void Gfx::endOfPage() {
 void Gfx::opBeginImage(Object args[], int numArgs) {
   Stream *str;
   GBool haveLength;
+  double t0;
   int c1, c2, c3;
 
   // NB: this function is run even if ocState is false -- doImage() is
@@ -4720,7 +4932,12 @@ void Gfx::opBeginImage(Object args[], int numArgs) {
 
   // display the image
   if (str) {
+    t0 = profiler ? GfxProfiler::getTime() : 0;
     doImage(NULL, str, gTrue);
+    if (profiler) {
+      profiler->addEvent(gfxProfileImage, "inline image",
+			 t0, GfxProfiler::getTime());
+    }
   
     // if we have the stream length, skip to end-of-stream and then
     // skip 'EI' in the original stream
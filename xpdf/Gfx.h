@@ -18,14 +18,17 @@
 #include "gtypes.h"
 #include "gfile.h"
 #include "GfxState.h"
+#include "GfxProfiler.h"
 
 class GString;
 class GList;
+class GArena;
 class PDFDoc;
 class XRef;
 class Array;
 class Stream;
 class Parser;
+class CompiledContent;
 class Dict;
 class Function;
 class OutputDev;
@@ -187,10 +190,15 @@ private:
   OutputDev *out;		// output device
   GBool subPage;		// is this a sub-page object?
   GBool printCommands;		// print the drawing commands (for debugging)
+  GfxProfiler *profiler;	// profiler (NULL if profiling is disabled)
+  int *profileOpCounts;		// per-operator call counts and times,
+  double *profileOpTimes;	//   merged into the profiler in ~Gfx
   GfxResources *res;		// resource stack
   int opCounter;		// operation counter (used to decide when
 				//   to check for an abort)
 
+  GArena *arena;		// arena for transient objects (content
+				//   stream objects and paths)
   GfxState *state;		// current graphics state
   GBool fontChanged;		// set if font or text matrix has changed
   GfxClipType clip;		// do a clip?
@@ -203,6 +211,8 @@ private:
   GList *markedContentStack;	// BMC/BDC/EMC stack [GfxMarkedContent]
 
   Parser *parser;		// parser for page content stream(s)
+  GFileOffset replayPos;	// stream offset of the current op, while
+				//   replaying compiled content
   GList *contentStreamStack;	// stack of open content streams, used
 				//   for loop-checking
 
@@ -212,10 +222,12 @@ private:
 
   static Operator opTab[];	// table of operators
 
+  void initProfiler();
   GBool checkForContentStreamLoop(Object *ref);
-  void go(GBool topLevel);
+  void go(GBool topLevel, CompiledContent *compiled);
+  void goCompiled(CompiledContent *compiled);
   GBool execOp(Object *cmd, Object args[], int numArgs);
-  Operator *findOp(char *name);
+  Operator *findOp(Object *cmd);
   GBool checkArg(Object *arg, TchkType type);
   GFileOffset getPos();
 
@@ -330,6 +342,8 @@ private:
 
   // XObject operators
   void opXObject(Object args[], int numArgs);
+  void profileXObject(GfxProfilerCategory cat, char *name, Object *ref,
+		      double t0);
   void doImage(Object *ref, Stream *str, GBool inlineImg);
   void doForm(Object *strRef, Object *str);
 
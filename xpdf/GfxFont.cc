@@ -26,6 +26,7 @@
 #include "Object.h"
 #include "Dict.h"
 #include "GlobalParams.h"
+#include "GfxProfiler.h"
 #include "CMap.h"
 #include "CharCodeToUnicode.h"
 #include "FontEncodingTables.h"
@@ -827,7 +828,7 @@ char *GfxFont::readEmbFontFile(XRef *xref, int *len) {
   char *buf;
   Object obj1, obj2;
   Stream *str;
-  int size, n;
+  int size, bufSize, n;
 
   obj1.initRef(embFontID.num, embFontID.gen);
   obj1.fetch(xref, &obj2);
@@ -840,18 +841,24 @@ char *GfxFont::readEmbFontFile(XRef *xref, int *len) {
   }
   str = obj2.getStream();
 
+  // grow the buffer geometrically, to avoid repeatedly copying large
+  // font programs
   size = 0;
+  bufSize = 0;
   buf = NULL;
   str->reset();
   do {
-    if (size > INT_MAX - 4096) {
-      error(errSyntaxError, -1, "Embedded font file is too large");
-      break;
+    if (bufSize - size < 4096) {
+      if (bufSize > INT_MAX / 2) {
+	error(errSyntaxError, -1, "Embedded font file is too large");
+	break;
+      }
+      bufSize = bufSize ? 2 * bufSize : 16384;
+      buf = (char *)grealloc(buf, bufSize);
     }
-    buf = (char *)grealloc(buf, size + 4096);
-    n = str->getBlock(buf + size, 4096);
+    n = str->getBlock(buf + size, bufSize - size);
     size += n;
-  } while (n == 4096);
+  } while (size == bufSize);
   *len = size;
   str->close();
 
@@ -2072,13 +2079,17 @@ GBool GfxCIDFont::problematicForUnicode() {
 
 GfxFontDict::GfxFontDict(XRef *xref, Ref *fontDictRef, Dict *fontDict) {
   GfxFont *font;
+  GfxProfiler *profiler;
+  GString *name;
   char *tag;
   Object obj1, obj2;
   Ref r;
+  double t0;
   int i;
 
   fonts = new GHash(gTrue);
   uniqueFonts = new GList();
+  profiler = globalParams->getProfiler();
   for (i = 0; i < fontDict->getLength(); ++i) {
     tag = fontDict->getKey(i);
     fontDict->getValNF(i, &obj1);
@@ -2101,14 +2112,25 @@ GfxFontDict::GfxFontDict(XRef *xref, Ref *fontDictRef, Dict *fontDict) {
 	r.gen = 100000;
 	r.num = hashFontObject(&obj2);
       }
+      t0 = profiler ? GfxProfiler::getTime() : 0;
       if ((font = GfxFont::makeFont(xref, tag, r, obj2.getDict()))) {
 	if (!font->isOk()) {
 	  delete font;
+	  font = NULL;
 	} else {
 	  uniqueFonts->append(font);
 	  fonts->add(new GString(tag), font);
 	}
       }
+      if (profiler) {
+	name = GString::format("{0:s} ({1:d} {2:d} R) - parse",
+			       (font && font->getName())
+			         ? font->getName()->getCString() : tag,
+			       r.num, r.gen);
+	profiler->addEvent(gfxProfileFont, name->getCString(),
+			   t0, GfxProfiler::getTime());
+	delete name;
+      }
     }
     obj1.free();
     obj2.free();
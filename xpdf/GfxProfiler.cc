@@ -0,0 +1,362 @@
+//========================================================================
+//
+// GfxProfiler.cc
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma implementation
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#  include <sys/time.h>
+#endif
+#include "gmem.h"
+#include "gmempp.h"
+#include "GString.h"
+#include "GList.h"
+#include "GHash.h"
+#include "GfxProfiler.h"
+
+#if MULTITHREADED
+#  define lockProfiler   gLockMutex(&mutex)
+#  define unlockProfiler gUnlockMutex(&mutex)
+#else
+#  define lockProfiler
+#  define unlockProfiler
+#endif
+
+//------------------------------------------------------------------------
+
+// Maximum number of individual events saved for tracing -- anything
+// past this is still included in the totals.
+#define gfxProfilerMaxEvents 1000000
+
+static const char *categoryNames[gfxProfilerNumCategories] = {
+  "page",
+  "op",
+  "xobject",
+  "image",
+  "font",
+  "jbig2"
+};
+
+static const char *categoryTitles[gfxProfilerNumCategories] = {
+  "pages",
+  "operators",
+  "form XObjects",
+  "images",
+  "fonts",
+  "JBIG2 segments"
+};
+
+//------------------------------------------------------------------------
+
+struct GfxProfilerEntry {
+  GfxProfilerCategory cat;
+  GString *name;
+  long count;
+  double total;
+  double max;
+};
+
+struct GfxProfilerEvent {
+  GfxProfilerEntry *entry;
+  double t0, t1;
+  int thread;
+};
+
+#if MULTITHREADED
+struct GfxProfilerThread {
+#ifdef _WIN32
+  DWORD id;
+#else
+  pthread_t id;
+#endif
+};
+#endif
+
+static int cmpEntries(const void *p1, const void *p2) {
+  GfxProfilerEntry *e1 = *(GfxProfilerEntry **)p1;
+  GfxProfilerEntry *e2 = *(GfxProfilerEntry **)p2;
+
+  if (e1->total > e2->total) {
+    return -1;
+  }
+  if (e1->total < e2->total) {
+    return 1;
+  }
+  return e1->name->cmp(e2->name);
+}
+
+//------------------------------------------------------------------------
+// GfxProfiler
+//------------------------------------------------------------------------
+
+GfxProfiler::GfxProfiler() {
+  tracing = gFalse;
+  entries = new GHash(gTrue);
+  entryList = new GList();
+  events = NULL;
+  eventsLen = eventsSize = 0;
+  nDroppedEvents = 0;
+#if MULTITHREADED
+  threads = new GList();
+  gInitMutex(&mutex);
+#endif
+  startTime = getTime();
+}
+
+GfxProfiler::~GfxProfiler() {
+  clear();
+  delete entries;
+  delete entryList;
+#if MULTITHREADED
+  deleteGList(threads, GfxProfilerThread);
+  gDestroyMutex(&mutex);
+#endif
+}
+
+double GfxProfiler::getTime() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, t;
+
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+#else
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + 1e-6 * (double)tv.tv_usec;
+#endif
+}
+
+void GfxProfiler::addEvent(GfxProfilerCategory cat, const char *name,
+			   double t0, double t1) {
+  GfxProfilerEntry *entry;
+  GfxProfilerEvent *ev;
+
+  lockProfiler;
+  entry = getEntry(cat, name);
+  ++entry->count;
+  entry->total += t1 - t0;
+  if (t1 - t0 > entry->max) {
+    entry->max = t1 - t0;
+  }
+  if (tracing) {
+    if (eventsLen < gfxProfilerMaxEvents) {
+      if (eventsLen == eventsSize) {
+	eventsSize = eventsSize ? 2 * eventsSize : 1024;
+	events = (GfxProfilerEvent *)greallocn(events, eventsSize,
+					       sizeof(GfxProfilerEvent));
+      }
+      ev = &events[eventsLen++];
+      ev->entry = entry;
+      ev->t0 = t0;
+      ev->t1 = t1;
+      ev->thread = getThreadIdx();
+    } else {
+      ++nDroppedEvents;
+    }
+  }
+  unlockProfiler;
+}
+
+void GfxProfiler::addTotals(GfxProfilerCategory cat, const char *name,
+			    int count, double time) {
+  GfxProfilerEntry *entry;
+
+  if (count <= 0) {
+    return;
+  }
+  lockProfiler;
+  entry = getEntry(cat, name);
+  entry->count += count;
+  entry->total += time;
+  // the individual times are unknown, so use the average
+  if (time / count > entry->max) {
+    entry->max = time / count;
+  }
+  unlockProfiler;
+}
+
+void GfxProfiler::clear() {
+  GfxProfilerEntry *entry;
+  int i;
+
+  lockProfiler;
+  for (i = 0; i < entryList->getLength(); ++i) {
+    entry = (GfxProfilerEntry *)entryList->get(i);
+    delete entry->name;
+    delete entry;
+  }
+  delete entries;
+  entries = new GHash(gTrue);
+  delete entryList;
+  entryList = new GList();
+  gfree(events);
+  events = NULL;
+  eventsLen = eventsSize = 0;
+  nDroppedEvents = 0;
+  startTime = getTime();
+  unlockProfiler;
+}
+
+// Find or create the entry for <cat>/<name> -- the caller must hold
+// the lock.
+GfxProfilerEntry *GfxProfiler::getEntry(GfxProfilerCategory cat,
+					const char *name) {
+  GfxProfilerEntry *entry;
+  GString *key;
+
+  key = GString::format("{0:d}/{1:s}", (int)cat, name);
+  if ((entry = (GfxProfilerEntry *)entries->lookup(key))) {
+    delete key;
+    return entry;
+  }
+  entry = new GfxProfilerEntry;
+  entry->cat = cat;
+  entry->name = new GString(name);
+  entry->count = 0;
+  entry->total = 0;
+  entry->max = 0;
+  entries->add(key, entry);
+  entryList->append(entry);
+  return entry;
+}
+
+// Return a small integer identifying the calling thread -- the caller
+// must hold the lock.
+int GfxProfiler::getThreadIdx() {
+#if MULTITHREADED
+  GfxProfilerThread *thread;
+  int i;
+
+  for (i = 0; i < threads->getLength(); ++i) {
+    thread = (GfxProfilerThread *)threads->get(i);
+#ifdef _WIN32
+    if (thread->id == GetCurrentThreadId()) {
+      return i;
+    }
+#else
+    if (pthread_equal(thread->id, pthread_self())) {
+      return i;
+    }
+#endif
+  }
+  thread = new GfxProfilerThread;
+#ifdef _WIN32
+  thread->id = GetCurrentThreadId();
+#else
+  thread->id = pthread_self();
+#endif
+  threads->append(thread);
+  return threads->getLength() - 1;
+#else
+  return 0;
+#endif
+}
+
+void GfxProfiler::writeReport(FILE *f) {
+  GfxProfilerEntry **sorted;
+  GfxProfilerEntry *entry;
+  double total;
+  long count;
+  int cat, n, i;
+
+  lockProfiler;
+  sorted = (GfxProfilerEntry **)gmallocn(entryList->getLength() + 1,
+					 sizeof(GfxProfilerEntry *));
+  for (cat = 0; cat < gfxProfilerNumCategories; ++cat) {
+    n = 0;
+    count = 0;
+    total = 0;
+    for (i = 0; i < entryList->getLength(); ++i) {
+      entry = (GfxProfilerEntry *)entryList->get(i);
+      if (entry->cat == cat) {
+	sorted[n++] = entry;
+	count += entry->count;
+	total += entry->total;
+      }
+    }
+    if (n == 0) {
+      continue;
+    }
+    qsort(sorted, n, sizeof(GfxProfilerEntry *), &cmpEntries);
+    fprintf(f, "%s: %ld, %.3f ms\n",
+	    categoryTitles[cat], count, 1000 * total);
+    fprintf(f, "      count     total ms       avg us       max us  name\n");
+    for (i = 0; i < n; ++i) {
+      entry = sorted[i];
+      fprintf(f, "%11ld %12.3f %12.3f %12.3f  %s\n",
+	      entry->count, 1000 * entry->total,
+	      1e6 * entry->total / entry->count, 1e6 * entry->max,
+	      entry->name->getCString());
+    }
+    fprintf(f, "\n");
+  }
+  if (nDroppedEvents > 0) {
+    fprintf(f, "%d trace events were dropped\n", nDroppedEvents);
+  }
+  gfree(sorted);
+  unlockProfiler;
+}
+
+void GfxProfiler::writeChromeTrace(FILE *f) {
+  GfxProfilerEvent *ev;
+  char *p;
+  int i;
+
+  lockProfiler;
+  fprintf(f, "{\"traceEvents\":[\n");
+  for (i = 0; i < eventsLen; ++i) {
+    ev = &events[i];
+    fprintf(f, "{\"name\":\"");
+    for (p = ev->entry->name->getCString(); *p; ++p) {
+      if (*p == '"' || *p == '\\') {
+	fprintf(f, "\\%c", *p);
+      } else if ((unsigned char)*p < 0x20 || (unsigned char)*p >= 0x7f) {
+	fprintf(f, "\\u%04x", *p & 0xff);
+      } else {
+	fputc(*p, f);
+      }
+    }
+    fprintf(f, "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+	    "\"pid\":1,\"tid\":%d}%s\n",
+	    categoryNames[ev->entry->cat],
+	    1e6 * (ev->t0 - startTime), 1e6 * (ev->t1 - ev->t0),
+	    ev->thread, i < eventsLen - 1 ? "," : "");
+  }
+  fprintf(f, "],\n\"displayTimeUnit\":\"ms\"}\n");
+  unlockProfiler;
+}
+
+GBool GfxProfiler::writeFile(const char *fileName) {
+  FILE *f;
+
+  if (!(f = fopen(fileName, "w"))) {
+    return gFalse;
+  }
+  if (tracing) {
+    writeChromeTrace(f);
+  } else {
+    writeReport(f);
+  }
+  fclose(f);
+  return gTrue;
+}
@@ -0,0 +1,111 @@
+//========================================================================
+//
+// GfxProfiler.h
+//
+// Collects timing statistics for content stream operators, XObjects,
+// font loads, and image decodes.
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#ifndef GFXPROFILER_H
+#define GFXPROFILER_H
+
+#include <aconf.h>
+
+#ifdef USE_GCC_PRAGMAS
+#pragma interface
+#endif
+
+#include <stdio.h>
+#include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
+
+class GString;
+class GHash;
+class GList;
+struct GfxProfilerEntry;
+struct GfxProfilerEvent;
+
+//------------------------------------------------------------------------
+
+enum GfxProfilerCategory {
+  gfxProfilePage,		// one page (content stream plus annotations)
+  gfxProfileOp,			// content stream operator
+  gfxProfileXObject,		// form XObject
+  gfxProfileImage,		// image XObject or inline image
+  gfxProfileFont,		// font dictionary parse or font file load
+  gfxProfileJBIG2		// JBIG2 segment decode
+};
+
+#define gfxProfilerNumCategories 6
+
+//------------------------------------------------------------------------
+// GfxProfiler
+//------------------------------------------------------------------------
+
+class GfxProfiler {
+public:
+
+  GfxProfiler();
+  ~GfxProfiler();
+
+  // Return the current time, in seconds.  Only differences between
+  // two values are meaningful.
+  static double getTime();
+
+  // If <tracingA> is true, individual events are saved (in addition
+  // to the per-name totals), so that writeChromeTrace can be used.
+  void setTracing(GBool tracingA) { tracing = tracingA; }
+  GBool getTracing() { return tracing; }
+
+  // Record a single event which started at time <t0> and ended at
+  // time <t1> (as returned by getTime()).
+  void addEvent(GfxProfilerCategory cat, const char *name,
+		double t0, double t1);
+
+  // Add <count> events, with a total time of <time> seconds, to the
+  // totals for <name>.  This does not save individual events.
+  void addTotals(GfxProfilerCategory cat, const char *name,
+		 int count, double time);
+
+  // Discard all collected data.
+  void clear();
+
+  // Write a plain text report, with one section per category, sorted
+  // by total time.
+  void writeReport(FILE *f);
+
+  // Write the saved events in the Chrome trace event format (JSON),
+  // which can be loaded into chrome://tracing and similar viewers.
+  void writeChromeTrace(FILE *f);
+
+  // Write a Chrome trace (if tracing is enabled) or a plain text
+  // report (otherwise) to <fileName>.  Returns false if the file
+  // couldn't be opened.
+  GBool writeFile(const char *fileName);
+
+private:
+
+  GfxProfilerEntry *getEntry(GfxProfilerCategory cat, const char *name);
+  int getThreadIdx();
+
+  GBool tracing;
+  double startTime;
+  GHash *entries;		// [GfxProfilerEntry], keyed by category
+				//   and name
+  GList *entryList;		// [GfxProfilerEntry]
+  GfxProfilerEvent *events;
+  int eventsLen;
+  int eventsSize;
+  int nDroppedEvents;
+#if MULTITHREADED
+  GList *threads;		// thread handles, indexed by thread idx
+  GMutex mutex;
+#endif
+};
+
+#endif
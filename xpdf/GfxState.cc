@@ -17,6 +17,7 @@
 #include <string.h>
 #include "gmem.h"
 #include "gmempp.h"
+#include "GArena.h"
 #include "Error.h"
 #include "GlobalParams.h"
 #include "Object.h"
@@ -42,6 +43,97 @@ static inline double clip01(double x) {
   return (x < 0) ? 0 : (x > 1) ? 1 : x;
 }
 
+//------------------------------------------------------------------------
+// GfxColorCache
+//------------------------------------------------------------------------
+
+// Number of colors handled in one batch by the getXXXLine functions.
+#define gfxColorLineChunk 64
+
+// Number of entries in a GfxColorCache (must be a power of two).
+#define gfxColorCacheSize 1024
+
+// A direct-mapped cache of color conversion results, keyed on the
+// exact input color components.  This is used by color spaces with
+// expensive conversions (tint transforms, Lab, CMYK->RGB), where
+// images and shadings tend to repeat the same colors many times.
+class GfxColorCache {
+public:
+
+  GfxColorCache(int nInA, int nOutA);
+  ~GfxColorCache();
+
+  // Returns a pointer to the <nOut> cached output components for
+  // <in>, or NULL if <in> isn't in the cache.
+  GfxColorComp *lookup(GfxColorComp *in);
+
+  // Add the conversion <in> -> <out>.
+  void add(GfxColorComp *in, GfxColorComp *out);
+
+private:
+
+  int hash(GfxColorComp *in);
+
+  int nIn, nOut;		// number of input/output components
+  GfxColorComp *keys;		// input components for each entry
+  GfxColorComp *vals;		// output components for each entry
+  GBool *valid;			// true for entries that have been set
+};
+
+GfxColorCache::GfxColorCache(int nInA, int nOutA) {
+  nIn = nInA;
+  nOut = nOutA;
+  keys = (GfxColorComp *)gmallocn(gfxColorCacheSize * nIn,
+				  sizeof(GfxColorComp));
+  vals = (GfxColorComp *)gmallocn(gfxColorCacheSize * nOut,
+				  sizeof(GfxColorComp));
+  valid = (GBool *)gmallocn(gfxColorCacheSize, sizeof(GBool));
+  memset(valid, 0, gfxColorCacheSize * sizeof(GBool));
+}
+
+GfxColorCache::~GfxColorCache() {
+  gfree(keys);
+  gfree(vals);
+  gfree(valid);
+}
+
+inline int GfxColorCache::hash(GfxColorComp *in) {
+  Guint h;
+  int i;
+
+  h = 0;
+  for (i = 0; i < nIn; ++i) {
+    h = (h ^ (Guint)in[i]) * 0x9e3779b1;
+  }
+  return (int)((h ^ (h >> 16)) & (gfxColorCacheSize - 1));
+}
+
+GfxColorComp *GfxColorCache::lookup(GfxColorComp *in) {
+  GfxColorComp *key;
+  int h, i;
+
+  h = hash(in);
+  if (!valid[h]) {
+    return NULL;
+  }
+  key = &keys[h * nIn];
+  for (i = 0; i < nIn; ++i) {
+    if (key[i] != in[i]) {
+      return NULL;
+    }
+  }
+  return &vals[h * nOut];
+}
+
+void GfxColorCache::add(GfxColorComp *in, GfxColorComp *out) {
+  int h;
+
+  h = hash(in);
+  memcpy(&keys[h * nIn], in, nIn * sizeof(GfxColorComp));
+  memcpy(&vals[h * nOut], out, nOut * sizeof(GfxColorComp));
+  valid[h] = gTrue;
+}
+
 //------------------------------------------------------------------------
 
 struct GfxBlendModeInfo {
@@ -105,6 +197,48 @@ GfxColorSpace::GfxColorSpace() {
 GfxColorSpace::~GfxColorSpace() {
 }
 
+void GfxColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+				GfxRenderingIntent ri) {
+  GfxColor color;
+  int nComps, i, j;
+
+  nComps = getNComps();
+  for (j = 0; j < n; ++j) {
+    for (i = 0; i < nComps; ++i) {
+      color.c[i] = *in++;
+    }
+    getGray(&color, &out[j], ri);
+  }
+}
+
+void GfxColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			       GfxRenderingIntent ri) {
+  GfxColor color;
+  int nComps, i, j;
+
+  nComps = getNComps();
+  for (j = 0; j < n; ++j) {
+    for (i = 0; i < nComps; ++i) {
+      color.c[i] = *in++;
+    }
+    getRGB(&color, &out[j], ri);
+  }
+}
+
+void GfxColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+				GfxRenderingIntent ri) {
+  GfxColor color;
+  int nComps, i, j;
+
+  nComps = getNComps();
+  for (j = 0; j < n; ++j) {
+    for (i = 0; i < nComps; ++i) {
+      color.c[i] = *in++;
+    }
+    getCMYK(&color, &out[j], ri);
+  }
+}
+
 GfxColorSpace *GfxColorSpace::parse(Object *csObj,
 				    int recursion) {
   GfxColorSpace *cs;
@@ -232,6 +366,34 @@ void GfxDeviceGrayColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = clip01(gfxColorComp1 - color->c[0]);
 }
 
+void GfxDeviceGrayColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out,
+					  int n, GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j) {
+    out[j] = clip01(in[j]);
+  }
+}
+
+void GfxDeviceGrayColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+					 GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j) {
+    out[j].r = out[j].g = out[j].b = clip01(in[j]);
+  }
+}
+
+void GfxDeviceGrayColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out,
+					  int n, GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j) {
+    out[j].c = out[j].m = out[j].y = 0;
+    out[j].k = clip01(gfxColorComp1 - in[j]);
+  }
+}
+
 
 void GfxDeviceGrayColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = 0;
@@ -330,6 +492,34 @@ void GfxCalGrayColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = clip01(gfxColorComp1 - color->c[0]);
 }
 
+void GfxCalGrayColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+				       GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j) {
+    out[j] = clip01(in[j]);
+  }
+}
+
+void GfxCalGrayColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+				      GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j) {
+    out[j].r = out[j].g = out[j].b = clip01(in[j]);
+  }
+}
+
+void GfxCalGrayColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+				       GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j) {
+    out[j].c = out[j].m = out[j].y = 0;
+    out[j].k = clip01(gfxColorComp1 - in[j]);
+  }
+}
+
 
 void GfxCalGrayColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = 0;
@@ -387,6 +577,51 @@ void GfxDeviceRGBColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = k;
 }
 
+void GfxDeviceRGBColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+					 GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j, in += 3) {
+    out[j] = clip01((GfxColorComp)(0.3  * in[0] +
+				   0.59 * in[1] +
+				   0.11 * in[2] + 0.5));
+  }
+}
+
+void GfxDeviceRGBColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+					GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j, in += 3) {
+    out[j].r = clip01(in[0]);
+    out[j].g = clip01(in[1]);
+    out[j].b = clip01(in[2]);
+  }
+}
+
+void GfxDeviceRGBColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+					 GfxRenderingIntent ri) {
+  GfxColorComp c, m, y, k;
+  int j;
+
+  for (j = 0; j < n; ++j, in += 3) {
+    c = clip01(gfxColorComp1 - in[0]);
+    m = clip01(gfxColorComp1 - in[1]);
+    y = clip01(gfxColorComp1 - in[2]);
+    k = c;
+    if (m < k) {
+      k = m;
+    }
+    if (y < k) {
+      k = y;
+    }
+    out[j].c = c - k;
+    out[j].m = m - k;
+    out[j].y = y - k;
+    out[j].k = k;
+  }
+}
+
 
 void GfxDeviceRGBColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = 0;
@@ -533,6 +768,51 @@ void GfxCalRGBColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = k;
 }
 
+void GfxCalRGBColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+				      GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j, in += 3) {
+    out[j] = clip01((GfxColorComp)(0.299 * in[0] +
+				   0.587 * in[1] +
+				   0.114 * in[2] + 0.5));
+  }
+}
+
+void GfxCalRGBColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+				     GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j, in += 3) {
+    out[j].r = clip01(in[0]);
+    out[j].g = clip01(in[1]);
+    out[j].b = clip01(in[2]);
+  }
+}
+
+void GfxCalRGBColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+				      GfxRenderingIntent ri) {
+  GfxColorComp c, m, y, k;
+  int j;
+
+  for (j = 0; j < n; ++j, in += 3) {
+    c = clip01(gfxColorComp1 - in[0]);
+    m = clip01(gfxColorComp1 - in[1]);
+    y = clip01(gfxColorComp1 - in[2]);
+    k = c;
+    if (m < k) {
+      k = m;
+    }
+    if (y < k) {
+      k = y;
+    }
+    out[j].c = c - k;
+    out[j].m = m - k;
+    out[j].y = y - k;
+    out[j].k = k;
+  }
+}
+
 
 void GfxCalRGBColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = 0;
@@ -545,9 +825,11 @@ void GfxCalRGBColorSpace::getDefaultColor(GfxColor *color) {
 //------------------------------------------------------------------------
 
 GfxDeviceCMYKColorSpace::GfxDeviceCMYKColorSpace() {
+  rgbCache = NULL;
 }
 
 GfxDeviceCMYKColorSpace::~GfxDeviceCMYKColorSpace() {
+  delete rgbCache;
 }
 
 GfxColorSpace *GfxDeviceCMYKColorSpace::copy() {
@@ -637,6 +919,58 @@ void GfxDeviceCMYKColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = clip01(color->c[3]);
 }
 
+void GfxDeviceCMYKColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out,
+					  int n, GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j, in += 4) {
+    out[j] = clip01((GfxColorComp)(gfxColorComp1 - in[3]
+				   - 0.3  * in[0]
+				   - 0.59 * in[1]
+				   - 0.11 * in[2] + 0.5));
+  }
+}
+
+void GfxDeviceCMYKColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+					 GfxRenderingIntent ri) {
+  GfxColor color;
+  GfxColorComp rgb[3], *p;
+  int j;
+
+  if (!rgbCache) {
+    rgbCache = new GfxColorCache(4, 3);
+  }
+  for (j = 0; j < n; ++j, in += 4) {
+    if ((p = rgbCache->lookup(in))) {
+      out[j].r = p[0];
+      out[j].g = p[1];
+      out[j].b = p[2];
+    } else {
+      color.c[0] = in[0];
+      color.c[1] = in[1];
+      color.c[2] = in[2];
+      color.c[3] = in[3];
+      GfxDeviceCMYKColorSpace::getRGB(&color, &out[j], ri);
+      rgb[0] = out[j].r;
+      rgb[1] = out[j].g;
+      rgb[2] = out[j].b;
+      rgbCache->add(in, rgb);
+    }
+  }
+}
+
+void GfxDeviceCMYKColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out,
+					  int n, GfxRenderingIntent ri) {
+  int j;
+
+  for (j = 0; j < n; ++j, in += 4) {
+    out[j].c = clip01(in[0]);
+    out[j].m = clip01(in[1]);
+    out[j].y = clip01(in[2]);
+    out[j].k = clip01(in[3]);
+  }
+}
+
 
 void GfxDeviceCMYKColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = 0;
@@ -663,9 +997,11 @@ GfxLabColorSpace::GfxLabColorSpace() {
   blackX = blackY = blackZ = 0;
   aMin = bMin = -100;
   aMax = bMax = 100;
+  rgbCache = NULL;
 }
 
 GfxLabColorSpace::~GfxLabColorSpace() {
+  delete rgbCache;
 }
 
 GfxColorSpace *GfxLabColorSpace::copy() {
@@ -833,6 +1169,77 @@ void GfxLabColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   cmyk->k = k;
 }
 
+void GfxLabColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+				   GfxRenderingIntent ri) {
+  GfxRGB rgb[gfxColorLineChunk];
+  int j, k, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    getRGBLine(in + 3 * j, rgb, m, ri);
+    for (k = 0; k < m; ++k) {
+      out[j + k] = clip01((GfxColorComp)(0.299 * rgb[k].r +
+					 0.587 * rgb[k].g +
+					 0.114 * rgb[k].b + 0.5));
+    }
+  }
+}
+
+void GfxLabColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+				  GfxRenderingIntent ri) {
+  GfxColor color;
+  GfxColorComp rgb[3], *p;
+  int j;
+
+  if (!rgbCache) {
+    rgbCache = new GfxColorCache(3, 3);
+  }
+  for (j = 0; j < n; ++j, in += 3) {
+    if ((p = rgbCache->lookup(in))) {
+      out[j].r = p[0];
+      out[j].g = p[1];
+      out[j].b = p[2];
+    } else {
+      color.c[0] = in[0];
+      color.c[1] = in[1];
+      color.c[2] = in[2];
+      GfxLabColorSpace::getRGB(&color, &out[j], ri);
+      rgb[0] = out[j].r;
+      rgb[1] = out[j].g;
+      rgb[2] = out[j].b;
+      rgbCache->add(in, rgb);
+    }
+  }
+}
+
+void GfxLabColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+				   GfxRenderingIntent ri) {
+  GfxRGB rgb[gfxColorLineChunk];
+  GfxColorComp c, m, y, k;
+  int j, i, nj;
+
+  for (j = 0; j < n; j += nj) {
+    nj = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    getRGBLine(in + 3 * j, rgb, nj, ri);
+    for (i = 0; i < nj; ++i) {
+      c = clip01(gfxColorComp1 - rgb[i].r);
+      m = clip01(gfxColorComp1 - rgb[i].g);
+      y = clip01(gfxColorComp1 - rgb[i].b);
+      k = c;
+      if (m < k) {
+	k = m;
+      }
+      if (y < k) {
+	k = y;
+      }
+      out[j + i].c = c - k;
+      out[j + i].m = m - k;
+      out[j + i].y = y - k;
+      out[j + i].k = k;
+    }
+  }
+}
+
 
 void GfxLabColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = 0;
@@ -988,6 +1395,20 @@ void GfxICCBasedColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   alt->getCMYK(color, cmyk, ri);
 }
 
+void GfxICCBasedColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+					GfxRenderingIntent ri) {
+  alt->getGrayLine(in, out, n, ri);
+}
+
+void GfxICCBasedColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+				       GfxRenderingIntent ri) {
+  alt->getRGBLine(in, out, n, ri);
+}
+
+void GfxICCBasedColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+					GfxRenderingIntent ri) {
+  alt->getCMYKLine(in, out, n, ri);
+}
 
 void GfxICCBasedColorSpace::getDefaultColor(GfxColor *color) {
   int i;
@@ -1172,6 +1593,67 @@ void GfxIndexedColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   base->getCMYK(mapColorToBase(color, &color2), cmyk, ri);
 }
 
+// Map a line of <n> (<= gfxColorLineChunk) indexes to base color
+// space components.  This is the same as calling mapColorToBase on
+// each index.
+void GfxIndexedColorSpace::mapLineToBase(GfxColorComp *in, GfxColorComp *out,
+					 int n) {
+  double low[gfxColorMaxComps], range[gfxColorMaxComps];
+  Guchar *p;
+  int nBase, i, j, k;
+
+  nBase = base->getNComps();
+  base->getDefaultRanges(low, range, indexHigh);
+  for (j = 0; j < n; ++j) {
+    k = (int)(colToDbl(in[j]) + 0.5);
+    if (k < 0) {
+      k = 0;
+    } else if (k > indexHigh) {
+      k = indexHigh;
+    }
+    p = &lookup[k * nBase];
+    for (i = 0; i < nBase; ++i) {
+      *out++ = dblToCol(low[i] + (p[i] / 255.0) * range[i]);
+    }
+  }
+}
+
+void GfxIndexedColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColorComp baseLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToBase(in + j, baseLine, m);
+    base->getGrayLine(baseLine, out + j, m, ri);
+  }
+}
+
+void GfxIndexedColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+				      GfxRenderingIntent ri) {
+  GfxColorComp baseLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToBase(in + j, baseLine, m);
+    base->getRGBLine(baseLine, out + j, m, ri);
+  }
+}
+
+void GfxIndexedColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColorComp baseLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToBase(in + j, baseLine, m);
+    base->getCMYKLine(baseLine, out + j, m, ri);
+  }
+}
+
 
 void GfxIndexedColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = 0;
@@ -1188,6 +1670,66 @@ void GfxIndexedColorSpace::getDefaultRanges(double *decodeLow,
 // GfxSeparationColorSpace
 //------------------------------------------------------------------------
 
+// Apply the tint transform <func> to a line of <n> (<=
+// gfxColorLineChunk) colors with <nIn> components each, producing
+// <nOut> alternate color space components per color.  Results are
+// cached in *<cache> (which is allocated if needed).  Colors which
+// aren't in the cache are run through the function as a batch.
+static void tintTransformLine(Function *func, int nIn, int nOut,
+			      GfxColorCache **cache,
+			      GfxColorComp *in, GfxColorComp *out, int n) {
+  double x[gfxColorLineChunk * gfxColorMaxComps];
+  double y[gfxColorLineChunk * gfxColorMaxComps];
+  double x1[gfxColorMaxComps], y1[gfxColorMaxComps];
+  int missIdx[gfxColorLineChunk];
+  GfxColorComp *p;
+  int nMiss, i, j, k;
+
+  if (!*cache) {
+    *cache = new GfxColorCache(nIn, nOut);
+  }
+
+  // copy cache hits, and collect the misses
+  nMiss = 0;
+  for (j = 0; j < n; ++j) {
+    if ((p = (*cache)->lookup(in + j * nIn))) {
+      for (i = 0; i < nOut; ++i) {
+	out[j * nOut + i] = p[i];
+      }
+    } else {
+      for (i = 0; i < nIn; ++i) {
+	x[nMiss * nIn + i] = colToDbl(in[j * nIn + i]);
+      }
+      missIdx[nMiss++] = j;
+    }
+  }
+  if (!nMiss) {
+    return;
+  }
+
+  // run the misses through the function
+  if (func->getInputSize() == nIn && func->getOutputSize() == nOut) {
+    func->transformN(x, y, nMiss);
+  } else {
+    for (k = 0; k < nMiss; ++k) {
+      for (i = 0; i < nIn; ++i) {
+	x1[i] = x[k * nIn + i];
+      }
+      func->transform(x1, y1);
+      for (i = 0; i < nOut; ++i) {
+	y[k * nOut + i] = y1[i];
+      }
+    }
+  }
+  for (k = 0; k < nMiss; ++k) {
+    j = missIdx[k];
+    for (i = 0; i < nOut; ++i) {
+      out[j * nOut + i] = dblToCol(y[k * nOut + i]);
+    }
+    (*cache)->add(in + j * nIn, out + j * nOut);
+  }
+}
+
 GfxSeparationColorSpace::GfxSeparationColorSpace(GString *nameA,
 						 GfxColorSpace *altA,
 						 Function *funcA) {
@@ -1195,6 +1737,7 @@ GfxSeparationColorSpace::GfxSeparationColorSpace(GString *nameA,
   alt = altA;
   func = funcA;
   nonMarking = !name->cmp("None");
+  altCache = NULL;
   if (!name->cmp("Cyan")) {
     overprintMask = 0x01;
   } else if (!name->cmp("Magenta")) {
@@ -1216,12 +1759,14 @@ GfxSeparationColorSpace::GfxSeparationColorSpace(GString *nameA,
   func = funcA;
   nonMarking = nonMarkingA;
   overprintMask = overprintMaskA;
+  altCache = NULL;
 }
 
 GfxSeparationColorSpace::~GfxSeparationColorSpace() {
   delete name;
   delete alt;
   delete func;
+  delete altCache;
 }
 
 GfxColorSpace *GfxSeparationColorSpace::copy() {
@@ -1322,6 +1867,49 @@ void GfxSeparationColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   alt->getCMYK(&color2, cmyk, ri);
 }
 
+// Apply the tint transform to a line of <n> (<= gfxColorLineChunk)
+// colors, producing alternate color space components.
+void GfxSeparationColorSpace::mapLineToAlt(GfxColorComp *in, GfxColorComp *out,
+					   int n) {
+  tintTransformLine(func, 1, alt->getNComps(), &altCache, in, out, n);
+}
+
+void GfxSeparationColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out,
+					  int n, GfxRenderingIntent ri) {
+  GfxColorComp altLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToAlt(in + j, altLine, m);
+    alt->getGrayLine(altLine, out + j, m, ri);
+  }
+}
+
+void GfxSeparationColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+					 GfxRenderingIntent ri) {
+  GfxColorComp altLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToAlt(in + j, altLine, m);
+    alt->getRGBLine(altLine, out + j, m, ri);
+  }
+}
+
+void GfxSeparationColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out,
+					  int n, GfxRenderingIntent ri) {
+  GfxColorComp altLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToAlt(in + j, altLine, m);
+    alt->getCMYKLine(altLine, out + j, m, ri);
+  }
+}
+
 
 void GfxSeparationColorSpace::getDefaultColor(GfxColor *color) {
   color->c[0] = gfxColorComp1;
@@ -1344,6 +1932,7 @@ GfxDeviceNColorSpace::GfxDeviceNColorSpace(int nCompsA,
   attrsA->copy(&attrs);
   nonMarking = gTrue;
   overprintMask = 0;
+  altCache = NULL;
   for (i = 0; i < nComps; ++i) {
     names[i] = namesA[i];
     if (names[i]->cmp("None")) {
@@ -1378,6 +1967,7 @@ GfxDeviceNColorSpace::GfxDeviceNColorSpace(int nCompsA,
   attrsA->copy(&attrs);
   nonMarking = nonMarkingA;
   overprintMask = overprintMaskA;
+  altCache = NULL;
   for (i = 0; i < nComps; ++i) {
     names[i] = namesA[i]->copy();
   }
@@ -1392,6 +1982,7 @@ GfxDeviceNColorSpace::~GfxDeviceNColorSpace() {
   delete alt;
   delete func;
   attrs.free();
+  delete altCache;
 }
 
 GfxColorSpace *GfxDeviceNColorSpace::copy() {
@@ -1520,6 +2111,49 @@ void GfxDeviceNColorSpace::getCMYK(GfxColor *color, GfxCMYK *cmyk,
   alt->getCMYK(&color2, cmyk, ri);
 }
 
+// Apply the tint transform to a line of <n> (<= gfxColorLineChunk)
+// colors, producing alternate color space components.
+void GfxDeviceNColorSpace::mapLineToAlt(GfxColorComp *in, GfxColorComp *out,
+					int n) {
+  tintTransformLine(func, nComps, alt->getNComps(), &altCache, in, out, n);
+}
+
+void GfxDeviceNColorSpace::getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColorComp altLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToAlt(in + nComps * j, altLine, m);
+    alt->getGrayLine(altLine, out + j, m, ri);
+  }
+}
+
+void GfxDeviceNColorSpace::getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+				      GfxRenderingIntent ri) {
+  GfxColorComp altLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToAlt(in + nComps * j, altLine, m);
+    alt->getRGBLine(altLine, out + j, m, ri);
+  }
+}
+
+void GfxDeviceNColorSpace::getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColorComp altLine[gfxColorLineChunk * gfxColorMaxComps];
+  int j, m;
+
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    mapLineToAlt(in + nComps * j, altLine, m);
+    alt->getCMYKLine(altLine, out + j, m, ri);
+  }
+}
+
 
 void GfxDeviceNColorSpace::getDefaultColor(GfxColor *color) {
   int i;
@@ -1979,6 +2613,56 @@ GBool GfxShading::init(Dict *dict
   return gTrue;
 }
 
+void GfxShading::getColors1(Function **funcs, int nFuncs,
+			    double *t, int nT, GfxColor *colors) {
+  double out[gfxColorMaxComps];
+  double *buf;
+  int nOut, i, j, k;
+
+  // check that the functions' output tuples fit in a GfxColor --
+  // otherwise, just do the same thing as getColor(), one value at a
+  // time
+  for (i = 0; i < nFuncs; ++i) {
+    nOut = funcs[i]->getOutputSize();
+    if (funcs[i]->getInputSize() != 1 ||
+	nOut < 1 || i + nOut > gfxColorMaxComps) {
+      break;
+    }
+  }
+  if (i < nFuncs) {
+    for (j = 0; j < nT; ++j) {
+      for (i = 0; i < gfxColorMaxComps; ++i) {
+	out[i] = 0;
+      }
+      for (i = 0; i < nFuncs; ++i) {
+	funcs[i]->transform(&t[j], &out[i]);
+      }
+      for (i = 0; i < gfxColorMaxComps; ++i) {
+	colors[j].c[i] = dblToCol(out[i]);
+      }
+    }
+    return;
+  }
+
+  for (j = 0; j < nT; ++j) {
+    for (i = 0; i < gfxColorMaxComps; ++i) {
+      colors[j].c[i] = 0;
+    }
+  }
+  buf = NULL;
+  for (i = 0; i < nFuncs; ++i) {
+    nOut = funcs[i]->getOutputSize();
+    buf = (double *)greallocn(buf, nT * nOut, sizeof(double));
+    funcs[i]->transformN(t, buf, nT);
+    for (j = 0; j < nT; ++j) {
+      for (k = 0; k < nOut; ++k) {
+	colors[j].c[i + k] = dblToCol(buf[j * nOut + k]);
+      }
+    }
+  }
+  gfree(buf);
+}
+
 //------------------------------------------------------------------------
 // GfxFunctionShading
 //------------------------------------------------------------------------
@@ -3694,87 +4378,85 @@ void GfxImageColorMap::getColor(Guchar *x, GfxColor *color) {
   }
 }
 
-void GfxImageColorMap::getGrayByteLine(Guchar *in, Guchar *out, int n,
-				       GfxRenderingIntent ri) {
-  GfxColor color;
-  GfxGray gray;
+// Decode a line of <n> (<= gfxColorLineChunk) pixels to packed color
+// components, using the secondary color space if there is one.
+// Returns the color space that <out> belongs to.
+GfxColorSpace *GfxImageColorMap::decodeLine(Guchar *in, GfxColorComp *out,
+					    int n) {
   int i, j;
 
   if (colorSpace2) {
     for (j = 0; j < n; ++j) {
       for (i = 0; i < nComps2; ++i) {
-	color.c[i] = lookup2[i][in[j]];
+	*out++ = lookup2[i][in[j]];
       }
-      colorSpace2->getGray(&color, &gray, ri);
-      out[j] = colToByte(gray);
     }
+    return colorSpace2;
   } else {
     for (j = 0; j < n; ++j) {
       for (i = 0; i < nComps; ++i) {
-	color.c[i] = lookup[i][in[j * nComps + i]];
+	*out++ = lookup[i][in[j * nComps + i]];
       }
-      colorSpace->getGray(&color, &gray, ri);
-      out[j] = colToByte(gray);
+    }
+    return colorSpace;
+  }
+}
+
+void GfxImageColorMap::getGrayByteLine(Guchar *in, Guchar *out, int n,
+				       GfxRenderingIntent ri) {
+  GfxColorComp line[gfxColorLineChunk * gfxColorMaxComps];
+  GfxGray gray[gfxColorLineChunk];
+  GfxColorSpace *cs;
+  int nIn, j, k, m;
+
+  nIn = colorSpace2 ? 1 : nComps;
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    cs = decodeLine(in + j * nIn, line, m);
+    cs->getGrayLine(line, gray, m, ri);
+    for (k = 0; k < m; ++k) {
+      out[j + k] = colToByte(gray[k]);
     }
   }
 }
 
 void GfxImageColorMap::getRGBByteLine(Guchar *in, Guchar *out, int n,
 				      GfxRenderingIntent ri) {
-  GfxColor color;
-  GfxRGB rgb;
-  int i, j;
-
-  if (colorSpace2) {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps2; ++i) {
-	color.c[i] = lookup2[i][in[j]];
-      }
-      colorSpace2->getRGB(&color, &rgb, ri);
-      out[j*3] = colToByte(rgb.r);
-      out[j*3 + 1] = colToByte(rgb.g);
-      out[j*3 + 2] = colToByte(rgb.b);
-    }
-  } else {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps; ++i) {
-	color.c[i] = lookup[i][in[j * nComps + i]];
-      }
-      colorSpace->getRGB(&color, &rgb, ri);
-      out[j*3] = colToByte(rgb.r);
-      out[j*3 + 1] = colToByte(rgb.g);
-      out[j*3 + 2] = colToByte(rgb.b);
+  GfxColorComp line[gfxColorLineChunk * gfxColorMaxComps];
+  GfxRGB rgb[gfxColorLineChunk];
+  GfxColorSpace *cs;
+  int nIn, j, k, m;
+
+  nIn = colorSpace2 ? 1 : nComps;
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    cs = decodeLine(in + j * nIn, line, m);
+    cs->getRGBLine(line, rgb, m, ri);
+    for (k = 0; k < m; ++k) {
+      out[(j + k) * 3] = colToByte(rgb[k].r);
+      out[(j + k) * 3 + 1] = colToByte(rgb[k].g);
+      out[(j + k) * 3 + 2] = colToByte(rgb[k].b);
     }
   }
 }
 
 void GfxImageColorMap::getCMYKByteLine(Guchar *in, Guchar *out, int n,
 				       GfxRenderingIntent ri) {
-  GfxColor color;
-  GfxCMYK cmyk;
-  int i, j;
-
-  if (colorSpace2) {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps2; ++i) {
-	color.c[i] = lookup2[i][in[j]];
-      }
-      colorSpace2->getCMYK(&color, &cmyk, ri);
-      out[j*4] = colToByte(cmyk.c);
-      out[j*4 + 1] = colToByte(cmyk.m);
-      out[j*4 + 2] = colToByte(cmyk.y);
-      out[j*4 + 3] = colToByte(cmyk.k);
-    }
-  } else {
-    for (j = 0; j < n; ++j) {
-      for (i = 0; i < nComps; ++i) {
-	color.c[i] = lookup[i][in[j * nComps + i]];
-      }
-      colorSpace->getCMYK(&color, &cmyk, ri);
-      out[j*4] = colToByte(cmyk.c);
-      out[j*4 + 1] = colToByte(cmyk.m);
-      out[j*4 + 2] = colToByte(cmyk.y);
-      out[j*4 + 3] = colToByte(cmyk.k);
+  GfxColorComp line[gfxColorLineChunk * gfxColorMaxComps];
+  GfxCMYK cmyk[gfxColorLineChunk];
+  GfxColorSpace *cs;
+  int nIn, j, k, m;
+
+  nIn = colorSpace2 ? 1 : nComps;
+  for (j = 0; j < n; j += m) {
+    m = n - j < gfxColorLineChunk ? n - j : gfxColorLineChunk;
+    cs = decodeLine(in + j * nIn, line, m);
+    cs->getCMYKLine(line, cmyk, m, ri);
+    for (k = 0; k < m; ++k) {
+      out[(j + k) * 4] = colToByte(cmyk[k].c);
+      out[(j + k) * 4 + 1] = colToByte(cmyk[k].m);
+      out[(j + k) * 4 + 2] = colToByte(cmyk[k].y);
+      out[(j + k) * 4 + 3] = colToByte(cmyk[k].k);
     }
   }
 }
@@ -3783,11 +4465,12 @@ void GfxImageColorMap::getCMYKByteLine(Guchar *in, Guchar *out, int n,
 // GfxSubpath and GfxPath
 //------------------------------------------------------------------------
 
-GfxSubpath::GfxSubpath(double x1, double y1) {
+GfxSubpath::GfxSubpath(double x1, double y1, GArena *arenaA) {
+  arena = arenaA;
   size = 16;
-  x = (double *)gmallocn(size, sizeof(double));
-  y = (double *)gmallocn(size, sizeof(double));
-  curve = (GBool *)gmallocn(size, sizeof(GBool));
+  x = (double *)gArenaAllocn(arena, size, sizeof(double));
+  y = (double *)gArenaAllocn(arena, size, sizeof(double));
+  curve = (GBool *)gArenaAllocn(arena, size, sizeof(GBool));
   n = 1;
   x[0] = x1;
   y[0] = y1;
@@ -3796,30 +4479,35 @@ GfxSubpath::GfxSubpath(double x1, double y1) {
 }
 
 GfxSubpath::~GfxSubpath() {
-  gfree(x);
-  gfree(y);
-  gfree(curve);
+  gArenaFree(x);
+  gArenaFree(y);
+  gArenaFree(curve);
 }
 
 // Used for copy().
 GfxSubpath::GfxSubpath(GfxSubpath *subpath) {
+  arena = NULL;
   size = subpath->size;
   n = subpath->n;
-  x = (double *)gmallocn(size, sizeof(double));
-  y = (double *)gmallocn(size, sizeof(double));
-  curve = (GBool *)gmallocn(size, sizeof(GBool));
+  x = (double *)gArenaAllocn(NULL, size, sizeof(double));
+  y = (double *)gArenaAllocn(NULL, size, sizeof(double));
+  curve = (GBool *)gArenaAllocn(NULL, size, sizeof(GBool));
   memcpy(x, subpath->x, n * sizeof(double));
   memcpy(y, subpath->y, n * sizeof(double));
   memcpy(curve, subpath->curve, n * sizeof(GBool));
   closed = subpath->closed;
 }
 
+void GfxSubpath::grow() {
+  size *= 2;
+  x = (double *)gArenaReallocn(arena, x, size, sizeof(double));
+  y = (double *)gArenaReallocn(arena, y, size, sizeof(double));
+  curve = (GBool *)gArenaReallocn(arena, curve, size, sizeof(GBool));
+}
+
 void GfxSubpath::lineTo(double x1, double y1) {
   if (n >= size) {
-    size *= 2;
-    x = (double *)greallocn(x, size, sizeof(double));
-    y = (double *)greallocn(y, size, sizeof(double));
-    curve = (GBool *)greallocn(curve, size, sizeof(GBool));
+    grow();
   }
   x[n] = x1;
   y[n] = y1;
@@ -3830,10 +4518,7 @@ void GfxSubpath::lineTo(double x1, double y1) {
 void GfxSubpath::curveTo(double x1, double y1, double x2, double y2,
 			 double x3, double y3) {
   if (n+3 > size) {
-    size *= 2;
-    x = (double *)greallocn(x, size, sizeof(double));
-    y = (double *)greallocn(y, size, sizeof(double));
-    curve = (GBool *)greallocn(curve, size, sizeof(GBool));
+    grow();
   }
   x[n] = x1;
   y[n] = y1;
@@ -3862,12 +4547,13 @@ void GfxSubpath::offset(double dx, double dy) {
   }
 }
 
-GfxPath::GfxPath() {
+GfxPath::GfxPath(GArena *arenaA) {
+  arena = arenaA;
   justMoved = gFalse;
   size = 16;
   n = 0;
   firstX = firstY = 0;
-  subpaths = (GfxSubpath **)gmallocn(size, sizeof(GfxSubpath *));
+  subpaths = (GfxSubpath **)gArenaAllocn(arena, size, sizeof(GfxSubpath *));
 }
 
 GfxPath::~GfxPath() {
@@ -3875,7 +4561,7 @@ GfxPath::~GfxPath() {
 
   for (i = 0; i < n; ++i)
     delete subpaths[i];
-  gfree(subpaths);
+  gArenaFree(subpaths);
 }
 
 // Used for copy().
@@ -3883,12 +4569,13 @@ GfxPath::GfxPath(GBool justMoved1, double firstX1, double firstY1,
 		 GfxSubpath **subpaths1, int n1, int size1) {
   int i;
 
+  arena = NULL;
   justMoved = justMoved1;
   firstX = firstX1;
   firstY = firstY1;
   size = size1;
   n = n1;
-  subpaths = (GfxSubpath **)gmallocn(size, sizeof(GfxSubpath *));
+  subpaths = (GfxSubpath **)gArenaAllocn(NULL, size, sizeof(GfxSubpath *));
   for (i = 0; i < n; ++i)
     subpaths[i] = subpaths1[i]->copy();
 }
@@ -3904,13 +4591,13 @@ void GfxPath::lineTo(double x, double y) {
     if (n >= size) {
       size *= 2;
       subpaths = (GfxSubpath **)
-	           greallocn(subpaths, size, sizeof(GfxSubpath *));
+	           gArenaReallocn(arena, subpaths, size, sizeof(GfxSubpath *));
     }
     if (justMoved) {
-      subpaths[n] = new GfxSubpath(firstX, firstY);
+      subpaths[n] = new GfxSubpath(firstX, firstY, arena);
     } else {
       subpaths[n] = new GfxSubpath(subpaths[n-1]->getLastX(),
-				   subpaths[n-1]->getLastY());
+				   subpaths[n-1]->getLastY(), arena);
     }
     ++n;
     justMoved = gFalse;
@@ -3924,13 +4611,13 @@ void GfxPath::curveTo(double x1, double y1, double x2, double y2,
     if (n >= size) {
       size *= 2;
       subpaths = (GfxSubpath **)
-	           greallocn(subpaths, size, sizeof(GfxSubpath *));
+	           gArenaReallocn(arena, subpaths, size, sizeof(GfxSubpath *));
     }
     if (justMoved) {
-      subpaths[n] = new GfxSubpath(firstX, firstY);
+      subpaths[n] = new GfxSubpath(firstX, firstY, arena);
     } else {
       subpaths[n] = new GfxSubpath(subpaths[n-1]->getLastX(),
-				   subpaths[n-1]->getLastY());
+				   subpaths[n-1]->getLastY(), arena);
     }
     ++n;
     justMoved = gFalse;
@@ -3945,9 +4632,9 @@ void GfxPath::close() {
     if (n >= size) {
       size *= 2;
       subpaths = (GfxSubpath **)
-	           greallocn(subpaths, size, sizeof(GfxSubpath *));
+	           gArenaReallocn(arena, subpaths, size, sizeof(GfxSubpath *));
     }
-    subpaths[n] = new GfxSubpath(firstX, firstY);
+    subpaths[n] = new GfxSubpath(firstX, firstY, arena);
     ++n;
     justMoved = gFalse;
   }
@@ -3960,7 +4647,7 @@ void GfxPath::append(GfxPath *path) {
   if (n + path->n > size) {
     size = n + path->n;
     subpaths = (GfxSubpath **)
-                 greallocn(subpaths, size, sizeof(GfxSubpath *));
+                 gArenaReallocn(arena, subpaths, size, sizeof(GfxSubpath *));
   }
   for (i = 0; i < path->n; ++i) {
     subpaths[n++] = path->subpaths[i]->copy();
@@ -4069,6 +4756,7 @@ GfxState::GfxState(double hDPIA, double vDPIA, PDFRectangle *pageBox,
   rise = 0;
   render = 0;
 
+  pathArena = NULL;
   path = new GfxPath();
   curX = curY = 0;
   lineX = lineY = 0;
@@ -4336,7 +5024,7 @@ void GfxState::setLineDash(double *dash, int length, double start) {
 
 void GfxState::clearPath() {
   delete path;
-  path = new GfxPath();
+  path = new GfxPath(pathArena);
 }
 
 void GfxState::clip() {
@@ -24,6 +24,8 @@ class GfxFont;
 class PDFRectangle;
 class GfxShading;
 class GfxState;
+class GfxColorCache;
+class GArena;
 
 //------------------------------------------------------------------------
 // GfxBlendMode
@@ -171,6 +173,17 @@ public:
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk,
 		       GfxRenderingIntent ri) = 0;
 
+  // Convert a line of <n> colors to gray, RGB, or CMYK.  The <in>
+  // array holds <n> * getNComps() packed color components.  These
+  // give the same results as calling getGray/getRGB/getCMYK on each
+  // color.
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
+
   // Return the number of color components.
   virtual int getNComps() = 0;
 
@@ -216,6 +229,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -241,6 +260,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -276,6 +301,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 3; }
   virtual void getDefaultColor(GfxColor *color);
@@ -301,6 +332,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 3; }
   virtual void getDefaultColor(GfxColor *color);
@@ -340,12 +377,20 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 4; }
   virtual void getDefaultColor(GfxColor *color);
 
 
 private:
+
+  GfxColorCache *rgbCache;	// cache for getRGBLine
 };
 
 //------------------------------------------------------------------------
@@ -366,6 +411,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 3; }
   virtual void getDefaultColor(GfxColor *color);
@@ -391,6 +442,7 @@ private:
   double blackX, blackY, blackZ;    // black point
   double aMin, aMax, bMin, bMax;    // range for the a and b components
   double kr, kg, kb;		    // gamut mapping mulitpliers
+  GfxColorCache *rgbCache;	    // cache for getRGBLine
 };
 
 //------------------------------------------------------------------------
@@ -413,6 +465,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return nComps; }
   virtual void getDefaultColor(GfxColor *color);
@@ -453,6 +511,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -468,6 +532,8 @@ public:
 
 private:
 
+  void mapLineToBase(GfxColorComp *in, GfxColorComp *out, int n);
+
   GfxColorSpace *base;		// base color space
   int indexHigh;		// max pixel value
   Guchar *lookup;		// lookup table
@@ -493,6 +559,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return 1; }
   virtual void getDefaultColor(GfxColor *color);
@@ -509,11 +581,13 @@ private:
   GfxSeparationColorSpace(GString *nameA, GfxColorSpace *altA,
 			  Function *funcA, GBool nonMarkingA,
 			  Guint overprintMaskA);
+  void mapLineToAlt(GfxColorComp *in, GfxColorComp *out, int n);
 
   GString *name;		// colorant name
   GfxColorSpace *alt;		// alternate color space
   Function *func;		// tint transform (into alternate color space)
   GBool nonMarking;
+  GfxColorCache *altCache;	// cache of tint transform results
 };
 
 //------------------------------------------------------------------------
@@ -537,6 +611,12 @@ public:
   virtual void getGray(GfxColor *color, GfxGray *gray, GfxRenderingIntent ri);
   virtual void getRGB(GfxColor *color, GfxRGB *rgb, GfxRenderingIntent ri);
   virtual void getCMYK(GfxColor *color, GfxCMYK *cmyk, GfxRenderingIntent ri);
+  virtual void getGrayLine(GfxColorComp *in, GfxGray *out, int n,
+			   GfxRenderingIntent ri);
+  virtual void getRGBLine(GfxColorComp *in, GfxRGB *out, int n,
+			  GfxRenderingIntent ri);
+  virtual void getCMYKLine(GfxColorComp *in, GfxCMYK *out, int n,
+			   GfxRenderingIntent ri);
 
   virtual int getNComps() { return nComps; }
   virtual void getDefaultColor(GfxColor *color);
@@ -555,6 +635,7 @@ private:
 		       GfxColorSpace *alt, Function *func,
 		       Object *attrsA,
 		       GBool nonMarkingA, Guint overprintMaskA);
+  void mapLineToAlt(GfxColorComp *in, GfxColorComp *out, int n);
 
   int nComps;			// number of components
   GString			// colorant names
@@ -563,6 +644,7 @@ private:
   Function *func;		// tint transform (into alternate color space)
   Object attrs;
   GBool nonMarking;
+  GfxColorCache *altCache;	// cache of tint transform results
 };
 
 //------------------------------------------------------------------------
@@ -710,6 +792,12 @@ protected:
   GBool init(Dict *dict
 	     );
 
+  // Evaluate the one-input functions <funcs> (one function with n
+  // outputs or n functions with one output each) at <nT> parameter
+  // values <t>, using the batched Function::transformN.
+  static void getColors1(Function **funcs, int nFuncs,
+			 double *t, int nT, GfxColor *colors);
+
   int type;
   GfxColorSpace *colorSpace;
   GfxColor background;
@@ -782,6 +870,10 @@ public:
   Function *getFunc(int i) { return funcs[i]; }
   void getColor(double t, GfxColor *color);
 
+  // Same as calling getColor for each of the <nT> values in <t>.
+  void getColors(double *t, int nT, GfxColor *colors)
+    { getColors1(funcs, nFuncs, t, nT, colors); }
+
 private:
 
   double x0, y0, x1, y1;
@@ -822,6 +914,10 @@ public:
   Function *getFunc(int i) { return funcs[i]; }
   void getColor(double t, GfxColor *color);
 
+  // Same as calling getColor for each of the <nT> values in <t>.
+  void getColors(double *t, int nT, GfxColor *colors)
+    { getColors1(funcs, nFuncs, t, nT, colors); }
+
 private:
 
   double x0, y0, r0, x1, y1, r1;
@@ -954,6 +1050,7 @@ public:
 private:
 
   GfxImageColorMap(GfxImageColorMap *colorMap);
+  GfxColorSpace *decodeLine(Guchar *in, GfxColorComp *out, int n);
 
   GfxColorSpace *colorSpace;	// the image color space
   int bits;			// bits per component
@@ -978,8 +1075,9 @@ private:
 class GfxSubpath {
 public:
 
-  // Constructor.
-  GfxSubpath(double x1, double y1);
+  // Constructor.  If <arenaA> is non-NULL, the point arrays are
+  // allocated from it.
+  GfxSubpath(double x1, double y1, GArena *arenaA = NULL);
 
   // Destructor.
   ~GfxSubpath();
@@ -1019,15 +1117,19 @@ private:
   int n;			// number of points
   int size;			// size of x/y arrays
   GBool closed;			// set if path is closed
+  GArena *arena;		// arena for x/y/curve (may be NULL)
 
   GfxSubpath(GfxSubpath *subpath);
+  void grow();
 };
 
 class GfxPath {
 public:
 
-  // Constructor.
-  GfxPath();
+  // Constructor.  If <arenaA> is non-NULL, the subpaths and their
+  // point arrays are allocated from it -- copies of the path always
+  // use the heap.
+  GfxPath(GArena *arenaA = NULL);
 
   // Destructor.
   ~GfxPath();
@@ -1076,6 +1178,7 @@ private:
   GfxSubpath **subpaths;	// subpaths
   int n;			// number of subpaths
   int size;			// size of subpaths array
+  GArena *arena;		// arena for storage (may be NULL)
 
   GfxPath(GBool justMoved1, double firstX1, double firstY1,
 	  GfxSubpath **subpaths1, int n1, int size1);
@@ -1247,6 +1350,11 @@ public:
     { path->close(); curX = path->getLastX(); curY = path->getLastY(); }
   void clearPath();
 
+  // Set the arena used for new paths (see GfxPath).  This is used by
+  // Gfx, which guarantees that the arena outlives its GfxState
+  // objects.
+  void setPathArena(GArena *arenaA) { pathArena = arenaA; }
+
   // Update clip region.
   void clip();
   void clipToStrokePath();
@@ -1316,6 +1424,7 @@ private:
   int render;			// text rendering mode
 
   GfxPath *path;		// array of path elements
+  GArena *pathArena;		// arena for new paths (may be NULL)
   double curX, curY;		// current point (user coords)
   double lineX, lineY;		// start of current text line (text coords)
 
@@ -26,6 +26,7 @@
 #include "GString.h"
 #include "GList.h"
 #include "GHash.h"
+#include "GMappedFile.h"
 #include "gfile.h"
 #include "FoFiIdentifier.h"
 #include "Error.h"
@@ -35,6 +36,8 @@
 #include "CMap.h"
 #include "BuiltinFontTables.h"
 #include "FontEncodingTables.h"
+#include "GfxProfiler.h"
+#include "AtomTable.h"
 #include "GlobalParams.h"
 
 #ifdef _WIN32
@@ -46,16 +49,20 @@
 #  define lockGlobalParams            gLockMutex(&mutex)
 #  define lockUnicodeMapCache         gLockMutex(&unicodeMapCacheMutex)
 #  define lockCMapCache               gLockMutex(&cMapCacheMutex)
+#  define lockMappedFontFiles         gLockMutex(&mappedFontFilesMutex)
 #  define unlockGlobalParams          gUnlockMutex(&mutex)
 #  define unlockUnicodeMapCache       gUnlockMutex(&unicodeMapCacheMutex)
 #  define unlockCMapCache             gUnlockMutex(&cMapCacheMutex)
+#  define unlockMappedFontFiles       gUnlockMutex(&mappedFontFilesMutex)
 #else
 #  define lockGlobalParams
 #  define lockUnicodeMapCache
 #  define lockCMapCache
+#  define lockMappedFontFiles
 #  define unlockGlobalParams
 #  define unlockUnicodeMapCache
 #  define unlockCMapCache
+#  define unlockMappedFontFiles
 #endif
 
 #include "NameToUnicodeTable.h"
@@ -522,6 +529,7 @@ void GlobalParams::init(const char *cfgFileName, const char *cfgExecutablePath)
   gInitMutex(&mutex);
   gInitMutex(&unicodeMapCacheMutex);
   gInitMutex(&cMapCacheMutex);
+  gInitMutex(&mappedFontFilesMutex);
 #endif
 
 #ifdef _WIN32
@@ -620,7 +628,20 @@ void GlobalParams::init(const char *cfgFileName, const char *cfgExecutablePath)
   maxTileHeight = 1500;
   tileCacheSize = 10;
   workerThreads = 1;
+  xrefCacheSize = 1024;
+  xrefCacheMem = 8 * 1024 * 1024;
+  objStrCacheSize = 64;
+  objStrCacheMem = 32 * 1024 * 1024;
+  glyphCacheSize = 4 * 1024 * 1024;
+  contentStreamCacheSize = 4 * 1024 * 1024;
+  dctMemoryLimit = 256 * 1024 * 1024;
+  memoryMapFiles = gFalse;
   enableFreeType = gTrue;
+#if LOAD_FONTS_FROM_MEM
+  loadFontsFromMem = gTrue;
+#else
+  loadFontsFromMem = gFalse;
+#endif
   disableFreeTypeHinting = gFalse;
   antialias = gTrue;
   vectorAntialias = gTrue;
@@ -649,6 +670,8 @@ void GlobalParams::init(const char *cfgFileName, const char *cfgExecutablePath)
   createDefaultKeyBindings();
   popupMenuCmds = new GList();
   printCommands = gFalse;
+  profileCommands = gFalse;
+  profiler = new GfxProfiler();
   errQuiet = gFalse;
 
   cidToUnicodeCache = new CharCodeToUnicodeCache(cidToUnicodeCacheSize);
@@ -656,6 +679,7 @@ void GlobalParams::init(const char *cfgFileName, const char *cfgExecutablePath)
       new CharCodeToUnicodeCache(unicodeToUnicodeCacheSize);
   unicodeMapCache = new UnicodeMapCache();
   cMapCache = new CMapCache();
+  mappedFontFiles = new GHash(gTrue);
 
   // set up the initial nameToUnicode table
   for (i = 0; nameToUnicodeTab[i].name; ++i) {
@@ -1028,8 +1052,32 @@ void GlobalParams::parseLine(char *buf, GString *fileName, int line) {
       parseInteger("tileCacheSize", &tileCacheSize, tokens, fileName, line);
     } else if (!cmd->cmp("workerThreads")) {
       parseInteger("workerThreads", &workerThreads, tokens, fileName, line);
+    } else if (!cmd->cmp("xrefCacheSize")) {
+      parseInteger("xrefCacheSize", &xrefCacheSize, tokens, fileName, line);
+    } else if (!cmd->cmp("objStrCacheSize")) {
+      parseInteger("objStrCacheSize", &objStrCacheSize,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("xrefCacheMem")) {
+      parseInteger("xrefCacheMem", &xrefCacheMem, tokens, fileName, line);
+    } else if (!cmd->cmp("objStrCacheMem")) {
+      parseInteger("objStrCacheMem", &objStrCacheMem,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("memoryMapFiles")) {
+      parseYesNo("memoryMapFiles", &memoryMapFiles, tokens, fileName, line);
     } else if (!cmd->cmp("enableFreeType")) {
       parseYesNo("enableFreeType", &enableFreeType, tokens, fileName, line);
+    } else if (!cmd->cmp("glyphCacheSize")) {
+      parseInteger("glyphCacheSize", &glyphCacheSize,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("contentStreamCacheSize")) {
+      parseInteger("contentStreamCacheSize", &contentStreamCacheSize,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("dctMemoryLimit")) {
+      parseInteger("dctMemoryLimit", &dctMemoryLimit,
+		   tokens, fileName, line);
+    } else if (!cmd->cmp("loadFontsFromMem")) {
+      parseYesNo("loadFontsFromMem", &loadFontsFromMem,
+		 tokens, fileName, line);
     } else if (!cmd->cmp("disableFreeTypeHinting")) {
       parseYesNo("disableFreeTypeHinting", &disableFreeTypeHinting,
 		 tokens, fileName, line);
@@ -1105,6 +1153,8 @@ void GlobalParams::parseLine(char *buf, GString *fileName, int line) {
       parsePopupMenuCmd(tokens, fileName, line);
     } else if (!cmd->cmp("printCommands")) {
       parseYesNo("printCommands", &printCommands, tokens, fileName, line);
+    } else if (!cmd->cmp("profileCommands")) {
+      parseYesNo("profileCommands", &profileCommands, tokens, fileName, line);
     } else if (!cmd->cmp("errQuiet")) {
       parseYesNo("errQuiet", &errQuiet, tokens, fileName, line);
     } else {
@@ -1921,9 +1971,14 @@ GlobalParams::~GlobalParams() {
   GHashIter *iter;
   GString *key;
   GList *list;
+  GMappedFile *map;
 
   freeBuiltinFontTables();
 
+  // all PDFDocs (and therefore all Objects) must be deleted before
+  // the GlobalParams object
+  AtomTable::freeAll();
+
   delete macRomanReverseMap;
 
   delete baseDir;
@@ -1975,10 +2030,18 @@ GlobalParams::~GlobalParams() {
   delete unicodeMapCache;
   delete cMapCache;
 
+  mappedFontFiles->startIter(&iter);
+  while (mappedFontFiles->getNext(&iter, &key, (void **)&map)) {
+    map->free();
+  }
+  delete mappedFontFiles;
+  delete profiler;
+
 #if MULTITHREADED
   gDestroyMutex(&mutex);
   gDestroyMutex(&unicodeMapCacheMutex);
   gDestroyMutex(&cMapCacheMutex);
+  gDestroyMutex(&mappedFontFilesMutex);
 #endif
 }
 
@@ -2779,6 +2842,78 @@ int GlobalParams::getWorkerThreads() {
   return n;
 }
 
+int GlobalParams::getXRefCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = xrefCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getXRefCacheMem() {
+  int n;
+
+  lockGlobalParams;
+  n = xrefCacheMem;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getObjStrCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = objStrCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getObjStrCacheMem() {
+  int n;
+
+  lockGlobalParams;
+  n = objStrCacheMem;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getGlyphCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = glyphCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getContentStreamCacheSize() {
+  int n;
+
+  lockGlobalParams;
+  n = contentStreamCacheSize;
+  unlockGlobalParams;
+  return n;
+}
+
+int GlobalParams::getDCTMemoryLimit() {
+  int n;
+
+  lockGlobalParams;
+  n = dctMemoryLimit;
+  unlockGlobalParams;
+  return n;
+}
+
+GBool GlobalParams::getMemoryMapFiles() {
+  GBool map;
+
+  lockGlobalParams;
+  map = memoryMapFiles;
+  unlockGlobalParams;
+  return map;
+}
+
 GBool GlobalParams::getEnableFreeType() {
   GBool f;
 
@@ -2788,6 +2923,15 @@ GBool GlobalParams::getEnableFreeType() {
   return f;
 }
 
+GBool GlobalParams::getLoadFontsFromMem() {
+  GBool mem;
+
+  lockGlobalParams;
+  mem = loadFontsFromMem;
+  unlockGlobalParams;
+  return mem;
+}
+
 GBool GlobalParams::getDisableFreeTypeHinting() {
   GBool f;
 
@@ -3046,6 +3190,25 @@ GBool GlobalParams::getPrintCommands() {
   return p;
 }
 
+GBool GlobalParams::getProfileCommands() {
+  GBool p;
+
+  lockGlobalParams;
+  p = profileCommands;
+  unlockGlobalParams;
+  return p;
+}
+
+// Returns the profiler if profiling is enabled, or NULL otherwise.
+GfxProfiler *GlobalParams::getProfiler() {
+  GfxProfiler *p;
+
+  lockGlobalParams;
+  p = profileCommands ? profiler : (GfxProfiler *)NULL;
+  unlockGlobalParams;
+  return p;
+}
+
 GBool GlobalParams::getErrQuiet() {
   // no locking -- this function may get called from inside a locked
   // section
@@ -3135,6 +3298,20 @@ CMap *GlobalParams::getCMap(GString *collection, GString *cMapName) {
   return cMap;
 }
 
+GMappedFile *GlobalParams::mapFontFile(GString *path) {
+  GMappedFile *map;
+
+  lockMappedFontFiles;
+  if ((map = (GMappedFile *)mappedFontFiles->lookup(path))) {
+    map->copy();
+  } else if ((map = GMappedFile::map(path->getCString()))) {
+    mappedFontFiles->add(path->copy(), map);
+    map->copy();
+  }
+  unlockMappedFontFiles;
+  return map;
+}
+
 UnicodeMap *GlobalParams::getTextEncoding() {
   return getUnicodeMap2(textEncoding);
 }
@@ -3351,6 +3528,12 @@ GBool GlobalParams::setEnableFreeType(char *s) {
   return ok;
 }
 
+void GlobalParams::setLoadFontsFromMem(GBool mem) {
+  lockGlobalParams;
+  loadFontsFromMem = mem;
+  unlockGlobalParams;
+}
+
 
 GBool GlobalParams::setAntialias(char *s) {
   GBool ok;
@@ -3450,12 +3633,24 @@ void GlobalParams::setPrintCommands(GBool printCommandsA) {
   unlockGlobalParams;
 }
 
+void GlobalParams::setProfileCommands(GBool profileCommandsA) {
+  lockGlobalParams;
+  profileCommands = profileCommandsA;
+  unlockGlobalParams;
+}
+
 void GlobalParams::setErrQuiet(GBool errQuietA) {
   lockGlobalParams;
   errQuiet = errQuietA;
   unlockGlobalParams;
 }
 
+void GlobalParams::setMemoryMapFiles(GBool map) {
+  lockGlobalParams;
+  memoryMapFiles = map;
+  unlockGlobalParams;
+}
+
 void GlobalParams::setExecutablePath(GString *path) {
   executablePath = path;
 }
@@ -36,6 +36,8 @@ class UnicodeMap;
 class UnicodeMapCache;
 class CMap;
 class CMapCache;
+class GMappedFile;
+class GfxProfiler;
 struct XpdfSecurityHandler;
 class GlobalParams;
 class SysFontList;
@@ -285,7 +287,16 @@ public:
   int getMaxTileHeight();
   int getTileCacheSize();
   int getWorkerThreads();
+  int getXRefCacheSize();
+  int getXRefCacheMem();
+  int getObjStrCacheSize();
+  int getObjStrCacheMem();
+  int getGlyphCacheSize();
+  int getContentStreamCacheSize();
+  int getDCTMemoryLimit();
+  GBool getMemoryMapFiles();
   GBool getEnableFreeType();
+  GBool getLoadFontsFromMem();
   GBool getDisableFreeTypeHinting();
   GBool getAntialias();
   GBool getVectorAntialias();
@@ -315,6 +326,8 @@ public:
   int getNumPopupMenuCmds();
   PopupMenuCmd *getPopupMenuCmd(int idx);
   GBool getPrintCommands();
+  GBool getProfileCommands();
+  GfxProfiler *getProfiler();
   GBool getErrQuiet();
   GString *getExecutablePath() { return executablePath; };
 
@@ -322,6 +335,11 @@ public:
   CharCodeToUnicode *getUnicodeToUnicode(GString *fontName);
   UnicodeMap *getUnicodeMap(GString *encodingName);
   CMap *getCMap(GString *collection, GString *cMapName);
+
+  // Memory-map the font file at <path>.  All callers share a single
+  // read-only mapping per file.  Returns a new reference (which the
+  // caller must free), or NULL if the file can't be mapped.
+  GMappedFile *mapFontFile(GString *path);
   UnicodeMap *getTextEncoding();
 
   //----- functions to set parameters
@@ -353,6 +371,7 @@ public:
   void setTextKeepTinyChars(GBool keep);
   void setInitialZoom(char *s);
   GBool setEnableFreeType(char *s);
+  void setLoadFontsFromMem(GBool mem);
   GBool setAntialias(char *s);
   GBool setVectorAntialias(char *s);
   void setScreenType(ScreenType t);
@@ -368,7 +387,9 @@ public:
   void setMapExtTrueTypeFontsViaUnicode(GBool map);
   void setEnableXFA(GBool enable);
   void setPrintCommands(GBool printCommandsA);
+  void setProfileCommands(GBool profileCommandsA);
   void setErrQuiet(GBool errQuietA);
+  void setMemoryMapFiles(GBool map);
   void setExecutablePath(GString *path);
 
 #ifdef _WIN32
@@ -511,7 +532,24 @@ private:
   int maxTileHeight;		// maximum rasterization tile height
   int tileCacheSize;		// number of rasterization tiles in cache
   int workerThreads;		// number of rasterization worker threads
+  int xrefCacheSize;		// number of parsed objects cached per
+				//   document
+  int xrefCacheMem;		// max memory used by the parsed object
+				//   cache, in bytes
+  int objStrCacheSize;		// number of object streams cached per
+				//   document
+  int objStrCacheMem;		// max memory used by the object stream
+				//   cache, in bytes
+  int glyphCacheSize;		// size of the shared glyph bitmap cache,
+				//   in bytes
+  int contentStreamCacheSize;	// size of the compiled content stream
+				//   cache, in bytes
+  int dctMemoryLimit;		// max memory used to buffer one
+				//   progressive JPEG image, in bytes
+  GBool memoryMapFiles;		// read PDF files through a memory mapping
   GBool enableFreeType;		// FreeType enable flag
+  GBool loadFontsFromMem;	// load font files from memory rather
+				//   than temp files
   GBool disableFreeTypeHinting;	// FreeType hinting disable flag
   GBool antialias;		// font anti-aliasing enable flag
   GBool vectorAntialias;	// vector anti-aliasing enable flag
@@ -542,18 +580,24 @@ private:
   GList *keyBindings;		// key & mouse button bindings [KeyBinding]
   GList *popupMenuCmds;		// popup menu commands [PopupMenuCmd]
   GBool printCommands;		// print the drawing commands
+  GBool profileCommands;	// collect timing statistics for the
+				//   drawing commands
+  GfxProfiler *profiler;	// timing statistics
   GBool errQuiet;		// suppress error messages?
 
   CharCodeToUnicodeCache *cidToUnicodeCache;
   CharCodeToUnicodeCache *unicodeToUnicodeCache;
   UnicodeMapCache *unicodeMapCache;
   CMapCache *cMapCache;
+  GHash *mappedFontFiles;	// memory-mapped font files: path mapped
+				//   to GMappedFile
   GString *executablePath;
 
 #if MULTITHREADED
   GMutex mutex;
   GMutex unicodeMapCacheMutex;
   GMutex cMapCacheMutex;
+  GMutex mappedFontFilesMutex;
 #endif
 #ifdef _WIN32
   DWORD tlsWin32ErrorInfo;	// TLS index for error info
@@ -72,7 +72,8 @@ public:
   // Read any leftover data in the stream.
   void cleanup();
 
-  // Decode one bit.
+  // Decode one bit.  The common case (MPS without renormalization) is
+  // handled inline; everything else goes to decodeBitSlow().
   int decodeBit(Guint context, JArithmeticDecoderStats *stats);
 
   // Decode eight bits.
@@ -90,6 +91,7 @@ public:
 private:
 
   Guint readByte();
+  int decodeBitSlow(Guint context, JArithmeticDecoderStats *stats);
   int decodeIntBit(JArithmeticDecoderStats *stats);
   void byteIn();
 
@@ -111,4 +113,17 @@ private:
   int readBuf;
 };
 
+inline int JArithmeticDecoder::decodeBit(Guint context,
+					 JArithmeticDecoderStats *stats) {
+  Guint cx, aa;
+
+  cx = stats->cxTab[context];
+  aa = a - qeTab[cx >> 1];
+  if ((aa & 0x80000000) && c < aa) {
+    a = aa;
+    return (int)(cx & 1);
+  }
+  return decodeBitSlow(context, stats);
+}
+
 #endif
@@ -17,6 +17,9 @@
 #include "gmempp.h"
 #include "GList.h"
 #include "Error.h"
+#include "XRef.h"
+#include "GlobalParams.h"
+#include "GfxProfiler.h"
 #include "JArithmeticDecoder.h"
 #include "JBIG2Stream.h"
 
@@ -689,6 +692,7 @@ public:
     { data[y * line + (x >> 3)] &= 0x7f7f >> (x & 7); }
   void getPixelPtr(int x, int y, JBIG2BitmapPtr *ptr);
   int nextPixel(JBIG2BitmapPtr *ptr);
+  void getRowBytes(int x, int y, Guchar *buf, int n);
   void duplicateRow(int yDest, int ySrc);
   void combine(JBIG2Bitmap *bitmap, int x, int y, Guint combOp);
   Guchar *getDataPtr() { return data; }
@@ -817,6 +821,37 @@ inline int JBIG2Bitmap::nextPixel(JBIG2BitmapPtr *ptr) {
   return pix;
 }
 
+// Copy <n> bytes of row <y> into <buf>, starting at pixel <x>, which
+// can be negative and need not be byte-aligned.  Pixels outside the
+// bitmap are zero.
+void JBIG2Bitmap::getRowBytes(int x, int y, Guchar *buf, int n) {
+  Guchar *row;
+  Guint b0, b1, lastMask;
+  int i, j, shift;
+
+  if (y < 0 || y >= h) {
+    memset(buf, 0, n);
+    return;
+  }
+  row = data + y * line;
+  lastMask = (0xff << ((8 - (w & 7)) & 7)) & 0xff;
+  i = x >= 0 ? x >> 3 : -((7 - x) >> 3);
+  shift = x - 8 * i;
+  b1 = (i >= 0 && i < line) ? row[i] : 0;
+  if (i == line - 1) {
+    b1 &= lastMask;
+  }
+  for (j = 0; j < n; ++j) {
+    b0 = b1;
+    ++i;
+    b1 = (i >= 0 && i < line) ? row[i] : 0;
+    if (i == line - 1) {
+      b1 &= lastMask;
+    }
+    buf[j] = (Guchar)(((b0 << 8) | b1) >> (8 - shift));
+  }
+}
+
 void JBIG2Bitmap::duplicateRow(int yDest, int ySrc) {
   memcpy(data + yDest * line, data + ySrc * line, line);
 }
@@ -1136,11 +1171,171 @@ JBIG2CodeTable::~JBIG2CodeTable() {
   gfree(table);
 }
 
+//------------------------------------------------------------------------
+// JBIG2Globals
+//------------------------------------------------------------------------
+
+// The segments read from a JBIG2Globals stream.
+class JBIG2Globals {
+public:
+
+  // Takes ownership of <segmentsA>.
+  JBIG2Globals(GList *segmentsA);
+
+  // Returns true if these segments can be shared with other
+  // JBIG2Streams, i.e., they're all dictionaries or code tables --
+  // decoding a page never modifies those (unlike intermediate region
+  // bitmaps, which can be consumed by a refinement region).
+  GBool isShareable();
+
+  GList *getSegments() { return segments; }
+
+  // Reference counting.
+  void incRef();
+  void decRef();
+
+private:
+
+  ~JBIG2Globals();
+
+  GList *segments;		// [JBIG2Segment]
+#if MULTITHREADED
+  GAtomicCounter refCnt;
+#else
+  int refCnt;
+#endif
+};
+
+JBIG2Globals::JBIG2Globals(GList *segmentsA) {
+  segments = segmentsA;
+  refCnt = 1;
+}
+
+JBIG2Globals::~JBIG2Globals() {
+  deleteGList(segments, JBIG2Segment);
+}
+
+GBool JBIG2Globals::isShareable() {
+  JBIG2SegmentType type;
+  int i;
+
+  for (i = 0; i < segments->getLength(); ++i) {
+    type = ((JBIG2Segment *)segments->get(i))->getType();
+    if (type != jbig2SegSymbolDict &&
+	type != jbig2SegPatternDict &&
+	type != jbig2SegCodeTable) {
+      return gFalse;
+    }
+  }
+  return gTrue;
+}
+
+void JBIG2Globals::incRef() {
+#if MULTITHREADED
+  gAtomicIncrement(&refCnt);
+#else
+  ++refCnt;
+#endif
+}
+
+void JBIG2Globals::decRef() {
+#if MULTITHREADED
+  if (gAtomicDecrement(&refCnt) == 0) {
+#else
+  if (--refCnt == 0) {
+#endif
+    delete this;
+  }
+}
+
+//------------------------------------------------------------------------
+// JBIG2GlobalsCache
+//------------------------------------------------------------------------
+
+JBIG2GlobalsCache::JBIG2GlobalsCache() {
+  nEntries = 0;
+#if MULTITHREADED
+  gInitMutex(&mutex);
+#endif
+}
+
+JBIG2GlobalsCache::~JBIG2GlobalsCache() {
+  int i;
+
+  for (i = 0; i < nEntries; ++i) {
+    globals[i]->decRef();
+  }
+#if MULTITHREADED
+  gDestroyMutex(&mutex);
+#endif
+}
+
+JBIG2Globals *JBIG2GlobalsCache::lookup(Ref ref) {
+  JBIG2Globals *g;
+  Ref r;
+  int i, j;
+
+  g = NULL;
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  for (i = 0; i < nEntries; ++i) {
+    if (refs[i].num == ref.num && refs[i].gen == ref.gen) {
+      // move the entry to the front of the list
+      r = refs[i];
+      g = globals[i];
+      for (j = i; j > 0; --j) {
+	refs[j] = refs[j - 1];
+	globals[j] = globals[j - 1];
+      }
+      refs[0] = r;
+      globals[0] = g;
+      g->incRef();
+      break;
+    }
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+  return g;
+}
+
+void JBIG2GlobalsCache::add(Ref ref, JBIG2Globals *globalsA) {
+  int i;
+
+#if MULTITHREADED
+  gLockMutex(&mutex);
+#endif
+  // another thread may have added this stream in the meantime
+  for (i = 0; i < nEntries; ++i) {
+    if (refs[i].num == ref.num && refs[i].gen == ref.gen) {
+      break;
+    }
+  }
+  if (i == nEntries) {
+    if (nEntries == jbig2GlobalsCacheSize) {
+      globals[--nEntries]->decRef();
+    }
+    for (i = nEntries; i > 0; --i) {
+      refs[i] = refs[i - 1];
+      globals[i] = globals[i - 1];
+    }
+    refs[0] = ref;
+    globals[0] = globalsA;
+    globalsA->incRef();
+    ++nEntries;
+  }
+#if MULTITHREADED
+  gUnlockMutex(&mutex);
+#endif
+}
+
 //------------------------------------------------------------------------
 // JBIG2Stream
 //------------------------------------------------------------------------
 
-JBIG2Stream::JBIG2Stream(Stream *strA, Object *globalsStreamA):
+JBIG2Stream::JBIG2Stream(Stream *strA, Object *globalsStreamA,
+			 Object *globalsStreamRefA):
   FilterStream(strA)
 {
   pageBitmap = NULL;
@@ -1166,6 +1361,8 @@ JBIG2Stream::JBIG2Stream(Stream *strA, Object *globalsStreamA):
   mmrDecoder = new JBIG2MMRDecoder();
 
   globalsStreamA->copy(&globalsStream);
+  globalsStreamRefA->copy(&globalsStreamRef);
+  globals = NULL;
   segments = globalSegments = NULL;
   curStr = NULL;
   dataPtr = dataEnd = NULL;
@@ -1174,6 +1371,7 @@ JBIG2Stream::JBIG2Stream(Stream *strA, Object *globalsStreamA):
 JBIG2Stream::~JBIG2Stream() {
   close();
   globalsStream.free();
+  globalsStreamRef.free();
   delete arithDecoder;
   delete genericRegionStats;
   delete refinementRegionStats;
@@ -1197,22 +1395,40 @@ JBIG2Stream::~JBIG2Stream() {
 }
 
 Stream *JBIG2Stream::copy() {
-  return new JBIG2Stream(str->copy(), &globalsStream);
+  return new JBIG2Stream(str->copy(), &globalsStream, &globalsStreamRef);
 }
 
 void JBIG2Stream::reset() {
+  JBIG2GlobalsCache *cache;
+  XRef *xref;
+
+  // check the globals cache
+  cache = NULL;
+  globals = NULL;
+  if (globalsStream.isStream() && globalsStreamRef.isRef() &&
+      (xref = globalsStream.streamGetDict()->getXRef()) &&
+      (cache = xref->getJBIG2GlobalsCache())) {
+    globals = cache->lookup(globalsStreamRef.getRef());
+  }
+
   // read the globals stream
-  globalSegments = new GList();
-  if (globalsStream.isStream()) {
-    segments = globalSegments;
-    curStr = globalsStream.getStream();
-    curStr->reset();
-    arithDecoder->setStream(curStr);
-    huffDecoder->setStream(curStr);
-    mmrDecoder->setStream(curStr);
-    readSegments();
-    curStr->close();
+  if (!globals) {
+    globals = new JBIG2Globals(new GList());
+    if (globalsStream.isStream()) {
+      segments = globalSegments = globals->getSegments();
+      curStr = globalsStream.getStream();
+      curStr->reset();
+      arithDecoder->setStream(curStr);
+      huffDecoder->setStream(curStr);
+      mmrDecoder->setStream(curStr);
+      readSegments();
+      curStr->close();
+      if (cache && !pageBitmap && globals->isShareable()) {
+	cache->add(globalsStreamRef.getRef(), globals);
+      }
+    }
   }
+  globalSegments = globals->getSegments();
 
   // read the main stream
   segments = new GList();
@@ -1240,10 +1456,11 @@ void JBIG2Stream::close() {
     deleteGList(segments, JBIG2Segment);
     segments = NULL;
   }
-  if (globalSegments) {
-    deleteGList(globalSegments, JBIG2Segment);
-    globalSegments = NULL;
+  if (globals) {
+    globals->decRef();
+    globals = NULL;
   }
+  globalSegments = NULL;
   dataPtr = dataEnd = NULL;
   FilterStream::close();
 }
@@ -1287,14 +1504,44 @@ GBool JBIG2Stream::isBinary(GBool last) {
   return str->isBinary(gTrue);
 }
 
+// Segment type names, for the profiler.
+static const char *getSegmentTypeName(Guint segType) {
+  switch (segType) {
+  case 0:  return "symbol dictionary";
+  case 4:
+  case 6:
+  case 7:  return "text region";
+  case 16: return "pattern dictionary";
+  case 20:
+  case 22:
+  case 23: return "halftone region";
+  case 36:
+  case 38:
+  case 39: return "generic region";
+  case 40:
+  case 42:
+  case 43: return "generic refinement region";
+  case 48: return "page information";
+  case 50: return "end of stripe";
+  case 51: return "end of file";
+  case 52: return "profiles";
+  case 53: return "code table";
+  case 62: return "extension";
+  default: return "unknown";
+  }
+}
+
 void JBIG2Stream::readSegments() {
   Guint segNum, segFlags, segType, page, segLength;
   Guint refFlags, nRefSegs;
   Guint *refSegs;
+  GfxProfiler *profiler;
+  double t0;
   int c1, c2, c3;
   Guint i;
   GBool done;
 
+  profiler = globalParams->getProfiler();
   done = gFalse;
   while (!done && readULong(&segNum)) {
 
@@ -1374,6 +1621,7 @@ void JBIG2Stream::readSegments() {
     huffDecoder->resetByteCounter();
     mmrDecoder->resetByteCounter();
     byteCounter = 0;
+    t0 = profiler ? GfxProfiler::getTime() : 0;
     switch (segType) {
     case 0:
       if (!readSymbolDictSeg(segNum, segLength, refSegs, nRefSegs)) {
@@ -1451,6 +1699,10 @@ void JBIG2Stream::readSegments() {
       }
       break;
     }
+    if (profiler) {
+      profiler->addEvent(gfxProfileJBIG2, getSegmentTypeName(segType),
+			 t0, GfxProfiler::getTime());
+    }
 
     // skip any unused data at the end of the segment
     // (except for immediate generic region segments which have
@@ -2804,6 +3056,7 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
   Guint atBuf0, atBuf1, atBuf2, atBuf3;
   int atShift0, atShift1, atShift2, atShift3;
   Guchar mask;
+  GBool nominalAT;
   int x, y, x0, x1, a0i, b1i, blackPixels, pix, i;
 
   bitmap = new JBIG2Bitmap(0, w, h);
@@ -3026,6 +3279,24 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
       }
     }
 
+    // check for the nominal AT pixels
+    switch (templ) {
+    case 0:
+      nominalAT = atx[0] == 3 && aty[0] == -1 &&
+		  atx[1] == -3 && aty[1] == -1 &&
+		  atx[2] == 2 && aty[2] == -2 &&
+		  atx[3] == -2 && aty[3] == -2;
+      break;
+    case 1:
+      nominalAT = atx[0] == 3 && aty[0] == -1;
+      break;
+    case 2:
+    case 3:
+    default:
+      nominalAT = atx[0] == 2 && aty[0] == -1;
+      break;
+    }
+
     ltp = 0;
     cx = cx0 = cx1 = cx2 = 0; // make gcc happy
     for (y = 0; y < h; ++y) {
@@ -3043,6 +3314,12 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
 	}
       }
 
+      // the common case -- nominal AT pixels, no skip bitmap
+      if (nominalAT && !useSkip) {
+	readGenericRow(bitmap, y, templ);
+	continue;
+      }
+
       switch (templ) {
       case 0:
 
@@ -3547,6 +3824,100 @@ JBIG2Bitmap *JBIG2Stream::readGenericBitmap(GBool mmr, int w, int h,
   return bitmap;
 }
 
+// Decode row <y> of a generic region, using template <templ> with the
+// nominal AT pixels and no skip bitmap.  This is equivalent to the
+// per-template code in readGenericBitmap, but with the AT pixels at
+// fixed positions, the whole context can be pulled out of the two
+// rolling row buffers (plus the already-decoded pixels) with constant
+// shifts, and the decoded pixels are assembled into whole bytes.
+void JBIG2Stream::readGenericRow(JBIG2Bitmap *bitmap, int y, int templ) {
+  Guchar *p0, *p1, *pp;
+  Guint buf0, buf1, buf2, cx, pix, byte;
+  int w, line, x0, x1, n;
+
+  w = bitmap->getWidth();
+  line = bitmap->getLineSize();
+  pp = bitmap->getDataPtr() + y * line;
+  if (y >= 1) {
+    p1 = pp - line;
+    buf1 = *p1++ << 8;
+    if (y >= 2) {
+      p0 = pp - 2 * line;
+      buf0 = *p0++ << 8;
+    } else {
+      p0 = NULL;
+      buf0 = 0;
+    }
+  } else {
+    p1 = p0 = NULL;
+    buf1 = buf0 = 0;
+  }
+  buf2 = 0;
+
+  // pixel x is bit 15 of buf0 (row y-2), buf1 (row y-1), and buf2
+  // (row y, decoded pixels only)
+  for (x0 = 0; x0 < w; x0 += 8) {
+    if (x0 + 8 < w) {
+      if (p0) {
+	buf0 |= *p0++;
+      }
+      if (p1) {
+	buf1 |= *p1++;
+      }
+    }
+    n = w - x0 < 8 ? w - x0 : 8;
+    byte = 0;
+    switch (templ) {
+    case 0:
+      for (x1 = 0; x1 < n; ++x1) {
+	cx = ((buf0 >> 1) & 0xe000) | ((buf1 >> 5) & 0x1f00) |
+	     ((buf2 >> 12) & 0x00f0) |
+	     ((buf1 >> 9) & 8) | ((buf1 >> 16) & 4) |
+	     ((buf0 >> 12) & 2) | ((buf0 >> 17) & 1);
+	pix = arithDecoder->decodeBit(cx, genericRegionStats);
+	byte = (byte << 1) | pix;
+	buf0 <<= 1;
+	buf1 <<= 1;
+	buf2 = (buf2 | (pix << 15)) << 1;
+      }
+      break;
+    case 1:
+      for (x1 = 0; x1 < n; ++x1) {
+	cx = ((buf0 >> 4) & 0x1e00) | ((buf1 >> 9) & 0x01f0) |
+	     ((buf2 >> 15) & 0x000e) | ((buf1 >> 12) & 1);
+	pix = arithDecoder->decodeBit(cx, genericRegionStats);
+	byte = (byte << 1) | pix;
+	buf0 <<= 1;
+	buf1 <<= 1;
+	buf2 = (buf2 | (pix << 15)) << 1;
+      }
+      break;
+    case 2:
+      for (x1 = 0; x1 < n; ++x1) {
+	cx = ((buf0 >> 7) & 0x380) | ((buf1 >> 11) & 0x078) |
+	     ((buf2 >> 15) & 0x006) | ((buf1 >> 13) & 1);
+	pix = arithDecoder->decodeBit(cx, genericRegionStats);
+	byte = (byte << 1) | pix;
+	buf0 <<= 1;
+	buf1 <<= 1;
+	buf2 = (buf2 | (pix << 15)) << 1;
+      }
+      break;
+    case 3:
+      for (x1 = 0; x1 < n; ++x1) {
+	cx = ((buf1 >> 9) & 0x3e0) | ((buf2 >> 15) & 0x01e) |
+	     ((buf1 >> 13) & 1);
+	pix = arithDecoder->decodeBit(cx, genericRegionStats);
+	byte = (byte << 1) | pix;
+	buf1 <<= 1;
+	buf2 = (buf2 | (pix << 15)) << 1;
+      }
+      break;
+    }
+    *pp++ = (Guchar)(byte << (8 - n));
+  }
+}
+
 void JBIG2Stream::readGenericRefinementRegionSeg(Guint segNum, GBool imm,
 						 GBool lossless, Guint length,
 						 Guint *refSegs,
@@ -3657,6 +4028,14 @@ JBIG2Bitmap *JBIG2Stream::readGenericRefinementRegion(int w, int h,
   bitmap = new JBIG2Bitmap(0, w, h);
   bitmap->clearToZero();
 
+  // the common case -- no typical prediction, nominal AT pixels
+  if (!tpgrOn &&
+      (templ ||
+       (atx[0] == -1 && aty[0] == -1 && atx[1] == -1 && aty[1] == -1))) {
+    readGenericRefinementRows(bitmap, templ, refBitmap, refDX, refDY);
+    return bitmap;
+  }
+
   // set up the typical row context
   if (templ) {
     ltpCX = 0x008;
@@ -3820,6 +4199,104 @@ JBIG2Bitmap *JBIG2Stream::readGenericRefinementRegion(int w, int h,
   return bitmap;
 }
 
+// Decode all rows of a generic refinement region, for the common case
+// of TPGRON off and (for template 0) the nominal AT pixels.  This is
+// equivalent to the per-pixel code in readGenericRefinementRegion.
+// The three reference rows are extracted into byte-aligned buffers
+// (already shifted by refDX), so that the context can be built with
+// constant shifts from rolling buffers, as in readGenericRow.
+void JBIG2Stream::readGenericRefinementRows(JBIG2Bitmap *bitmap, int templ,
+					    JBIG2Bitmap *refBitmap,
+					    int refDX, int refDY) {
+  Guchar *refRowBuf, *refRow0, *refRow1, *refRow2, *t;
+  Guchar *p1, *pp, *q0, *q1, *q2;
+  Guint c1, c2, r0, r1, r2, cx, pix, byte;
+  int w, h, line, refLine, n, x0, x1, y;
+
+  w = bitmap->getWidth();
+  h = bitmap->getHeight();
+  line = bitmap->getLineSize();
+
+  // each reference row buffer holds pixels -8 .. 8*(line+1)-1, i.e.,
+  // one extra byte on each side of the bitmap row
+  refLine = line + 2;
+  refRowBuf = (Guchar *)gmallocn(3, refLine);
+  refRow0 = refRowBuf;
+  refRow1 = refRowBuf + refLine;
+  refRow2 = refRowBuf + 2 * refLine;
+  refBitmap->getRowBytes(-8 - refDX, -1 - refDY, refRow0, refLine);
+  refBitmap->getRowBytes(-8 - refDX, -refDY, refRow1, refLine);
+
+  for (y = 0; y < h; ++y) {
+    refBitmap->getRowBytes(-8 - refDX, y + 1 - refDY, refRow2, refLine);
+
+    // pixel x is bit 15 of c1 (row y-1), c2 (row y, decoded pixels
+    // only), and r0/r1/r2 (reference rows y-1, y, y+1)
+    pp = bitmap->getDataPtr() + y * line;
+    if (y >= 1) {
+      p1 = pp - line;
+      c1 = *p1++ << 8;
+    } else {
+      p1 = NULL;
+      c1 = 0;
+    }
+    c2 = 0;
+    r0 = (refRow0[0] << 16) | (refRow0[1] << 8);
+    r1 = (refRow1[0] << 16) | (refRow1[1] << 8);
+    r2 = (refRow2[0] << 16) | (refRow2[1] << 8);
+    q0 = refRow0 + 2;
+    q1 = refRow1 + 2;
+    q2 = refRow2 + 2;
+
+    for (x0 = 0; x0 < w; x0 += 8) {
+      if (p1 && x0 + 8 < w) {
+	c1 |= *p1++;
+      }
+      r0 |= *q0++;
+      r1 |= *q1++;
+      r2 |= *q2++;
+      n = w - x0 < 8 ? w - x0 : 8;
+      byte = 0;
+      if (templ) {
+	for (x1 = 0; x1 < n; ++x1) {
+	  cx = ((c1 >> 7) & 0x380) | ((c2 >> 10) & 0x040) |
+	       ((r0 >> 10) & 0x020) | ((r1 >> 12) & 0x01c) |
+	       ((r2 >> 14) & 3);
+	  pix = arithDecoder->decodeBit(cx, refinementRegionStats);
+	  byte = (byte << 1) | pix;
+	  c1 <<= 1;
+	  c2 = (c2 | (pix << 15)) << 1;
+	  r0 <<= 1;
+	  r1 <<= 1;
+	  r2 <<= 1;
+	}
+      } else {
+	for (x1 = 0; x1 < n; ++x1) {
+	  cx = ((c1 >> 3) & 0x1800) | ((c2 >> 6) & 0x0400) |
+	       ((r0 >> 6) & 0x0300) | ((r1 >> 9) & 0x00e0) |
+	       ((r2 >> 12) & 0x001c) |
+	       ((c1 >> 15) & 2) | ((r0 >> 16) & 1);
+	  pix = arithDecoder->decodeBit(cx, refinementRegionStats);
+	  byte = (byte << 1) | pix;
+	  c1 <<= 1;
+	  c2 = (c2 | (pix << 15)) << 1;
+	  r0 <<= 1;
+	  r1 <<= 1;
+	  r2 <<= 1;
+	}
+      }
+      *pp++ = (Guchar)(byte << (8 - n));
+    }
+
+    t = refRow0;
+    refRow0 = refRow1;
+    refRow1 = refRow2;
+    refRow2 = t;
+  }
+
+  gfree(refRowBuf);
+}
+
 void JBIG2Stream::readPageInfoSeg(Guint length) {
   Guint xRes, yRes, flags, striping;
 
@@ -16,11 +16,15 @@
 #endif
 
 #include "gtypes.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
 #include "Object.h"
 #include "Stream.h"
 
 class GList;
 class JBIG2Segment;
+class JBIG2Globals;
 class JBIG2Bitmap;
 class JArithmeticDecoder;
 class JArithmeticDecoderStats;
@@ -33,7 +37,12 @@ class JBIG2MMRDecoder;
 class JBIG2Stream: public FilterStream {
 public:
 
-  JBIG2Stream(Stream *strA, Object *globalsStreamA);
+  // <globalsStreamRefA> is the (unfetched) JBIG2Globals entry -- if
+  // it's an indirect reference, the decoded globals segments are
+  // shared via the PDFDoc's JBIG2GlobalsCache (found through the
+  // XRef).
+  JBIG2Stream(Stream *strA, Object *globalsStreamA,
+	      Object *globalsStreamRefA);
   virtual ~JBIG2Stream();
   virtual Stream *copy();
   virtual StreamKind getKind() { return strJBIG2; }
@@ -89,6 +98,7 @@ private:
 				 GBool useSkip, JBIG2Bitmap *skip,
 				 int *atx, int *aty,
 				 int mmrDataLength);
+  void readGenericRow(JBIG2Bitmap *bitmap, int y, int templ);
   void readGenericRefinementRegionSeg(Guint segNum, GBool imm,
 				      GBool lossless, Guint length,
 				      Guint *refSegs,
@@ -98,6 +108,9 @@ private:
 					   JBIG2Bitmap *refBitmap,
 					   int refDX, int refDY,
 					   int *atx, int *aty);
+  void readGenericRefinementRows(JBIG2Bitmap *bitmap, int templ,
+				 JBIG2Bitmap *refBitmap,
+				 int refDX, int refDY);
   void readPageInfoSeg(Guint length);
   void readEndOfStripeSeg(Guint length);
   void readProfilesSeg(Guint length);
@@ -117,12 +130,14 @@ private:
   GBool readLong(int *x);
 
   Object globalsStream;
+  Object globalsStreamRef;
+  JBIG2Globals *globals;	// decoded globals stream segments
   Guint pageW, pageH, curPageH;
   Guint pageDefPixel;
   JBIG2Bitmap *pageBitmap;
   Guint defCombOp;
   GList *segments;		// [JBIG2Segment]
-  GList *globalSegments;	// [JBIG2Segment]
+  GList *globalSegments;	// [JBIG2Segment] (owned by <globals>)
   Stream *curStr;
   Guchar *dataPtr;
   Guchar *dataEnd;
@@ -149,4 +164,45 @@ private:
   JBIG2MMRDecoder *mmrDecoder;
 };
 
+//------------------------------------------------------------------------
+// JBIG2GlobalsCache
+//
+// A cache of decoded JBIG2Globals streams (symbol dictionaries,
+// pattern dictionaries, and code tables), keyed by the globals
+// stream's object reference (number and generation).  Scanned
+// documents typically share one globals stream across all of their
+// pages, and this lets each page decode only its own segments.  Each
+// PDFDoc owns one cache, which streams find through the XRef.  Cached
+// segments are read-only, and can be shared by multiple threads.
+//------------------------------------------------------------------------
+
+#define jbig2GlobalsCacheSize 8
+
+class JBIG2GlobalsCache {
+public:
+
+  JBIG2GlobalsCache();
+  ~JBIG2GlobalsCache();
+
+  // Look up globals stream <ref>.  If it is cached, add a reference
+  // to it (which the caller must release with decRef) and return it;
+  // otherwise return NULL.
+  JBIG2Globals *lookup(Ref ref);
+
+  // Add <globalsA> to the cache as globals stream <ref>, evicting the
+  // least recently used entry if the cache is full.  The cache takes
+  // its own reference to <globalsA>.
+  void add(Ref ref, JBIG2Globals *globalsA);
+
+private:
+
+  // entries are kept in most-recently-used-first order
+  Ref refs[jbig2GlobalsCacheSize];
+  JBIG2Globals *globals[jbig2GlobalsCacheSize];
+  int nEntries;
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
 #endif
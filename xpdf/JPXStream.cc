@@ -172,6 +172,22 @@ static Guint signContext[5][5][2] = {
 // ceil(x / 2^y)
 #define jpxCeilDivPow2(x, y) (((x) + (1 << (y)) - 1) >> (y))
 
+// Number of extra coefficients, in each direction, kept around the
+// region of interest -- this covers the support of the inverse
+// wavelet filters, accumulated over all decomposition levels.
+#define jpxROIMargin 8
+
+// Returns true if coefficients [<x0>, <x1>) at decomposition depth
+// <depth> can affect tile-component samples [<rx0>, <rx1>).
+static inline GBool jpxOverlapsROI(Guint x0, Guint x1, Guint depth,
+				   Guint rx0, Guint rx1) {
+  if (depth >= 32) {
+    return gTrue;
+  }
+  return x0 < (rx1 >> depth) + 1 + jpxROIMargin &&
+         x1 + jpxROIMargin > (rx0 >> depth);
+}
+
 //------------------------------------------------------------------------
 
 #if 1 //----- disable coverage tracking
@@ -236,6 +252,8 @@ JPXStream::JPXStream(Stream *strA):
   bpc = NULL;
   width = height = 0;
   reduction = 0;
+  haveROI = gFalse;
+  roiX0 = roiY0 = roiX1 = roiY1 = 0;
   haveCS = gFalse;
 
   palette.bpc = NULL;
@@ -269,6 +287,109 @@ Stream *JPXStream::copy() {
   return new JPXStream(str->copy());
 }
 
+void JPXStream::setRegionOfInterest(int x0, int y0, int x1, int y1) {
+  haveROI = gTrue;
+  roiX0 = x0 < 0 ? 0 : x0;
+  roiY0 = y0 < 0 ? 0 : y0;
+  roiX1 = x1 < roiX0 ? roiX0 : x1;
+  roiY1 = y1 < roiY0 ? roiY0 : y1;
+}
+
+void JPXStream::reduceResolution(int reductionA, int *widthA, int *heightA) {
+  Guint boxType, boxLen, dataLen;
+  Guint xSize, ySize, xOffset, yOffset, nDecompLevels;
+  GBool ok;
+
+  ok = gFalse;
+  bufStr->reset();
+  if (bufStr->lookChar() == 0xff) {
+    ok = readReductionParams(&xSize, &ySize, &xOffset, &yOffset,
+			     &nDecompLevels);
+  } else {
+    while (readBoxHdr(&boxType, &boxLen, &dataLen)) {
+      if (boxType == 0x6a703268) { // JP2 header
+	// skip the superbox
+      } else if (boxType == 0x6A703263) { // codestream
+	ok = readReductionParams(&xSize, &ySize, &xOffset, &yOffset,
+				 &nDecompLevels);
+	break;
+      } else {
+	bufStr->discardChars(dataLen);
+      }
+    }
+  }
+  bufStr->close();
+  if (!ok) {
+    return;
+  }
+
+  if (reductionA > (int)nDecompLevels - reduction) {
+    reductionA = (int)nDecompLevels - reduction;
+  }
+  reduction += reductionA;
+  *widthA = (int)(jpxCeilDivPow2(xSize, reduction)
+		  - jpxCeilDivPow2(xOffset, reduction));
+  *heightA = (int)(jpxCeilDivPow2(ySize, reduction)
+		   - jpxCeilDivPow2(yOffset, reduction));
+}
+
+// Read the image size and the minimum number of decomposition levels
+// from the main codestream header.
+GBool JPXStream::readReductionParams(Guint *xSize, Guint *ySize,
+				     Guint *xOffset, Guint *yOffset,
+				     Guint *nDecompLevels) {
+  int segType;
+  Guint segLen, nComps1, nLevels, n, dummy;
+  GBool haveSIZ, haveCOD;
+
+  haveSIZ = haveCOD = gFalse;
+  nComps1 = 0;
+  while (readMarkerHdr(&segType, &segLen)) {
+    if (segType == 0x51) { // SIZ - image and tile size
+      if (!readUWord(&dummy) ||
+	  !readULong(xSize) ||
+	  !readULong(ySize) ||
+	  !readULong(xOffset) ||
+	  !readULong(yOffset) ||
+	  !readULong(&dummy) ||
+	  !readULong(&dummy) ||
+	  !readULong(&dummy) ||
+	  !readULong(&dummy) ||
+	  !readUWord(&nComps1) ||
+	  segLen < 38 ||
+	  *xOffset >= *xSize || *yOffset >= *ySize) {
+	return gFalse;
+      }
+      bufStr->discardChars(segLen - 38);
+      haveSIZ = gTrue;
+    } else if (segType == 0x52 || segType == 0x53) { // COD, COC
+      if (segType == 0x52) {
+	// Scod, progression order, number of layers, multiple
+	// component transform
+	n = 5;
+      } else {
+	// component index, Scoc
+	n = nComps1 > 256 ? 3 : 2;
+      }
+      if (segLen < n + 3 ||
+	  bufStr->discardChars(n) != n ||
+	  !readUByte(&nLevels)) {
+	return gFalse;
+      }
+      bufStr->discardChars(segLen - n - 3);
+      if (!haveCOD || nLevels < *nDecompLevels) {
+	*nDecompLevels = nLevels;
+      }
+      haveCOD = gTrue;
+    } else if (segType == 0x90) { // SOT - start of tile
+      break;
+    } else if (segLen > 2) {
+      bufStr->discardChars(segLen - 2);
+    }
+  }
+  return haveSIZ && haveCOD;
+}
+
 void JPXStream::reset() {
   bufStr->reset();
   if (readBoxes() == jpxDecodeFatalError) {
@@ -361,6 +482,9 @@ void JPXStream::close() {
     gfree(img.tiles);
     img.tiles = NULL;
   }
+  reduction = 0;
+  haveROI = gFalse;
+  roiX0 = roiY0 = roiX1 = roiY1 = 0;
   bufStr->close();
 }
 
@@ -404,24 +528,31 @@ int JPXStream::lookChar() {
 }
 
 void JPXStream::fillReadBuf() {
+  JPXTile *tile;
   JPXTileComp *tileComp;
   Guint tileIdx, tx, ty;
   int pix, pixBits, k;
   GBool eol;
 
   do {
-    if (curY >= (img.ySize >> reduction)) {
+    if (curY >= img.ySizeR) {
       return;
     }
-    tileIdx = ((curY - img.yTileOffsetR) / img.yTileSizeR) * img.nXTiles
-              + (curX - img.xTileOffsetR) / img.xTileSizeR;
+    // the reduced tile boundaries are ceil(x / 2^reduction), so they
+    // aren't necessarily multiples of the reduced tile size
+    tileIdx = (((curY << reduction) - img.yTileOffset) / img.yTileSize)
+                * img.nXTiles
+              + ((curX << reduction) - img.xTileOffset) / img.xTileSize;
+    tile = &img.tiles[tileIdx];
 #if 1 //~ ignore the palette, assume the PDF ColorSpace object is valid
-    tileComp = &img.tiles[tileIdx].tileComps[curComp];
+    tileComp = &tile->tileComps[curComp];
 #else
-    tileComp = &img.tiles[tileIdx].tileComps[havePalette ? 0 : curComp];
+    tileComp = &tile->tileComps[havePalette ? 0 : curComp];
 #endif
-    tx = jpxCeilDiv((curX - img.xTileOffsetR) % img.xTileSizeR, tileComp->hSep);
-    ty = jpxCeilDiv((curY - img.yTileOffsetR) % img.yTileSizeR, tileComp->vSep);
+    tx = jpxCeilDiv(curX - jpxCeilDivPow2(tile->x0, reduction),
+		    tileComp->hSep);
+    ty = jpxCeilDiv(curY - jpxCeilDivPow2(tile->y0, reduction),
+		    tileComp->vSep);
     pix = (int)tileComp->data[ty * tileComp->w + tx];
     pixBits = tileComp->prec;
     eol = gFalse;
@@ -439,7 +570,7 @@ void JPXStream::fillReadBuf() {
     if (++curComp == (Guint)(havePalette ? palette.nComps : img.nComps)) {
 #endif
       curComp = 0;
-      if (++curX == (img.xSize >> reduction)) {
+      if (++curX == img.xSizeR) {
 	curX = img.xOffsetR;
 	++curY;
 	eol = gTrue;
@@ -949,10 +1080,29 @@ JPXDecodeResult JPXStream::readCodestream(Guint len) {
       img.ySizeR = jpxCeilDivPow2(img.ySize, reduction);
       img.xOffsetR = jpxCeilDivPow2(img.xOffset, reduction);
       img.yOffsetR = jpxCeilDivPow2(img.yOffset, reduction);
-      img.xTileSizeR = jpxCeilDivPow2(img.xTileSize, reduction);
-      img.yTileSizeR = jpxCeilDivPow2(img.yTileSize, reduction);
-      img.xTileOffsetR = jpxCeilDivPow2(img.xTileOffset, reduction);
-      img.yTileOffsetR = jpxCeilDivPow2(img.yTileOffset, reduction);
+      img.xROI0 = 0;
+      img.yROI0 = 0;
+      img.xROI1 = img.xSize;
+      img.yROI1 = img.ySize;
+      if (haveROI) {
+	// output pixel x corresponds to reduced ref coord xOffsetR + x
+	if ((Guint)roiX0 < img.xSizeR - img.xOffsetR) {
+	  img.xROI0 = (img.xOffsetR + roiX0) << reduction;
+	} else {
+	  img.xROI0 = img.xSize;
+	}
+	if ((Guint)roiY0 < img.ySizeR - img.yOffsetR) {
+	  img.yROI0 = (img.yOffsetR + roiY0) << reduction;
+	} else {
+	  img.yROI0 = img.ySize;
+	}
+	if ((Guint)roiX1 < img.xSizeR - img.xOffsetR) {
+	  img.xROI1 = (img.xOffsetR + roiX1) << reduction;
+	}
+	if ((Guint)roiY1 < img.ySizeR - img.yOffsetR) {
+	  img.yROI1 = (img.yOffsetR + roiY1) << reduction;
+	}
+      }
       img.nXTiles = (img.xSize - img.xTileOffset + img.xTileSize - 1)
 	            / img.xTileSize;
       img.nYTiles = (img.ySize - img.yTileOffset + img.yTileSize - 1)
@@ -1482,6 +1632,9 @@ JPXDecodeResult JPXStream::readCodestream(Guint len) {
       error(errSyntaxError, getPos(), "Uninitialized tile in JPX codestream");
       return jpxDecodeFatalError;
     }
+    if (tile->skip) {
+      continue;
+    }
     for (comp = 0; comp < img.nComps; ++comp) {
       tileComp = &tile->tileComps[comp];
       inverseTransform(tileComp);
@@ -1509,6 +1662,7 @@ GBool JPXStream::readTilePart() {
   GBool tilePartToEOC;
   Guint precinctSize, style;
   Guint n, nSBs, nx, ny, sbx0, sby0, comp, segLen;
+  Guint rx0, ry0, rx1, ry1, depth;
   Guint i, j, k, cbX, cbY, r, pre, sb, cbi, cbj;
   int segType, level;
 
@@ -1893,6 +2047,15 @@ GBool JPXStream::readTilePart() {
   //----- initialize the tile, precincts, and code-blocks
   if (tilePartIdx == 0) {
     tile = &img.tiles[tileIdx];
+    // reduceResolution() only checks the main header, but the number
+    // of decomposition levels can be changed in tile-part headers
+    for (comp = 0; comp < img.nComps; ++comp) {
+      if (tile->tileComps[comp].nDecompLevels < (Guint)reduction) {
+	error(errUnimplemented, -1,
+	      "Too few decomposition levels in JPX tile for reduced resolution");
+	return gFalse;
+      }
+    }
     tile->init = gTrue;
     i = tileIdx / img.nXTiles;
     j = tileIdx % img.nXTiles;
@@ -1908,6 +2071,11 @@ GBool JPXStream::readTilePart() {
     if ((tile->y1 = img.yTileOffset + (i + 1) * img.yTileSize) > img.ySize) {
       tile->y1 = img.ySize;
     }
+    // tiles outside the region of interest are skipped (unless the
+    // tile-part length is unknown)
+    tile->skip = !tilePartToEOC &&
+                 (tile->x1 <= img.xROI0 || tile->x0 >= img.xROI1 ||
+		  tile->y1 <= img.yROI0 || tile->y0 >= img.yROI1);
     tile->comp = 0;
     tile->res = 0;
     tile->precinct = 0;
@@ -1927,6 +2095,14 @@ GBool JPXStream::readTilePart() {
       tileComp->w = jpxCeilDivPow2(tileComp->x1 - tileComp->x0, reduction);
       tileComp->h = jpxCeilDivPow2(tileComp->y1 - tileComp->y0, reduction);
       tileComp->data = (int *)gmallocn(tileComp->w * tileComp->h, sizeof(int));
+      if (tile->skip) {
+	memset(tileComp->data, 0, tileComp->w * tileComp->h * sizeof(int));
+	continue;
+      }
+      rx0 = jpxFloorDiv(img.xROI0, tileComp->hSep);
+      ry0 = jpxFloorDiv(img.yROI0, tileComp->vSep);
+      rx1 = jpxCeilDiv(img.xROI1, tileComp->hSep);
+      ry1 = jpxCeilDiv(img.yROI1, tileComp->vSep);
       if (tileComp->x1 - tileComp->x0 > tileComp->y1 - tileComp->y0) {
 	n = tileComp->x1 - tileComp->x0;
       } else {
@@ -2032,6 +2208,8 @@ GBool JPXStream::readTilePart() {
 	    }
 	    sbx0 = jpxFloorDivPow2(subband->x0, tileComp->codeBlockW);
 	    sby0 = jpxFloorDivPow2(subband->y0, tileComp->codeBlockH);
+	    depth = r == 0 ? tileComp->nDecompLevels
+	                   : tileComp->nDecompLevels - r + 1;
 	    if (r == 0) { // (NL)LL
 	      sbCoeffs = tileComp->data;
 	    } else if (sb == 0) { // (NL-r+1)HL
@@ -2065,6 +2243,9 @@ GBool JPXStream::readTilePart() {
 		  cb->y1 = subband->y1;
 		}
 		cb->seen = gFalse;
+		cb->skip = r > tileComp->nDecompLevels - reduction ||
+		           !jpxOverlapsROI(cb->x0, cb->x1, depth, rx0, rx1) ||
+		           !jpxOverlapsROI(cb->y0, cb->y1, depth, ry0, ry1);
 		cb->lBlock = 3;
 		cb->nextPass = jpxPassCleanup;
 		cb->nZeroBitPlanes = 0;
@@ -2098,6 +2279,22 @@ GBool JPXStream::readTilePart() {
     }
   }
 
+  //----- skip tiles outside the region of interest
+  if (img.tiles[tileIdx].skip) {
+    if (tilePartToEOC) {
+      while (!(bufStr->lookChar(0) == 0xff && bufStr->lookChar(1) == 0xd9)) {
+	if (bufStr->getChar() == EOF) {
+	  error(errSyntaxError, getPos(), "Error in JPX stream");
+	  return gFalse;
+	}
+      }
+    } else if (bufStr->discardChars(tilePartLen) != tilePartLen) {
+      error(errSyntaxError, getPos(), "Error in JPX stream");
+      return gFalse;
+    }
+    return gTrue;
+  }
+
   return readTilePartData(tileIdx, tilePartLen, tilePartToEOC);
 }
 
@@ -2449,7 +2646,7 @@ GBool JPXStream::readCodeBlockData(JPXTileComp *tileComp,
   int segSym;
   Guint n, i, x, y0, y1;
 
-  if (res > tileComp->nDecompLevels - reduction) {
+  if (cb->skip) {
     // skip the codeblock data
     if (tileComp->codeBlockStyle & 0x04) {
       n = 0;
@@ -108,6 +108,9 @@ struct JPXCodeBlock {
   //----- persistent state
   GBool seen;			// true if this code-block has already
 				//   been seen
+  GBool skip;			// true if this code-block's data isn't
+				//   needed (above the reduced resolution,
+				//   or outside the region of interest)
   Guint lBlock;			// base number of bits used for pkt data length
   Guint nextPass;		// next coding pass
 
@@ -218,6 +221,8 @@ struct JPXTileComp {
 
 struct JPXTile {
   GBool init;
+  GBool skip;			// true if this tile is outside the region
+				//   of interest
 
   //----- from the COD segments (main and tile)
   Guint progOrder;		// progression order
@@ -253,12 +258,11 @@ struct JPXImage {
         yTileOffset;
   Guint xSizeR, ySizeR;		// size of reference grid >> reduction
   Guint xOffsetR, yOffsetR;	// image offset >> reduction
-  Guint xTileSizeR, yTileSizeR;	// size of tiles >> reduction
-  Guint xTileOffsetR,		// offset of first tile >> reduction
-        yTileOffsetR;
   Guint nComps;			// number of components
 
   //----- computed
+  Guint xROI0, yROI0,		// region of interest, in ref coords
+        xROI1, yROI1;
   Guint nXTiles;		// number of tiles in x direction
   Guint nYTiles;		// number of tiles in y direction
 
@@ -291,12 +295,30 @@ public:
   virtual GBool isBinary(GBool last = gTrue);
   virtual void getImageParams(int *bitsPerComponent,
 			      StreamColorSpaceMode *csMode);
-  void reduceResolution(int reductionA) { reduction = reductionA; }
+
+  // Reduce the resolution by a (further) factor of 2^<reductionA>.
+  // The total reduction is limited to the number of wavelet
+  // decomposition levels.  On return, *<widthA> x *<heightA> is the
+  // size of the image that will be produced.  This reads the main
+  // codestream header, so it must be called before reset; if the
+  // header can't be read, the reduction and the size are unchanged.
+  void reduceResolution(int reductionA, int *widthA, int *heightA);
+
+  // Only the part of the image inside (<x0>,<y0>)-(<x1>,<y1>), in
+  // output pixel coordinates (i.e., after any resolution reduction),
+  // needs to be decoded.  Tiles and code-blocks which can't affect
+  // that region are skipped, so pixels outside it will be wrong.  This
+  // (and reduceResolution) applies to the next reset, and is cleared
+  // by close.
+  void setRegionOfInterest(int x0, int y0, int x1, int y1);
 
 private:
 
   void fillReadBuf();
   void getImageParams2(int *bitsPerComponent, StreamColorSpaceMode *csMode);
+  GBool readReductionParams(Guint *xSize, Guint *ySize,
+			    Guint *xOffset, Guint *yOffset,
+			    Guint *nDecompLevels);
   JPXDecodeResult readBoxes();
   GBool readColorSpecBox(Guint dataLen);
   JPXDecodeResult readCodestream(Guint len);
@@ -334,6 +356,9 @@ private:
   Guint *bpc;			// bits per component, for each component
   Guint width, height;		// image size
   int reduction;		// log2(reduction in resolution)
+  GBool haveROI;		// set if a region of interest was given
+  int roiX0, roiY0,		// region of interest, in output pixel
+      roiX1, roiY1;		//   coords
   GBool haveImgHdr;		// set if a JP2/JPX image header has been
 				//   found
   JPXColorSpec cs;		// color specification
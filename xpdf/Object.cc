@@ -15,6 +15,7 @@
 #include <stddef.h>
 #include "gmempp.h"
 #include "Object.h"
+#include "AtomTable.h"
 #include "Array.h"
 #include "Dict.h"
 #include "Error.h"
@@ -57,12 +58,27 @@ Object *Object::initArray(XRef *xref) {
   return this;
 }
 
+// The <nElems> objects in <elems> are moved into the new array, whose
+// element storage is allocated from <arena>.
+Object *Object::initArray(XRef *xref, Object *elems, int nElems,
+			  GArena *arena) {
+  initObj(objArray);
+  array = new Array(xref, elems, nElems, arena);
+  return this;
+}
+
 Object *Object::initDict(XRef *xref) {
   initObj(objDict);
   dict = new Dict(xref);
   return this;
 }
 
+Object *Object::initDict(XRef *xref, int size, GArena *arena) {
+  initObj(objDict);
+  dict = new Dict(xref, size, arena);
+  return this;
+}
+
 Object *Object::initDict(Dict *dictA) {
   initObj(objDict);
   dict = dictA;
@@ -76,6 +92,19 @@ Object *Object::initStream(Stream *streamA) {
   return this;
 }
 
+// Names and commands are stored as atoms whenever possible, which
+// avoids allocating (and freeing) a copy of the string.
+char *Object::atomizeOrCopy(const char *s) {
+  char *p;
+
+  if ((p = AtomTable::atomize(s, (int)strlen(s)))) {
+    atom = gTrue;
+    return p;
+  }
+  atom = gFalse;
+  return copyString(s);
+}
+
 Object *Object::copy(Object *obj) {
   *obj = *this;
   switch (type) {
@@ -83,7 +112,9 @@ Object *Object::copy(Object *obj) {
     obj->string = string->copy();
     break;
   case objName:
-    obj->name = copyString(name);
+    if (!atom) {
+      obj->name = copyString(name);
+    }
     break;
   case objArray:
     array->incRef();
@@ -95,7 +126,9 @@ Object *Object::copy(Object *obj) {
     obj->stream = stream->copy();
     break;
   case objCmd:
-    obj->cmd = copyString(cmd);
+    if (!atom) {
+      obj->cmd = copyString(cmd);
+    }
     break;
   default:
     break;
@@ -121,7 +154,9 @@ void Object::free() {
     delete string;
     break;
   case objName:
-    gfree(name);
+    if (!atom) {
+      gfree(name);
+    }
     break;
   case objArray:
     if (!array->decRef()) {
@@ -137,7 +172,9 @@ void Object::free() {
     delete stream;
     break;
   case objCmd:
-    gfree(cmd);
+    if (!atom) {
+      gfree(cmd);
+    }
     break;
   default:
     break;
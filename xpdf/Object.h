@@ -29,6 +29,7 @@ class XRef;
 class Array;
 class Dict;
 class Stream;
+class GArena;
 
 //------------------------------------------------------------------------
 // Ref
@@ -98,17 +99,19 @@ public:
   Object *initString(GString *stringA)
     { initObj(objString); string = stringA; return this; }
   Object *initName(const char *nameA)
-    { initObj(objName); name = copyString(nameA); return this; }
+    { initObj(objName); name = atomizeOrCopy(nameA); return this; }
   Object *initNull()
     { initObj(objNull); return this; }
   Object *initArray(XRef *xref);
+  Object *initArray(XRef *xref, Object *elems, int nElems, GArena *arena);
   Object *initDict(XRef *xref);
+  Object *initDict(XRef *xref, int size, GArena *arena);
   Object *initDict(Dict *dictA);
   Object *initStream(Stream *streamA);
   Object *initRef(int numA, int genA)
     { initObj(objRef); ref.num = numA; ref.gen = genA; return this; }
   Object *initCmd(char *cmdA)
-    { initObj(objCmd); cmd = copyString(cmdA); return this; }
+    { initObj(objCmd); cmd = atomizeOrCopy(cmdA); return this; }
   Object *initError()
     { initObj(objError); return this; }
   Object *initEOF()
@@ -142,6 +145,10 @@ public:
   GBool isEOF() { return type == objEOF; }
   GBool isNone() { return type == objNone; }
 
+  // Returns true if this is a name or command whose string is an atom
+  // (see AtomTable.h).
+  GBool isAtom() { return (type == objName || type == objCmd) && atom; }
+
   // Special type checking.
   GBool isName(const char *nameA)
     { return type == objName && !strcmp(name, nameA); }
@@ -174,6 +181,7 @@ public:
   // Dict accessors.
   int dictGetLength();
   void dictAdd(char *key, Object *val);
+  void dictAddAtom(char *key, Object *val);
   GBool dictIs(const char *dictType);
   Object *dictLookup(const char *key, Object *obj, int recursion = 0);
   Object *dictLookupNF(const char *key, Object *obj);
@@ -202,7 +210,11 @@ public:
 
 private:
 
+  char *atomizeOrCopy(const char *s);
+
   ObjType type;			// object type
+  GBool atom;			// set if name/cmd is an atom (and
+				//   therefore isn't owned by this object)
   union {			// value for each type:
     GBool booln;		//   boolean
     int intg;			//   integer
@@ -257,6 +269,9 @@ inline int Object::dictGetLength()
 inline void Object::dictAdd(char *key, Object *val)
   { dict->add(key, val); }
 
+inline void Object::dictAddAtom(char *key, Object *val)
+  { dict->addAtom(key, val); }
+
 inline GBool Object::dictIs(const char *dictType)
   { return dict->is(dictType); }
 
@@ -21,6 +21,7 @@
 #endif
 #include "gmempp.h"
 #include "GString.h"
+#include "GMappedFile.h"
 #include "config.h"
 #include "GlobalParams.h"
 #include "Page.h"
@@ -38,6 +39,8 @@
 #include "Outline.h"
 #endif
 #include "OptionalContent.h"
+#include "ContentStreamCache.h"
+#include "JBIG2Stream.h"
 #include "PDFDoc.h"
 
 //------------------------------------------------------------------------
@@ -51,7 +54,6 @@
 
 PDFDoc::PDFDoc(GString *fileNameA, GString *ownerPassword,
 	       GString *userPassword, PDFCore *coreA) {
-  Object obj;
   GString *fileName1, *fileName2;
 #ifdef _WIN32
   int n, i;
@@ -70,6 +72,8 @@ PDFDoc::PDFDoc(GString *fileNameA, GString *ownerPassword,
   outline = NULL;
 #endif
   optContent = NULL;
+  contentStreamCache = NULL;
+  jbig2GlobalsCache = NULL;
 
   fileName = fileNameA;
 #ifdef _WIN32
@@ -109,8 +113,7 @@ PDFDoc::PDFDoc(GString *fileNameA, GString *ownerPassword,
 #endif
 
   // create stream
-  obj.initNull();
-  str = new FileStream(file, 0, gFalse, 0, &obj);
+  str = makeFileStream();
 
   ok = setup(ownerPassword, userPassword);
 }
@@ -119,7 +122,6 @@ PDFDoc::PDFDoc(GString *fileNameA, GString *ownerPassword,
 PDFDoc::PDFDoc(wchar_t *fileNameA, int fileNameLen, GString *ownerPassword,
 	       GString *userPassword, PDFCore *coreA) {
   OSVERSIONINFO version;
-  Object obj;
   int i;
 
   ok = gFalse;
@@ -135,6 +137,8 @@ PDFDoc::PDFDoc(wchar_t *fileNameA, int fileNameLen, GString *ownerPassword,
   outline = NULL;
 #endif
   optContent = NULL;
+  contentStreamCache = NULL;
+  jbig2GlobalsCache = NULL;
 
   // save both Unicode and 8-bit copies of the file name
   fileName = new GString();
@@ -161,8 +165,7 @@ PDFDoc::PDFDoc(wchar_t *fileNameA, int fileNameLen, GString *ownerPassword,
   }
 
   // create stream
-  obj.initNull();
-  str = new FileStream(file, 0, gFalse, 0, &obj);
+  str = makeFileStream();
 
   ok = setup(ownerPassword, userPassword);
 }
@@ -201,9 +204,31 @@ PDFDoc::PDFDoc(BaseStream *strA, GString *ownerPassword,
   outline = NULL;
 #endif
   optContent = NULL;
+  contentStreamCache = NULL;
+  jbig2GlobalsCache = NULL;
   ok = setup(ownerPassword, userPassword);
 }
 
+// Create the base stream for <file>.  If memory-mapped files are
+// enabled, and the file can be mapped, this returns an MMapStream
+// (and closes <file>, which is no longer needed); otherwise it
+// returns a FileStream.
+BaseStream *PDFDoc::makeFileStream() {
+  GMappedFile *map;
+  BaseStream *strA;
+  Object obj;
+
+  obj.initNull();
+  if (globalParams->getMemoryMapFiles() && (map = GMappedFile::map(file))) {
+    strA = new MMapStream(map, 0, gFalse, 0, &obj);
+    map->free();
+    fclose(file);
+    file = NULL;
+    return strA;
+  }
+  return new FileStream(file, 0, gFalse, 0, &obj);
+}
+
 GBool PDFDoc::setup(GString *ownerPassword, GString *userPassword) {
 
   str->reset();
@@ -225,6 +250,10 @@ GBool PDFDoc::setup(GString *ownerPassword, GString *userPassword) {
     }
   }
 
+  // set up the JBIG2Globals cache (streams find it via the XRef)
+  jbig2GlobalsCache = new JBIG2GlobalsCache();
+  xref->setJBIG2GlobalsCache(jbig2GlobalsCache);
+
 #ifndef DISABLE_OUTLINE
   // read outline
   outline = new Outline(catalog->getOutline(), xref);
@@ -233,6 +262,9 @@ GBool PDFDoc::setup(GString *ownerPassword, GString *userPassword) {
   // read the optional content info
   optContent = new OptionalContent(this);
 
+  // set up the content stream cache
+  contentStreamCache =
+      new ContentStreamCache(globalParams->getContentStreamCacheSize());
 
   // done
   return gTrue;
@@ -274,6 +306,9 @@ GBool PDFDoc::setup2(GString *ownerPassword, GString *userPassword,
 }
 
 PDFDoc::~PDFDoc() {
+  if (contentStreamCache) {
+    delete contentStreamCache;
+  }
   if (optContent) {
     delete optContent;
   }
@@ -288,6 +323,9 @@ PDFDoc::~PDFDoc() {
   if (xref) {
     delete xref;
   }
+  if (jbig2GlobalsCache) {
+    delete jbig2GlobalsCache;
+  }
   if (str) {
     delete str;
   }
@@ -29,6 +29,8 @@ class LinkDest;
 class Outline;
 class OutlineItem;
 class OptionalContent;
+class ContentStreamCache;
+class JBIG2GlobalsCache;
 class PDFCore;
 
 //------------------------------------------------------------------------
@@ -141,6 +143,9 @@ public:
   // Return the OptionalContent object.
   OptionalContent *getOptionalContent() { return optContent; }
 
+  // Return the cache of compiled content streams.
+  ContentStreamCache *getContentStreamCache() { return contentStreamCache; }
+
   // Is the file encrypted?
   GBool isEncrypted() { return xref->isEncrypted(); }
 
@@ -185,6 +190,7 @@ public:
 
 private:
 
+  BaseStream *makeFileStream();
   GBool setup(GString *ownerPassword, GString *userPassword);
   GBool setup2(GString *ownerPassword, GString *userPassword,
 	       GBool repairXRef);
@@ -206,6 +212,8 @@ private:
   Outline *outline;
 #endif
   OptionalContent *optContent;
+  ContentStreamCache *contentStreamCache;
+  JBIG2GlobalsCache *jbig2GlobalsCache;
 
   GBool ok;
   int errCode;
@@ -997,8 +997,12 @@ private:
   GfxImageColorMap *colorMap;
   Function *func;
   ImageStream *imgStr;
-  int buf[gfxColorMaxComps];
-  int pixelIdx;
+  int nComps;			// number of DeviceN components
+  int nAltComps;		// number of alternate color space components
+  double *inLine;		// tint transform input for one line
+  double *outLine;		// tint transform output for one line
+  int *buf;			// one line of output values
+  int y;
   int bufIdx;
   int bufSize;
 };
@@ -1010,15 +1014,22 @@ DeviceNRecoder::DeviceNRecoder(Stream *strA, int widthA, int heightA,
   height = heightA;
   colorMap = colorMapA;
   imgStr = NULL;
-  pixelIdx = 0;
-  bufIdx = gfxColorMaxComps;
-  bufSize = ((GfxDeviceNColorSpace *)colorMap->getColorSpace())->
-              getAlt()->getNComps();
+  y = 0;
+  nComps = ((GfxDeviceNColorSpace *)colorMap->getColorSpace())->getNComps();
+  nAltComps = ((GfxDeviceNColorSpace *)colorMap->getColorSpace())->
+                getAlt()->getNComps();
   func = ((GfxDeviceNColorSpace *)colorMap->getColorSpace())->
            getTintTransformFunc();
+  inLine = (double *)gmallocn(width, nComps * (int)sizeof(double));
+  outLine = (double *)gmallocn(width, nAltComps * (int)sizeof(double));
+  buf = (int *)gmallocn(width, nAltComps * (int)sizeof(int));
+  bufIdx = bufSize = width * nAltComps;
 }
 
 DeviceNRecoder::~DeviceNRecoder() {
+  gfree(inLine);
+  gfree(outLine);
+  gfree(buf);
   if (str->isEncoder()) {
     delete str;
   }
@@ -1041,28 +1052,47 @@ void DeviceNRecoder::close() {
   str->close();
 }
 
+// Convert one line of pixels.  The tint transform is applied to the
+// whole line at once when the function's input and output sizes
+// match the color spaces.
 GBool DeviceNRecoder::fillBuf() {
-  Guchar pixBuf[gfxColorMaxComps];
+  Guchar *pixLine;
   GfxColor color;
-  double x[gfxColorMaxComps], y[gfxColorMaxComps];
-  int i;
+  double x1[gfxColorMaxComps], y1[gfxColorMaxComps];
+  int i, j;
 
-  if (pixelIdx >= width * height) {
+  if (y >= height || bufSize == 0) {
     return gFalse;
   }
-  imgStr->getPixel(pixBuf);
-  colorMap->getColor(pixBuf, &color);
-  for (i = 0;
-       i < ((GfxDeviceNColorSpace *)colorMap->getColorSpace())->getNComps();
-       ++i) {
-    x[i] = colToDbl(color.c[i]);
-  }
-  func->transform(x, y);
-  for (i = 0; i < bufSize; ++i) {
-    buf[i] = (int)(y[i] * 255 + 0.5);
+  if (!(pixLine = imgStr->getLine())) {
+    memset(buf, 0, bufSize * sizeof(int));
+  } else {
+    for (j = 0; j < width; ++j) {
+      colorMap->getColor(pixLine + j * colorMap->getNumPixelComps(), &color);
+      for (i = 0; i < nComps; ++i) {
+	inLine[j * nComps + i] = colToDbl(color.c[i]);
+      }
+    }
+    if (func->getInputSize() == nComps &&
+	func->getOutputSize() == nAltComps) {
+      func->transformN(inLine, outLine, width);
+    } else {
+      for (j = 0; j < width; ++j) {
+	for (i = 0; i < nComps; ++i) {
+	  x1[i] = inLine[j * nComps + i];
+	}
+	func->transform(x1, y1);
+	for (i = 0; i < nAltComps; ++i) {
+	  outLine[j * nAltComps + i] = y1[i];
+	}
+      }
+    }
+    for (i = 0; i < bufSize; ++i) {
+      buf[i] = (int)(outLine[i] * 255 + 0.5);
+    }
   }
   bufIdx = 0;
-  ++pixelIdx;
+  ++y;
   return gTrue;
 }
 
@@ -5831,8 +5861,7 @@ void PSOutputDev::doImageL1(Object *ref, GfxState *state,
 			    GBool invert, GBool inlineImg,
 			    Stream *str, int width, int height, int len) {
   ImageStream *imgStr;
-  Guchar pixBuf[gfxColorMaxComps];
-  GfxGray gray;
+  Guchar *pixLine, *grayLine;
   int col, x, y, c, i;
 
   if ((inType3Char || preload) && !colorMap) {
@@ -5897,14 +5926,21 @@ void PSOutputDev::doImageL1(Object *ref, GfxState *state,
       imgStr->reset();
 
       // process the data stream
+      grayLine = (Guchar *)gmalloc(width);
       i = 0;
       for (y = 0; y < height; ++y) {
 
+	// convert the line
+	if ((pixLine = imgStr->getLine())) {
+	  colorMap->getGrayByteLine(pixLine, grayLine, width,
+				    state->getRenderingIntent());
+	} else {
+	  memset(grayLine, 0, width);
+	}
+
 	// write the line
 	for (x = 0; x < width; ++x) {
-	  imgStr->getPixel(pixBuf);
-	  colorMap->getGray(pixBuf, &gray, state->getRenderingIntent());
-	  writePSFmt("{0:02x}", colToByte(gray));
+	  writePSFmt("{0:02x}", grayLine[x]);
 	  if (++i == 32) {
 	    writePSChar('\n');
 	    i = 0;
@@ -5914,6 +5950,7 @@ void PSOutputDev::doImageL1(Object *ref, GfxState *state,
       if (i != 0) {
 	writePSChar('\n');
       }
+      gfree(grayLine);
       str->close();
       delete imgStr;
 
@@ -14,6 +14,7 @@
 
 #include <stddef.h>
 #include "gmempp.h"
+#include "GString.h"
 #include "GlobalParams.h"
 #include "Object.h"
 #include "Array.h"
@@ -25,6 +26,7 @@
 #ifndef PDF_PARSER_ONLY
 #include "Gfx.h"
 #include "GfxState.h"
+#include "GfxProfiler.h"
 #include "Annot.h"
 #include "Form.h"
 #endif
@@ -336,6 +338,9 @@ void Page::displaySlice(OutputDev *out, double hDPI, double vDPI,
   Object obj;
   Annots *annotList;
   Form *form;
+  GfxProfiler *profiler;
+  GString *profileName;
+  double t0;
   int i;
 
   if (!out->checkPageSlice(this, hDPI, vDPI, rotate, useMediaBox, crop,
@@ -364,6 +369,9 @@ void Page::displaySlice(OutputDev *out, double hDPI, double vDPI,
     printf("***** Rotate = %d\n", attrs->getRotate());
   }
 
+  profiler = globalParams->getProfiler();
+  t0 = profiler ? GfxProfiler::getTime() : 0;
+
   gfx = new Gfx(doc, out, num, attrs->getResourceDict(),
 		hDPI, vDPI, &box, crop ? cropBox : (PDFRectangle *)NULL,
 		rotate, abortCheckCbk, abortCheckCbkData);
@@ -404,6 +412,13 @@ void Page::displaySlice(OutputDev *out, double hDPI, double vDPI,
   }
 
   delete gfx;
+
+  if (profiler) {
+    profileName = GString::format("page {0:d}", num);
+    profiler->addEvent(gfxProfilePage, profileName->getCString(),
+		       t0, GfxProfiler::getTime());
+    delete profileName;
+  }
 #endif
 }
 
@@ -27,11 +27,15 @@
 // in the object structure.
 #define recursionLimit 500
 
-Parser::Parser(XRef *xrefA, Lexer *lexerA, GBool allowStreamsA) {
+Parser::Parser(XRef *xrefA, Lexer *lexerA, GBool allowStreamsA,
+	       GArena *arenaA) {
   xref = xrefA;
   lexer = lexerA;
   inlineImg = 0;
   allowStreams = allowStreamsA;
+  arena = arenaA;
+  stk = NULL;
+  stkLen = stkSize = 0;
   lexer->getObj(&buf1);
   lexer->getObj(&buf2);
 }
@@ -39,6 +43,7 @@ Parser::Parser(XRef *xrefA, Lexer *lexerA, GBool allowStreamsA) {
 Parser::~Parser() {
   buf1.free();
   buf2.free();
+  gfree(stk);
   delete lexer;
 }
 
@@ -46,13 +51,12 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
 		       Guchar *fileKey,
 		       CryptAlgorithm encAlgorithm, int keyLength,
 		       int objNum, int objGen, int recursion) {
-  char *key;
   Stream *str;
   Object obj2;
   int num;
   DecryptStream *decrypt;
   GString *s, *s2;
-  int c;
+  int start, c, i;
 
   // refill buffer after inline image data
   if (inlineImg == 2) {
@@ -63,38 +67,55 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
     inlineImg = 0;
   }
 
-  // array
+  // array -- the elements are collected on the stack, so the array
+  // can be allocated at its final size
   if (!simpleOnly && recursion < recursionLimit && buf1.isCmd("[")) {
     shift();
-    obj->initArray(xref);
-    while (!buf1.isCmd("]") && !buf1.isEOF())
-      obj->arrayAdd(getObj(&obj2, gFalse, fileKey, encAlgorithm, keyLength,
-			   objNum, objGen, recursion + 1));
+    start = stkLen;
+    while (!buf1.isCmd("]") && !buf1.isEOF()) {
+      push(getObj(&obj2, gFalse, fileKey, encAlgorithm, keyLength,
+		  objNum, objGen, recursion + 1));
+    }
     if (buf1.isEOF())
       error(errSyntaxError, getPos(), "End of file inside array");
+    obj->initArray(xref, stk + start, stkLen - start, arena);
+    stkLen = start;
     shift();
 
-  // dictionary or stream
+  // dictionary or stream -- the keys and values are collected on the
+  // stack, as with arrays
   } else if (!simpleOnly && recursion < recursionLimit && buf1.isCmd("<<")) {
     shift();
-    obj->initDict(xref);
+    start = stkLen;
     while (!buf1.isCmd(">>") && !buf1.isEOF()) {
       if (!buf1.isName()) {
 	error(errSyntaxError, getPos(),
 	      "Dictionary key must be a name object");
 	shift();
       } else {
-	key = copyString(buf1.getName());
+	// move the key object onto the stack
+	push(&buf1);
+	buf1.initNull();
 	shift();
 	if (buf1.isEOF() || buf1.isError()) {
-	  gfree(key);
+	  stk[--stkLen].free();
 	  break;
 	}
-	obj->dictAdd(key, getObj(&obj2, gFalse,
-				 fileKey, encAlgorithm, keyLength,
-				 objNum, objGen, recursion + 1));
+	push(getObj(&obj2, gFalse, fileKey, encAlgorithm, keyLength,
+		    objNum, objGen, recursion + 1));
+      }
+    }
+    obj->initDict(xref, (stkLen - start) / 2, arena);
+    for (i = start; i < stkLen; i += 2) {
+      // atoms are permanent, so they don't need to be copied
+      if (stk[i].isAtom()) {
+	obj->dictAddAtom(stk[i].getName(), &stk[i+1]);
+      } else {
+	obj->dictAdd(copyString(stk[i].getName()), &stk[i+1]);
       }
+      stk[i].free();
     }
+    stkLen = start;
     if (buf1.isEOF())
       error(errSyntaxError, getPos(), "End of file inside dictionary");
     // stream objects are not allowed inside content streams or
@@ -140,9 +161,11 @@ Object *Parser::getObj(Object *obj, GBool simpleOnly,
     obj->initString(s2);
     shift();
 
-  // simple object
+  // simple object -- move it out of the lookahead buffer (rather
+  // than copying it), which avoids copying strings
   } else {
-    buf1.copy(obj);
+    *obj = buf1;
+    buf1.initNull();
     shift();
   }
 
@@ -247,6 +270,14 @@ Stream *Parser::makeStream(Object *dict, Guchar *fileKey,
   return str;
 }
 
+void Parser::push(Object *obj) {
+  if (stkLen == stkSize) {
+    stkSize = stkSize ? 2 * stkSize : 64;
+    stk = (Object *)greallocn(stk, stkSize, sizeof(Object));
+  }
+  stk[stkLen++] = *obj;
+}
+
 void Parser::shift() {
   if (inlineImg > 0) {
     if (inlineImg < 2) {
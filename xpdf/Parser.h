@@ -17,6 +17,8 @@
 
 #include "Lexer.h"
 
+class GArena;
+
 //------------------------------------------------------------------------
 // Parser
 //------------------------------------------------------------------------
@@ -24,8 +26,10 @@
 class Parser {
 public:
 
-  // Constructor.
-  Parser(XRef *xrefA, Lexer *lexerA, GBool allowStreamsA);
+  // Constructor.  If <arenaA> is non-NULL, the element storage for
+  // arrays and dictionaries is allocated from it.
+  Parser(XRef *xrefA, Lexer *lexerA, GBool allowStreamsA,
+	 GArena *arenaA = NULL);
 
   // Destructor.
   ~Parser();
@@ -54,11 +58,16 @@ private:
   GBool allowStreams;		// parse stream objects?
   Object buf1, buf2;		// next two tokens
   int inlineImg;		// set when inline image data is encountered
+  GArena *arena;		// arena for array/dict storage (may be
+				//   NULL)
+  Object *stk;			// elements of the arrays/dicts currently
+  int stkLen, stkSize;		//   being parsed
 
   Stream *makeStream(Object *dict, Guchar *fileKey,
 		     CryptAlgorithm encAlgorithm, int keyLength,
 		     int objNum, int objGen, int recursion);
   void shift();
+  void push(Object *obj);
 };
 
 #endif
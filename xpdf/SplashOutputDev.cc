@@ -17,11 +17,13 @@
 #include <limits.h>
 #include "gmempp.h"
 #include "gfile.h"
+#include "GMappedFile.h"
 #include "GlobalParams.h"
 #include "Error.h"
 #include "Object.h"
 #include "Gfx.h"
 #include "GfxFont.h"
+#include "GfxProfiler.h"
 #include "Link.h"
 #include "CharCodeToUnicode.h"
 #include "FontEncodingTables.h"
@@ -34,12 +36,15 @@
 #include "SplashPattern.h"
 #include "SplashScreen.h"
 #include "SplashPath.h"
+#include "SplashClip.h"
 #include "SplashState.h"
 #include "SplashErrorCodes.h"
 #include "SplashFontEngine.h"
 #include "SplashFont.h"
 #include "SplashFontFile.h"
 #include "SplashFontFileID.h"
+#include "SplashGlyphCache.h"
+#include "SplashSIMD.h"
 #include "Splash.h"
 #include "SplashOutputDev.h"
 
@@ -443,6 +448,19 @@ public:
            ((SplashOutFontFileID *)id)->r.gen == r.gen;
   }
 
+  Guint hash() {
+    return (Guint)r.num * 0x9e3779b1 ^ (Guint)r.gen;
+  }
+
+  SplashFontFileID *copy() {
+    SplashOutFontFileID *id;
+
+    id = new SplashOutFontFileID(&r);
+    id->oblique = oblique;
+    id->substIdx = substIdx;
+    return id;
+  }
+
   void setOblique(double obliqueA) { oblique = obliqueA; }
   double getOblique() { return oblique; }
   void setSubstIdx(int substIdxA) { substIdx = substIdxA; }
@@ -611,6 +629,8 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA,
   splash->clear(paperColor, 0);
 
   fontEngine = NULL;
+  glyphCache = NULL;
+  ownGlyphCache = gFalse;
 
   nT3Fonts = 0;
   t3GlyphStack = NULL;
@@ -687,6 +707,9 @@ SplashOutputDev::~SplashOutputDev() {
   if (fontEngine) {
     delete fontEngine;
   }
+  if (ownGlyphCache) {
+    delete glyphCache;
+  }
   if (splash) {
     delete splash;
   }
@@ -711,12 +734,32 @@ void SplashOutputDev::startDoc(XRef *xrefA) {
 				    allowAntialias &&
 				      globalParams->getAntialias() &&
 				      colorMode != splashModeMono1);
+  // glyphs are keyed by font object number, so the cache can't be
+  // reused across documents
+  if (ownGlyphCache) {
+    glyphCache->clear();
+  } else if (!glyphCache && globalParams->getGlyphCacheSize() > 0) {
+    glyphCache = new SplashGlyphCache(globalParams->getGlyphCacheSize());
+    ownGlyphCache = gTrue;
+  }
+  fontEngine->setGlyphCache(glyphCache);
   for (i = 0; i < nT3Fonts; ++i) {
     delete t3FontCache[i];
   }
   nT3Fonts = 0;
 }
 
+void SplashOutputDev::setGlyphCache(SplashGlyphCache *glyphCacheA) {
+  if (ownGlyphCache) {
+    delete glyphCache;
+  }
+  glyphCache = glyphCacheA;
+  ownGlyphCache = gFalse;
+  if (fontEngine) {
+    fontEngine->setGlyphCache(glyphCache);
+  }
+}
+
 void SplashOutputDev::startPage(int pageNum, GfxState *state) {
   int w, h;
   double *ctm;
@@ -1122,6 +1165,29 @@ void SplashOutputDev::updateFont(GfxState *state) {
   needFontUpdate = gTrue;
 }
 
+// Create a SplashFontSrc for an external font file.  If fonts are
+// loaded from memory, the file is mapped once, and the mapping is
+// shared by all font engines.
+static SplashFontSrc *makeExtFontSrc(GString *path) {
+  GMappedFile *map;
+  SplashFontSrc *src;
+
+  if (globalParams->getLoadFontsFromMem() &&
+      (map = globalParams->mapFontFile(path)) &&
+      (src = SplashFontSrc::makeMappedFile(map))) {
+    return src;
+  }
+  return SplashFontSrc::makeFile(path->getCString(), gFalse);
+}
+
+static FoFiTrueType *loadTrueTypeFont(SplashFontSrc *src, int fontNum) {
+  if (src->isFile()) {
+    return FoFiTrueType::load(src->getFileName(), fontNum);
+  } else {
+    return FoFiTrueType::make(src->getBuf(), src->getLength(), fontNum);
+  }
+}
+
 void SplashOutputDev::doUpdateFont(GfxState *state) {
   GfxFont *gfxFont;
   GfxFontLoc *fontLoc;
@@ -1132,13 +1198,11 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
   FoFiTrueType *ff;
   Ref embRef;
   Object refObj, strObj;
-#if LOAD_FONTS_FROM_MEM
-  GString *fontBuf;
-  FILE *extFontFile;
-#else
-  GString *tmpFileName, *fileName;
+  SplashFontSrc *fontSrc;
+  GString *tmpFileName;
   FILE *tmpFile;
-#endif
+  char *fontBuf;
+  int fontBufLen;
   char blk[4096];
   int *codeToGID;
   CharCodeToUnicode *ctu;
@@ -1149,16 +1213,14 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
   SplashCoord mat[4];
   char *name;
   Unicode uBuf[8];
+  GfxProfiler *profiler;
+  GString *profileName;
+  double t0;
   int substIdx, n, code, cmap, cmapPlatform, cmapEncoding, i;
 
   needFontUpdate = gFalse;
   font = NULL;
-#if LOAD_FONTS_FROM_MEM
-  fontBuf = NULL;
-#else
-  tmpFileName = NULL;
-  fileName = NULL;
-#endif
+  fontSrc = NULL;
   substIdx = -1;
 
   if (!(gfxFont = state->getFont())) {
@@ -1186,6 +1248,8 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
 
   } else {
 
+    profiler = globalParams->getProfiler();
+    t0 = profiler ? GfxProfiler::getTime() : 0;
     fontNum = 0;
 
     if (!(fontLoc = gfxFont->locateFont(xref, gFalse))) {
@@ -1197,67 +1261,47 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
 
     // embedded font
     if (fontLoc->locType == gfxFontLocEmbedded) {
-      gfxFont->getEmbeddedFontID(&embRef);
-#if LOAD_FONTS_FROM_MEM
-      fontBuf = new GString();
-      refObj.initRef(embRef.num, embRef.gen);
-      refObj.fetch(xref, &strObj);
-      refObj.free();
-      if (!strObj.isStream()) {
-	error(errSyntaxError, -1, "Embedded font object is wrong type");
-	strObj.free();
-	delete fontLoc;
-	goto err2;
-      }
-      strObj.streamReset();
-      while ((n = strObj.streamGetBlock(blk, sizeof(blk))) > 0) {
-	fontBuf->append(blk, n);
-      }
-      strObj.streamClose();
-      strObj.free();
-#else
-      if (!openTempFile(&tmpFileName, &tmpFile, "wb", NULL)) {
-	error(errIO, -1, "Couldn't create temporary font file");
-	delete fontLoc;
-	goto err2;
-      }
-      refObj.initRef(embRef.num, embRef.gen);
-      refObj.fetch(xref, &strObj);
-      refObj.free();
-      if (!strObj.isStream()) {
-	error(errSyntaxError, -1, "Embedded font object is wrong type");
+      // the decoded font program is handed over to the font engine
+      // (which copies it again for TrueType fonts, since those are
+      // rewritten with writeTTF before loading)
+      if (globalParams->getLoadFontsFromMem()) {
+	if (!(fontBuf = gfxFont->readEmbFontFile(xref, &fontBufLen))) {
+	  delete fontLoc;
+	  goto err2;
+	}
+	fontSrc = SplashFontSrc::makeBuf(fontBuf, fontBufLen);
+      } else {
+	gfxFont->getEmbeddedFontID(&embRef);
+	tmpFileName = NULL;
+	if (!openTempFile(&tmpFileName, &tmpFile, "wb", NULL)) {
+	  error(errIO, -1, "Couldn't create temporary font file");
+	  delete fontLoc;
+	  goto err2;
+	}
+	fontSrc = SplashFontSrc::makeFile(tmpFileName->getCString(), gTrue);
+	delete tmpFileName;
+	refObj.initRef(embRef.num, embRef.gen);
+	refObj.fetch(xref, &strObj);
+	refObj.free();
+	if (!strObj.isStream()) {
+	  error(errSyntaxError, -1, "Embedded font object is wrong type");
+	  strObj.free();
+	  fclose(tmpFile);
+	  delete fontLoc;
+	  goto err2;
+	}
+	strObj.streamReset();
+	while ((n = strObj.streamGetBlock(blk, sizeof(blk))) > 0) {
+	  fwrite(blk, 1, n, tmpFile);
+	}
+	strObj.streamClose();
 	strObj.free();
 	fclose(tmpFile);
-	delete fontLoc;
-	goto err2;
-      }
-      strObj.streamReset();
-      while ((n = strObj.streamGetBlock(blk, sizeof(blk))) > 0) {
-	fwrite(blk, 1, n, tmpFile);
       }
-      strObj.streamClose();
-      strObj.free();
-      fclose(tmpFile);
-      fileName = tmpFileName;
-#endif
 
     // external font
     } else { // gfxFontLocExternal
-#if LOAD_FONTS_FROM_MEM
-      if (!(extFontFile = fopen(fontLoc->path->getCString(), "rb"))) {
-	error(errSyntaxError, -1, "Couldn't open external font file '{0:t}'",
-	      fontLoc->path);
-	delete fontLoc;
-	goto err2;
-      }
-      fontBuf = new GString();
-      while ((n = fread(blk, 1, sizeof(blk), extFontFile)) > 0) {
-	fontBuf->append(blk, n);
-      }
-      fclose(extFontFile);
-#else
-      fileName = fontLoc->path;
-#endif
+      fontSrc = makeExtFontSrc(fontLoc->path);
       fontNum = fontLoc->fontNum;
       if (fontLoc->substIdx >= 0) {
 	id->setSubstIdx(fontLoc->substIdx);
@@ -1272,12 +1316,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
     case fontType1:
       if (!(fontFile = fontEngine->loadType1Font(
 		   id,
-#if LOAD_FONTS_FROM_MEM
-		   fontBuf,
-#else
-		   fileName->getCString(),
-		   fileName == tmpFileName,
-#endif
+		   fontSrc,
 		   (const char **)((Gfx8BitFont *)gfxFont)->getEncoding()))) {
 	error(errSyntaxError, -1, "Couldn't create a font for '{0:s}'",
 	      gfxFont->getName() ? gfxFont->getName()->getCString()
@@ -1289,12 +1328,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
     case fontType1C:
       if (!(fontFile = fontEngine->loadType1CFont(
 		   id,
-#if LOAD_FONTS_FROM_MEM
-		   fontBuf,
-#else
-		   fileName->getCString(),
-		   fileName == tmpFileName,
-#endif
+		   fontSrc,
 		   (const char **)((Gfx8BitFont *)gfxFont)->getEncoding()))) {
 	error(errSyntaxError, -1, "Couldn't create a font for '{0:s}'",
 	      gfxFont->getName() ? gfxFont->getName()->getCString()
@@ -1306,12 +1340,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
     case fontType1COT:
       if (!(fontFile = fontEngine->loadOpenTypeT1CFont(
 		   id,
-#if LOAD_FONTS_FROM_MEM
-		   fontBuf,
-#else
-		   fileName->getCString(),
-		   fileName == tmpFileName,
-#endif
+		   fontSrc,
 		   (const char **)((Gfx8BitFont *)gfxFont)->getEncoding()))) {
 	error(errSyntaxError, -1, "Couldn't create a font for '{0:s}'",
 	      gfxFont->getName() ? gfxFont->getName()->getCString()
@@ -1322,12 +1351,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
       break;
     case fontTrueType:
     case fontTrueTypeOT:
-#if LOAD_FONTS_FROM_MEM
-      if ((ff = FoFiTrueType::make(fontBuf->getCString(), fontBuf->getLength(),
-				   fontNum))) {
-#else
-      if ((ff = FoFiTrueType::load(fileName->getCString(), fontNum))) {
-#endif
+      if ((ff = loadTrueTypeFont(fontSrc, fontNum))) {
 	codeToGID = ((Gfx8BitFont *)gfxFont)->getCodeToGIDMap(ff);
 	n = 256;
 	delete ff;
@@ -1348,12 +1372,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
       }
       if (!(fontFile = fontEngine->loadTrueTypeFont(
 			   id,
-#if LOAD_FONTS_FROM_MEM
-			   fontBuf,
-#else
-			   fileName->getCString(),
-			   fileName == tmpFileName,
-#endif
+			   fontSrc,
 			   fontNum, codeToGID, n,
 			   gfxFont->getEmbeddedFontName()
 			     ? gfxFont->getEmbeddedFontName()->getCString()
@@ -1378,12 +1397,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
       }
       if (!(fontFile = fontEngine->loadCIDFont(
 			   id,
-#if LOAD_FONTS_FROM_MEM
-			   fontBuf,
-#else
-			   fileName->getCString(),
-			   fileName == tmpFileName,
-#endif
+			   fontSrc,
 			   codeToGID, n))) {
 
 	error(errSyntaxError, -1, "Couldn't create a font for '{0:s}'",
@@ -1406,12 +1420,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
       } else if (globalParams->getMapExtTrueTypeFontsViaUnicode()) {
 	// create a CID-to-GID mapping, via Unicode
 	if ((ctu = ((GfxCIDFont *)gfxFont)->getToUnicode())) {
-#if LOAD_FONTS_FROM_MEM
-	  if ((ff = FoFiTrueType::make(fontBuf->getCString(),
-				       fontBuf->getLength(), fontNum))) {
-#else
-	  if ((ff = FoFiTrueType::load(fileName->getCString(), fontNum))) {
-#endif
+	  if ((ff = loadTrueTypeFont(fontSrc, fontNum))) {
 	    // look for a Unicode cmap
 	    for (cmap = 0; cmap < ff->getNumCmaps(); ++cmap) {
 	      cmapPlatform = ff->getCmapPlatform(cmap);
@@ -1449,12 +1458,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
       }
       if (!(fontFile = fontEngine->loadOpenTypeCFFFont(
 			   id,
-#if LOAD_FONTS_FROM_MEM
-			   fontBuf,
-#else
-			   fileName->getCString(),
-			   fileName == tmpFileName,
-#endif
+			   fontSrc,
 			   codeToGID, n))) {
 	error(errSyntaxError, -1, "Couldn't create a font for '{0:s}'",
 	      gfxFont->getName() ? gfxFont->getName()->getCString()
@@ -1477,12 +1481,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
       } else if (globalParams->getMapExtTrueTypeFontsViaUnicode()) {
 	// create a CID-to-GID mapping, via Unicode
 	if ((ctu = ((GfxCIDFont *)gfxFont)->getToUnicode())) {
-#if LOAD_FONTS_FROM_MEM
-	  if ((ff = FoFiTrueType::make(fontBuf->getCString(),
-				       fontBuf->getLength(), fontNum))) {
-#else
-	  if ((ff = FoFiTrueType::load(fileName->getCString(), fontNum))) {
-#endif
+	  if ((ff = loadTrueTypeFont(fontSrc, fontNum))) {
 	    // look for a Unicode cmap
 	    for (cmap = 0; cmap < ff->getNumCmaps(); ++cmap) {
 	      cmapPlatform = ff->getCmapPlatform(cmap);
@@ -1520,12 +1519,7 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
       }
       if (!(fontFile = fontEngine->loadTrueTypeFont(
 			   id,
-#if LOAD_FONTS_FROM_MEM
-			   fontBuf,
-#else
-			   fileName->getCString(),
-			   fileName == tmpFileName,
-#endif
+			   fontSrc,
 			   fontNum, codeToGID, n,
 			   gfxFont->getEmbeddedFontName()
 			     ? gfxFont->getEmbeddedFontName()->getCString()
@@ -1543,6 +1537,18 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
     }
 
     delete fontLoc;
+
+    if (profiler) {
+      profileName = GString::format("{0:s} ({1:d} {2:d} R) - load",
+				    gfxFont->getName()
+				      ? gfxFont->getName()->getCString()
+				      : "(unnamed)",
+				    gfxFont->getID()->num,
+				    gfxFont->getID()->gen);
+      profiler->addEvent(gfxProfileFont, profileName->getCString(),
+			 t0, GfxProfiler::getTime());
+      delete profileName;
+    }
   }
 
   // get the font matrix
@@ -1604,26 +1610,14 @@ void SplashOutputDev::doUpdateFont(GfxState *state) {
   mat[2] = m21;  mat[3] = m22;
   font = fontEngine->getFont(fontFile, mat, splash->getMatrix());
 
-#if !LOAD_FONTS_FROM_MEM
-  if (tmpFileName) {
-    delete tmpFileName;
-  }
-#endif
   return;
 
  err2:
   delete id;
  err1:
-#if LOAD_FONTS_FROM_MEM
-  if (fontBuf) {
-    delete fontBuf;
-  }
-#else
-  if (tmpFileName) {
-    unlink(tmpFileName->getCString());
-    delete tmpFileName;
+  if (fontSrc) {
+    delete fontSrc;
   }
-#endif
   return;
 }
 
@@ -1954,8 +1948,10 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
   double ictm[6];
   double xMin, yMin, xMax, yMax, tx, ty, xx, yy;
   double xx0, yy0, xx1, yy1, dx, dy, d, s, t;
+  double xxRow, yyRow;
   GBool dZero, go;
   int ixMin, iyMin, ixMax, iyMax, bitmapWidth, bitmapHeight, nColors;
+  int *idx;
   SplashClipResult clipRes;
   SplashColorMode srcMode;
   SplashBitmap *tBitmap;
@@ -1964,7 +1960,9 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
   SplashColorPtr dataPtr;
   Guchar *alphaPtr;
   GfxColor color;
-  SplashColorPtr sColors, sColor;
+  GfxColor *colors;
+  double *tVals;
+  SplashColorPtr sColors;
   SplashColor sColor0;
 
   // get the shading parameters
@@ -2091,7 +2089,8 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
       }
     }
 
-  // special case: horizontal axis (in device space)
+  // special case: horizontal axis (in device space) -- compute the
+  // first row, and copy it to the rest of the bitmap
   } else if (fabs(yy0 - yy1) < 0.01) {
     for (x = 0; x < bitmapWidth; ++x) {
       dataPtr = tBitmap->getDataPtr() + x * nComps;
@@ -2121,14 +2120,17 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
 	shading->getColor(t, &color);
       }
       computeShadingColor(state, srcMode, &color, sColor0);
-      for (y = 0; y < bitmapHeight; ++y) {
-	for (i = 0; i < nComps; ++i) {
-	  dataPtr[i] = sColor0[i];
-	}
-	*alphaPtr = 0xff;
-	dataPtr += tBitmap->getRowSize();
-	alphaPtr += bitmapWidth;
+      for (i = 0; i < nComps; ++i) {
+	dataPtr[i] = sColor0[i];
       }
+      *alphaPtr = 0xff;
+    }
+    dataPtr = tBitmap->getDataPtr();
+    alphaPtr = tBitmap->getAlphaPtr();
+    for (y = 1; y < bitmapHeight; ++y) {
+      memcpy(dataPtr + y * tBitmap->getRowSize(), dataPtr,
+	     bitmapWidth * nComps);
+      memcpy(alphaPtr + y * bitmapWidth, alphaPtr, bitmapWidth);
     }
 
   // special case: vertical axis (in device space)
@@ -2179,56 +2181,53 @@ GBool SplashOutputDev::axialShadedFill(GfxState *state,
     } else if (nColors > 1024) {
       nColors = 1024;
     }
-    sColors = (SplashColorPtr)gmallocn(nColors, nComps);
-    sColor = sColors;
+    sColors = (SplashColorPtr)gmalloc(nColors * nComps
+				    + splashShadingColorsPad);
+    tVals = (double *)gmallocn(nColors, sizeof(double));
+    colors = (GfxColor *)gmallocn(nColors, sizeof(GfxColor));
     for (i = 0; i < nColors; ++i) {
       s = (double)i / (double)(nColors - 1);
-      t = t0 + s * (t1 - t0);
-      shading->getColor(t, &color);
-      computeShadingColor(state, srcMode, &color, sColor);
-      sColor += nComps;
+      tVals[i] = t0 + s * (t1 - t0);
     }
-
+    shading->getColors(tVals, nColors, colors);
+    computeShadingColors(state, srcMode, colors, nColors, sColors);
+    gfree(tVals);
+    gfree(colors);
+
+    // each row is mapped to color table indexes, and then filled
+    // from the table
+    idx = (int *)gmallocn(bitmapWidth, sizeof(int));
     dataPtr = tBitmap->getDataPtr();
     alphaPtr = tBitmap->getAlphaPtr();
     for (y = 0; y < bitmapHeight; ++y) {
-      for (x = 0; x < bitmapWidth; ++x) {
 
-	// convert coords to user space
-	tx = ixMin + x + 0.5;
-	ty = iyMin + y + 0.5;
-	xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
-	yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
+      // the y part of the user space coords is constant along the
+      // row
+      ty = iyMin + y + 0.5;
+      xxRow = ty * ictm[2];
+      yyRow = ty * ictm[3];
 
-	// compute the position along the axis
+      for (x = 0; x < bitmapWidth; ++x) {
+	// convert coords to user space, and compute the position along
+	// the axis
+	tx = ixMin + x + 0.5;
+	xx = tx * ictm[0] + xxRow + ictm[4];
+	yy = tx * ictm[1] + yyRow + ictm[5];
 	s = ((xx - x0) * dx + (yy - y0) * dy) * d;
-	go = gFalse;
-	if (s < 0) {
-	  go = ext0;
-	} else if (s > 1) {
-	  go = ext1;
-	} else {
-	  go = gTrue;
-	}
-	if (!go) {
-	  dataPtr += nComps;
-	  ++alphaPtr;
-	  continue;
-	}
 	if (s <= 0) {
-	  sColor = sColors;
+	  idx[x] = (s < 0 && !ext0) ? -1 : 0;
 	} else if (s >= 1) {
-	  sColor = sColors + (nColors - 1) * nComps;
+	  idx[x] = (s > 1 && !ext1) ? -1 : nColors - 1;
 	} else {
-	  i = (int)((nColors - 1) * s + 0.5);
-	  sColor = sColors + i * nComps;
-	}
-	for (i = 0; i < nComps; ++i) {
-	  *dataPtr++ = sColor[i];
+	  idx[x] = (int)((nColors - 1) * s + 0.5);
 	}
-	*alphaPtr++ = 0xff;
       }
+      splashFillShadingRow(dataPtr, alphaPtr, idx, bitmapWidth,
+			   sColors, nComps);
+      dataPtr += tBitmap->getRowSize();
+      alphaPtr += bitmapWidth;
     }
+    gfree(idx);
   }
 
   // composite the bitmap
@@ -2252,10 +2251,12 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
   double *ctm;
   double ictm[6];
   double xMin, yMin, xMax, yMax, tx, ty, xx, yy;
-  double dx, dy, dr, r0dr, r02, a, a2, b, c, e, es, s, s0, s1, rs0, rs1, t;
+  double dx, dy, dr, r0dr, r02, a, a2, b, c, e, es, s, s0, s1, rs0, rs1;
+  double xxRow, yyRow;
   GBool aIsZero, go;
   int ixMin, iyMin, ixMax, iyMax, bitmapWidth, bitmapHeight, nColors;
   int bxMin, byMin, bxMax, byMax;
+  int *idx;
   SplashClipResult clipRes;
   SplashColorMode srcMode;
   SplashBitmap *tBitmap;
@@ -2263,7 +2264,8 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
   int x, y, i;
   SplashColorPtr dataPtr;
   Guchar *alphaPtr;
-  GfxColor color;
+  GfxColor *colors;
+  double *tVals;
   SplashColorPtr sColors, sColor;
 
   // get the shading parameters
@@ -2390,15 +2392,18 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
   } else if (nColors > 1024) {
     nColors = 1024;
   }
-  sColors = (SplashColorPtr)gmallocn(nColors, nComps);
-  sColor = sColors;
+  sColors = (SplashColorPtr)gmalloc(nColors * nComps
+				    + splashShadingColorsPad);
+  tVals = (double *)gmallocn(nColors, sizeof(double));
+  colors = (GfxColor *)gmallocn(nColors, sizeof(GfxColor));
   for (i = 0; i < nColors; ++i) {
     s = (double)i / (double)(nColors - 1);
-    t = t0 + s * (t1 - t0);
-    shading->getColor(t, &color);
-    computeShadingColor(state, srcMode, &color, sColor);
-    sColor += nComps;
+    tVals[i] = t0 + s * (t1 - t0);
   }
+  shading->getColors(tVals, nColors, colors);
+  computeShadingColors(state, srcMode, colors, nColors, sColors);
+  gfree(tVals);
+  gfree(colors);
 
   // special case: in the "enclosed" + extended case, we can fill the
   // bitmap with the outer color and just render inside the larger
@@ -2515,17 +2520,21 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
     aIsZero = gFalse;
     a2 = 1 / (2 * a);
   }
+  idx = (int *)gmallocn(bitmapWidth, sizeof(int));
   for (y = byMin; y < byMax; ++y) {
-    dataPtr = tBitmap->getDataPtr()
-              + y * tBitmap->getRowSize() + bxMin * nComps;
-    alphaPtr = tBitmap->getAlphaPtr() + y * bitmapWidth + bxMin;
+
+    // the y part of the user space coords is constant along the row
+    ty = iyMin + y + 0.5;
+    xxRow = ty * ictm[2];
+    yyRow = ty * ictm[3];
+
+    // compute the color table index for each pixel in the row
     for (x = bxMin; x < bxMax; ++x) {
 
       // convert coords to user space
       tx = ixMin + x + 0.5;
-      ty = iyMin + y + 0.5;
-      xx = tx * ictm[0] + ty * ictm[2] + ictm[4];
-      yy = tx * ictm[1] + ty * ictm[3] + ictm[5];
+      xx = tx * ictm[0] + xxRow + ictm[4];
+      yy = tx * ictm[1] + yyRow + ictm[5];
 
       // compute the radius of the circle at x,y
       b = 2 * ((xx - x0) * dx + (yy - y0) * dy + r0dr);
@@ -2581,24 +2590,24 @@ GBool SplashOutputDev::radialShadedFill(GfxState *state,
 	}
       }
       if (!go) {
-	dataPtr += nComps;
-	++alphaPtr;
-	continue;
-      }
-      if (s <= 0) {
-	sColor = sColors;
+	idx[x - bxMin] = -1;
+      } else if (s <= 0) {
+	idx[x - bxMin] = 0;
       } else if (s >= 1) {
-	sColor = sColors + (nColors - 1) * nComps;
+	idx[x - bxMin] = nColors - 1;
       } else {
-	i = (int)((nColors - 1) * s + 0.5);
-	sColor = sColors + i * nComps;
+	idx[x - bxMin] = (int)((nColors - 1) * s + 0.5);
       }
-      for (i = 0; i < nComps; ++i) {
-	*dataPtr++ = sColor[i];
-      }
-      *alphaPtr++ = 0xff;
     }
+
+    // fill the row
+    dataPtr = tBitmap->getDataPtr()
+              + y * tBitmap->getRowSize() + bxMin * nComps;
+    alphaPtr = tBitmap->getAlphaPtr() + y * bitmapWidth + bxMin;
+    splashFillShadingRow(dataPtr, alphaPtr, idx, bxMax - bxMin,
+			 sColors, nComps);
   }
+  gfree(idx);
 
   // composite the bitmap
   setOverprintMask(state, state->getFillColorSpace(),
@@ -2646,6 +2655,70 @@ void SplashOutputDev::computeShadingColor(GfxState *state,
   }
 }
 
+// Convert <n> shading colors (in the fill color space) to Splash
+// colors, using the batched color space conversion functions.  On
+// return, the fill color is set to the last color, as with
+// computeShadingColor.
+void SplashOutputDev::computeShadingColors(GfxState *state,
+					   SplashColorMode mode,
+					   GfxColor *colors, int n,
+					   SplashColorPtr sColors) {
+  GfxColorSpace *colorSpace;
+  GfxColorComp *comps;
+  GfxGray *gray;
+  GfxRGB *rgb;
+#if SPLASH_CMYK
+  GfxCMYK *cmyk;
+#endif
+  int nComps, i, j;
+
+  if (n <= 0) {
+    return;
+  }
+  colorSpace = state->getFillColorSpace();
+  nComps = colorSpace->getNComps();
+  comps = (GfxColorComp *)gmallocn(n, nComps * (int)sizeof(GfxColorComp));
+  for (j = 0; j < n; ++j) {
+    for (i = 0; i < nComps; ++i) {
+      comps[j * nComps + i] = colors[j].c[i];
+    }
+  }
+  switch (mode) {
+  case splashModeMono8:
+    gray = (GfxGray *)gmallocn(n, sizeof(GfxGray));
+    colorSpace->getGrayLine(comps, gray, n, state->getRenderingIntent());
+    for (j = 0; j < n; ++j) {
+      getColor(gray[j], sColors + j);
+    }
+    gfree(gray);
+    break;
+  case splashModeRGB8:
+    rgb = (GfxRGB *)gmallocn(n, sizeof(GfxRGB));
+    colorSpace->getRGBLine(comps, rgb, n, state->getRenderingIntent());
+    for (j = 0; j < n; ++j) {
+      getColor(&rgb[j], sColors + 3 * j);
+    }
+    gfree(rgb);
+    break;
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    cmyk = (GfxCMYK *)gmallocn(n, sizeof(GfxCMYK));
+    colorSpace->getCMYKLine(comps, cmyk, n, state->getRenderingIntent());
+    for (j = 0; j < n; ++j) {
+      getColor(&cmyk[j], sColors + 4 * j);
+    }
+    gfree(cmyk);
+    break;
+#endif
+  case splashModeMono1:
+  case splashModeBGR8:
+    // mode cannot be Mono1 or BGR8
+    break;
+  }
+  gfree(comps);
+  state->setFillColor(&colors[n - 1]);
+}
+
 void SplashOutputDev::clip(GfxState *state) {
   SplashPath *path;
 
@@ -3149,15 +3222,124 @@ void SplashOutputDev::endTextObject(GfxState *state) {
 
 struct SplashOutImageMaskData {
   ImageStream *imgStr;
+  CCITTFaxStream *ccittStr;	// set (instead of imgStr) if the mask
+				//   is read as runs from a CCITT stream
+  int *spans;			// span buffer, for ccittStr
   GBool invert;
   int width, height, y;
 };
 
+// Set up <imgMaskData> to read an image mask from <str>.  CCITTFax
+// masks (the common case for scanned pages) are read one row of run
+// lengths at a time, which avoids packing and unpacking the bits.
+static void initImageMaskData(SplashOutImageMaskData *imgMaskData,
+			      Stream *str, int width, int height,
+			      GBool invert) {
+  if (str->getKind() == strCCITTFax &&
+      ((CCITTFaxStream *)str)->getColumns() == width) {
+    imgMaskData->imgStr = NULL;
+    imgMaskData->ccittStr = (CCITTFaxStream *)str;
+    imgMaskData->ccittStr->reset();
+    imgMaskData->spans = (int *)gmallocn(width + 2, sizeof(int));
+  } else {
+    imgMaskData->imgStr = new ImageStream(str, width, 1, 1);
+    imgMaskData->imgStr->reset();
+    imgMaskData->ccittStr = NULL;
+    imgMaskData->spans = NULL;
+  }
+  imgMaskData->invert = invert ? 0 : 1;
+  imgMaskData->width = width;
+  imgMaskData->height = height;
+  imgMaskData->y = 0;
+}
+
+// Skip the rest of the image mask (for inline images).
+static void skipImageMaskData(SplashOutImageMaskData *imgMaskData) {
+  int *changes;
+
+  while (imgMaskData->y < imgMaskData->height) {
+    if (imgMaskData->ccittStr) {
+      imgMaskData->ccittStr->readRowChanges(&changes);
+    } else {
+      imgMaskData->imgStr->getLine();
+    }
+    ++imgMaskData->y;
+  }
+}
+
+static void freeImageMaskData(SplashOutImageMaskData *imgMaskData) {
+  if (imgMaskData->imgStr) {
+    delete imgMaskData->imgStr;
+  }
+  gfree(imgMaskData->spans);
+}
+
+GBool SplashOutputDev::imageMaskSpanSrc(void *data, int **spans,
+					int *nSpans) {
+  SplashOutImageMaskData *imgMaskData = (SplashOutImageMaskData *)data;
+  int *changes, *sp;
+  int nChanges, x0, x1, i;
+
+  *spans = imgMaskData->spans;
+  *nSpans = 0;
+  if (imgMaskData->y == imgMaskData->height) {
+    return gFalse;
+  }
+
+  // if the CCITT data ends early, the missing rows are padded with 1
+  // bits, which are set in the output line only if the mask is
+  // inverted
+  if (!(nChanges = imgMaskData->ccittStr->readRowChanges(&changes))) {
+    if (!imgMaskData->invert) {
+      imgMaskData->spans[0] = 0;
+      imgMaskData->spans[1] = imgMaskData->width;
+      *nSpans = 1;
+    }
+    ++imgMaskData->y;
+    return gTrue;
+  }
+
+  // changes[i] ends a white run if i is even, a black run if i is
+  // odd; the set (1) pixels in the output line are the white runs if
+  // white pixels are 1 bits in the stream, and the mask isn't
+  // inverted -- or vice versa
+  i = ((imgMaskData->ccittStr->getBlackIs1() ? 0 : 1)
+       ^ imgMaskData->invert) ? 0 : 1;
+  x0 = i ? changes[0] : 0;
+  sp = imgMaskData->spans;
+  for (; i < nChanges; i += 2) {
+    x1 = changes[i];
+    if (x1 > x0) {
+      *sp++ = x0;
+      *sp++ = x1;
+    }
+    if (i + 1 >= nChanges) {
+      break;
+    }
+    x0 = changes[i + 1];
+  }
+  *nSpans = (int)(sp - imgMaskData->spans) / 2;
+  ++imgMaskData->y;
+  return gTrue;
+}
+
 GBool SplashOutputDev::imageMaskSrc(void *data, SplashColorPtr line) {
   SplashOutImageMaskData *imgMaskData = (SplashOutImageMaskData *)data;
   Guchar *p;
   SplashColorPtr q;
-  int x;
+  int *spans;
+  int nSpans, x;
+
+  if (imgMaskData->ccittStr) {
+    memset(line, 0, imgMaskData->width);
+    if (!imageMaskSpanSrc(data, &spans, &nSpans)) {
+      return gFalse;
+    }
+    for (x = 0; x < nSpans; ++x) {
+      memset(line + spans[2*x], 1, spans[2*x + 1] - spans[2*x]);
+    }
+    return gTrue;
+  }
 
   if (imgMaskData->y == imgMaskData->height ||
       !(p = imgMaskData->imgStr->getLine())) {
@@ -3195,23 +3377,16 @@ void SplashOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str,
 
   reduceImageResolution(str, ctm, &width, &height);
 
-  imgMaskData.imgStr = new ImageStream(str, width, 1, 1);
-  imgMaskData.imgStr->reset();
-  imgMaskData.invert = invert ? 0 : 1;
-  imgMaskData.width = width;
-  imgMaskData.height = height;
-  imgMaskData.y = 0;
+  initImageMaskData(&imgMaskData, str, width, height, invert);
 
   splash->fillImageMask(&imageMaskSrc, &imgMaskData, width, height, mat,
-			t3GlyphStack != NULL, interpolate);
+			t3GlyphStack != NULL, interpolate,
+			imgMaskData.ccittStr ? &imageMaskSpanSrc : NULL);
   if (inlineImg) {
-    while (imgMaskData.y < height) {
-      imgMaskData.imgStr->getLine();
-      ++imgMaskData.y;
-    }
+    skipImageMaskData(&imgMaskData);
   }
 
-  delete imgMaskData.imgStr;
+  freeImageMaskData(&imgMaskData);
   str->close();
 }
 
@@ -3236,12 +3411,7 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
   mat[4] = ctm[2] + ctm[4];
   mat[5] = ctm[3] + ctm[5];
   reduceImageResolution(str, ctm, &width, &height);
-  imgMaskData.imgStr = new ImageStream(str, width, 1, 1);
-  imgMaskData.imgStr->reset();
-  imgMaskData.invert = invert ? 0 : 1;
-  imgMaskData.width = width;
-  imgMaskData.height = height;
-  imgMaskData.y = 0;
+  initImageMaskData(&imgMaskData, str, width, height, invert);
   maskBitmap = new SplashBitmap(bitmap->getWidth(), bitmap->getHeight(),
 				1, splashModeMono8, gFalse);
   maskSplash = new Splash(maskBitmap, gTrue);
@@ -3253,8 +3423,9 @@ void SplashOutputDev::setSoftMaskFromImageMask(GfxState *state,
   maskColor[0] = 0xff;
   maskSplash->setFillPattern(new SplashSolidColor(maskColor));
   maskSplash->fillImageMask(&imageMaskSrc, &imgMaskData,
-			    width, height, mat, gFalse, interpolate);
-  delete imgMaskData.imgStr;
+			    width, height, mat, gFalse, interpolate,
+			    imgMaskData.ccittStr ? &imageMaskSpanSrc : NULL);
+  freeImageMaskData(&imgMaskData);
   str->close();
   delete maskSplash;
   splash->setSoftMask(maskBitmap);
@@ -3343,11 +3514,6 @@ GBool SplashOutputDev::alphaImageSrc(void *data, SplashColorPtr colorLine,
   SplashOutImageData *imgData = (SplashOutImageData *)data;
   Guchar *p, *aq;
   SplashColorPtr q, col;
-  GfxRGB rgb;
-  GfxGray gray;
-#if SPLASH_CMYK
-  GfxCMYK cmyk;
-#endif
   Guchar alpha;
   int nComps, x, i;
 
@@ -3361,6 +3527,28 @@ GBool SplashOutputDev::alphaImageSrc(void *data, SplashColorPtr colorLine,
 
   nComps = imgData->colorMap->getNumPixelComps();
 
+  // without a lookup table, convert the whole line at once
+  if (!imgData->lookup) {
+    switch (imgData->colorMode) {
+    case splashModeMono1:
+    case splashModeMono8:
+      imgData->colorMap->getGrayByteLine(p, colorLine, imgData->width,
+					 imgData->ri);
+      break;
+    case splashModeRGB8:
+    case splashModeBGR8:
+      imgData->colorMap->getRGBByteLine(p, colorLine, imgData->width,
+					imgData->ri);
+      break;
+#if SPLASH_CMYK
+    case splashModeCMYK8:
+      imgData->colorMap->getCMYKByteLine(p, colorLine, imgData->width,
+					 imgData->ri);
+      break;
+#endif
+    }
+  }
+
   for (x = 0, q = colorLine, aq = alphaLine;
        x < imgData->width;
        ++x, p += nComps) {
@@ -3395,33 +3583,8 @@ GBool SplashOutputDev::alphaImageSrc(void *data, SplashColorPtr colorLine,
 	break;
 #endif
       }
-      *aq++ = alpha;
-    } else {
-      switch (imgData->colorMode) {
-      case splashModeMono1:
-      case splashModeMono8:
-	imgData->colorMap->getGray(p, &gray, imgData->ri);
-	*q++ = colToByte(gray);
-	break;
-      case splashModeRGB8:
-      case splashModeBGR8:
-	imgData->colorMap->getRGB(p, &rgb, imgData->ri);
-	*q++ = colToByte(rgb.r);
-	*q++ = colToByte(rgb.g);
-	*q++ = colToByte(rgb.b);
-	break;
-#if SPLASH_CMYK
-      case splashModeCMYK8:
-	imgData->colorMap->getCMYK(p, &cmyk, imgData->ri);
-	*q++ = colToByte(cmyk.c);
-	*q++ = colToByte(cmyk.m);
-	*q++ = colToByte(cmyk.y);
-	*q++ = colToByte(cmyk.k);
-	break;
-#endif
-      }
-      *aq++ = alpha;
     }
+    *aq++ = alpha;
   }
 
   ++imgData->y;
@@ -3697,12 +3860,8 @@ void SplashOutputDev::drawMaskedImage(GfxState *state, Object *ref,
     mat[3] = (SplashCoord)height;
     mat[4] = 0;
     mat[5] = 0;
-    imgMaskData.imgStr = new ImageStream(maskStr, maskWidth, 1, 1);
-    imgMaskData.imgStr->reset();
-    imgMaskData.invert = maskInvert ? 0 : 1;
-    imgMaskData.width = maskWidth;
-    imgMaskData.height = maskHeight;
-    imgMaskData.y = 0;
+    initImageMaskData(&imgMaskData, maskStr, maskWidth, maskHeight,
+		      maskInvert);
     maskBitmap = new SplashBitmap(width, height, 1, splashModeMono1, gFalse);
     maskSplash = new Splash(maskBitmap, gFalse);
     maskSplash->setStrokeAdjust(
@@ -3715,8 +3874,9 @@ void SplashOutputDev::drawMaskedImage(GfxState *state, Object *ref,
     maskSplash->setFillPattern(new SplashSolidColor(maskColor));
     // use "glyph mode" here to get the correct scaled size
     maskSplash->fillImageMask(&imageMaskSrc, &imgMaskData,
-			      maskWidth, maskHeight, mat, gTrue, interpolate);
-    delete imgMaskData.imgStr;
+			      maskWidth, maskHeight, mat, gTrue, interpolate,
+			      imgMaskData.ccittStr ? &imageMaskSpanSrc : NULL);
+    freeImageMaskData(&imgMaskData);
     maskStr->close();
     delete maskSplash;
 
@@ -3818,13 +3978,8 @@ GBool SplashOutputDev::softMaskMatteImageSrc(void *data,
       (SplashOutSoftMaskMatteImageData *)data;
   Guchar *p, *ap, *aq;
   SplashColorPtr q;
-  GfxRGB rgb;
-  GfxGray gray;
-#if SPLASH_CMYK
-  GfxCMYK cmyk;
-#endif
   Guchar alpha;
-  int nComps, x;
+  int nColorComps, x, i;
 
   if (imgData->y == imgData->height ||
       !(p = imgData->imgStr->getLine()) ||
@@ -3835,59 +3990,39 @@ GBool SplashOutputDev::softMaskMatteImageSrc(void *data,
     return gFalse;
   }
 
-  nComps = imgData->colorMap->getNumPixelComps();
-
+  // convert the line, then un-premultiply it
+  switch (imgData->colorMode) {
+  case splashModeMono1:
+  case splashModeMono8:
+    imgData->colorMap->getGrayByteLine(p, colorLine, imgData->width,
+				       imgData->ri);
+    break;
+  case splashModeRGB8:
+  case splashModeBGR8:
+    imgData->colorMap->getRGBByteLine(p, colorLine, imgData->width,
+				      imgData->ri);
+    break;
+#if SPLASH_CMYK
+  case splashModeCMYK8:
+    imgData->colorMap->getCMYKByteLine(p, colorLine, imgData->width,
+				       imgData->ri);
+    break;
+#endif
+  }
+  nColorComps = splashColorModeNComps[imgData->colorMode];
   for (x = 0, q = colorLine, aq = alphaLine;
        x < imgData->width;
-       ++x, p += nComps, ++ap) {
+       ++x, ++ap) {
     alpha = *ap;
-    switch (imgData->colorMode) {
-    case splashModeMono1:
-    case splashModeMono8:
-      if (alpha) {
-	imgData->colorMap->getGray(p, &gray, imgData->ri);
-	*q++ = imgData->matte[0] + (255 * (colToByte(gray) -
-					   imgData->matte[0])) / alpha;
-      } else {
-	*q++ = 0;
-      }
-      break;
-    case splashModeRGB8:
-    case splashModeBGR8:
-      if (alpha) {
-	imgData->colorMap->getRGB(p, &rgb, imgData->ri);
-	*q++ = imgData->matte[0] + (255 * (colToByte(rgb.r) -
-					   imgData->matte[0])) / alpha;
-	*q++ = imgData->matte[1] + (255 * (colToByte(rgb.g) -
-					   imgData->matte[1])) / alpha;
-	*q++ = imgData->matte[2] + (255 * (colToByte(rgb.b) -
-					   imgData->matte[2])) / alpha;
-      } else {
-	*q++ = 0;
-	*q++ = 0;
-	*q++ = 0;
+    if (alpha) {
+      for (i = 0; i < nColorComps; ++i) {
+	*q = imgData->matte[i] + (255 * (*q - imgData->matte[i])) / alpha;
+	++q;
       }
-      break;
-#if SPLASH_CMYK
-    case splashModeCMYK8:
-      if (alpha) {
-	imgData->colorMap->getCMYK(p, &cmyk, imgData->ri);
-	*q++ = imgData->matte[0] + (255 * (colToByte(cmyk.c) -
-					   imgData->matte[0])) / alpha;
-	*q++ = imgData->matte[1] + (255 * (colToByte(cmyk.m) -
-					   imgData->matte[1])) / alpha;
-	*q++ = imgData->matte[2] + (255 * (colToByte(cmyk.y) -
-					   imgData->matte[2])) / alpha;
-	*q++ = imgData->matte[3] + (255 * (colToByte(cmyk.k) -
-					   imgData->matte[3])) / alpha;
-      } else {
-	*q++ = 0;
-	*q++ = 0;
-	*q++ = 0;
+    } else {
+      for (i = 0; i < nColorComps; ++i) {
 	*q++ = 0;
       }
-      break;
-#endif
     }
     *aq++ = alpha;
   }
@@ -4119,28 +4254,87 @@ void SplashOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref,
 
 void SplashOutputDev::reduceImageResolution(Stream *str, double *ctm,
 					    int *width, int *height) {
-  double sw, sh;
-  int reduction;
-
-  if (str->getKind() == strJPX &&
-      *width * *height > 10000000) {
-    sw = (double)*width / (fabs(ctm[2]) + fabs(ctm[3]));
-    sh = (double)*height / (fabs(ctm[0]) + fabs(ctm[1]));
-    if (sw > 8 && sh > 8) {
-      reduction = 3;
-    } else if (sw > 4 && sh > 4) {
-      reduction = 2;
-    } else if (sw > 2 && sh > 2) {
-      reduction = 1;
-    } else {
-      reduction = 0;
+  SplashClip *clip;
+  double sw, sh, det, dx, dy, u, v, x, y, xMin, yMin, xMax, yMax;
+  int reduction, i;
+
+  if (str->getKind() != strDCT && str->getKind() != strJPX) {
+    return;
+  }
+  sw = sqrt(ctm[0] * ctm[0] + ctm[1] * ctm[1]);
+  sh = sqrt(ctm[2] * ctm[2] + ctm[3] * ctm[3]);
+  if (sw == 0 || sh == 0) {
+    return;
+  }
+  sw = (double)*width / sw;
+  sh = (double)*height / sh;
+
+  // JPEG images can be decoded at 1/2, 1/4, or 1/8 resolution -- do
+  // that if the image is going to be downsampled at least that much
+  // in both directions anyway
+  if (str->getKind() == strDCT) {
+    for (reduction = 0;
+	 reduction < 3 && sw > (2 << reduction) && sh > (2 << reduction);
+	 ++reduction) ;
+    if (reduction > 0 &&
+	(reduction = ((DCTStream *)str)->reduceResolution(reduction)) > 0) {
+      *width = (*width + (1 << reduction) - 1) >> reduction;
+      *height = (*height + (1 << reduction) - 1) >> reduction;
     }
-    if (reduction > 0) {
-      ((JPXStream *)str)->reduceResolution(reduction);
-      *width >>= reduction;
-      *height >>= reduction;
+    return;
+  }
+
+  // JPEG 2000 images can be decoded at any power-of-two reduction, up
+  // to the number of wavelet decomposition levels (the stream
+  // enforces that limit, and computes the reduced size)
+  for (reduction = 0; reduction < 32 && sw > 2 && sh > 2; ++reduction) {
+    sw *= 0.5;
+    sh *= 0.5;
+  }
+  if (reduction > 0) {
+    ((JPXStream *)str)->reduceResolution(reduction, width, height);
+  }
+
+  // only the part of the image inside the clip region needs to be
+  // decoded -- map the clip bbox (plus a couple of pixels for the
+  // image scaling filters) back into image space
+  clip = splash->getClip();
+  det = ctm[0] * ctm[3] - ctm[1] * ctm[2];
+  if (det == 0) {
+    return;
+  }
+  if (clip->getXMin() > clip->getXMax() ||
+      clip->getYMin() > clip->getYMax()) {
+    ((JPXStream *)str)->setRegionOfInterest(0, 0, 0, 0);
+    return;
+  }
+  xMin = yMin = xMax = yMax = 0; // make gcc happy
+  for (i = 0; i < 4; ++i) {
+    dx = ((i & 1) ? clip->getXMax() + 2 : clip->getXMin() - 2) - ctm[4];
+    dy = ((i & 2) ? clip->getYMax() + 2 : clip->getYMin() - 2) - ctm[5];
+    u = (ctm[3] * dx - ctm[2] * dy) / det;
+    v = (ctm[0] * dy - ctm[1] * dx) / det;
+    x = u * *width;
+    y = (1 - v) * *height;
+    if (i == 0 || x < xMin) {
+      xMin = x;
+    }
+    if (i == 0 || x > xMax) {
+      xMax = x;
+    }
+    if (i == 0 || y < yMin) {
+      yMin = y;
+    }
+    if (i == 0 || y > yMax) {
+      yMax = y;
     }
   }
+  xMin = xMin - 2 < 0 ? 0 : xMin - 2 > *width ? *width : xMin - 2;
+  yMin = yMin - 2 < 0 ? 0 : yMin - 2 > *height ? *height : yMin - 2;
+  xMax = xMax + 2 < 0 ? 0 : xMax + 2 > *width ? *width : xMax + 2;
+  yMax = yMax + 2 < 0 ? 0 : yMax + 2 > *height ? *height : yMax + 2;
+  ((JPXStream *)str)->setRegionOfInterest((int)floor(xMin), (int)floor(yMin),
+					  (int)ceil(xMax), (int)ceil(yMax));
 }
 
 void SplashOutputDev::clearMaskRegion(GfxState *state,
@@ -4655,12 +4849,7 @@ SplashFont *SplashOutputDev::getFont(GString *name, SplashCoord *textMatA) {
   Ref ref;
   SplashOutFontFileID *id;
   GfxFontLoc *fontLoc;
-#if LOAD_FONTS_FROM_MEM
-  GString *fontBuf;
-  FILE *extFontFile;
-  char blk[4096];
-  int n;
-#endif
+  SplashFontSrc *fontSrc;
   SplashFontFile *fontFile;
   SplashFont *fontObj;
   FoFiTrueType *ff;
@@ -4691,40 +4880,16 @@ SplashFont *SplashOutputDev::getFont(GString *name, SplashCoord *textMatA) {
     if (!(fontLoc = GfxFont::locateBase14Font(name))) {
       return NULL;
     }
-#if LOAD_FONTS_FROM_MEM
-    fontBuf = NULL;
-    if (fontLoc->fontType == fontType1 ||
-	fontLoc->fontType == fontTrueType) {
-      if (!(extFontFile = fopen(fontLoc->path->getCString(), "rb"))) {
-	delete fontLoc;
-	delete id;
-	return NULL;
-      }
-      fontBuf = new GString();
-      while ((n = fread(blk, 1, sizeof(blk), extFontFile)) > 0) {
-	fontBuf->append(blk, n);
-      }
-      fclose(extFontFile);
-    }
-#endif
     if (fontLoc->fontType == fontType1) {
-      fontFile = fontEngine->loadType1Font(id,
-#if LOAD_FONTS_FROM_MEM
-					   fontBuf,
-#else
-					   fontLoc->path->getCString(),
-					   gFalse,
-#endif
-					   winAnsiEncoding);
+      fontSrc = makeExtFontSrc(fontLoc->path);
+      if (!(fontFile = fontEngine->loadType1Font(id, fontSrc,
+						 winAnsiEncoding))) {
+	delete fontSrc;
+      }
     } else if (fontLoc->fontType == fontTrueType) {
-#if LOAD_FONTS_FROM_MEM
-      if (!(ff = FoFiTrueType::make(fontBuf->getCString(),
-				    fontBuf->getLength(),
-				    fontLoc->fontNum))) {
-#else
-      if (!(ff = FoFiTrueType::load(fontLoc->path->getCString(),
-				    fontLoc->fontNum))) {
-#endif
+      fontSrc = makeExtFontSrc(fontLoc->path);
+      if (!(ff = loadTrueTypeFont(fontSrc, fontLoc->fontNum))) {
+	delete fontSrc;
 	delete fontLoc;
 	delete id;
 	return NULL;
@@ -4739,6 +4904,7 @@ SplashFont *SplashOutputDev::getFont(GString *name, SplashCoord *textMatA) {
       }
       if (cmap == ff->getNumCmaps()) {
 	delete ff;
+	delete fontSrc;
 	delete fontLoc;
 	delete id;
 	return NULL;
@@ -4752,15 +4918,11 @@ SplashFont *SplashOutputDev::getFont(GString *name, SplashCoord *textMatA) {
 	}
       }
       delete ff;
-      fontFile = fontEngine->loadTrueTypeFont(id,
-#if LOAD_FONTS_FROM_MEM
-					      fontBuf,
-#else
-					      fontLoc->path->getCString(),
-					      gFalse,
-#endif
-					      fontLoc->fontNum,
-					      codeToGID, 256, NULL);
+      if (!(fontFile = fontEngine->loadTrueTypeFont(id, fontSrc,
+						    fontLoc->fontNum,
+						    codeToGID, 256, NULL))) {
+	delete fontSrc;
+      }
     } else {
       delete fontLoc;
       delete id;
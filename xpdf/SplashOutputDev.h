@@ -27,6 +27,7 @@ class Splash;
 class SplashPath;
 class SplashPattern;
 class SplashFontEngine;
+class SplashGlyphCache;
 class SplashFont;
 class T3FontCache;
 struct T3FontCacheTag;
@@ -185,6 +186,15 @@ public:
   // Called to indicate that a new PDF document has been loaded.
   void startDoc(XRef *xrefA);
 
+  // Share a glyph cache with other SplashOutputDevs which are
+  // rendering the same document (e.g., in other threads).  This
+  // should be called before startDoc.  The caller keeps ownership of
+  // the cache, and must clear it before it is used for a different
+  // document.  By default, each SplashOutputDev creates its own
+  // glyph cache (see the glyphCacheSize setting).
+  void setGlyphCache(SplashGlyphCache *glyphCacheA);
+  SplashGlyphCache *getGlyphCache() { return glyphCache; }
+
   void setStartPageCallback(void (*cbk)(void *data), void *data)
     { startPageCbk = cbk; startPageCbkData = data; }
  
@@ -262,12 +272,17 @@ private:
 			   SplashColorMode mode,
 			   GfxColor *color,
 			   SplashColorPtr sColor);
+  void computeShadingColors(GfxState *state,
+			    SplashColorMode mode,
+			    GfxColor *colors, int n,
+			    SplashColorPtr sColors);
   SplashPath *convertPath(GfxState *state, GfxPath *path,
 			  GBool dropEmptySubpaths);
   void doUpdateFont(GfxState *state);
   void drawType3Glyph(GfxState *state, T3FontCache *t3Font,
 		      T3FontCacheTag *tag, Guchar *data);
   static GBool imageMaskSrc(void *data, SplashColorPtr line);
+  static GBool imageMaskSpanSrc(void *data, int **spans, int *nSpans);
   static GBool imageSrc(void *data, SplashColorPtr colorLine,
 			Guchar *alphaLine);
   static GBool alphaImageSrc(void *data, SplashColorPtr line,
@@ -302,6 +317,8 @@ private:
   SplashBitmap *bitmap;
   Splash *splash;
   SplashFontEngine *fontEngine;
+  SplashGlyphCache *glyphCache;	// glyph cache shared by all fonts
+  GBool ownGlyphCache;		// set if glyphCache should be deleted
 
   T3FontCache *			// Type 3 font cache
     t3FontCache[splashOutT3FontCacheSize];
@@ -26,11 +26,13 @@
 #include "gmem.h"
 #include "gmempp.h"
 #include "gfile.h"
+#include "GMappedFile.h"
 #if MULTITHREADED
 #include "GMutex.h"
 #endif
 #include "config.h"
 #include "Error.h"
+#include "GlobalParams.h"
 #include "Object.h"
 #include "Lexer.h"
 #include "GfxState.h"
@@ -38,6 +40,7 @@
 #include "JBIG2Stream.h"
 #include "JPXStream.h"
 #include "Stream-CCITT.h"
+#include "DCTSIMD.h"
 
 #ifdef __DJGPP__
 static GBool setDJSYSFLAGS = gFalse;
@@ -179,7 +182,7 @@ Stream *Stream::makeFilter(char *name, Stream *str, Object *params,
   GBool endOfLine, byteAlign, endOfBlock, black;
   int columns, rows;
   int colorXform;
-  Object globals, obj;
+  Object globals, globalsRef, obj;
 
   if (!strcmp(name, "ASCIIHexDecode") || !strcmp(name, "AHx")) {
     str = new ASCIIHexStream(str);
@@ -299,9 +302,11 @@ Stream *Stream::makeFilter(char *name, Stream *str, Object *params,
   } else if (!strcmp(name, "JBIG2Decode")) {
     if (params->isDict()) {
       params->dictLookup("JBIG2Globals", &globals, recursion);
+      params->dictLookupNF("JBIG2Globals", &globalsRef);
     }
-    str = new JBIG2Stream(str, &globals);
+    str = new JBIG2Stream(str, &globals, &globalsRef);
     globals.free();
+    globalsRef.free();
   } else if (!strcmp(name, "JPXDecode")) {
     str = new JPXStream(str);
   } else {
@@ -860,6 +865,93 @@ void FileStream::moveStart(int delta) {
   bufPos = start;
 }
 
+//------------------------------------------------------------------------
+// MMapStream
+//------------------------------------------------------------------------
+
+MMapStream::MMapStream(GMappedFile *mapA, GFileOffset startA, GBool limitedA,
+		       GFileOffset lengthA, Object *dictA):
+    BaseStream(dictA) {
+  map = mapA->copy();
+  data = map->getData();
+  fileSize = map->getSize();
+  start = startA;
+  limited = limitedA;
+  length = lengthA;
+  setEnd();
+  reset();
+}
+
+MMapStream::~MMapStream() {
+  map->free();
+}
+
+Stream *MMapStream::copy() {
+  Object dictA;
+
+  dict.copy(&dictA);
+  return new MMapStream(map, start, limited, length, &dictA);
+}
+
+Stream *MMapStream::makeSubStream(GFileOffset startA, GBool limitedA,
+				  GFileOffset lengthA, Object *dictA) {
+  return new MMapStream(map, startA, limitedA, lengthA, dictA);
+}
+
+void MMapStream::setEnd() {
+  GFileOffset end;
+
+  end = fileSize;
+  if (limited && start >= 0 && length >= 0 && start + length < end) {
+    end = start + length;
+  }
+  bufEnd = data + end;
+}
+
+void MMapStream::reset() {
+  setPos(start);
+}
+
+int MMapStream::getBlock(char *blk, int size) {
+  int n;
+
+  if (size <= 0) {
+    return 0;
+  }
+  if (bufEnd - bufPtr < size) {
+    n = (int)(bufEnd - bufPtr);
+  } else {
+    n = size;
+  }
+  memcpy(blk, bufPtr, n);
+  bufPtr += n;
+  return n;
+}
+
+void MMapStream::setPos(GFileOffset pos, int dir) {
+  GFileOffset p;
+
+  if (dir >= 0) {
+    p = pos;
+  } else if (pos <= fileSize) {
+    p = fileSize - pos;
+  } else {
+    p = 0;
+  }
+  if (p < 0) {
+    p = 0;
+  } else if (p > (GFileOffset)(bufEnd - data)) {
+    p = (GFileOffset)(bufEnd - data);
+  }
+  bufPtr = data + p;
+}
+
+void MMapStream::moveStart(int delta) {
+  start += delta;
+  setEnd();
+  reset();
+}
+
 //------------------------------------------------------------------------
 // MemStream
 //------------------------------------------------------------------------
@@ -1719,6 +1811,18 @@ int CCITTFaxStream::getBlock(char *blk, int size) {
   return bytesRead;
 }
 
+int CCITTFaxStream::readRowChanges(int **changes) {
+  int n;
+
+  if (eof || !readRow()) {
+    return 0;
+  }
+  for (n = 0; codingLine[n] < columns; ++n) ;
+  nextCol = columns;
+  *changes = codingLine;
+  return n + 1;
+}
+
 inline void CCITTFaxStream::addPixels(int a1, int blackPixels) {
   if (a1 > codingLine[a0i]) {
     if (a1 > columns) {
@@ -2294,6 +2398,7 @@ GBool CCITTFaxStream::isBinary(GBool last) {
 DCTStream::DCTStream(Stream *strA, GBool colorXformA):
     FilterStream(strA) {
   colorXform = colorXformA;
+  reduction = 0;
   lineBuf = NULL;
   inlineImage = str->isEmbedStream();
 }
@@ -2337,6 +2442,10 @@ void DCTStream::reset() {
 
   // read the header
   jpeg_read_header(&decomp, TRUE);
+  if (reduction > 0) {
+    decomp.scale_num = 1;
+    decomp.scale_denom = 1 << reduction;
+  }
   jpeg_calc_output_dimensions(&decomp);
 
   // set up the color transform
@@ -2377,6 +2486,7 @@ void DCTStream::close() {
   jpeg_destroy_decompress(&decomp);
  skip:
   gfree(lineBuf);
+  reduction = 0;
   FilterStream::close();
 }
 
@@ -2534,6 +2644,44 @@ static int idctScaleMat[64] = {
   idctScaleB, idctScaleE, idctScaleF, idctScaleG, idctScaleB, idctScaleG, idctScaleF, idctScaleE
 };
 
+// Reduced-size inverse DCT matrices, for reduced-resolution
+// decoding: entry [x][u] is C(u)/2 * cos((2x+1)*u*pi/(2n)), where
+// C(0) = 1/sqrt(2) and C(u) = 1 otherwise, scaled by 2^11.  (The
+// 8-point matrix is used for the full-size direction of a subsampled
+// component's data unit.)
+static const int idctReduced8Mat[64] = {
+  724,  1004,  946,   851,  724,   569,  392,   200,
+  724,   851,  392,  -200, -724, -1004, -946,  -569,
+  724,   569, -392, -1004, -724,   200,  946,   851,
+  724,   200, -946,  -569,  724,   851, -392, -1004,
+  724,  -200, -946,   569,  724,  -851, -392,  1004,
+  724,  -569, -392,  1004, -724,  -200,  946,  -851,
+  724,  -851,  392,   200, -724,  1004, -946,   569,
+  724, -1004,  946,  -851,  724,  -569,  392,  -200
+};
+static const int idctReduced4Mat[16] = {
+  724,  946,  724,  392,
+  724,  392, -724, -946,
+  724, -392, -724,  946,
+  724, -946,  724, -392
+};
+static const int idctReduced2Mat[4] = {
+  724,  724,
+  724, -724
+};
+static const int idctReduced1Mat[1] = {
+  724
+};
+
+static const int *idctReducedMat(int n) {
+  switch (n) {
+  case 8:  return idctReduced8Mat;
+  case 4:  return idctReduced4Mat;
+  case 2:  return idctReduced2Mat;
+  default: return idctReduced1Mat;
+  }
+}
+
 // color conversion parameters (16.16 fixed point format)
 #define dctCrToR   91881	//  1.4020
 #define dctCbToG  -22553	// -0.3441363
@@ -2606,16 +2754,18 @@ DCTStream::DCTStream(Stream *strA, GBool colorXformA):
   int i;
 
   colorXform = colorXformA;
+  reduction = 0;
   progressive = interleaved = gFalse;
   width = height = 0;
   mcuWidth = mcuHeight = 0;
   numComps = 0;
-  comp = 0;
-  x = y = 0;
+  y = 0;
   for (i = 0; i < 4; ++i) {
-    frameBuf[i] = NULL;
+    coefBuf[i] = NULL;
+    nzBuf[i] = NULL;
   }
-  rowBuf = NULL;
+  coefReduction = 0;
+  rowBuf = rowBufPtr = rowBufEnd = NULL;
   memset(dcHuffTables, 0, sizeof(dcHuffTables));
   memset(acHuffTables, 0, sizeof(acHuffTables));
 
@@ -2632,12 +2782,17 @@ Stream *DCTStream::copy() {
 }
 
 void DCTStream::reset() {
-  int i;
+  double coefMem, blockSize, limit;
+  GBool reducible;
+  int bufHeight, n, i;
 
   str->reset();
 
   progressive = interleaved = gFalse;
   width = height = 0;
+  mcuWidth = mcuHeight = 0;
+  bufHeight = 0; // make gcc happy
+  rowBufPtr = rowBufEnd = NULL;
   numComps = 0;
   numQuantTables = 0;
   numDCHuffTables = 0;
@@ -2648,7 +2803,6 @@ void DCTStream::reset() {
 
   if (!readHeader()) {
     // force an EOF condition
-    progressive = gTrue;
     y = height;
     return;
   }
@@ -2670,6 +2824,24 @@ void DCTStream::reset() {
   mcuWidth *= 8;
   mcuHeight *= 8;
 
+  // reduced-resolution decoding maps each data unit to a smaller
+  // block of pixels, which only works if the sampling factors evenly
+  // divide the MCU size (reduceResolution() checks this before
+  // setting reduction, but the memory limit fallback doesn't)
+  reducible = gTrue;
+  for (i = 0; i < numComps; ++i) {
+    if ((mcuWidth / 8) % compInfo[i].hSample ||
+	(mcuHeight / 8) % compInfo[i].vSample) {
+      reducible = gFalse;
+    }
+  }
+  if (reduction > 0 && !reducible) {
+    error(errSyntaxError, getPos(),
+	  "Unsupported sampling factors for reduced-resolution DCT");
+    y = height;
+    return;
+  }
+
   // figure out color transform
   if (colorXform == -1) {
     if (numComps == 3) {
@@ -2688,34 +2860,51 @@ void DCTStream::reset() {
 
   if (progressive || !interleaved) {
 
-    // allocate a buffer for the whole image
+    // the coefficients for the whole image are buffered (16 bits per
+    // coefficient); if that would exceed the memory limit, keep only
+    // the low-frequency coefficients, and decode at reduced
+    // resolution
     bufWidth = ((width + mcuWidth - 1) / mcuWidth) * mcuWidth;
     bufHeight = ((height + mcuHeight - 1) / mcuHeight) * mcuHeight;
     if (bufWidth <= 0 || bufHeight <= 0 ||
-	bufWidth > INT_MAX / bufWidth / (int)sizeof(int)) {
+	bufHeight > INT_MAX / bufWidth) {
       error(errSyntaxError, getPos(), "Invalid image size in DCT stream");
       y = height;
       return;
     }
     for (i = 0; i < numComps; ++i) {
-      frameBuf[i] = (int *)gmallocn(bufWidth * bufHeight, sizeof(int));
-      memset(frameBuf[i], 0, bufWidth * bufHeight * sizeof(int));
+      blocksPerRow[i] = bufWidth / (mcuWidth / compInfo[i].hSample);
+    }
+    limit = globalParams->getDCTMemoryLimit();
+    for (coefReduction = reduction; ; ++coefReduction) {
+      setDataUnitSizes(coefReduction);
+      coefMem = 0;
+      for (i = 0; i < numComps; ++i) {
+	n = compInfo[i].duWidth * compInfo[i].duHeight;
+	blockSize = (double)(n * sizeof(short));
+	if (n < 64) {
+	  blockSize += 2 * sizeof(Guint);
+	}
+	coefMem += (double)blocksPerRow[i] *
+	           (bufHeight / (mcuHeight / compInfo[i].vSample)) *
+	           blockSize;
+      }
+      if (limit <= 0 || coefMem <= limit ||
+	  coefReduction == 3 || !reducible) {
+	break;
+      }
+    }
+    if (limit > 0 && coefMem > limit) {
+      // no more coefficients can be dropped (either this is already
+      // 1/8 resolution, or the sampling factors don't allow reduced
+      // decoding), so decode anyway, over the limit
+      error(errSyntaxWarning, getPos(),
+	    "DCT image exceeds the memory limit");
+    } else if (coefReduction > reduction) {
+      error(errSyntaxWarning, getPos(),
+	    "DCT image exceeds the memory limit"
+	    " - decoding at reduced resolution");
     }
-
-    // read the image data
-    do {
-      restartMarker = 0xd0;
-      restart();
-      readScan();
-    } while (readHeader());
-
-    // decode
-    decodeImage();
-
-    // initialize counters
-    comp = 0;
-    x = 0;
-    y = 0;
 
   } else {
 
@@ -2724,15 +2913,50 @@ void DCTStream::reset() {
       y = height;
       return;
     }
+    coefReduction = reduction;
+    setDataUnitSizes(coefReduction);
+  }
 
-    // allocate a buffer for one row of MCUs
-    bufWidth = ((width + mcuWidth - 1) / mcuWidth) * mcuWidth;
-    rowBuf = (Guchar *)gmallocn(numComps * mcuHeight, bufWidth);
-    rowBufPtr = rowBufEnd = rowBuf;
+  if (progressive || !interleaved) {
+
+    // allocate the coefficient buffers
+    for (i = 0; i < numComps; ++i) {
+      n = blocksPerRow[i] * (bufHeight / (mcuHeight / compInfo[i].vSample));
+      coefBuf[i] = (short *)gmallocn(n, compInfo[i].duWidth *
+				        compInfo[i].duHeight * sizeof(short));
+      memset(coefBuf[i], 0, n * compInfo[i].duWidth *
+			    compInfo[i].duHeight * sizeof(short));
+      if (compInfo[i].duWidth * compInfo[i].duHeight < 64) {
+	nzBuf[i] = (Guint *)gmallocn(n, 2 * sizeof(Guint));
+	memset(nzBuf[i], 0, n * 2 * sizeof(Guint));
+      }
+    }
+
+    // read the image data
+    do {
+      restartMarker = 0xd0;
+      restart();
+      readScan();
+    } while (readHeader());
+  }
 
-    // initialize counters
-    y = -mcuHeight;
+  // switch to output pixel units for reduced-resolution decoding
+  if (reduction > 0) {
+    width = (width + (1 << reduction) - 1) >> reduction;
+    height = (height + (1 << reduction) - 1) >> reduction;
+    mcuWidth >>= reduction;
+    mcuHeight >>= reduction;
+  }
+
+  // allocate a buffer for one row of MCUs
+  bufWidth = ((width + mcuWidth - 1) / mcuWidth) * mcuWidth;
+  rowBuf = (Guchar *)gmallocn(numComps * mcuHeight, bufWidth);
+  rowBufPtr = rowBufEnd = rowBuf;
 
+  // initialize counters
+  y = -mcuHeight;
+
+  if (!progressive && interleaved) {
     restartMarker = 0xd0;
     restart();
   }
@@ -2742,105 +2966,65 @@ void DCTStream::close() {
   int i;
 
   for (i = 0; i < 4; ++i) {
-    gfree(frameBuf[i]);
-    frameBuf[i] = NULL;
+    gfree(coefBuf[i]);
+    coefBuf[i] = NULL;
+    gfree(nzBuf[i]);
+    nzBuf[i] = NULL;
   }
   gfree(rowBuf);
-  rowBuf = NULL;
+  rowBuf = rowBufPtr = rowBufEnd = NULL;
+  reduction = 0;
   FilterStream::close();
 }
 
 int DCTStream::getChar() {
-  int c;
-
-  if (progressive || !interleaved) {
-    if (y >= height) {
+  if (rowBufPtr == rowBufEnd) {
+    if (y + mcuHeight >= height) {
       return EOF;
     }
-    c = frameBuf[comp][y * bufWidth + x];
-    if (++comp == numComps) {
-      comp = 0;
-      if (++x == width) {
-	x = 0;
-	++y;
-      }
-    }
-  } else {
-    if (rowBufPtr == rowBufEnd) {
-      if (y + mcuHeight >= height) {
-	return EOF;
-      }
-      y += mcuHeight;
-      if (!readMCURow()) {
-	y = height;
-	return EOF;
-      }
+    y += mcuHeight;
+    if (!readMCURow()) {
+      y = height;
+      return EOF;
     }
-    c = *rowBufPtr++;
   }
-  return c;
+  return *rowBufPtr++;
 }
 
 int DCTStream::lookChar() {
-  if (progressive || !interleaved) {
-    if (y >= height) {
+  if (rowBufPtr == rowBufEnd) {
+    if (y + mcuHeight >= height) {
       return EOF;
     }
-    return frameBuf[comp][y * bufWidth + x];
-  } else {
-    if (rowBufPtr == rowBufEnd) {
-      if (y + mcuHeight >= height) {
-	return EOF;
-      }
-      if (!readMCURow()) {
-	y = height;
-	return EOF;
-      }
+    y += mcuHeight;
+    if (!readMCURow()) {
+      y = height;
+      return EOF;
     }
-    return *rowBufPtr;
   }
+  return *rowBufPtr;
 }
 
 int DCTStream::getBlock(char *blk, int size) {
   int nRead, nAvail, n;
 
-  if (progressive || !interleaved) {
-    if (y >= height) {
-      return 0;
-    }
-    for (nRead = 0; nRead < size; ++nRead) {
-      blk[nRead] = (char)frameBuf[comp][y * bufWidth + x];
-      if (++comp == numComps) {
-	comp = 0;
-	if (++x == width) {
-	  x = 0;
-	  ++y;
-	  if (y >= height) {
-	    ++nRead;
-	    break;
-	  }
-	}
+  nRead = 0;
+  while (nRead < size) {
+    if (rowBufPtr == rowBufEnd) {
+      if (y + mcuHeight >= height) {
+	break;
       }
-    }
-  } else {
-    nRead = 0;
-    while (nRead < size) {
-      if (rowBufPtr == rowBufEnd) {
-	if (y + mcuHeight >= height) {
-	  break;
-	}
-	y += mcuHeight;
-	if (!readMCURow()) {
-	  y = height;
-	  break;
-	}
+      y += mcuHeight;
+      if (!readMCURow()) {
+	y = height;
+	break;
       }
-      nAvail = (int)(rowBufEnd - rowBufPtr);
-      n = (nAvail < size - nRead) ? nAvail : size - nRead;
-      memcpy(blk + nRead, rowBufPtr, n);
-      rowBufPtr += n;
-      nRead += n;
     }
+    nAvail = (int)(rowBufEnd - rowBufPtr);
+    n = (nAvail < size - nRead) ? nAvail : size - nRead;
+    memcpy(blk + nRead, rowBufPtr, n);
+    rowBufPtr += n;
+    nRead += n;
   }
   return nRead;
 }
@@ -2856,20 +3040,22 @@ void DCTStream::restart() {
   eobRun = 0;
 }
 
-// Read one row of MCUs from a sequential JPEG stream.
+// Read one row of MCUs, either from a sequential JPEG stream, or (in
+// progressive / non-interleaved mode) from the coefficient buffer.
 GBool DCTStream::readMCURow() {
   int data1[64];
   Guchar data2[64];
   Guchar *p1, *p2;
   int pY, pCb, pCr, pR, pG, pB;
-  int h, v, horiz, vert, hSub, vSub;
+  int h, v, horiz, vert, hSub, vSub, duWidth, duHeight;
   int x1, x2, y2, x3, y3, x4, y4, x5, y5, cc, i;
   int c;
 
   for (x1 = 0; x1 < width; x1 += mcuWidth) {
 
     // deal with restart marker
-    if (restartInterval > 0 && restartCtr == 0) {
+    if (!progressive && interleaved &&
+	restartInterval > 0 && restartCtr == 0) {
       c = readMarker();
       if (c != restartMarker) {
 	error(errSyntaxError, getPos(),
@@ -2887,19 +3073,31 @@ GBool DCTStream::readMCURow() {
       v = compInfo[cc].vSample;
       horiz = mcuWidth / h;
       vert = mcuHeight / v;
-      hSub = horiz / 8;
-      vSub = vert / 8;
+      duWidth = compInfo[cc].duWidth;
+      duHeight = compInfo[cc].duHeight;
+      hSub = horiz / duWidth;
+      vSub = vert / duHeight;
       for (y2 = 0; y2 < mcuHeight; y2 += vert) {
 	for (x2 = 0; x2 < mcuWidth; x2 += horiz) {
-	  if (!readDataUnit(&dcHuffTables[scanInfo.dcHuffTable[cc]],
-			    &acHuffTables[scanInfo.acHuffTable[cc]],
-			    &compInfo[cc].prevDC,
-			    data1)) {
+	  if (progressive || !interleaved) {
+	    loadCoefs(cc, ((y / mcuHeight) * v + y2 / vert) * blocksPerRow[cc]
+			  + (x1 / mcuWidth) * h + x2 / horiz,
+		      data1);
+	  } else if (!readDataUnit(&dcHuffTables[scanInfo.dcHuffTable[cc]],
+				   &acHuffTables[scanInfo.acHuffTable[cc]],
+				   &compInfo[cc].prevDC,
+				   data1)) {
 	    return gFalse;
 	  }
-	  transformDataUnit(quantTables[compInfo[cc].quantTable],
-			    data1, data2);
-	  if (hSub == 1 && vSub == 1 && x1+x2+8 <= width) {
+	  if (duWidth < 8 || duHeight < 8) {
+	    transformDataUnitReduced(quantTables[compInfo[cc].quantTable],
+				     data1, data2, duWidth, duHeight);
+	  } else {
+	    transformDataUnit(quantTables[compInfo[cc].quantTable],
+			      data1, data2);
+	  }
+	  if (duWidth == 8 && duHeight == 8 && hSub == 1 && vSub == 1 &&
+	      x1+x2+8 <= width) {
 	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
 	      p1 = &rowBuf[((y2+y3) * width + (x1+x2)) * numComps + cc];
 	      p1[0]          = data2[i];
@@ -2911,7 +3109,8 @@ GBool DCTStream::readMCURow() {
 	      p1[6*numComps] = data2[i+6];
 	      p1[7*numComps] = data2[i+7];
 	    }
-	  } else if (hSub == 2 && vSub == 2 && x1+x2+16 <= width) {
+	  } else if (duWidth == 8 && duHeight == 8 &&
+		     hSub == 2 && vSub == 2 && x1+x2+16 <= width) {
 	    for (y3 = 0, i = 0; y3 < 16; y3 += 2, i += 8) {
 	      p1 = &rowBuf[((y2+y3) * width + (x1+x2)) * numComps + cc];
 	      p2 = p1 + width * numComps;
@@ -2935,8 +3134,8 @@ GBool DCTStream::readMCURow() {
 	  } else {
 	    p1 = &rowBuf[(y2 * width + (x1+x2)) * numComps + cc];
 	    i = 0;
-	    for (y3 = 0, y4 = 0; y3 < 8; ++y3, y4 += vSub) {
-	      for (x3 = 0, x4 = 0; x3 < 8; ++x3, x4 += hSub) {
+	    for (y3 = 0, y4 = 0; y3 < duHeight; ++y3, y4 += vSub) {
+	      for (x3 = 0, x4 = 0; x3 < duWidth; ++x3, x4 += hSub) {
 		for (y5 = 0; y5 < vSub; ++y5) {
 		  for (x5 = 0; x5 < hSub && x1+x2+x4+x5 < width; ++x5) {
 		    p1[((y4+y5) * width + (x4+x5)) * numComps] = data2[i];
@@ -2956,7 +3155,8 @@ GBool DCTStream::readMCURow() {
   if (colorXform) {
     // convert YCbCr to RGB
     if (numComps == 3) {
-      for (i = 0, p1 = rowBuf; i < width * mcuHeight; ++i, p1 += 3) {
+      i = dctConvertYCbCr(rowBuf, width * mcuHeight, 3);
+      for (p1 = rowBuf + 3 * i; i < width * mcuHeight; ++i, p1 += 3) {
 	pY = p1[0];
 	pCb = p1[1] - 128;
 	pCr = p1[2] - 128;
@@ -2969,7 +3169,8 @@ GBool DCTStream::readMCURow() {
       }
     // convert YCbCrK to CMYK (K is passed through unchanged)
     } else if (numComps == 4) {
-      for (i = 0, p1 = rowBuf; i < width * mcuHeight; ++i, p1 += 4) {
+      i = dctConvertYCbCr(rowBuf, width * mcuHeight, 4);
+      for (p1 = rowBuf + 4 * i; i < width * mcuHeight; ++i, p1 += 4) {
 	pY = p1[0];
 	pCb = p1[1] - 128;
 	pCr = p1[2] - 128;
@@ -2996,9 +3197,8 @@ GBool DCTStream::readMCURow() {
 // Read one scan from a progressive or non-interleaved JPEG stream.
 void DCTStream::readScan() {
   int data[64];
-  int x1, y1, dx1, dy1, x2, y2, y3, cc, i;
-  int h, v, horiz, vert, vSub;
-  int *p1;
+  int x1, y1, dx1, dy1, x2, y2, cc, idx;
+  int h, v, horiz, vert;
   int c;
 
   if (scanInfo.numComps == 1) {
@@ -3041,23 +3241,12 @@ void DCTStream::readScan() {
 	v = compInfo[cc].vSample;
 	horiz = mcuWidth / h;
 	vert = mcuHeight / v;
-	vSub = vert / 8;
 	for (y2 = 0; y2 < dy1; y2 += vert) {
 	  for (x2 = 0; x2 < dx1; x2 += horiz) {
 
 	    // pull out the current values
-	    p1 = &frameBuf[cc][(y1+y2) * bufWidth + (x1+x2)];
-	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
-	      data[i] = p1[0];
-	      data[i+1] = p1[1];
-	      data[i+2] = p1[2];
-	      data[i+3] = p1[3];
-	      data[i+4] = p1[4];
-	      data[i+5] = p1[5];
-	      data[i+6] = p1[6];
-	      data[i+7] = p1[7];
-	      p1 += bufWidth * vSub;
-	    }
+	    idx = ((y1+y2) / vert) * blocksPerRow[cc] + (x1+x2) / horiz;
+	    loadCoefs(cc, idx, data);
 
 	    // read one data unit
 	    if (progressive) {
@@ -3077,19 +3266,8 @@ void DCTStream::readScan() {
 	      }
 	    }
 
-	    // add the data unit into frameBuf
-	    p1 = &frameBuf[cc][(y1+y2) * bufWidth + (x1+x2)];
-	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
-	      p1[0] = data[i];
-	      p1[1] = data[i+1];
-	      p1[2] = data[i+2];
-	      p1[3] = data[i+3];
-	      p1[4] = data[i+4];
-	      p1[5] = data[i+5];
-	      p1[6] = data[i+6];
-	      p1[7] = data[i+7];
-	      p1 += bufWidth * vSub;
-	    }
+	    // add the data unit into coefBuf
+	    storeCoefs(cc, idx, data);
 	  }
 	}
       }
@@ -3296,137 +3474,63 @@ GBool DCTStream::readProgressiveDataUnit(DCTHuffTable *dcHuffTable,
   return gTrue;
 }
 
-// Decode a progressive JPEG image.
-void DCTStream::decodeImage() {
-  int dataIn[64];
-  Guchar dataOut[64];
-  Gushort *quantTable;
-  int pY, pCb, pCr, pR, pG, pB;
-  int x1, y1, x2, y2, x3, y3, x4, y4, x5, y5, cc, i;
-  int h, v, horiz, vert, hSub, vSub;
-  int *p0, *p1, *p2;
+// Copy the coefficients for data unit <idx> of component <cc> from
+// coefBuf into <data>.  If coefBuf holds only the low-frequency
+// coefficients, the others are set to 1 if they're nonzero, which is
+// all that is needed to decode later refinement scans.
+void DCTStream::loadCoefs(int cc, int idx, int data[64]) {
+  short *p;
+  Guint *nz;
+  int w, h, i, j;
 
-  for (y1 = 0; y1 < bufHeight; y1 += mcuHeight) {
-    for (x1 = 0; x1 < bufWidth; x1 += mcuWidth) {
-      for (cc = 0; cc < numComps; ++cc) {
-	quantTable = quantTables[compInfo[cc].quantTable];
-	h = compInfo[cc].hSample;
-	v = compInfo[cc].vSample;
-	horiz = mcuWidth / h;
-	vert = mcuHeight / v;
-	hSub = horiz / 8;
-	vSub = vert / 8;
-	for (y2 = 0; y2 < mcuHeight; y2 += vert) {
-	  for (x2 = 0; x2 < mcuWidth; x2 += horiz) {
-
-	    // pull out the coded data unit
-	    p1 = &frameBuf[cc][(y1+y2) * bufWidth + (x1+x2)];
-	    for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
-	      dataIn[i]   = p1[0];
-	      dataIn[i+1] = p1[1];
-	      dataIn[i+2] = p1[2];
-	      dataIn[i+3] = p1[3];
-	      dataIn[i+4] = p1[4];
-	      dataIn[i+5] = p1[5];
-	      dataIn[i+6] = p1[6];
-	      dataIn[i+7] = p1[7];
-	      p1 += bufWidth * vSub;
-	    }
+  if (!nzBuf[cc]) {
+    p = &coefBuf[cc][idx * 64];
+    for (i = 0; i < 64; ++i) {
+      data[i] = p[i];
+    }
+    return;
+  }
+  nz = &nzBuf[cc][idx * 2];
+  for (i = 0; i < 64; ++i) {
+    data[i] = (nz[i >> 5] >> (i & 31)) & 1;
+  }
+  w = compInfo[cc].duWidth;
+  h = compInfo[cc].duHeight;
+  p = &coefBuf[cc][idx * w * h];
+  for (i = 0; i < h; ++i) {
+    for (j = 0; j < w; ++j) {
+      data[i*8 + j] = p[i*w + j];
+    }
+  }
+}
 
-	    // transform
-	    transformDataUnit(quantTable, dataIn, dataOut);
-
-	    // store back into frameBuf, doing replication for
-	    // subsampled components
-	    p1 = &frameBuf[cc][(y1+y2) * bufWidth + (x1+x2)];
-	    if (hSub == 1 && vSub == 1) {
-	      for (y3 = 0, i = 0; y3 < 8; ++y3, i += 8) {
-		p1[0] = dataOut[i] & 0xff;
-		p1[1] = dataOut[i+1] & 0xff;
-		p1[2] = dataOut[i+2] & 0xff;
-		p1[3] = dataOut[i+3] & 0xff;
-		p1[4] = dataOut[i+4] & 0xff;
-		p1[5] = dataOut[i+5] & 0xff;
-		p1[6] = dataOut[i+6] & 0xff;
-		p1[7] = dataOut[i+7] & 0xff;
-		p1 += bufWidth;
-	      }
-	    } else if (hSub == 2 && vSub == 2) {
-	      p2 = p1 + bufWidth;
-	      for (y3 = 0, i = 0; y3 < 16; y3 += 2, i += 8) {
-		p1[0] = p1[1] = p2[0] = p2[1] = dataOut[i] & 0xff;
-		p1[2] = p1[3] = p2[2] = p2[3] = dataOut[i+1] & 0xff;
-		p1[4] = p1[5] = p2[4] = p2[5] = dataOut[i+2] & 0xff;
-		p1[6] = p1[7] = p2[6] = p2[7] = dataOut[i+3] & 0xff;
-		p1[8] = p1[9] = p2[8] = p2[9] = dataOut[i+4] & 0xff;
-		p1[10] = p1[11] = p2[10] = p2[11] = dataOut[i+5] & 0xff;
-		p1[12] = p1[13] = p2[12] = p2[13] = dataOut[i+6] & 0xff;
-		p1[14] = p1[15] = p2[14] = p2[15] = dataOut[i+7] & 0xff;
-		p1 += bufWidth * 2;
-		p2 += bufWidth * 2;
-	      }
-	    } else {
-	      i = 0;
-	      for (y3 = 0, y4 = 0; y3 < 8; ++y3, y4 += vSub) {
-		for (x3 = 0, x4 = 0; x3 < 8; ++x3, x4 += hSub) {
-		  p2 = p1 + x4;
-		  for (y5 = 0; y5 < vSub; ++y5) {
-		    for (x5 = 0; x5 < hSub; ++x5) {
-		      p2[x5] = dataOut[i] & 0xff;
-		    }
-		    p2 += bufWidth;
-		  }
-		  ++i;
-		}
-		p1 += bufWidth * vSub;
-	      }
-	    }
-	  }
-	}
-      }
+// Copy the coefficients in <data> back into coefBuf (the inverse of
+// loadCoefs).
+void DCTStream::storeCoefs(int cc, int idx, int data[64]) {
+  short *p;
+  Guint *nz;
+  int w, h, i, j;
 
-      // color space conversion
-      if (colorXform) {
-	// convert YCbCr to RGB
-	if (numComps == 3) {
-	  for (y2 = 0; y2 < mcuHeight; ++y2) {
-	    p0 = &frameBuf[0][(y1+y2) * bufWidth + x1];
-	    p1 = &frameBuf[1][(y1+y2) * bufWidth + x1];
-	    p2 = &frameBuf[2][(y1+y2) * bufWidth + x1];
-	    for (x2 = 0; x2 < mcuWidth; ++x2) {
-	      pY = *p0;
-	      pCb = *p1 - 128;
-	      pCr = *p2 - 128;
-	      pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	      *p0++ = dctClip(pR);
-	      pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr +
-		    32768) >> 16;
-	      *p1++ = dctClip(pG);
-	      pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	      *p2++ = dctClip(pB);
-	    }
-	  }
-	// convert YCbCrK to CMYK (K is passed through unchanged)
-	} else if (numComps == 4) {
-	  for (y2 = 0; y2 < mcuHeight; ++y2) {
-	    p0 = &frameBuf[0][(y1+y2) * bufWidth + x1];
-	    p1 = &frameBuf[1][(y1+y2) * bufWidth + x1];
-	    p2 = &frameBuf[2][(y1+y2) * bufWidth + x1];
-	    for (x2 = 0; x2 < mcuWidth; ++x2) {
-	      pY = *p0;
-	      pCb = *p1 - 128;
-	      pCr = *p2 - 128;
-	      pR = ((pY << 16) + dctCrToR * pCr + 32768) >> 16;
-	      *p0++ = 255 - dctClip(pR);
-	      pG = ((pY << 16) + dctCbToG * pCb + dctCrToG * pCr +
-		    32768) >> 16;
-	      *p1++ = 255 - dctClip(pG);
-	      pB = ((pY << 16) + dctCbToB * pCb + 32768) >> 16;
-	      *p2++ = 255 - dctClip(pB);
-	    }
-	  }
-	}
-      }
+  if (!nzBuf[cc]) {
+    p = &coefBuf[cc][idx * 64];
+    for (i = 0; i < 64; ++i) {
+      p[i] = (short)data[i];
+    }
+    return;
+  }
+  nz = &nzBuf[cc][idx * 2];
+  nz[0] = nz[1] = 0;
+  for (i = 0; i < 64; ++i) {
+    if (data[i]) {
+      nz[i >> 5] |= 1U << (i & 31);
+    }
+  }
+  w = compInfo[cc].duWidth;
+  h = compInfo[cc].duHeight;
+  p = &coefBuf[cc][idx * w * h];
+  for (i = 0; i < h; ++i) {
+    for (j = 0; j < w; ++j) {
+      p[i*w + j] = (short)data[i*8 + j];
     }
   }
 }
@@ -3452,6 +3556,16 @@ void DCTStream::transformDataUnit(Gushort *quantTable,
   Gushort *q;
   int i;
 
+  // vectorized version: dequant here, then let the kernel do the rest
+  if (dctGetSIMDLevel() != dctSIMDNone) {
+    for (i = 0; i < 64; ++i) {
+      dataIn[i] = dataIn[i] * quantTable[i] * idctScaleMat[i];
+    }
+    dataIn[0] += 1 << 12;	// rounding bias
+    dctInverseTransform(dataIn, dataOut);
+    return;
+  }
+
   // dequant; inverse DCT on rows
   for (i = 0; i < 64; i += 8) {
     p = dataIn + i;
@@ -3643,16 +3757,109 @@ void DCTStream::transformDataUnit(Gushort *quantTable,
   }
 }
 
+// Transform one data unit for reduced-resolution decoding, producing
+// a <w> x <h> block, where <w> and <h> are 8, 4, 2, or 1.  Each output
+// sample is the inverse DCT evaluated at the center of the
+// corresponding group of full-resolution pixels, using only the
+// lowest-frequency <w> x <h> coefficients -- which is a close
+// approximation to averaging the full-resolution pixels.  The 1x1 case
+// is the DC coefficient, with the same rounding as transformDataUnit.
+void DCTStream::transformDataUnitReduced(Gushort *quantTable,
+					 int dataIn[64], Guchar dataOut[64],
+					 int w, int h) {
+  int tmp[64];
+  const int *matW, *matH;
+  int t, i, j, k;
+
+  if (w == 1 && h == 1) {
+    dataOut[0] = dctClip(128 + ((dataIn[0] * quantTable[0] + 4) >> 3));
+    return;
+  }
+  matW = idctReducedMat(w);
+  matH = idctReducedMat(h);
+
+  // dequant; inverse DCT on rows (result has 3 fractional bits)
+  for (i = 0; i < h; ++i) {
+    for (j = 0; j < w; ++j) {
+      t = 0;
+      for (k = 0; k < w; ++k) {
+	t += dataIn[i*8 + k] * quantTable[i*8 + k] * matW[j*w + k];
+      }
+      tmp[i*w + j] = t >> 8;
+    }
+  }
+
+  // inverse DCT on columns; convert to 8-bit integers
+  for (j = 0; j < w; ++j) {
+    for (i = 0; i < h; ++i) {
+      t = 0;
+      for (k = 0; k < h; ++k) {
+	t += tmp[k*w + j] * matH[i*h + k];
+      }
+      dataOut[i*w + j] = dctClip(128 + ((t + (1 << 13)) >> 14));
+    }
+  }
+}
+
+// Set each component's data unit size for decoding at 1/2^<r>
+// resolution.  As with libjpeg's DCT_scaled_size, a subsampled
+// component gets a larger data unit (up to 8x8), rather than having
+// its reduced samples replicated, as far as its sampling factors
+// allow.  This must be called before mcuWidth/mcuHeight are converted
+// to output pixels.
+void DCTStream::setDataUnitSizes(int r) {
+  DCTCompInfo *comp;
+  int hMax, vMax, m, i;
+
+  hMax = mcuWidth / 8;
+  vMax = mcuHeight / 8;
+  for (i = 0; i < numComps; ++i) {
+    comp = &compInfo[i];
+    comp->duWidth = 8 >> r;
+    for (m = 2;
+	 comp->duWidth < 8 && hMax % (comp->hSample * m) == 0;
+	 m <<= 1) {
+      comp->duWidth <<= 1;
+    }
+    comp->duHeight = 8 >> r;
+    for (m = 2;
+	 comp->duHeight < 8 && vMax % (comp->vSample * m) == 0;
+	 m <<= 1) {
+      comp->duHeight <<= 1;
+    }
+  }
+}
+
 int DCTStream::readHuffSym(DCTHuffTable *table) {
   Gushort code;
   int bit;
-  int codeBits;
+  int codeBits, look, len;
 
+  // fast path: look up the next dctHuffLookupBits bits in the table
+  if (inputBits < dctHuffLookupBits) {
+    fillInputBuf();
+  }
+  if (inputBits >= dctHuffLookupBits) {
+    look = (inputBuf >> (inputBits - dctHuffLookupBits))
+           & (dctHuffLookupSize - 1);
+    if ((len = table->lookupLen[look])) {
+      inputBits -= len;
+      return table->lookupSym[look];
+    }
+  }
+
+  // slow path: long codes, bad codes, and codes that run into a
+  // marker or the end of the stream
+  if (inputBits < 16) {
+    fillInputBuf();
+  }
   code = 0;
   codeBits = 0;
   do {
     // add a bit to the code
-    if ((bit = readBit()) == EOF) {
+    if (inputBits > 0) {
+      bit = (inputBuf >> --inputBits) & 1;
+    } else if ((bit = readBit()) == EOF) {
       return 9999;
     }
     code = (code << 1) + bit;
@@ -3676,6 +3883,18 @@ int DCTStream::readAmp(int size) {
   int amp, bit;
   int bits;
 
+  if (size > 0 && size <= 16) {
+    if (inputBits < size) {
+      fillInputBuf();
+    }
+    if (inputBits >= size) {
+      inputBits -= size;
+      amp = (inputBuf >> inputBits) & ((1 << size) - 1);
+      if (amp < (1 << (size - 1)))
+	amp -= (1 << size) - 1;
+      return amp;
+    }
+  }
   amp = 0;
   for (bits = 0; bits < size; ++bits) {
     if ((bit = readBit()) == EOF)
@@ -3711,6 +3930,25 @@ int DCTStream::readBit() {
   return bit;
 }
 
+// Add whole bytes to the input buffer, up to 32 bits.  This stops at
+// 0xff bytes (without reading them) -- stuffed zero bytes and markers
+// are handled by readBit().  Any bytes read here that are left
+// unused at the end of a scan or restart interval are skipped by
+// readMarker() anyway.
+inline void DCTStream::fillInputBuf() {
+  int c;
+
+  while (inputBits <= 24) {
+    c = str->lookChar();
+    if (c == EOF || c == 0xff) {
+      break;
+    }
+    str->getChar();
+    inputBuf = (inputBuf << 8) | c;
+    inputBits += 8;
+  }
+}
+
 GBool DCTStream::readHeader() {
   GBool doScan;
   int n;
@@ -3959,6 +4197,37 @@ GBool DCTStream::readQuantTables() {
   return gTrue;
 }
 
+// Fill in the lookup table used by readHuffSym()'s fast path.  Each
+// entry is found by running the bit-at-a-time search over the
+// corresponding prefix, so the two paths always agree; prefixes that
+// don't resolve to a valid symbol within dctHuffLookupBits bits are
+// left to the slow path.
+static void buildHuffLookupTable(DCTHuffTable *tbl) {
+  Gushort code;
+  int look, codeBits, i;
+
+  for (look = 0; look < dctHuffLookupSize; ++look) {
+    tbl->lookupLen[look] = 0;
+    tbl->lookupSym[look] = 0;
+    code = 0;
+    for (codeBits = 1; codeBits <= dctHuffLookupBits; ++codeBits) {
+      code = (Gushort)((code << 1) +
+		       ((look >> (dctHuffLookupBits - codeBits)) & 1));
+      if (code < tbl->firstCode[codeBits]) {
+	break;
+      }
+      if (code - tbl->firstCode[codeBits] < tbl->numCodes[codeBits]) {
+	i = tbl->firstSym[codeBits] + (code - tbl->firstCode[codeBits]);
+	if (i < 256) {
+	  tbl->lookupLen[look] = (Guchar)codeBits;
+	  tbl->lookupSym[look] = tbl->sym[i];
+	}
+	break;
+      }
+    }
+  }
+}
+
 GBool DCTStream::readHuffmanTables() {
   DCTHuffTable *tbl;
   int length;
@@ -4001,6 +4270,7 @@ GBool DCTStream::readHuffmanTables() {
     for (i = 0; i < sym; ++i)
       tbl->sym[i] = str->getChar();
     length -= sym;
+    buildHuffLookupTable(tbl);
   }
   return gTrue;
 }
@@ -4089,6 +4359,64 @@ GBool DCTStream::readTrailer() {
   return gTrue;
 }
 
+// Read up to the frame header, and check that the sampling factors
+// allow reduced-resolution decoding (see reset()).  Errors are left
+// for reset() to report.
+GBool DCTStream::checkReducedSampling() {
+  int hSample[4], vSample[4];
+  int hMax, vMax, nComps, n, c, i;
+
+  while (1) {
+    c = readMarker();
+    if (c == 0xc0 || c == 0xc1 || c == 0xc2) { // SOF0, SOF1, SOF2
+      break;
+    }
+    if (c == EOF || c == 0xd9 || c == 0xda) { // EOI, SOS
+      return gFalse;
+    }
+    if (c != 0xd8) { // SOI
+      if ((n = read16()) < 2) {
+	return gFalse;
+      }
+      str->discardChars(n - 2);
+    }
+  }
+  read16(); // length
+  str->getChar(); // precision
+  read16(); // height
+  read16(); // width
+  nComps = str->getChar();
+  if (nComps <= 0 || nComps > 4) {
+    return gFalse;
+  }
+  if (nComps == 1) {
+    return gTrue;
+  }
+  hMax = vMax = 0;
+  for (i = 0; i < nComps; ++i) {
+    str->getChar(); // id
+    c = str->getChar();
+    hSample[i] = (c >> 4) & 0x0f;
+    vSample[i] = c & 0x0f;
+    str->getChar(); // quant table
+    if (hSample[i] < 1 || vSample[i] < 1) {
+      return gFalse;
+    }
+    if (hSample[i] > hMax) {
+      hMax = hSample[i];
+    }
+    if (vSample[i] > vMax) {
+      vMax = vSample[i];
+    }
+  }
+  for (i = 0; i < nComps; ++i) {
+    if (hMax % hSample[i] || vMax % vSample[i]) {
+      return gFalse;
+    }
+  }
+  return gTrue;
+}
+
 int DCTStream::readMarker() {
   int c;
 
@@ -4115,6 +4443,33 @@ int DCTStream::read16() {
 
 #endif // HAVE_JPEGLIB
 
+int DCTStream::reduceResolution(int reductionA) {
+#if !HAVE_JPEGLIB
+  GBool ok;
+#endif
+
+  if (reductionA > 3 - reduction) {
+    reductionA = 3 - reduction;
+  }
+  if (reductionA <= 0) {
+    return 0;
+  }
+#if !HAVE_JPEGLIB
+  // the header of an inline image can't be read twice
+  if (str->getBaseStream()->isEmbedStream()) {
+    return 0;
+  }
+  str->reset();
+  ok = checkReducedSampling();
+  str->close();
+  if (!ok) {
+    return 0;
+  }
+#endif
+  reduction += reductionA;
+  return reductionA;
+}
+
 GString *DCTStream::getPSFilter(int psLevel, const char *indent) {
   GString *s;
 
@@ -4136,6 +4491,8 @@ GBool DCTStream::isBinary(GBool last) {
 // FlateStream
 //------------------------------------------------------------------------
 
+#if !HAVE_ZLIB
+
 int FlateStream::codeLenCodeMap[flateMaxCodeLenCodes] = {
   16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
 };
@@ -4207,563 +4564,17 @@ FlateDecode FlateStream::distDecode[flateMaxDistCodes] = {
   {13, 24577}
 };
 
-static FlateCode flateFixedLitCodeTabCodes[512] = {
-  {7, 0x0100},
-  {8, 0x0050},
-  {8, 0x0010},
-  {8, 0x0118},
-  {7, 0x0110},
-  {8, 0x0070},
-  {8, 0x0030},
-  {9, 0x00c0},
-  {7, 0x0108},
-  {8, 0x0060},
-  {8, 0x0020},
-  {9, 0x00a0},
-  {8, 0x0000},
-  {8, 0x0080},
-  {8, 0x0040},
-  {9, 0x00e0},
-  {7, 0x0104},
-  {8, 0x0058},
-  {8, 0x0018},
-  {9, 0x0090},
-  {7, 0x0114},
-  {8, 0x0078},
-  {8, 0x0038},
-  {9, 0x00d0},
-  {7, 0x010c},
-  {8, 0x0068},
-  {8, 0x0028},
-  {9, 0x00b0},
-  {8, 0x0008},
-  {8, 0x0088},
-  {8, 0x0048},
-  {9, 0x00f0},
-  {7, 0x0102},
-  {8, 0x0054},
-  {8, 0x0014},
-  {8, 0x011c},
-  {7, 0x0112},
-  {8, 0x0074},
-  {8, 0x0034},
-  {9, 0x00c8},
-  {7, 0x010a},
-  {8, 0x0064},
-  {8, 0x0024},
-  {9, 0x00a8},
-  {8, 0x0004},
-  {8, 0x0084},
-  {8, 0x0044},
-  {9, 0x00e8},
-  {7, 0x0106},
-  {8, 0x005c},
-  {8, 0x001c},
-  {9, 0x0098},
-  {7, 0x0116},
-  {8, 0x007c},
-  {8, 0x003c},
-  {9, 0x00d8},
-  {7, 0x010e},
-  {8, 0x006c},
-  {8, 0x002c},
-  {9, 0x00b8},
-  {8, 0x000c},
-  {8, 0x008c},
-  {8, 0x004c},
-  {9, 0x00f8},
-  {7, 0x0101},
-  {8, 0x0052},
-  {8, 0x0012},
-  {8, 0x011a},
-  {7, 0x0111},
-  {8, 0x0072},
-  {8, 0x0032},
-  {9, 0x00c4},
-  {7, 0x0109},
-  {8, 0x0062},
-  {8, 0x0022},
-  {9, 0x00a4},
-  {8, 0x0002},
-  {8, 0x0082},
-  {8, 0x0042},
-  {9, 0x00e4},
-  {7, 0x0105},
-  {8, 0x005a},
-  {8, 0x001a},
-  {9, 0x0094},
-  {7, 0x0115},
-  {8, 0x007a},
-  {8, 0x003a},
-  {9, 0x00d4},
-  {7, 0x010d},
-  {8, 0x006a},
-  {8, 0x002a},
-  {9, 0x00b4},
-  {8, 0x000a},
-  {8, 0x008a},
-  {8, 0x004a},
-  {9, 0x00f4},
-  {7, 0x0103},
-  {8, 0x0056},
-  {8, 0x0016},
-  {8, 0x011e},
-  {7, 0x0113},
-  {8, 0x0076},
-  {8, 0x0036},
-  {9, 0x00cc},
-  {7, 0x010b},
-  {8, 0x0066},
-  {8, 0x0026},
-  {9, 0x00ac},
-  {8, 0x0006},
-  {8, 0x0086},
-  {8, 0x0046},
-  {9, 0x00ec},
-  {7, 0x0107},
-  {8, 0x005e},
-  {8, 0x001e},
-  {9, 0x009c},
-  {7, 0x0117},
-  {8, 0x007e},
-  {8, 0x003e},
-  {9, 0x00dc},
-  {7, 0x010f},
-  {8, 0x006e},
-  {8, 0x002e},
-  {9, 0x00bc},
-  {8, 0x000e},
-  {8, 0x008e},
-  {8, 0x004e},
-  {9, 0x00fc},
-  {7, 0x0100},
-  {8, 0x0051},
-  {8, 0x0011},
-  {8, 0x0119},
-  {7, 0x0110},
-  {8, 0x0071},
-  {8, 0x0031},
-  {9, 0x00c2},
-  {7, 0x0108},
-  {8, 0x0061},
-  {8, 0x0021},
-  {9, 0x00a2},
-  {8, 0x0001},
-  {8, 0x0081},
-  {8, 0x0041},
-  {9, 0x00e2},
-  {7, 0x0104},
-  {8, 0x0059},
-  {8, 0x0019},
-  {9, 0x0092},
-  {7, 0x0114},
-  {8, 0x0079},
-  {8, 0x0039},
-  {9, 0x00d2},
-  {7, 0x010c},
-  {8, 0x0069},
-  {8, 0x0029},
-  {9, 0x00b2},
-  {8, 0x0009},
-  {8, 0x0089},
-  {8, 0x0049},
-  {9, 0x00f2},
-  {7, 0x0102},
-  {8, 0x0055},
-  {8, 0x0015},
-  {8, 0x011d},
-  {7, 0x0112},
-  {8, 0x0075},
-  {8, 0x0035},
-  {9, 0x00ca},
-  {7, 0x010a},
-  {8, 0x0065},
-  {8, 0x0025},
-  {9, 0x00aa},
-  {8, 0x0005},
-  {8, 0x0085},
-  {8, 0x0045},
-  {9, 0x00ea},
-  {7, 0x0106},
-  {8, 0x005d},
-  {8, 0x001d},
-  {9, 0x009a},
-  {7, 0x0116},
-  {8, 0x007d},
-  {8, 0x003d},
-  {9, 0x00da},
-  {7, 0x010e},
-  {8, 0x006d},
-  {8, 0x002d},
-  {9, 0x00ba},
-  {8, 0x000d},
-  {8, 0x008d},
-  {8, 0x004d},
-  {9, 0x00fa},
-  {7, 0x0101},
-  {8, 0x0053},
-  {8, 0x0013},
-  {8, 0x011b},
-  {7, 0x0111},
-  {8, 0x0073},
-  {8, 0x0033},
-  {9, 0x00c6},
-  {7, 0x0109},
-  {8, 0x0063},
-  {8, 0x0023},
-  {9, 0x00a6},
-  {8, 0x0003},
-  {8, 0x0083},
-  {8, 0x0043},
-  {9, 0x00e6},
-  {7, 0x0105},
-  {8, 0x005b},
-  {8, 0x001b},
-  {9, 0x0096},
-  {7, 0x0115},
-  {8, 0x007b},
-  {8, 0x003b},
-  {9, 0x00d6},
-  {7, 0x010d},
-  {8, 0x006b},
-  {8, 0x002b},
-  {9, 0x00b6},
-  {8, 0x000b},
-  {8, 0x008b},
-  {8, 0x004b},
-  {9, 0x00f6},
-  {7, 0x0103},
-  {8, 0x0057},
-  {8, 0x0017},
-  {8, 0x011f},
-  {7, 0x0113},
-  {8, 0x0077},
-  {8, 0x0037},
-  {9, 0x00ce},
-  {7, 0x010b},
-  {8, 0x0067},
-  {8, 0x0027},
-  {9, 0x00ae},
-  {8, 0x0007},
-  {8, 0x0087},
-  {8, 0x0047},
-  {9, 0x00ee},
-  {7, 0x0107},
-  {8, 0x005f},
-  {8, 0x001f},
-  {9, 0x009e},
-  {7, 0x0117},
-  {8, 0x007f},
-  {8, 0x003f},
-  {9, 0x00de},
-  {7, 0x010f},
-  {8, 0x006f},
-  {8, 0x002f},
-  {9, 0x00be},
-  {8, 0x000f},
-  {8, 0x008f},
-  {8, 0x004f},
-  {9, 0x00fe},
-  {7, 0x0100},
-  {8, 0x0050},
-  {8, 0x0010},
-  {8, 0x0118},
-  {7, 0x0110},
-  {8, 0x0070},
-  {8, 0x0030},
-  {9, 0x00c1},
-  {7, 0x0108},
-  {8, 0x0060},
-  {8, 0x0020},
-  {9, 0x00a1},
-  {8, 0x0000},
-  {8, 0x0080},
-  {8, 0x0040},
-  {9, 0x00e1},
-  {7, 0x0104},
-  {8, 0x0058},
-  {8, 0x0018},
-  {9, 0x0091},
-  {7, 0x0114},
-  {8, 0x0078},
-  {8, 0x0038},
-  {9, 0x00d1},
-  {7, 0x010c},
-  {8, 0x0068},
-  {8, 0x0028},
-  {9, 0x00b1},
-  {8, 0x0008},
-  {8, 0x0088},
-  {8, 0x0048},
-  {9, 0x00f1},
-  {7, 0x0102},
-  {8, 0x0054},
-  {8, 0x0014},
-  {8, 0x011c},
-  {7, 0x0112},
-  {8, 0x0074},
-  {8, 0x0034},
-  {9, 0x00c9},
-  {7, 0x010a},
-  {8, 0x0064},
-  {8, 0x0024},
-  {9, 0x00a9},
-  {8, 0x0004},
-  {8, 0x0084},
-  {8, 0x0044},
-  {9, 0x00e9},
-  {7, 0x0106},
-  {8, 0x005c},
-  {8, 0x001c},
-  {9, 0x0099},
-  {7, 0x0116},
-  {8, 0x007c},
-  {8, 0x003c},
-  {9, 0x00d9},
-  {7, 0x010e},
-  {8, 0x006c},
-  {8, 0x002c},
-  {9, 0x00b9},
-  {8, 0x000c},
-  {8, 0x008c},
-  {8, 0x004c},
-  {9, 0x00f9},
-  {7, 0x0101},
-  {8, 0x0052},
-  {8, 0x0012},
-  {8, 0x011a},
-  {7, 0x0111},
-  {8, 0x0072},
-  {8, 0x0032},
-  {9, 0x00c5},
-  {7, 0x0109},
-  {8, 0x0062},
-  {8, 0x0022},
-  {9, 0x00a5},
-  {8, 0x0002},
-  {8, 0x0082},
-  {8, 0x0042},
-  {9, 0x00e5},
-  {7, 0x0105},
-  {8, 0x005a},
-  {8, 0x001a},
-  {9, 0x0095},
-  {7, 0x0115},
-  {8, 0x007a},
-  {8, 0x003a},
-  {9, 0x00d5},
-  {7, 0x010d},
-  {8, 0x006a},
-  {8, 0x002a},
-  {9, 0x00b5},
-  {8, 0x000a},
-  {8, 0x008a},
-  {8, 0x004a},
-  {9, 0x00f5},
-  {7, 0x0103},
-  {8, 0x0056},
-  {8, 0x0016},
-  {8, 0x011e},
-  {7, 0x0113},
-  {8, 0x0076},
-  {8, 0x0036},
-  {9, 0x00cd},
-  {7, 0x010b},
-  {8, 0x0066},
-  {8, 0x0026},
-  {9, 0x00ad},
-  {8, 0x0006},
-  {8, 0x0086},
-  {8, 0x0046},
-  {9, 0x00ed},
-  {7, 0x0107},
-  {8, 0x005e},
-  {8, 0x001e},
-  {9, 0x009d},
-  {7, 0x0117},
-  {8, 0x007e},
-  {8, 0x003e},
-  {9, 0x00dd},
-  {7, 0x010f},
-  {8, 0x006e},
-  {8, 0x002e},
-  {9, 0x00bd},
-  {8, 0x000e},
-  {8, 0x008e},
-  {8, 0x004e},
-  {9, 0x00fd},
-  {7, 0x0100},
-  {8, 0x0051},
-  {8, 0x0011},
-  {8, 0x0119},
-  {7, 0x0110},
-  {8, 0x0071},
-  {8, 0x0031},
-  {9, 0x00c3},
-  {7, 0x0108},
-  {8, 0x0061},
-  {8, 0x0021},
-  {9, 0x00a3},
-  {8, 0x0001},
-  {8, 0x0081},
-  {8, 0x0041},
-  {9, 0x00e3},
-  {7, 0x0104},
-  {8, 0x0059},
-  {8, 0x0019},
-  {9, 0x0093},
-  {7, 0x0114},
-  {8, 0x0079},
-  {8, 0x0039},
-  {9, 0x00d3},
-  {7, 0x010c},
-  {8, 0x0069},
-  {8, 0x0029},
-  {9, 0x00b3},
-  {8, 0x0009},
-  {8, 0x0089},
-  {8, 0x0049},
-  {9, 0x00f3},
-  {7, 0x0102},
-  {8, 0x0055},
-  {8, 0x0015},
-  {8, 0x011d},
-  {7, 0x0112},
-  {8, 0x0075},
-  {8, 0x0035},
-  {9, 0x00cb},
-  {7, 0x010a},
-  {8, 0x0065},
-  {8, 0x0025},
-  {9, 0x00ab},
-  {8, 0x0005},
-  {8, 0x0085},
-  {8, 0x0045},
-  {9, 0x00eb},
-  {7, 0x0106},
-  {8, 0x005d},
-  {8, 0x001d},
-  {9, 0x009b},
-  {7, 0x0116},
-  {8, 0x007d},
-  {8, 0x003d},
-  {9, 0x00db},
-  {7, 0x010e},
-  {8, 0x006d},
-  {8, 0x002d},
-  {9, 0x00bb},
-  {8, 0x000d},
-  {8, 0x008d},
-  {8, 0x004d},
-  {9, 0x00fb},
-  {7, 0x0101},
-  {8, 0x0053},
-  {8, 0x0013},
-  {8, 0x011b},
-  {7, 0x0111},
-  {8, 0x0073},
-  {8, 0x0033},
-  {9, 0x00c7},
-  {7, 0x0109},
-  {8, 0x0063},
-  {8, 0x0023},
-  {9, 0x00a7},
-  {8, 0x0003},
-  {8, 0x0083},
-  {8, 0x0043},
-  {9, 0x00e7},
-  {7, 0x0105},
-  {8, 0x005b},
-  {8, 0x001b},
-  {9, 0x0097},
-  {7, 0x0115},
-  {8, 0x007b},
-  {8, 0x003b},
-  {9, 0x00d7},
-  {7, 0x010d},
-  {8, 0x006b},
-  {8, 0x002b},
-  {9, 0x00b7},
-  {8, 0x000b},
-  {8, 0x008b},
-  {8, 0x004b},
-  {9, 0x00f7},
-  {7, 0x0103},
-  {8, 0x0057},
-  {8, 0x0017},
-  {8, 0x011f},
-  {7, 0x0113},
-  {8, 0x0077},
-  {8, 0x0037},
-  {9, 0x00cf},
-  {7, 0x010b},
-  {8, 0x0067},
-  {8, 0x0027},
-  {9, 0x00af},
-  {8, 0x0007},
-  {8, 0x0087},
-  {8, 0x0047},
-  {9, 0x00ef},
-  {7, 0x0107},
-  {8, 0x005f},
-  {8, 0x001f},
-  {9, 0x009f},
-  {7, 0x0117},
-  {8, 0x007f},
-  {8, 0x003f},
-  {9, 0x00df},
-  {7, 0x010f},
-  {8, 0x006f},
-  {8, 0x002f},
-  {9, 0x00bf},
-  {8, 0x000f},
-  {8, 0x008f},
-  {8, 0x004f},
-  {9, 0x00ff}
-};
+// Sizes of the primary lookup tables (see compHuffmanCodes).
+#define flateLitPrimaryBits     10
+#define flateDistPrimaryBits     8
+#define flateCodeLenPrimaryBits  7
 
-FlateHuffmanTab FlateStream::fixedLitCodeTab = {
-  flateFixedLitCodeTabCodes, 9
-};
+// Longest string that can be produced by a single length/distance
+// pair -- readCompressed stops when there is less than this much room
+// in the output buffer.
+#define flateMaxMatch          258
 
-static FlateCode flateFixedDistCodeTabCodes[32] = {
-  {5, 0x0000},
-  {5, 0x0010},
-  {5, 0x0008},
-  {5, 0x0018},
-  {5, 0x0004},
-  {5, 0x0014},
-  {5, 0x000c},
-  {5, 0x001c},
-  {5, 0x0002},
-  {5, 0x0012},
-  {5, 0x000a},
-  {5, 0x001a},
-  {5, 0x0006},
-  {5, 0x0016},
-  {5, 0x000e},
-  {0, 0x0000},
-  {5, 0x0001},
-  {5, 0x0011},
-  {5, 0x0009},
-  {5, 0x0019},
-  {5, 0x0005},
-  {5, 0x0015},
-  {5, 0x000d},
-  {5, 0x001d},
-  {5, 0x0003},
-  {5, 0x0013},
-  {5, 0x000b},
-  {5, 0x001b},
-  {5, 0x0007},
-  {5, 0x0017},
-  {5, 0x000f},
-  {0, 0x0000}
-};
-
-FlateHuffmanTab FlateStream::fixedDistCodeTab = {
-  flateFixedDistCodeTabCodes, 5
-};
+#endif // !HAVE_ZLIB
 
 FlateStream::FlateStream(Stream *strA, int predictor, int columns,
 			 int colors, int bits):
@@ -4777,18 +4588,27 @@ FlateStream::FlateStream(Stream *strA, int predictor, int columns,
   } else {
     pred = NULL;
   }
+  inlineImage = str->isEmbedStream();
+#if HAVE_ZLIB
+  zStreamOpen = gFalse;
+#else
   litCodeTab.codes = NULL;
+  litCodeTab.size = 0;
   distCodeTab.codes = NULL;
+  distCodeTab.size = 0;
+#endif
   memset(buf, 0, flateWindow);
 }
 
 FlateStream::~FlateStream() {
-  if (litCodeTab.codes != fixedLitCodeTab.codes) {
-    gfree(litCodeTab.codes);
-  }
-  if (distCodeTab.codes != fixedDistCodeTab.codes) {
-    gfree(distCodeTab.codes);
+#if HAVE_ZLIB
+  if (zStreamOpen) {
+    inflateEnd(&zStream);
   }
+#else
+  gfree(litCodeTab.codes);
+  gfree(distCodeTab.codes);
+#endif
   if (pred) {
     delete pred;
   }
@@ -4810,9 +4630,18 @@ void FlateStream::reset() {
 
   index = 0;
   remain = 0;
+  inPos = inLen = 0;
+#if HAVE_ZLIB
+  if (zStreamOpen) {
+    inflateEnd(&zStream);
+    zStreamOpen = gFalse;
+  }
+#else
   codeBuf = 0;
   codeSize = 0;
   compressedBlock = gFalse;
+  fixedCodes = gFalse;
+#endif
   endOfBlock = gTrue;
   eof = gTrue;
 
@@ -4842,6 +4671,21 @@ void FlateStream::reset() {
     return;
   }
 
+#if HAVE_ZLIB
+  // the zlib header has already been checked, so zlib is used in raw
+  // inflate mode
+  zStream.zalloc = Z_NULL;
+  zStream.zfree = Z_NULL;
+  zStream.opaque = Z_NULL;
+  zStream.next_in = Z_NULL;
+  zStream.avail_in = 0;
+  if (inflateInit2(&zStream, -15) != Z_OK) {
+    error(errInternal, -1, "Couldn't initialize zlib");
+    return;
+  }
+  zStreamOpen = gTrue;
+#endif
+
   eof = gFalse;
 }
 
@@ -4892,7 +4736,7 @@ int FlateStream::getRawChar() {
 }
 
 int FlateStream::getBlock(char *blk, int size) {
-  int n;
+  int n, nn;
 
   if (pred) {
     return pred->getBlock(blk, size);
@@ -4905,12 +4749,19 @@ int FlateStream::getBlock(char *blk, int size) {
 	break;
       }
       readSome();
+      continue;
+    }
+    nn = size - n;
+    if (nn > remain) {
+      nn = remain;
     }
-    while (remain && n < size) {
-      blk[n++] = buf[index];
-      index = (index + 1) & flateMask;
-      --remain;
+    if (nn > flateWindow - index) {
+      nn = flateWindow - index;
     }
+    memcpy(blk + n, buf + index, nn);
+    index = (index + nn) & flateMask;
+    remain -= nn;
+    n += nn;
   }
   return n;
 }
@@ -4932,85 +4783,232 @@ GBool FlateStream::isBinary(GBool last) {
   return str->isBinary(gTrue);
 }
 
-void FlateStream::readSome() {
-  int code1, code2;
-  int len, dist;
-  int i, j, k;
+// Refill the input buffer.  Returns the number of bytes read, or 0 at
+// end of input.
+int FlateStream::fillInBuf() {
   int c;
 
+  // for inline images, we need to read one byte at a time so we don't
+  // read past the end of the input data
+  if (inlineImage) {
+    if ((c = str->getChar()) == EOF) {
+      inLen = 0;
+    } else {
+      inBuf[0] = (Guchar)c;
+      inLen = 1;
+    }
+  } else {
+    inLen = str->getBlock((char *)inBuf, flateInBufSize);
+    if (inLen < 0) {
+      inLen = 0;
+    }
+  }
+  inPos = 0;
+  return inLen;
+}
+
+#if HAVE_ZLIB
+
+// Decode as much data as will fit in the (empty) output buffer.  zlib
+// keeps its own history window, so the output always starts at the
+// beginning of the buffer.
+void FlateStream::readSome() {
+  int ret;
+
+  if (!zStreamOpen) {
+    eof = gTrue;
+    return;
+  }
+  index = 0;
+  zStream.next_out = buf;
+  zStream.avail_out = flateWindow;
+  while (zStream.avail_out == flateWindow) {
+    if (zStream.avail_in == 0) {
+      if (!fillInBuf()) {
+	error(errSyntaxError, getPos(),
+	      "Unexpected end of file in flate stream");
+	eof = gTrue;
+	break;
+      }
+      zStream.next_in = inBuf;
+      zStream.avail_in = inLen;
+    }
+    ret = inflate(&zStream, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END) {
+      eof = gTrue;
+      break;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+      error(errSyntaxError, getPos(), "Bad data in flate stream: {0:s}",
+	    zStream.msg ? zStream.msg : "unknown error");
+      eof = gTrue;
+      break;
+    }
+  }
+  remain = flateWindow - (int)zStream.avail_out;
+}
+
+#else // HAVE_ZLIB
+
+void FlateStream::readSome() {
   if (endOfBlock) {
     if (!startBlock())
       return;
   }
-
   if (compressedBlock) {
-    if ((code1 = getHuffmanCodeWord(&litCodeTab)) == EOF)
+    readCompressed();
+  } else {
+    readUncompressed();
+  }
+}
+
+// Decode symbols from a compressed block until the end of the block,
+// or until the output buffer is (nearly) full.
+void FlateStream::readCompressed() {
+  FlateCode *code;
+  int sym, len, dist, n, w, src, k;
+
+  w = (index + remain) & flateMask;
+  while (remain <= flateWindow - flateMaxMatch) {
+
+    // literal/length code
+    if (codeSize < 25) {
+      fillCodeBuf();
+    }
+    code = &litCodeTab.codes[codeBuf & ((1 << litCodeTab.primaryBits) - 1)];
+    if (code->op == flateCodeSubTable) {
+      code = &litCodeTab.codes[code->val +
+			       ((codeBuf >> litCodeTab.primaryBits) &
+				((1 << code->val2) - 1))];
+    }
+    if (code->len == 0 || code->len > codeSize) {
+      // near the end of the input, there may not be enough bits
+      // left for both halves of a literal pair
+      if (code->op == flateCodeLitPair && code->len1 <= codeSize) {
+	codeBuf >>= code->len1;
+	codeSize -= code->len1;
+	buf[w] = (Guchar)code->val;
+	w = (w + 1) & flateMask;
+	++remain;
+	continue;
+      }
       goto err;
-    if (code1 < 256) {
-      buf[index] = code1;
-      remain = 1;
-    } else if (code1 == 256) {
+    }
+    codeBuf >>= code->len;
+    codeSize -= code->len;
+    if (code->op == flateCodeLitPair) {
+      buf[w] = (Guchar)code->val;
+      w = (w + 1) & flateMask;
+      buf[w] = (Guchar)code->val2;
+      w = (w + 1) & flateMask;
+      remain += 2;
+      continue;
+    }
+    sym = code->val;
+    if (sym < 256) {
+      buf[w] = (Guchar)sym;
+      w = (w + 1) & flateMask;
+      ++remain;
+      continue;
+    }
+    if (sym == 256) {
       endOfBlock = gTrue;
-      remain = 0;
-    } else {
-      code1 -= 257;
-      code2 = lengthDecode[code1].bits;
-      if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
-	goto err;
-      len = lengthDecode[code1].first + code2;
-      if ((code1 = getHuffmanCodeWord(&distCodeTab)) == EOF)
-	goto err;
-      code2 = distDecode[code1].bits;
-      if (code2 > 0 && (code2 = getCodeWord(code2)) == EOF)
+      return;
+    }
+
+    // length/distance pair
+    sym -= 257;
+    len = lengthDecode[sym].first;
+    if ((n = lengthDecode[sym].bits) > 0) {
+      if ((k = getCodeWord(n)) == EOF) {
 	goto err;
-      dist = distDecode[code1].first + code2;
-      i = index;
-      j = (index - dist) & flateMask;
-      for (k = 0; k < len; ++k) {
-	buf[i] = buf[j];
-	i = (i + 1) & flateMask;
-	j = (j + 1) & flateMask;
       }
-      remain = len;
+      len += k;
     }
-
-  } else {
-    len = (blockLen < flateWindow) ? blockLen : flateWindow;
-    for (i = 0, j = index; i < len; ++i, j = (j + 1) & flateMask) {
-      if ((c = str->getChar()) == EOF) {
-	endOfBlock = eof = gTrue;
-	break;
+    if ((sym = getHuffmanCodeWord(&distCodeTab)) == EOF) {
+      goto err;
+    }
+    dist = distDecode[sym].first;
+    if ((n = distDecode[sym].bits) > 0) {
+      if ((k = getCodeWord(n)) == EOF) {
+	goto err;
+      }
+      dist += k;
+    }
+
+    // copy the string -- use memcpy/memset when the source and
+    // destination don't wrap around the end of the buffer
+    src = (w - dist) & flateMask;
+    if (w + len <= flateWindow && src + len <= flateWindow &&
+	(src + len <= w || w + len <= src)) {
+      memcpy(buf + w, buf + src, len);
+      w = (w + len) & flateMask;
+    } else if (dist == 1 && w + len <= flateWindow) {
+      memset(buf + w, buf[src], len);
+      w = (w + len) & flateMask;
+    } else {
+      for (k = 0; k < len; ++k) {
+	buf[w] = buf[src];
+	w = (w + 1) & flateMask;
+	src = (src + 1) & flateMask;
       }
-      buf[j] = c & 0xff;
     }
-    remain = i;
-    blockLen -= len;
-    if (blockLen == 0)
-      endOfBlock = gTrue;
+    remain += len;
   }
-
   return;
 
 err:
   error(errSyntaxError, getPos(), "Unexpected end of file in flate stream");
   endOfBlock = eof = gTrue;
-  remain = 0;
 }
 
-GBool FlateStream::startBlock() {
-  int blockHdr;
-  int c;
-  int check;
+// Copy data from an uncompressed block until the end of the block, or
+// until the output buffer is full.
+void FlateStream::readUncompressed() {
+  int w, n;
 
-  // free the code tables from the previous block
-  if (litCodeTab.codes != fixedLitCodeTab.codes) {
-    gfree(litCodeTab.codes);
+  w = (index + remain) & flateMask;
+
+  // any whole bytes left in the bit buffer come first
+  while (blockLen > 0 && codeSize >= 8 && remain < flateWindow) {
+    buf[w] = (Guchar)(codeBuf & 0xff);
+    codeBuf >>= 8;
+    codeSize -= 8;
+    w = (w + 1) & flateMask;
+    ++remain;
+    --blockLen;
   }
-  litCodeTab.codes = NULL;
-  if (distCodeTab.codes != fixedDistCodeTab.codes) {
-    gfree(distCodeTab.codes);
+
+  while (blockLen > 0 && remain < flateWindow) {
+    if (inPos >= inLen && !fillInBuf()) {
+      endOfBlock = eof = gTrue;
+      return;
+    }
+    n = inLen - inPos;
+    if (n > blockLen) {
+      n = blockLen;
+    }
+    if (n > flateWindow - remain) {
+      n = flateWindow - remain;
+    }
+    if (n > flateWindow - w) {
+      n = flateWindow - w;
+    }
+    memcpy(buf + w, inBuf + inPos, n);
+    inPos += n;
+    w = (w + n) & flateMask;
+    remain += n;
+    blockLen -= n;
   }
-  distCodeTab.codes = NULL;
+
+  if (blockLen == 0) {
+    endOfBlock = gTrue;
+  }
+}
+
+GBool FlateStream::startBlock() {
+  int blockHdr;
+  int check;
 
   // read block header
   blockHdr = getCodeWord(3);
@@ -5021,28 +5019,23 @@ GBool FlateStream::startBlock() {
   // uncompressed block
   if (blockHdr == 0) {
     compressedBlock = gFalse;
-    if ((c = str->getChar()) == EOF)
+    // skip to a byte boundary
+    codeBuf >>= codeSize & 7;
+    codeSize -= codeSize & 7;
+    if ((blockLen = getCodeWord(16)) == EOF)
       goto err;
-    blockLen = c & 0xff;
-    if ((c = str->getChar()) == EOF)
-      goto err;
-    blockLen |= (c & 0xff) << 8;
-    if ((c = str->getChar()) == EOF)
-      goto err;
-    check = c & 0xff;
-    if ((c = str->getChar()) == EOF)
+    if ((check = getCodeWord(16)) == EOF)
       goto err;
-    check |= (c & 0xff) << 8;
     if (check != (~blockLen & 0xffff))
       error(errSyntaxError, getPos(),
 	    "Bad uncompressed block length in flate stream");
-    codeBuf = 0;
-    codeSize = 0;
 
   // compressed block with fixed codes
   } else if (blockHdr == 1) {
     compressedBlock = gTrue;
-    loadFixedCodes();
+    if (!fixedCodes) {
+      loadFixedCodes();
+    }
 
   // compressed block with dynamic codes
   } else if (blockHdr == 2) {
@@ -5066,10 +5059,28 @@ err:
 }
 
 void FlateStream::loadFixedCodes() {
-  litCodeTab.codes = fixedLitCodeTab.codes;
-  litCodeTab.maxLen = fixedLitCodeTab.maxLen;
-  distCodeTab.codes = fixedDistCodeTab.codes;
-  distCodeTab.maxLen = fixedDistCodeTab.maxLen;
+  int i;
+
+  for (i = 0; i < 144; ++i) {
+    codeLengths[i] = 8;
+  }
+  for (i = 144; i < 256; ++i) {
+    codeLengths[i] = 9;
+  }
+  for (i = 256; i < 280; ++i) {
+    codeLengths[i] = 7;
+  }
+  for (i = 280; i < flateMaxLitCodes; ++i) {
+    codeLengths[i] = 8;
+  }
+  compHuffmanCodes(codeLengths, flateMaxLitCodes, &litCodeTab,
+		   flateLitPrimaryBits, gTrue);
+  for (i = 0; i < flateMaxDistCodes; ++i) {
+    codeLengths[i] = 5;
+  }
+  compHuffmanCodes(codeLengths, flateMaxDistCodes, &distCodeTab,
+		   flateDistPrimaryBits, gFalse);
+  fixedCodes = gTrue;
 }
 
 GBool FlateStream::readDynamicCodes() {
@@ -5081,7 +5092,9 @@ GBool FlateStream::readDynamicCodes() {
   int len, repeat, code;
   int i;
 
+  fixedCodes = gFalse;
   codeLenCodeTab.codes = NULL;
+  codeLenCodeTab.size = 0;
 
   // read lengths
   if ((numLitCodes = getCodeWord(5)) == EOF) {
@@ -5111,7 +5124,8 @@ GBool FlateStream::readDynamicCodes() {
       goto err;
     }
   }
-  compHuffmanCodes(codeLenCodeLengths, flateMaxCodeLenCodes, &codeLenCodeTab);
+  compHuffmanCodes(codeLenCodeLengths, flateMaxCodeLenCodes, &codeLenCodeTab,
+		   flateCodeLenPrimaryBits, gFalse);
 
   // build the literal and distance code tables
   len = 0;
@@ -5160,8 +5174,10 @@ GBool FlateStream::readDynamicCodes() {
       codeLengths[i++] = len = code;
     }
   }
-  compHuffmanCodes(codeLengths, numLitCodes, &litCodeTab);
-  compHuffmanCodes(codeLengths + numLitCodes, numDistCodes, &distCodeTab);
+  compHuffmanCodes(codeLengths, numLitCodes, &litCodeTab,
+		   flateLitPrimaryBits, gTrue);
+  compHuffmanCodes(codeLengths + numLitCodes, numDistCodes, &distCodeTab,
+		   flateDistPrimaryBits, gFalse);
 
   gfree(codeLenCodeTab.codes);
   return gTrue;
@@ -5173,68 +5189,165 @@ err:
 }
 
 // Convert an array <lengths> of <n> lengths, in value order, into a
-// Huffman code lookup table.
-void FlateStream::compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab) {
-  int tabSize, len, code, code2, skip, val, i, t;
-
-  // find max code length
-  tab->maxLen = 0;
+// Huffman code lookup table.  Codes of up to <primaryBits> bits are
+// decoded with a single lookup in the primary table; each longer code
+// goes through a sub-table, indexed by the bits following the first
+// <primaryBits>.  If <litPairs> is set, primary table entries for a
+// literal which is followed (within <primaryBits> bits) by another
+// literal decode both literals at once.
+void FlateStream::compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab,
+				   int primaryBits, GBool litPairs) {
+  int count[flateMaxHuffman + 1];
+  int revCodes[flateMaxLitCodes];
+  int subBits[1 << flateLitPrimaryBits];
+  int subOffset[1 << flateLitPrimaryBits];
+  FlateCode *code, *code2;
+  int maxLen, pBits, pSize, tabSize, len, nextCode, prefix, val, i, t;
+
+  // count the codes of each length
+  for (len = 0; len <= flateMaxHuffman; ++len) {
+    count[len] = 0;
+  }
+  maxLen = 0;
   for (val = 0; val < n; ++val) {
-    if (lengths[val] > tab->maxLen) {
-      tab->maxLen = lengths[val];
+    if ((len = lengths[val]) > 0) {
+      ++count[len];
+      if (len > maxLen) {
+	maxLen = len;
+      }
     }
   }
-
-  // allocate the table
-  tabSize = 1 << tab->maxLen;
-  tab->codes = (FlateCode *)gmallocn(tabSize, sizeof(FlateCode));
-
-  // clear the table
-  for (i = 0; i < tabSize; ++i) {
-    tab->codes[i].len = 0;
-    tab->codes[i].val = 0;
+  pBits = maxLen < primaryBits ? maxLen : primaryBits;
+  if (pBits < 1) {
+    pBits = 1;
   }
+  pSize = 1 << pBits;
 
-  // build the table
-  for (len = 1, code = 0, skip = 2;
-       len <= tab->maxLen;
-       ++len, code <<= 1, skip <<= 1) {
+  // assign the (canonical) codes, and bit-reverse them, since the
+  // input bits are stored LSB first
+  for (len = 1, nextCode = 0; len <= flateMaxHuffman; ++len) {
     for (val = 0; val < n; ++val) {
       if (lengths[val] == len) {
-
-	// bit-reverse the code
-	code2 = 0;
-	t = code;
+	revCodes[val] = 0;
+	t = nextCode++;
 	for (i = 0; i < len; ++i) {
-	  code2 = (code2 << 1) | (t & 1);
+	  revCodes[val] = (revCodes[val] << 1) | (t & 1);
 	  t >>= 1;
 	}
+      }
+    }
+    nextCode <<= 1;
+  }
 
-	// fill in the table entries
-	for (i = code2; i < tabSize; i += skip) {
-	  tab->codes[i].len = (Gushort)len;
-	  tab->codes[i].val = (Gushort)val;
-	}
+  // lay out the sub-tables
+  for (prefix = 0; prefix < pSize; ++prefix) {
+    subBits[prefix] = 0;
+  }
+  for (val = 0; val < n; ++val) {
+    if ((len = lengths[val]) > pBits) {
+      prefix = revCodes[val] & (pSize - 1);
+      if (len - pBits > subBits[prefix]) {
+	subBits[prefix] = len - pBits;
+      }
+    }
+  }
+  tabSize = pSize;
+  for (prefix = 0; prefix < pSize; ++prefix) {
+    if (subBits[prefix]) {
+      subOffset[prefix] = tabSize;
+      tabSize += 1 << subBits[prefix];
+    }
+  }
 
-	++code;
+  // allocate and clear the table
+  if (tabSize > tab->size) {
+    gfree(tab->codes);
+    tab->codes = (FlateCode *)gmallocn(tabSize, sizeof(FlateCode));
+    tab->size = tabSize;
+  }
+  tab->primaryBits = pBits;
+  memset(tab->codes, 0, tabSize * sizeof(FlateCode));
+
+  // fill in the table entries
+  for (prefix = 0; prefix < pSize; ++prefix) {
+    if (subBits[prefix]) {
+      code = &tab->codes[prefix];
+      code->op = flateCodeSubTable;
+      code->val = (Gushort)subOffset[prefix];
+      code->val2 = (Gushort)subBits[prefix];
+    }
+  }
+  for (val = 0; val < n; ++val) {
+    if ((len = lengths[val]) == 0) {
+      continue;
+    }
+    if (len <= pBits) {
+      for (i = revCodes[val]; i < pSize; i += 1 << len) {
+	code = &tab->codes[i];
+	code->len = (Guchar)len;
+	code->op = flateCodeSymbol;
+	code->val = (Gushort)val;
+      }
+    } else {
+      prefix = revCodes[val] & (pSize - 1);
+      for (i = revCodes[val] >> pBits;
+	   i < (1 << subBits[prefix]);
+	   i += 1 << (len - pBits)) {
+	code = &tab->codes[subOffset[prefix] + i];
+	code->len = (Guchar)len;
+	code->op = flateCodeSymbol;
+	code->val = (Gushort)val;
       }
     }
   }
-}
 
-int FlateStream::getHuffmanCodeWord(FlateHuffmanTab *tab) {
-  FlateCode *code;
-  int c;
+  // merge literal pairs -- entry i >> len is always still a single
+  // symbol when entry i is processed, because i >> len < i
+  if (litPairs) {
+    for (i = pSize - 1; i >= 0; --i) {
+      code = &tab->codes[i];
+      if (code->op != flateCodeSymbol || code->len == 0 ||
+	  code->val >= 256 || code->len >= pBits) {
+	continue;
+      }
+      code2 = &tab->codes[i >> code->len];
+      if (code2->op != flateCodeSymbol || code2->len == 0 ||
+	  code2->val >= 256 || code->len + code2->len > pBits) {
+	continue;
+      }
+      code->op = flateCodeLitPair;
+      code->len1 = code->len;
+      code->len = (Guchar)(code->len + code2->len);
+      code->val2 = code2->val;
+    }
+  }
+}
 
-  while (codeSize < tab->maxLen) {
-    if ((c = str->getChar()) == EOF) {
+// Refill the bit buffer so that it contains at least 25 bits, unless
+// the end of the input has been reached.
+inline void FlateStream::fillCodeBuf() {
+  while (codeSize <= 24) {
+    if (inPos >= inLen && !fillInBuf()) {
       break;
     }
-    codeBuf |= (c & 0xff) << codeSize;
+    codeBuf |= (Guint)inBuf[inPos++] << codeSize;
     codeSize += 8;
   }
-  code = &tab->codes[codeBuf & ((1 << tab->maxLen) - 1)];
-  if (codeSize == 0 || codeSize < code->len || code->len == 0) {
+}
+
+int FlateStream::getHuffmanCodeWord(FlateHuffmanTab *tab) {
+  FlateCode *code;
+
+  if (codeSize < flateMaxHuffman) {
+    fillCodeBuf();
+  }
+  code = &tab->codes[codeBuf & ((1 << tab->primaryBits) - 1)];
+  if (code->op == flateCodeSubTable) {
+    code = &tab->codes[code->val +
+		       ((codeBuf >> tab->primaryBits) &
+			((1 << code->val2) - 1))];
+  }
+  if (code->len == 0 || code->len > codeSize) {
     return EOF;
   }
   codeBuf >>= code->len;
@@ -5245,18 +5358,20 @@ int FlateStream::getHuffmanCodeWord(FlateHuffmanTab *tab) {
 int FlateStream::getCodeWord(int bits) {
   int c;
 
-  while (codeSize < bits) {
-    if ((c = str->getChar()) == EOF)
+  if (codeSize < bits) {
+    fillCodeBuf();
+    if (codeSize < bits) {
       return EOF;
-    codeBuf |= (c & 0xff) << codeSize;
-    codeSize += 8;
+    }
   }
-  c = codeBuf & ((1 << bits) - 1);
+  c = (int)(codeBuf & ((1 << bits) - 1));
   codeBuf >>= bits;
   codeSize -= bits;
   return c;
 }
 
+#endif // HAVE_ZLIB
+
 //------------------------------------------------------------------------
 // EOFStream
 //------------------------------------------------------------------------
@@ -20,12 +20,16 @@
 #include <jpeglib.h>
 #include <setjmp.h>
 #endif
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include "gtypes.h"
 #include "gfile.h"
 #include "Object.h"
 
 class BaseStream;
 class SharedFile;
+class GMappedFile;
 
 //------------------------------------------------------------------------
 
@@ -335,6 +339,51 @@ private:
   GFileOffset bufPos;
 };
 
+//------------------------------------------------------------------------
+// MMapStream
+//
+// A BaseStream that reads directly from a read-only memory mapping of
+// a file.  Substreams share the mapping, and reads don't take any
+// locks or copy into an intermediate buffer.  Positions and the
+// limited/length semantics are the same as FileStream.
+//------------------------------------------------------------------------
+
+class MMapStream: public BaseStream {
+public:
+
+  // Adds a reference to <mapA>.
+  MMapStream(GMappedFile *mapA, GFileOffset startA, GBool limitedA,
+	     GFileOffset lengthA, Object *dictA);
+  virtual ~MMapStream();
+  virtual Stream *copy();
+  virtual Stream *makeSubStream(GFileOffset startA, GBool limitedA,
+				GFileOffset lengthA, Object *dictA);
+  virtual StreamKind getKind() { return strFile; }
+  virtual void reset();
+  virtual int getChar()
+    { return (bufPtr < bufEnd) ? (*bufPtr++ & 0xff) : EOF; }
+  virtual int lookChar()
+    { return (bufPtr < bufEnd) ? (*bufPtr & 0xff) : EOF; }
+  virtual int getBlock(char *blk, int size);
+  virtual GFileOffset getPos() { return (GFileOffset)(bufPtr - data); }
+  virtual void setPos(GFileOffset pos, int dir = 0);
+  virtual GFileOffset getStart() { return start; }
+  virtual void moveStart(int delta);
+
+private:
+
+  void setEnd();
+
+  GMappedFile *map;
+  const char *data;		// start of the mapped file
+  GFileOffset fileSize;		// size of the mapped file
+  GFileOffset start;
+  GBool limited;
+  GFileOffset length;
+  const char *bufPtr;		// current read position
+  const char *bufEnd;		// end of the readable region
+};
+
 //------------------------------------------------------------------------
 // MemStream
 //------------------------------------------------------------------------
@@ -554,6 +603,19 @@ public:
   virtual GString *getPSFilter(int psLevel, const char *indent);
   virtual GBool isBinary(GBool last = gTrue);
 
+  // Read the next row, and return its changing elements, rather than
+  // packed bits: 0 <= c[0] <= c[1] <= ... <= c[n-1] = columns, where
+  // the pixels in [0, c[0]) are white, [c[0], c[1]) are black, and so
+  // on (runs may be empty).
+  // (With BlackIs1 = false, white pixels are returned as 1 bits by
+  // getChar.)  Sets *<changes> to c, and returns n, or 0 at the end
+  // of the stream.  The array is valid until the next call.  This
+  // skips any part of the current row not yet read with getChar.
+  int readRowChanges(int **changes);
+
+  int getColumns() { return columns; }
+  GBool getBlackIs1() { return black; }
+
 private:
 
   int encoding;			// 'K' parameter
@@ -614,6 +676,9 @@ struct DCTCompInfo {
   int hSample, vSample;		// horiz/vert sampling resolutions
   int quantTable;		// quantization table number
   int prevDC;			// DC coefficient accumulator
+  int duWidth, duHeight;	// size of a transformed data unit, in
+				//   samples (8x8 unless decoding at
+				//   reduced resolution)
 };
 
 struct DCTScanInfo {
@@ -627,11 +692,17 @@ struct DCTScanInfo {
 };
 
 // DCT Huffman decoding table
+#define dctHuffLookupBits 9
+#define dctHuffLookupSize (1 << dctHuffLookupBits)
 struct DCTHuffTable {
   Guchar firstSym[17];		// first symbol for this bit length
   Gushort firstCode[17];	// first code for this bit length
   Gushort numCodes[17];		// number of codes of this bit length
   Guchar sym[256];		// symbols
+  Guchar lookupLen[dctHuffLookupSize];	// code length for each
+					//   dctHuffLookupBits-bit prefix
+					//   (0 = use the slow path)
+  Guchar lookupSym[dctHuffLookupSize];	// symbol for each prefix
 };
 
 #endif // HAVE_JPEGLIB
@@ -652,8 +723,18 @@ public:
   virtual GBool isBinary(GBool last = gTrue);
   Stream *getRawStream() { return str; }
 
+  // Decode at a (further) 1/2^<reductionA> of the resolution, up to a
+  // total of 1/8, producing a ceil(w / 2^r) x ceil(h / 2^r) image.
+  // Returns the additional reduction actually applied, which is 0 if
+  // the image can't be decoded at reduced resolution (e.g., because
+  // of its sampling factors).  This must be called before reset(),
+  // and applies until the stream is closed.
+  int reduceResolution(int reductionA);
+
 private:
 
+  int reduction;		// log2(reduction in resolution)
+
 #if HAVE_JPEGLIB
 
   int colorXform;		// color transform: -1 = unspecified
@@ -684,7 +765,7 @@ private:
   GBool interleaved;		// set if in interleaved mode
   int width, height;		// image size
   int mcuWidth, mcuHeight;	// size of min coding unit, in data units
-  int bufWidth, bufHeight;	// frameBuf size
+  int bufWidth;			// rowBuf width
   DCTCompInfo compInfo[4];	// info for each component
   DCTScanInfo scanInfo;		// info for the current scan
   int numComps;			// number of components in image
@@ -703,12 +784,22 @@ private:
   Guchar *rowBuf;
   Guchar *rowBufPtr;		// current position within rowBuf
   Guchar *rowBufEnd;		// end of valid data in rowBuf
-  int *frameBuf[4];		// buffer for frame (progressive mode)
-  int comp, x, y;		// current position within image/MCU
+  short *coefBuf[4];		// quantized coefficients for each data
+				//   unit (progressive / non-interleaved
+				//   mode)
+  Guint *nzBuf[4];		// nonzero flags for the coefficients
+				//   not kept in coefBuf (two words per
+				//   data unit), or NULL if all are kept
+				//   (coefBuf keeps the lowest duWidth x
+				//   duHeight coefficients)
+  int blocksPerRow[4];		// number of data units per row in coefBuf
+  int coefReduction;		// log2(resolution reduction) of the
+				//   data units in coefBuf / readMCURow
+  int y;			// current position within image
   int restartCtr;		// MCUs left until restart
   int restartMarker;		// next restart marker
   int eobRun;			// number of EOBs left in the current run
-  int inputBuf;			// input buffer for variable length codes
+  Guint inputBuf;		// input buffer for variable length codes
   int inputBits;		// number of valid bits in input buffer
 
   void restart();
@@ -720,12 +811,18 @@ private:
   GBool readProgressiveDataUnit(DCTHuffTable *dcHuffTable,
 				DCTHuffTable *acHuffTable,
 				int *prevDC, int data[64]);
-  void decodeImage();
+  void loadCoefs(int cc, int idx, int data[64]);
+  void storeCoefs(int cc, int idx, int data[64]);
   void transformDataUnit(Gushort *quantTable,
 			 int dataIn[64], Guchar dataOut[64]);
+  void transformDataUnitReduced(Gushort *quantTable,
+				int dataIn[64], Guchar dataOut[64],
+				int w, int h);
+  void setDataUnitSizes(int r);
   int readHuffSym(DCTHuffTable *table);
   int readAmp(int size);
   int readBit();
+  void fillInputBuf();
   GBool readHeader();
   GBool readBaselineSOF();
   GBool readProgressiveSOF();
@@ -736,6 +833,7 @@ private:
   GBool readJFIFMarker();
   GBool readAdobeMarker();
   GBool readTrailer();
+  GBool checkReducedSampling();
   int readMarker();
   int read16();
 
@@ -748,6 +846,10 @@ private:
 
 #define flateWindow          32768    // buffer size
 #define flateMask            (flateWindow-1)
+#define flateInBufSize        4096    // input buffer size
+
+#if !HAVE_ZLIB
+
 #define flateMaxHuffman         15    // max Huffman code length
 #define flateMaxCodeLenCodes    19    // max # code length codes
 #define flateMaxLitCodes       288    // max # literal codes
@@ -755,13 +857,30 @@ private:
 
 // Huffman code table entry
 struct FlateCode {
-  Gushort len;			// code length, in bits
-  Gushort val;			// value represented by this code
+  Guchar len;			// code length, in bits (total length of
+				//   both codes for a literal pair); 0 for
+				//   an invalid code
+  Guchar op;			// flateCodeSymbol, flateCodeLitPair,
+				//   or flateCodeSubTable
+  Guchar len1;			// length of the first code of a literal
+				//   pair
+  Gushort val;			// value represented by this code, first
+				//   literal of a pair, or sub-table offset
+  Gushort val2;			// second literal of a pair, or number of
+				//   sub-table index bits
 };
 
+#define flateCodeSymbol   0
+#define flateCodeLitPair  1
+#define flateCodeSubTable 2
+
+// Two-level lookup table: the first (1 << primaryBits) entries are
+// indexed by the next primaryBits input bits; longer codes go
+// through a sub-table.
 struct FlateHuffmanTab {
   FlateCode *codes;
-  int maxLen;
+  int size;			// allocated size of codes
+  int primaryBits;
 };
 
 // Decoding info for length and distance code words
@@ -770,6 +889,8 @@ struct FlateDecode {
   int first;			// first length/distance
 };
 
+#endif // !HAVE_ZLIB
+
 class FlateStream: public FilterStream {
 public:
 
@@ -792,16 +913,33 @@ private:
   Guchar buf[flateWindow];	// output data buffer
   int index;			// current index into output buffer
   int remain;			// number valid bytes in output buffer
-  int codeBuf;			// input buffer
+  Guchar inBuf[flateInBufSize];	// input buffer
+  int inPos, inLen;		// current position in / length of inBuf
+  GBool inlineImage;		// set if the input is an inline image --
+				//   don't read past the end of the data
+  GBool endOfBlock;		// set when end of block is reached
+  GBool eof;			// set when end of stream is reached
+
+  void readSome();
+  int fillInBuf();
+
+#if HAVE_ZLIB
+
+  z_stream zStream;		// zlib decompressor
+  GBool zStreamOpen;		// set if zStream needs to be freed
+
+#else // HAVE_ZLIB
+
+  Guint codeBuf;		// input bit buffer
   int codeSize;			// number of bits in input buffer
   int				// literal and distance code lengths
     codeLengths[flateMaxLitCodes + flateMaxDistCodes];
   FlateHuffmanTab litCodeTab;	// literal code table
   FlateHuffmanTab distCodeTab;	// distance code table
   GBool compressedBlock;	// set if reading a compressed block
+  GBool fixedCodes;		// set if the code tables hold the fixed
+				//   codes
   int blockLen;			// remaining length of uncompressed block
-  GBool endOfBlock;		// set when end of block is reached
-  GBool eof;			// set when end of stream is reached
 
   static int			// code length code reordering
     codeLenCodeMap[flateMaxCodeLenCodes];
@@ -809,18 +947,19 @@ private:
     lengthDecode[flateMaxLitCodes-257];
   static FlateDecode		// distance decoding info
     distDecode[flateMaxDistCodes];
-  static FlateHuffmanTab	// fixed literal code table
-    fixedLitCodeTab;
-  static FlateHuffmanTab	// fixed distance code table
-    fixedDistCodeTab;
 
-  void readSome();
+  void readCompressed();
+  void readUncompressed();
   GBool startBlock();
   void loadFixedCodes();
   GBool readDynamicCodes();
-  void compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab);
+  void compHuffmanCodes(int *lengths, int n, FlateHuffmanTab *tab,
+			int primaryBits, GBool litPairs);
+  void fillCodeBuf();
   int getHuffmanCodeWord(FlateHuffmanTab *tab);
   int getCodeWord(int bits);
+
+#endif // HAVE_ZLIB
 };
 
 //------------------------------------------------------------------------
@@ -4956,6 +4956,12 @@ void TextOutputDev::generateBOM() {
   }
 }
 
+void TextOutputDev::writeText(const char *s, int len) {
+  if (outputStream) {
+    (*outputFunc)(outputStream, s, len);
+  }
+}
+
 void TextOutputDev::startPage(int pageNum, GfxState *state) {
   text->startPage(state);
 }
@@ -599,6 +599,11 @@ public:
   // Check if file was successfully created.
   virtual GBool isOk() { return ok; }
 
+  // Write <len> bytes of already-encoded text to the output stream.
+  // This is used to merge text generated by other TextOutputDev
+  // objects, e.g., when converting pages in parallel.
+  void writeText(const char *s, int len);
+
   //---- get info about output device
 
   // Does this device use upside-down coordinates?
@@ -16,10 +16,8 @@
 #include "gmempp.h"
 #include "GList.h"
 #include "GMutex.h"
-#ifdef _WIN32
-#  include <windows.h>
-#else
-#  include <pthread.h>
+#include "GThread.h"
+#ifndef _WIN32
 #  include <unistd.h>
 #endif
 #include "Object.h"
@@ -66,94 +64,6 @@ CachedTileDesc::~CachedTileDesc() {
   }
 }
 
-//------------------------------------------------------------------------
-// OS-dependent threading support code
-//
-// NB: This wrapper code is not meant to be general purpose.  Pthreads
-// condition objects are not equivalent to Windows event objects, in
-// general.
-//------------------------------------------------------------------------
-
-//-------------------- Windows --------------------
-#ifdef _WIN32
-
-typedef HANDLE GThreadID;
-typedef DWORD (WINAPI *GThreadFunc)(void *);
-#define GThreadReturn DWORD WINAPI
-
-static void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
-			  void *data) {
-  *thr = CreateThread(NULL, 0, threadFunc, data, 0, NULL);
-}
-   
-static void gJoinThread(GThreadID thr) {
-  WaitForSingleObject(thr, INFINITE);
-  CloseHandle(thr);
-}
-
-typedef HANDLE GCondition;
-
-static void gInitCondition(GCondition *c) {
-  *c = CreateEvent(NULL, TRUE, FALSE, NULL);
-}
-
-static void gDestroyCondition(GCondition *c) {
-  CloseHandle(*c);
-}
-
-static void gSignalCondition(GCondition *c) {
-  SetEvent(*c);
-}
-
-static void gClearCondition(GCondition *c) {
-  ResetEvent(*c);
-}
-
-static void gWaitCondition(GCondition *c, GMutex *m) {
-  LeaveCriticalSection(m);
-  WaitForSingleObject(*c, INFINITE);
-  EnterCriticalSection(m);
-}
-
-//-------------------- pthreads --------------------
-#else
-
-typedef pthread_t GThreadID;
-typedef void *(*GThreadFunc)(void *);
-#define GThreadReturn void*
-
-static void gCreateThread(GThreadID *thr, GThreadFunc threadFunc,
-			  void *data) {
-  pthread_create(thr, NULL, threadFunc, data);
-}
-
-static void gJoinThread(GThreadID thr) {
-  pthread_join(thr, NULL);
-}
-
-typedef pthread_cond_t GCondition;
-
-static void gInitCondition(GCondition *c) {
-  pthread_cond_init(c, NULL);
-}
-
-static void gDestroyCondition(GCondition *c) {
-  pthread_cond_destroy(c);
-}
-
-static void gSignalCondition(GCondition *c) {
-  pthread_cond_broadcast(c);
-}
-
-static void gClearCondition(GCondition *c) {
-}
-
-static void gWaitCondition(GCondition *c, GMutex *m) {
-  pthread_cond_wait(c, m);
-}
-
-#endif
-
 //------------------------------------------------------------------------
 // TileCacheThreadPool
 //------------------------------------------------------------------------
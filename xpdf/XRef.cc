@@ -20,6 +20,9 @@
 #include "gmem.h"
 #include "gmempp.h"
 #include "gfile.h"
+#if MULTITHREADED
+#include "GMutex.h"
+#endif
 #include "Object.h"
 #include "Stream.h"
 #include "Lexer.h"
@@ -27,6 +30,7 @@
 #include "Dict.h"
 #include "Error.h"
 #include "ErrorCodes.h"
+#include "GlobalParams.h"
 #include "XRef.h"
 
 //------------------------------------------------------------------------
@@ -34,6 +38,9 @@
 #define xrefSearchSize 1024	// read this many bytes at end of file
 				//   to look for 'startxref'
 
+#define xrefCacheStripes 16	// number of independently locked stripes
+				//   in the object and object stream caches
+
 //------------------------------------------------------------------------
 // Permission bits
 //------------------------------------------------------------------------
@@ -44,6 +51,44 @@
 #define permNotes    (1<<5)
 #define defPermFlags 0xfffc
 
+//------------------------------------------------------------------------
+
+// Per-entry overhead for an array or dictionary element.
+#define xrefCacheElemSize ((int)sizeof(Object) + 8)
+
+// Approximate number of bytes used by <obj>, not including the Object
+// itself.  Referenced objects aren't followed.
+static int objMemSize(Object *obj) {
+  Object obj2;
+  int n, i;
+
+  n = 0;
+  if (obj->isString()) {
+    n = obj->getString()->getLength();
+  } else if (obj->isName()) {
+    n = (int)strlen(obj->getName()) + 1;
+  } else if (obj->isArray()) {
+    for (i = 0; i < obj->arrayGetLength(); ++i) {
+      obj->arrayGetNF(i, &obj2);
+      n += xrefCacheElemSize + objMemSize(&obj2);
+      obj2.free();
+    }
+  } else if (obj->isDict()) {
+    for (i = 0; i < obj->dictGetLength(); ++i) {
+      obj->dictGetValNF(i, &obj2);
+      n += xrefCacheElemSize + objMemSize(&obj2);
+      obj2.free();
+    }
+  } else if (obj->isStream()) {
+    for (i = 0; i < obj->streamGetDict()->getLength(); ++i) {
+      obj->streamGetDict()->getValNF(i, &obj2);
+      n += xrefCacheElemSize + objMemSize(&obj2);
+      obj2.free();
+    }
+  }
+  return n;
+}
+
 //------------------------------------------------------------------------
 // XRefPosSet
 //------------------------------------------------------------------------
@@ -146,12 +191,16 @@ public:
   // object number <objNum>, generation 0.
   Object *getObject(int objIdx, int objNum, Object *obj);
 
+  // Approximate number of bytes used by the parsed objects.
+  int getMemSize() { return memSize; }
+
 private:
 
   int objStrNum;		// object number of the object stream
   int nObjects;			// number of objects in the stream
   Object *objs;			// the objects (length = nObjects)
   int *objNums;			// the object numbers (length = nObjects)
+  int memSize;			// approximate memory used
   GBool ok;
 };
 
@@ -167,6 +216,7 @@ ObjectStream::ObjectStream(XRef *xref, int objStrNumA) {
   nObjects = 0;
   objs = NULL;
   objNums = NULL;
+  memSize = 0;
   ok = gFalse;
 
   if (!xref->fetch(objStrNum, 0, &objStr)->isStream()) {
@@ -255,6 +305,7 @@ ObjectStream::ObjectStream(XRef *xref, int objStrNumA) {
     parser->getObj(&objs[i]);
     lexer->skipToEOF();
     delete parser;
+    memSize += (int)sizeof(Object) + (int)sizeof(int) + objMemSize(&objs[i]);
   }
 
   gfree(offsets);
@@ -287,6 +338,350 @@ Object *ObjectStream::getObject(int objIdx, int objNum, Object *obj) {
   return obj;
 }
 
+//------------------------------------------------------------------------
+// XRefCache
+//------------------------------------------------------------------------
+
+// The cache is split into independently locked stripes (selected by
+// object number), so that rendering threads sharing one XRef don't
+// all serialize on a single mutex.  Each stripe is a small hash table
+// plus an LRU list.  An entry holds either a parsed object (the
+// object cache) or an ObjectStream (the object stream cache).  The
+// cache is bounded both by entry count and by (approximate) memory
+// use; the limits are split evenly between the stripes.
+
+struct XRefCacheEntry {
+  int num;
+  int gen;
+  Object obj;			// cached object (object cache)
+  ObjectStream *objStr;		// cached object stream (object stream cache)
+  int memSize;			// approximate memory used by this entry
+  XRefCacheEntry *hashNext;	// next entry in the same hash bucket
+  XRefCacheEntry *prev;		// LRU list: previous (more recently used)
+  XRefCacheEntry *next;		// LRU list: next (less recently used)
+};
+
+struct XRefCacheStripe {
+  XRefCacheEntry **hashTab;	// hash buckets
+  XRefCacheEntry *head;		// most recently used entry
+  XRefCacheEntry *tail;		// least recently used entry
+  int nEntries;
+  int nBytes;			// total memSize of all entries
+  double hits;
+  double misses;
+#if MULTITHREADED
+  GMutex mutex;
+#endif
+};
+
+class XRefCache {
+public:
+
+  // Create a cache holding at most <maxEntriesA> entries, using at
+  // most (approximately) <maxBytesA> bytes (zero for either one
+  // disables caching), split into <nStripesA> stripes.
+  XRefCache(int maxEntriesA, int maxBytesA, int nStripesA);
+
+  ~XRefCache();
+
+  // Look up object <num, gen>.  If it is cached, copy it into <obj>
+  // and return true.
+  GBool getObject(int num, int gen, Object *obj);
+
+  // Add a copy of <obj> to the cache as object <num, gen>.
+  void addObject(int num, int gen, Object *obj);
+
+  // Copy the <objIdx>th object, which should be object number
+  // <objNum>, from object stream <objStrNum> into <obj>, loading
+  // the object stream if it isn't already cached.  Returns false if
+  // the object stream couldn't be loaded.
+  GBool getObjStrObject(XRef *xref, int objStrNum, int objIdx,
+			int objNum, Object *obj);
+
+  void getStats(XRefCacheStats *stats);
+
+private:
+
+  XRefCacheStripe *lockStripe(int num);
+  void unlockStripe(XRefCacheStripe *stripe);
+  int hash(int num, int gen)
+    { return ((num / nStripes) ^ (gen << 4)) & (hashSize - 1); }
+  XRefCacheEntry *find(XRefCacheStripe *stripe, int num, int gen);
+  XRefCacheEntry *insert(XRefCacheStripe *stripe, int num, int gen,
+			 int memSize);
+  void freeEntry(XRefCacheEntry *e);
+
+  XRefCacheStripe *stripes;
+  int nStripes;
+  int maxEntries;		// max entries in the whole cache
+  int stripeMaxEntries;		// max entries per stripe
+  int maxBytes;			// max memory used by the whole cache
+  int stripeMaxBytes;		// max memory used per stripe
+  int hashSize;			// number of hash buckets per stripe
+};
+
+XRefCache::XRefCache(int maxEntriesA, int maxBytesA, int nStripesA) {
+  int i;
+
+  maxEntries = maxEntriesA < 0 ? 0 : maxEntriesA;
+  maxBytes = maxBytesA < 0 ? 0 : maxBytesA;
+  if (!maxBytes) {
+    maxEntries = 0;
+  }
+  nStripes = nStripesA;
+  if (nStripes > maxEntries) {
+    nStripes = maxEntries;
+  }
+  if (nStripes < 1) {
+    nStripes = 1;
+  }
+  stripeMaxEntries = (maxEntries + nStripes - 1) / nStripes;
+  stripeMaxBytes = maxBytes / nStripes;
+  hashSize = 1;
+  while (hashSize < 2 * stripeMaxEntries && hashSize < 0x10000) {
+    hashSize <<= 1;
+  }
+  stripes = (XRefCacheStripe *)gmallocn(nStripes, sizeof(XRefCacheStripe));
+  for (i = 0; i < nStripes; ++i) {
+    stripes[i].hashTab = (XRefCacheEntry **)gmallocn(hashSize,
+						     sizeof(XRefCacheEntry *));
+    memset(stripes[i].hashTab, 0, hashSize * sizeof(XRefCacheEntry *));
+    stripes[i].head = stripes[i].tail = NULL;
+    stripes[i].nEntries = 0;
+    stripes[i].nBytes = 0;
+    stripes[i].hits = stripes[i].misses = 0;
+#if MULTITHREADED
+    gInitMutex(&stripes[i].mutex);
+#endif
+  }
+}
+
+XRefCache::~XRefCache() {
+  XRefCacheEntry *e, *next;
+  int i;
+
+  for (i = 0; i < nStripes; ++i) {
+    for (e = stripes[i].head; e; e = next) {
+      next = e->next;
+      freeEntry(e);
+    }
+    gfree(stripes[i].hashTab);
+#if MULTITHREADED
+    gDestroyMutex(&stripes[i].mutex);
+#endif
+  }
+  gfree(stripes);
+}
+
+XRefCacheStripe *XRefCache::lockStripe(int num) {
+  XRefCacheStripe *stripe;
+
+  stripe = &stripes[num % nStripes];
+#if MULTITHREADED
+  gLockMutex(&stripe->mutex);
+#endif
+  return stripe;
+}
+
+void XRefCache::unlockStripe(XRefCacheStripe *stripe) {
+#if MULTITHREADED
+  gUnlockMutex(&stripe->mutex);
+#endif
+}
+
+// Find an entry, and move it to the front of the LRU list.
+// NB: the stripe must be locked when calling this function.
+XRefCacheEntry *XRefCache::find(XRefCacheStripe *stripe, int num, int gen) {
+  XRefCacheEntry *e;
+
+  for (e = stripe->hashTab[hash(num, gen)]; e; e = e->hashNext) {
+    if (e->num == num && e->gen == gen) {
+      break;
+    }
+  }
+  if (!e) {
+    ++stripe->misses;
+    return NULL;
+  }
+  ++stripe->hits;
+  if (e != stripe->head) {
+    e->prev->next = e->next;
+    if (e->next) {
+      e->next->prev = e->prev;
+    } else {
+      stripe->tail = e->prev;
+    }
+    e->prev = NULL;
+    e->next = stripe->head;
+    stripe->head->prev = e;
+    stripe->head = e;
+  }
+  return e;
+}
+
+// Add a new (empty) entry, which will use <memSize> bytes, at the
+// front of the LRU list, evicting least recently used entries until
+// the new one fits.  The caller must check that <memSize> is no
+// larger than stripeMaxBytes.
+// NB: the stripe must be locked when calling this function.
+XRefCacheEntry *XRefCache::insert(XRefCacheStripe *stripe, int num, int gen,
+				  int memSize) {
+  XRefCacheEntry *e, **p;
+  int h;
+
+  while (stripe->tail &&
+	 (stripe->nEntries >= stripeMaxEntries ||
+	  stripe->nBytes > stripeMaxBytes - memSize)) {
+    e = stripe->tail;
+    for (p = &stripe->hashTab[hash(e->num, e->gen)];
+	 *p != e;
+	 p = &(*p)->hashNext) ;
+    *p = e->hashNext;
+    stripe->tail = e->prev;
+    if (stripe->tail) {
+      stripe->tail->next = NULL;
+    } else {
+      stripe->head = NULL;
+    }
+    stripe->nBytes -= e->memSize;
+    freeEntry(e);
+    --stripe->nEntries;
+  }
+  e = (XRefCacheEntry *)gmalloc(sizeof(XRefCacheEntry));
+  e->num = num;
+  e->gen = gen;
+  e->obj.initNull();
+  e->objStr = NULL;
+  e->memSize = memSize;
+  h = hash(num, gen);
+  e->hashNext = stripe->hashTab[h];
+  stripe->hashTab[h] = e;
+  e->prev = NULL;
+  e->next = stripe->head;
+  if (stripe->head) {
+    stripe->head->prev = e;
+  } else {
+    stripe->tail = e;
+  }
+  stripe->head = e;
+  ++stripe->nEntries;
+  stripe->nBytes += memSize;
+  return e;
+}
+
+void XRefCache::freeEntry(XRefCacheEntry *e) {
+  e->obj.free();
+  if (e->objStr) {
+    delete e->objStr;
+  }
+  gfree(e);
+}
+
+GBool XRefCache::getObject(int num, int gen, Object *obj) {
+  XRefCacheStripe *stripe;
+  XRefCacheEntry *e;
+
+  if (!maxEntries) {
+    return gFalse;
+  }
+  stripe = lockStripe(num);
+  if ((e = find(stripe, num, gen))) {
+    e->obj.copy(obj);
+  }
+  unlockStripe(stripe);
+  return e != NULL;
+}
+
+void XRefCache::addObject(int num, int gen, Object *obj) {
+  XRefCacheStripe *stripe;
+  XRefCacheEntry *e;
+  int memSize;
+
+  if (!maxEntries) {
+    return;
+  }
+  // don't let one huge object flush the whole stripe
+  memSize = (int)sizeof(XRefCacheEntry) + objMemSize(obj);
+  if (memSize > stripeMaxBytes) {
+    return;
+  }
+  stripe = lockStripe(num);
+  // another thread may have added this object in the meantime
+  for (e = stripe->hashTab[hash(num, gen)]; e; e = e->hashNext) {
+    if (e->num == num && e->gen == gen) {
+      break;
+    }
+  }
+  if (!e) {
+    e = insert(stripe, num, gen, memSize);
+    obj->copy(&e->obj);
+  }
+  unlockStripe(stripe);
+}
+
+// NB: the stripe lock is held while a new ObjectStream is parsed, so
+// that two threads never parse the same (shared) stream concurrently.
+GBool XRefCache::getObjStrObject(XRef *xref, int objStrNum, int objIdx,
+				 int objNum, Object *obj) {
+  XRefCacheStripe *stripe;
+  XRefCacheEntry *e;
+  ObjectStream *objStr;
+  int memSize;
+
+  if (!maxEntries) {
+    objStr = new ObjectStream(xref, objStrNum);
+    if (!objStr->isOk()) {
+      delete objStr;
+      return gFalse;
+    }
+    objStr->getObject(objIdx, objNum, obj);
+    delete objStr;
+    return gTrue;
+  }
+  stripe = lockStripe(objStrNum);
+  if (!(e = find(stripe, objStrNum, 0))) {
+    objStr = new ObjectStream(xref, objStrNum);
+    if (!objStr->isOk()) {
+      delete objStr;
+      unlockStripe(stripe);
+      return gFalse;
+    }
+    // object streams too large for the cache are used once and
+    // discarded
+    memSize = (int)sizeof(XRefCacheEntry) + objStr->getMemSize();
+    if (memSize > stripeMaxBytes) {
+      objStr->getObject(objIdx, objNum, obj);
+      delete objStr;
+      unlockStripe(stripe);
+      return gTrue;
+    }
+    e = insert(stripe, objStrNum, 0, memSize);
+    e->objStr = objStr;
+  }
+  e->objStr->getObject(objIdx, objNum, obj);
+  unlockStripe(stripe);
+  return gTrue;
+}
+
+void XRefCache::getStats(XRefCacheStats *stats) {
+  XRefCacheStripe *stripe;
+  int i;
+
+  stats->hits = stats->misses = 0;
+  stats->nEntries = 0;
+  stats->maxEntries = maxEntries;
+  stats->nBytes = 0;
+  stats->maxBytes = maxBytes;
+  for (i = 0; i < nStripes; ++i) {
+    stripe = lockStripe(i);
+    stats->hits += stripe->hits;
+    stats->misses += stripe->misses;
+    stats->nEntries += stripe->nEntries;
+    stats->nBytes += stripe->nBytes;
+    unlockStripe(stripe);
+  }
+}
+
 //------------------------------------------------------------------------
 // XRef
 //------------------------------------------------------------------------
@@ -307,22 +702,17 @@ XRef::XRef(BaseStream *strA, GBool repair) {
   xrefTablePosLen = 0;
   streamEnds = NULL;
   streamEndsLen = 0;
-  for (i = 0; i < objStrCacheSize; ++i) {
-    objStrs[i] = NULL;
-  }
+  objStrCache = new XRefCache(globalParams->getObjStrCacheSize(),
+			      globalParams->getObjStrCacheMem(),
+			      xrefCacheStripes);
 
   encrypted = gFalse;
   permFlags = defPermFlags;
   ownerPasswordOk = gFalse;
 
-  for (i = 0; i < xrefCacheSize; ++i) {
-    cache[i].num = -1;
-  }
-
-#if MULTITHREADED
-  gInitMutex(&objStrsMutex);
-  gInitMutex(&cacheMutex);
-#endif
+  cache = new XRefCache(globalParams->getXRefCacheSize(),
+			globalParams->getXRefCacheMem(), xrefCacheStripes);
+  jbig2GlobalsCache = NULL;
 
   str = strA;
   start = str->getStart();
@@ -381,13 +771,7 @@ XRef::XRef(BaseStream *strA, GBool repair) {
 }
 
 XRef::~XRef() {
-  int i;
-
-  for (i = 0; i < xrefCacheSize; ++i) {
-    if (cache[i].num >= 0) {
-      cache[i].obj.free();
-    }
-  }
+  delete cache;
   gfree(entries);
   trailerDict.free();
   if (xrefTablePos) {
@@ -396,15 +780,7 @@ XRef::~XRef() {
   if (streamEnds) {
     gfree(streamEnds);
   }
-  for (i = 0; i < objStrCacheSize; ++i) {
-    if (objStrs[i]) {
-      delete objStrs[i];
-    }
-  }
-#if MULTITHREADED
-  gDestroyMutex(&objStrsMutex);
-  gDestroyMutex(&cacheMutex);
-#endif
+  delete objStrCache;
 }
 
 // Read the 'startxref' position.
@@ -1022,8 +1398,6 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
   XRefEntry *e;
   Parser *parser;
   Object obj1, obj2, obj3;
-  XRefCacheEntry tmp;
-  int i, j;
 
   // check for bogus ref - this can happen in corrupted PDF files
   if (num < 0 || num >= size) {
@@ -1031,33 +1405,9 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
   }
 
   // check the cache
-#if MULTITHREADED
-  gLockMutex(&cacheMutex);
-#endif
-  if (cache[0].num == num && cache[0].gen == gen) {
-    cache[0].obj.copy(obj);
-#if MULTITHREADED
-    gUnlockMutex(&cacheMutex);
-#endif
+  if (cache->getObject(num, gen, obj)) {
     return obj;
   }
-  for (i = 1; i < xrefCacheSize; ++i) {
-    if (cache[i].num == num && cache[i].gen == gen) {
-      tmp = cache[i];
-      for (j = i; j > 0; --j) {
-	cache[j] = cache[j - 1];
-      }
-      cache[0] = tmp;
-      cache[0].obj.copy(obj);
-#if MULTITHREADED
-      gUnlockMutex(&cacheMutex);
-#endif
-      return obj;
-    }
-  }
-#if MULTITHREADED
-  gUnlockMutex(&cacheMutex);
-#endif
 
   e = &entries[num];
   switch (e->type) {
@@ -1111,23 +1461,9 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
     goto err;
   }
 
-  // put the new object in the cache, throwing away the oldest object
-  // currently in the cache
-#if MULTITHREADED
-  gLockMutex(&cacheMutex);
-#endif
-  if (cache[xrefCacheSize - 1].num >= 0) {
-    cache[xrefCacheSize - 1].obj.free();
-  }
-  for (i = xrefCacheSize - 1; i > 0; --i) {
-    cache[i] = cache[i - 1];
-  }
-  cache[0].num = num;
-  cache[0].gen = gen;
-  obj->copy(&cache[0].obj);
-#if MULTITHREADED
-  gUnlockMutex(&cacheMutex);
-#endif
+  // put the new object in the cache, throwing away the least recently
+  // used object in its stripe
+  cache->addObject(num, gen, obj);
 
   return obj;
 
@@ -1137,61 +1473,15 @@ Object *XRef::fetch(int num, int gen, Object *obj, int recursion) {
 
 GBool XRef::getObjectStreamObject(int objStrNum, int objIdx,
 				   int objNum, Object *obj) {
-  ObjectStream *objStr;
-
-#if MULTITHREADED
-  gLockMutex(&objStrsMutex);
-#endif
-  if (!(objStr = getObjectStream(objStrNum))) {
-    return gFalse;
-  }
-  objStr->getObject(objIdx, objNum, obj);
-#if MULTITHREADED
-  gUnlockMutex(&objStrsMutex);
-#endif
-  return gTrue;
+  return objStrCache->getObjStrObject(this, objStrNum, objIdx, objNum, obj);
 }
 
-// NB: objStrsMutex must be locked when calling this function.
-ObjectStream *XRef::getObjectStream(int objStrNum) {
-  ObjectStream *objStr;
-  int i, j;
-
-  // check the MRU entry in the cache
-  if (objStrs[0] && objStrs[0]->getObjStrNum() == objStrNum) {
-    objStr = objStrs[0];
-    return objStr;
-  }
-
-  // check the rest of the cache
-  for (i = 1; i < objStrCacheSize; ++i) {
-    if (objStrs[i] && objStrs[i]->getObjStrNum() == objStrNum) {
-      objStr = objStrs[i];
-      for (j = i; j > 0; --j) {
-	objStrs[j] = objStrs[j - 1];
-      }
-      objStrs[0] = objStr;
-      return objStr;
-    }
-  }
-
-  // load a new ObjectStream
-  objStr = new ObjectStream(this, objStrNum);
-  if (!objStr->isOk()) {
-    delete objStr;
-    return NULL;
-  }
-
-  // add to the cache
-  if (objStrs[objStrCacheSize - 1]) {
-    delete objStrs[objStrCacheSize - 1];
-  }
-  for (j = objStrCacheSize - 1; j > 0; --j) {
-    objStrs[j] = objStrs[j - 1];
-  }
-  objStrs[0] = objStr;
+void XRef::getObjectCacheStats(XRefCacheStats *stats) {
+  cache->getStats(stats);
+}
 
-  return objStr;
+void XRef::getObjStrCacheStats(XRefCacheStats *stats) {
+  objStrCache->getStats(stats);
 }
 
 Object *XRef::getDocInfo(Object *obj) {
@@ -18,15 +18,14 @@
 #include "gtypes.h"
 #include "gfile.h"
 #include "Object.h"
-#if MULTITHREADED
-#include "GMutex.h"
-#endif
 
 class Dict;
 class Stream;
 class Parser;
 class ObjectStream;
 class XRefPosSet;
+class XRefCache;
+class JBIG2GlobalsCache;
 
 //------------------------------------------------------------------------
 // XRef
@@ -44,16 +43,15 @@ struct XRefEntry {
   XRefEntryType type;
 };
 
-struct XRefCacheEntry {
-  int num;
-  int gen;
-  Object obj;
+struct XRefCacheStats {
+  double hits;			// number of lookups that found the entry
+  double misses;		// number of lookups that didn't
+  int nEntries;			// current number of cached entries
+  int maxEntries;		// maximum number of cached entries
+  int nBytes;			// approximate memory used by the entries
+  int maxBytes;			// maximum memory used by the entries
 };
 
-#define xrefCacheSize 16
-
-#define objStrCacheSize 4
-
 class XRef {
 public:
 
@@ -93,6 +91,17 @@ public:
   // Fetch an indirect reference.
   Object *fetch(int num, int gen, Object *obj, int recursion = 0);
 
+  // Get hit/miss counters for the parsed object cache and the object
+  // stream cache.
+  void getObjectCacheStats(XRefCacheStats *stats);
+  void getObjStrCacheStats(XRefCacheStats *stats);
+
+  // Get/set the cache of decoded JBIG2Globals streams.  The cache is
+  // owned by the PDFDoc; this returns NULL if there isn't one.
+  JBIG2GlobalsCache *getJBIG2GlobalsCache() { return jbig2GlobalsCache; }
+  void setJBIG2GlobalsCache(JBIG2GlobalsCache *cacheA)
+    { jbig2GlobalsCache = cacheA; }
+
   // Return the document's Info dictionary (if any).
   Object *getDocInfo(Object *obj);
   Object *getDocInfoNF(Object *obj);
@@ -142,11 +151,7 @@ private:
   GFileOffset *streamEnds;	// 'endstream' positions - only used in
 				//   damaged files
   int streamEndsLen;		// number of valid entries in streamEnds
-  ObjectStream *		// cached object streams
-    objStrs[objStrCacheSize];
-#if MULTITHREADED
-  GMutex objStrsMutex;
-#endif
+  XRefCache *objStrCache;	// cached object streams
   GBool encrypted;		// true if file is encrypted
   int permFlags;		// permission bits
   GBool ownerPasswordOk;	// true if owner password is correct
@@ -154,11 +159,9 @@ private:
   int keyLength;		// length of key, in bytes
   int encVersion;		// encryption version
   CryptAlgorithm encAlgorithm;	// encryption algorithm
-  XRefCacheEntry		// cache of recently accessed objects
-    cache[xrefCacheSize];
-#if MULTITHREADED
-  GMutex cacheMutex;
-#endif
+  XRefCache *cache;		// cache of recently accessed objects
+  JBIG2GlobalsCache *jbig2GlobalsCache;	// decoded JBIG2Globals streams
+					//   (owned by the PDFDoc)
 
   GFileOffset getStartXref();
   GBool readXRef(GFileOffset *pos, XRefPosSet *posSet);
@@ -168,7 +171,6 @@ private:
   GBool constructXRef();
   GBool getObjectStreamObject(int objStrNum, int objIdx,
 			      int objNum, Object *obj);
-  ObjectStream *getObjectStream(int objStrNum);
   GFileOffset strToFileOffset(char *s);
 };
 
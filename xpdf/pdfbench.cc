@@ -0,0 +1,669 @@
+//========================================================================
+//
+// pdfbench.cc
+//
+// Benchmark the parsing, rendering, and text extraction code over a
+// set of PDF files, and write the results as JSON.
+//
+// Copyright 2026 xpdf contributors
+//
+//========================================================================
+
+#include <aconf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <new>
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/time.h>
+#  include <sys/resource.h>
+#  include <sys/stat.h>
+#  include <dirent.h>
+#endif
+#include "gmem.h"
+#include "GString.h"
+#include "GList.h"
+#include "gfile.h"
+#include "parseargs.h"
+#include "GlobalParams.h"
+#include "Object.h"
+#include "Stream.h"
+#include "XRef.h"
+#include "PDFDoc.h"
+#include "OutputDev.h"
+#include "TextOutputDev.h"
+#include "SplashTypes.h"
+#include "SplashOutputDev.h"
+#include "Error.h"
+#include "config.h"
+// NB: gmempp.h is not included -- this file replaces the global new
+// and delete operators (see below).
+
+//------------------------------------------------------------------------
+
+#define pdfbenchCopyright "Copyright 2026 xpdf contributors"
+
+//------------------------------------------------------------------------
+
+static int firstPage = 1;
+static int lastPage = 0;
+static int resolution = 150;
+static int nIters = 1;
+static char phasesStr[256] = "load,streams,gfx,text,raster";
+static char outFileName[256] = "";
+static GBool quiet = gFalse;
+static char cfgFileName[256] = "";
+static GBool printVersion = gFalse;
+static GBool printHelp = gFalse;
+
+static ArgDesc argDesc[] = {
+  {"-f",       argInt,      &firstPage,     0,
+   "first page to process"},
+  {"-l",       argInt,      &lastPage,      0,
+   "last page to process"},
+  {"-r",       argInt,      &resolution,    0,
+   "resolution, in DPI, for the raster phase (default is 150)"},
+  {"-n",       argInt,      &nIters,        0,
+   "number of times to run each phase (default is 1)"},
+  {"-phases",  argString,   phasesStr,      sizeof(phasesStr),
+   "comma-separated list of phases to run"},
+  {"-o",       argString,   outFileName,    sizeof(outFileName),
+   "write the JSON report to this file (default is stdout)"},
+  {"-q",       argFlag,     &quiet,         0,
+   "don't print any messages or errors"},
+  {"-cfg",     argString,   cfgFileName,    sizeof(cfgFileName),
+   "configuration file to use in place of .xpdfrc"},
+  {"-v",       argFlag,     &printVersion,  0,
+   "print copyright and version info"},
+  {"-h",       argFlag,     &printHelp,     0,
+   "print usage information"},
+  {"-help",    argFlag,     &printHelp,     0,
+   "print usage information"},
+  {"--help",   argFlag,     &printHelp,     0,
+   "print usage information"},
+  {"-?",       argFlag,     &printHelp,     0,
+   "print usage information"},
+  {NULL}
+};
+
+//------------------------------------------------------------------------
+// allocation counting
+//------------------------------------------------------------------------
+
+// Route the C++ allocations through gmalloc/gfree (as gmempp.cc does
+// in DEBUG_MEM builds), so they show up in the allocation counts.
+#ifndef DEBUG_MEM
+
+// gmalloc takes an int, so larger requests fail as new normally does.
+static void *benchNew(size_t size) {
+  if (size > INT_MAX) {
+    throw std::bad_alloc();
+  }
+  return gmalloc(size ? (int)size : 1);
+}
+
+void *operator new(size_t size) {
+  return benchNew(size);
+}
+
+void *operator new[](size_t size) {
+  return benchNew(size);
+}
+
+void operator delete(void *p) {
+  gfree(p);
+}
+
+void operator delete[](void *p) {
+  gfree(p);
+}
+
+#endif
+
+struct BenchAllocCounts {
+  long nAllocs;
+  long nReallocs;
+  long nFrees;
+};
+
+static void getAllocCounts(BenchAllocCounts *counts) {
+  gMemGetCounts(&counts->nAllocs, &counts->nReallocs, &counts->nFrees);
+}
+
+//------------------------------------------------------------------------
+// timing and memory usage
+//------------------------------------------------------------------------
+
+// Return the wall clock time, in seconds.
+static double getTime() {
+#ifdef _WIN32
+  LARGE_INTEGER freq, t;
+
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)freq.QuadPart;
+#else
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + 1e-6 * (double)tv.tv_usec;
+#endif
+}
+
+// Return the peak resident set size, in bytes, or -1 if unknown.
+static double getPeakRSS() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+    return -1;
+  }
+  return (double)pmc.PeakWorkingSetSize;
+#else
+  struct rusage ru;
+
+  if (getrusage(RUSAGE_SELF, &ru)) {
+    return -1;
+  }
+#  ifdef __APPLE__
+  return (double)ru.ru_maxrss;		// bytes
+#  else
+  return 1024.0 * (double)ru.ru_maxrss;	// kilobytes
+#  endif
+#endif
+}
+
+//------------------------------------------------------------------------
+// phases
+//------------------------------------------------------------------------
+
+enum BenchPhase {
+  benchLoad,			// PDFDoc construction (xref, catalog)
+  benchStreams,			// decode every stream in the file
+  benchGfx,			// content stream interpretation only
+  benchText,			// TextOutputDev extraction
+  benchRaster,			// SplashOutputDev rasterization
+  benchNPhases
+};
+
+static const char *phaseNames[benchNPhases] = {
+  "load",
+  "streams",
+  "gfx",
+  "text",
+  "raster"
+};
+
+// stream decoding is broken down by the outermost filter
+enum BenchStreamKind {
+  benchStreamFlate,
+  benchStreamDCT,
+  benchStreamJBIG2,
+  benchStreamJPX,
+  benchStreamOther,
+  benchNStreamKinds
+};
+
+static const char *streamKindNames[benchNStreamKinds] = {
+  "flate",
+  "dct",
+  "jbig2",
+  "jpx",
+  "other"
+};
+
+struct BenchStreamStats {
+  int count;			// number of streams
+  double bytes;			// number of decoded bytes
+  double time;			// decode time, in seconds
+};
+
+struct BenchPhaseStats {
+  GBool run;			// set if this phase was run
+  double time;			// wall time, in seconds
+  int pages;			// pages processed (summed over iterations)
+  BenchAllocCounts allocs;	// allocation counts
+};
+
+struct BenchStats {
+  BenchPhaseStats phases[benchNPhases];
+  BenchStreamStats streams[benchNStreamKinds];
+};
+
+static void clearStats(BenchStats *stats) {
+  memset(stats, 0, sizeof(BenchStats));
+}
+
+static void addStats(BenchStats *total, BenchStats *stats) {
+  BenchPhaseStats *t, *s;
+  int i;
+
+  for (i = 0; i < benchNPhases; ++i) {
+    t = &total->phases[i];
+    s = &stats->phases[i];
+    t->run = t->run || s->run;
+    t->time += s->time;
+    t->pages += s->pages;
+    t->allocs.nAllocs += s->allocs.nAllocs;
+    t->allocs.nReallocs += s->allocs.nReallocs;
+    t->allocs.nFrees += s->allocs.nFrees;
+  }
+  for (i = 0; i < benchNStreamKinds; ++i) {
+    total->streams[i].count += stats->streams[i].count;
+    total->streams[i].bytes += stats->streams[i].bytes;
+    total->streams[i].time += stats->streams[i].time;
+  }
+}
+
+//------------------------------------------------------------------------
+// BenchOutputDev
+//------------------------------------------------------------------------
+
+// An OutputDev which draws nothing, used to time the content stream
+// interpreter (Gfx) by itself.
+class BenchOutputDev: public OutputDev {
+public:
+
+  virtual GBool upsideDown() { return gTrue; }
+  virtual GBool useDrawChar() { return gTrue; }
+  virtual GBool interpretType3Chars() { return gTrue; }
+};
+
+static void discardText(void *stream, const char *text, int len) {
+}
+
+//------------------------------------------------------------------------
+
+static void decodeStreams(PDFDoc *doc, BenchStats *stats) {
+  XRef *xref;
+  XRefEntry *e;
+  Object obj;
+  Stream *str;
+  BenchStreamKind kind;
+  char buf[16384];
+  double t0, bytes;
+  int num, n;
+
+  xref = doc->getXRef();
+  for (num = 0; num < xref->getNumObjects(); ++num) {
+    e = xref->getEntry(num);
+    if (e->type == xrefEntryFree) {
+      continue;
+    }
+    xref->fetch(num, e->type == xrefEntryCompressed ? 0 : e->gen, &obj);
+    if (obj.isStream()) {
+      str = obj.getStream();
+      switch (str->getKind()) {
+      case strFlate: kind = benchStreamFlate; break;
+      case strDCT:   kind = benchStreamDCT;   break;
+      case strJBIG2: kind = benchStreamJBIG2; break;
+      case strJPX:   kind = benchStreamJPX;   break;
+      default:       kind = benchStreamOther; break;
+      }
+      t0 = getTime();
+      bytes = 0;
+      str->reset();
+      while ((n = str->getBlock(buf, sizeof(buf))) > 0) {
+	bytes += n;
+      }
+      str->close();
+      stats->streams[kind].time += getTime() - t0;
+      stats->streams[kind].bytes += bytes;
+      ++stats->streams[kind].count;
+    }
+    obj.free();
+  }
+}
+
+// Run one phase on <fileName>.  Returns false if the file couldn't
+// be opened.
+static GBool runPhase(BenchPhase phase, GString *fileName,
+		      BenchPhaseStats *pstats, BenchStats *stats) {
+  PDFDoc *doc;
+  OutputDev *out;
+  SplashOutputDev *splashOut;
+  SplashColor paperColor;
+  TextOutputControl textOutControl;
+  BenchAllocCounts a0, a1;
+  double t0;
+  int first, last, pg;
+
+  out = NULL;
+  getAllocCounts(&a0);
+  t0 = getTime();
+
+  doc = new PDFDoc(fileName->copy());
+  if (!doc->isOk()) {
+    delete doc;
+    return gFalse;
+  }
+  first = firstPage < 1 ? 1 : firstPage;
+  last = (lastPage < 1 || lastPage > doc->getNumPages()) ? doc->getNumPages()
+                                                         : lastPage;
+
+  // everything except the load phase is timed after the PDFDoc is
+  // constructed
+  if (phase != benchLoad) {
+    getAllocCounts(&a0);
+    t0 = getTime();
+  }
+
+  switch (phase) {
+  case benchLoad:
+    break;
+  case benchStreams:
+    decodeStreams(doc, stats);
+    break;
+  case benchGfx:
+    out = new BenchOutputDev();
+    break;
+  case benchText:
+    out = new TextOutputDev(&discardText, NULL, &textOutControl);
+    break;
+  case benchRaster:
+    paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+    splashOut = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
+    splashOut->startDoc(doc->getXRef());
+    out = splashOut;
+    break;
+  default:
+    break;
+  }
+  if (out) {
+    for (pg = first; pg <= last; ++pg) {
+      doc->displayPage(out, pg, resolution, resolution, 0,
+		       gFalse, gTrue, gFalse);
+      ++pstats->pages;
+    }
+    delete out;
+  }
+
+  if (phase != benchLoad) {
+    pstats->time += getTime() - t0;
+    getAllocCounts(&a1);
+  }
+  delete doc;
+  if (phase == benchLoad) {
+    pstats->time += getTime() - t0;
+    getAllocCounts(&a1);
+  }
+
+  pstats->run = gTrue;
+  pstats->allocs.nAllocs += a1.nAllocs - a0.nAllocs;
+  pstats->allocs.nReallocs += a1.nReallocs - a0.nReallocs;
+  pstats->allocs.nFrees += a1.nFrees - a0.nFrees;
+  return gTrue;
+}
+
+//------------------------------------------------------------------------
+// JSON output
+//------------------------------------------------------------------------
+
+static void writeJSONString(FILE *f, const char *s) {
+  fputc('"', f);
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\') {
+      fprintf(f, "\\%c", *s);
+    } else if ((unsigned char)*s < 0x20) {
+      fprintf(f, "\\u%04x", (unsigned char)*s);
+    } else {
+      fputc(*s, f);
+    }
+  }
+  fputc('"', f);
+}
+
+static void writeStats(FILE *f, BenchStats *stats, const char *indent) {
+  BenchPhaseStats *p;
+  BenchStreamStats *s;
+  GBool first;
+  int i, j;
+
+  fprintf(f, "%s\"phases\": {", indent);
+  first = gTrue;
+  for (i = 0; i < benchNPhases; ++i) {
+    p = &stats->phases[i];
+    if (!p->run) {
+      continue;
+    }
+    fprintf(f, "%s\n%s  \"%s\": {\"time\": %.6f",
+	    first ? "" : ",", indent, phaseNames[i], p->time);
+    if (i != benchLoad && i != benchStreams) {
+      fprintf(f, ", \"pages\": %d, \"pagesPerSec\": %.3f",
+	      p->pages, p->time > 0 ? p->pages / p->time : 0.0);
+    }
+    fprintf(f, ", \"allocs\": %ld, \"reallocs\": %ld, \"frees\": %ld",
+	    p->allocs.nAllocs, p->allocs.nReallocs, p->allocs.nFrees);
+    if (i == benchStreams) {
+      fprintf(f, ",\n%s    \"filters\": {", indent);
+      for (j = 0; j < benchNStreamKinds; ++j) {
+	s = &stats->streams[j];
+	fprintf(f, "%s\n%s      \"%s\": {\"count\": %d, \"bytes\": %.0f,"
+		" \"time\": %.6f, \"bytesPerSec\": %.0f}",
+		j ? "," : "", indent, streamKindNames[j],
+		s->count, s->bytes, s->time,
+		s->time > 0 ? s->bytes / s->time : 0.0);
+      }
+      fprintf(f, "\n%s    }", indent);
+    }
+    fprintf(f, "}");
+    first = gFalse;
+  }
+  fprintf(f, "\n%s}", indent);
+}
+
+//------------------------------------------------------------------------
+
+// Add <path> to <files> -- if it's a directory, add all of the PDF
+// files in it (non-recursively), in sorted order.
+static void addFiles(GList *files, char *path) {
+  GList *dirFiles;
+  GString *name;
+  int i, j;
+#ifdef _WIN32
+  WIN32_FIND_DATAA ffd;
+  HANDLE h;
+  DWORD attrs;
+#else
+  struct stat st;
+  DIR *dir;
+  struct dirent *ent;
+#endif
+
+#ifdef _WIN32
+  attrs = GetFileAttributesA(path);
+  if (attrs == INVALID_FILE_ATTRIBUTES ||
+      !(attrs & FILE_ATTRIBUTE_DIRECTORY)) {
+    files->append(new GString(path));
+    return;
+  }
+  dirFiles = new GList();
+  name = appendToPath(new GString(path), "*");
+  if ((h = FindFirstFileA(name->getCString(), &ffd))
+      != INVALID_HANDLE_VALUE) {
+    do {
+      j = (int)strlen(ffd.cFileName);
+      if (j > 4 && !_stricmp(ffd.cFileName + j - 4, ".pdf")) {
+	dirFiles->append(appendToPath(new GString(path), ffd.cFileName));
+      }
+    } while (FindNextFileA(h, &ffd));
+    FindClose(h);
+  }
+  delete name;
+#else
+  if (stat(path, &st) || !S_ISDIR(st.st_mode) || !(dir = opendir(path))) {
+    files->append(new GString(path));
+    return;
+  }
+  dirFiles = new GList();
+  while ((ent = readdir(dir))) {
+    j = (int)strlen(ent->d_name);
+    if (j > 4 && (!strcmp(ent->d_name + j - 4, ".pdf") ||
+		  !strcmp(ent->d_name + j - 4, ".PDF"))) {
+      dirFiles->append(appendToPath(new GString(path), ent->d_name));
+    }
+  }
+  closedir(dir);
+#endif
+
+  // sort, so the output order is stable
+  for (i = 1; i < dirFiles->getLength(); ++i) {
+    name = (GString *)dirFiles->get(i);
+    for (j = i; j > 0 && ((GString *)dirFiles->get(j - 1))->cmp(name) > 0;
+	 --j) {
+      dirFiles->put(j, dirFiles->get(j - 1));
+    }
+    dirFiles->put(j, name);
+  }
+  files->append(dirFiles);
+  delete dirFiles;
+}
+
+int main(int argc, char *argv[]) {
+  GList *files;
+  GString *fileName;
+  GBool phases[benchNPhases];
+  BenchStats fileStats, totalStats;
+  BenchAllocCounts allocs;
+  FILE *f;
+  char *p, *q;
+  double t0, totalTime;
+  int nFiles, nOk, i, j, k;
+  GBool ok, fileOk;
+  int exitCode;
+
+  exitCode = 99;
+
+  // parse args
+  ok = parseArgs(argDesc, &argc, argv);
+  if (!ok || argc < 2 || printVersion || printHelp) {
+    fprintf(stderr, "pdfbench version %s\n", xpdfVersion);
+    fprintf(stderr, "%s\n", pdfbenchCopyright);
+    fprintf(stderr, "Xpdf library: %s\n", xpdfCopyright);
+    if (!printVersion) {
+      printUsage("pdfbench", "<PDF-file-or-dir> ...", argDesc);
+    }
+    goto err0;
+  }
+  if (nIters < 1) {
+    nIters = 1;
+  }
+
+  // parse the phase list
+  for (i = 0; i < benchNPhases; ++i) {
+    phases[i] = gFalse;
+  }
+  for (p = phasesStr; *p; p = q) {
+    for (q = p; *q && *q != ','; ++q) ;
+    for (i = 0; i < benchNPhases; ++i) {
+      if ((int)strlen(phaseNames[i]) == (int)(q - p) &&
+	  !strncmp(p, phaseNames[i], q - p)) {
+	phases[i] = gTrue;
+	break;
+      }
+    }
+    if (i == benchNPhases && q > p) {
+      fprintf(stderr, "Unknown phase '%.*s'\n", (int)(q - p), p);
+      goto err0;
+    }
+    if (*q) {
+      ++q;
+    }
+  }
+
+  // read config file
+  globalParams = new GlobalParams(cfgFileName);
+  if (quiet) {
+    globalParams->setErrQuiet(quiet);
+  }
+
+  // get the file list
+  files = new GList();
+  for (i = 1; i < argc; ++i) {
+    addFiles(files, argv[i]);
+  }
+  nFiles = files->getLength();
+
+  // open the output file
+  if (outFileName[0] && strcmp(outFileName, "-")) {
+    if (!(f = fopen(outFileName, "w"))) {
+      error(errIO, -1, "Couldn't open output file '{0:s}'", outFileName);
+      exitCode = 2;
+      goto err1;
+    }
+  } else {
+    f = stdout;
+  }
+
+  gMemSetCounting(1);
+
+  fprintf(f, "{\n");
+  fprintf(f, "  \"version\": \"%s\",\n", xpdfVersion);
+  fprintf(f, "  \"resolution\": %d,\n", resolution);
+  fprintf(f, "  \"iterations\": %d,\n", nIters);
+  fprintf(f, "  \"files\": [");
+  clearStats(&totalStats);
+  nOk = 0;
+  t0 = getTime();
+  for (i = 0; i < nFiles; ++i) {
+    fileName = (GString *)files->get(i);
+    clearStats(&fileStats);
+    fileOk = gTrue;
+    for (j = 0; j < benchNPhases && fileOk; ++j) {
+      if (!phases[j]) {
+	continue;
+      }
+      for (k = 0; k < nIters && fileOk; ++k) {
+	fileOk = runPhase((BenchPhase)j, fileName,
+			     &fileStats.phases[j], &fileStats);
+      }
+    }
+    fprintf(f, "%s\n    {\"file\": ", i ? "," : "");
+    writeJSONString(f, fileName->getCString());
+    fprintf(f, ", \"ok\": %s", fileOk ? "true" : "false");
+    if (fileOk) {
+      ++nOk;
+      addStats(&totalStats, &fileStats);
+      fprintf(f, ",\n");
+      writeStats(f, &fileStats, "     ");
+    }
+    fprintf(f, "}");
+    fflush(f);
+  }
+  totalTime = getTime() - t0;
+  fprintf(f, "\n  ],\n");
+  fprintf(f, "  \"totals\": {\n");
+  fprintf(f, "    \"files\": %d, \"failed\": %d, \"time\": %.6f,\n",
+	  nOk, nFiles - nOk, totalTime);
+  writeStats(f, &totalStats, "    ");
+  fprintf(f, "\n  },\n");
+  getAllocCounts(&allocs);
+  fprintf(f, "  \"allocs\": %ld, \"reallocs\": %ld, \"frees\": %ld,\n",
+	  allocs.nAllocs, allocs.nReallocs, allocs.nFrees);
+  fprintf(f, "  \"peakRSS\": %.0f\n", getPeakRSS());
+  fprintf(f, "}\n");
+
+  gMemSetCounting(0);
+
+  if (f != stdout) {
+    fclose(f);
+  }
+  exitCode = nOk == nFiles ? 0 : 1;
+
+  // clean up
+ err1:
+  deleteGList(files, GString);
+  delete globalParams;
+ err0:
+
+  // check for memory leaks
+  Object::memCheck(stderr);
+  gMemReport(stderr);
+
+  return exitCode;
+}
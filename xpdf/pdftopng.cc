@@ -16,6 +16,9 @@
 #endif
 #include "gmem.h"
 #include "gmempp.h"
+#if MULTITHREADED
+#include "GThread.h"
+#endif
 #include "parseargs.h"
 #include "GString.h"
 #include "GlobalParams.h"
@@ -24,6 +27,7 @@
 #include "SplashBitmap.h"
 #include "Splash.h"
 #include "SplashOutputDev.h"
+#include "SplashGlyphCache.h"
 #include "config.h"
 
 static int firstPage = 1;
@@ -37,6 +41,9 @@ static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
+#if MULTITHREADED
+static int nThreads = 1;
+#endif
 static GBool quiet = gFalse;
 static char cfgFileName[256] = "";
 static GBool printVersion = gFalse;
@@ -67,6 +74,10 @@ static ArgDesc argDesc[] = {
    "owner password (for encrypted files)"},
   {"-upw",    argString,   userPassword,   sizeof(userPassword),
    "user password (for encrypted files)"},
+#if MULTITHREADED
+  {"-j",      argInt,      &nThreads,      0,
+   "number of pages to render in parallel (default is 1)"},
+#endif
   {"-q",      argFlag,     &quiet,         0,
    "don't print any messages or errors"},
   {"-cfg",        argString,      cfgFileName,    sizeof(cfgFileName),
@@ -89,21 +100,22 @@ static void setupPNG(png_structp *png, png_infop *pngInfo, FILE *f,
 		     SplashBitmap *bitmap);
 static void writePNGData(png_structp png, SplashBitmap *bitmap);
 static void finishPNG(png_structp *png, png_infop *pngInfo);
+static SplashOutputDev *makeOutputDev(PDFDoc *doc,
+				      SplashGlyphCache *glyphCache);
+static void writePage(SplashOutputDev *splashOut, char *pngRoot, int pg);
+#if MULTITHREADED
+static void renderPagesParallel(PDFDoc *doc, char *pngRoot);
+#endif
 
 int main(int argc, char *argv[]) {
   PDFDoc *doc;
   GString *fileName;
   char *pngRoot;
-  GString *pngFile;
   GString *ownerPW, *userPW;
-  SplashColor paperColor;
   SplashOutputDev *splashOut;
   GBool ok;
   int exitCode;
   int pg;
-  png_structp png;
-  png_infop pngInfo;
-  FILE *f;
 
   exitCode = 99;
 
@@ -181,6 +193,44 @@ int main(int argc, char *argv[]) {
 
 
   // write PNG files
+#if MULTITHREADED
+  if (nThreads > 1 && lastPage > firstPage) {
+    renderPagesParallel(doc, pngRoot);
+  } else {
+#endif
+    splashOut = makeOutputDev(doc, NULL);
+    for (pg = firstPage; pg <= lastPage; ++pg) {
+      doc->displayPage(splashOut, pg, resolution, resolution, 0,
+		       gFalse, gTrue, gFalse);
+      writePage(splashOut, pngRoot, pg);
+    }
+    delete splashOut;
+#if MULTITHREADED
+  }
+#endif
+
+  exitCode = 0;
+
+  // clean up
+ err1:
+  delete doc;
+  delete globalParams;
+ err0:
+
+  // check for memory leaks
+  Object::memCheck(stderr);
+  gMemReport(stderr);
+
+  return exitCode;
+}
+
+// If [glyphCache] is non-NULL, it is shared with the new
+// SplashOutputDev; otherwise the SplashOutputDev creates its own.
+static SplashOutputDev *makeOutputDev(PDFDoc *doc,
+				      SplashGlyphCache *glyphCache) {
+  SplashColor paperColor;
+  SplashOutputDev *splashOut;
+
   if (mono) {
     paperColor[0] = 0xff;
     splashOut = new SplashOutputDev(splashModeMono1, 1, gFalse, paperColor);
@@ -194,83 +244,78 @@ int main(int argc, char *argv[]) {
   if (pngAlpha) {
     splashOut->setNoComposite(gTrue);
   }
+  if (glyphCache) {
+    splashOut->setGlyphCache(glyphCache);
+  }
   splashOut->startDoc(doc->getXRef());
-  for (pg = firstPage; pg <= lastPage; ++pg) {
-    doc->displayPage(splashOut, pg, resolution, resolution, 0,
-		     gFalse, gTrue, gFalse);
-    if (mono) {
-      if (!strcmp(pngRoot, "-")) {
-	f = stdout;
+  return splashOut;
+}
+
+static void writePage(SplashOutputDev *splashOut, char *pngRoot, int pg) {
+  SplashBitmap *bitmap;
+  GString *pngFile;
+  png_structp png;
+  png_infop pngInfo;
+  FILE *f;
+
+  bitmap = splashOut->getBitmap();
+  if (mono) {
+    if (!strcmp(pngRoot, "-")) {
+      f = stdout;
 #ifdef _WIN32
-	_setmode(_fileno(f), _O_BINARY);
+      _setmode(_fileno(f), _O_BINARY);
 #endif
-      } else {
-	pngFile = GString::format("{0:s}-{1:06d}.png", pngRoot, pg);
-	if (!(f = fopen(pngFile->getCString(), "wb"))) {
-	  exit(2);
-	}
-	delete pngFile;
+    } else {
+      pngFile = GString::format("{0:s}-{1:06d}.png", pngRoot, pg);
+      if (!(f = fopen(pngFile->getCString(), "wb"))) {
+	exit(2);
       }
-      setupPNG(&png, &pngInfo, f,
-	       1, PNG_COLOR_TYPE_GRAY, resolution, splashOut->getBitmap());
-      writePNGData(png, splashOut->getBitmap());
-      finishPNG(&png, &pngInfo);
-      fclose(f);
-    } else if (gray) {
-      if (!strcmp(pngRoot, "-")) {
-	f = stdout;
+      delete pngFile;
+    }
+    setupPNG(&png, &pngInfo, f,
+	     1, PNG_COLOR_TYPE_GRAY, resolution, bitmap);
+    writePNGData(png, bitmap);
+    finishPNG(&png, &pngInfo);
+    fclose(f);
+  } else if (gray) {
+    if (!strcmp(pngRoot, "-")) {
+      f = stdout;
 #ifdef _WIN32
-	_setmode(_fileno(f), _O_BINARY);
+      _setmode(_fileno(f), _O_BINARY);
 #endif
-      } else {
-	pngFile = GString::format("{0:s}-{1:06d}.png", pngRoot, pg);
-	if (!(f = fopen(pngFile->getCString(), "wb"))) {
-	  exit(2);
-	}
-	delete pngFile;
+    } else {
+      pngFile = GString::format("{0:s}-{1:06d}.png", pngRoot, pg);
+      if (!(f = fopen(pngFile->getCString(), "wb"))) {
+	exit(2);
       }
-      setupPNG(&png, &pngInfo, f,
-	       8, pngAlpha ? PNG_COLOR_TYPE_GRAY_ALPHA : PNG_COLOR_TYPE_GRAY,
-	       resolution, splashOut->getBitmap());
-      writePNGData(png, splashOut->getBitmap());
-      finishPNG(&png, &pngInfo);
-      fclose(f);
-    } else { // RGB
-      if (!strcmp(pngRoot, "-")) {
-	f = stdout;
+      delete pngFile;
+    }
+    setupPNG(&png, &pngInfo, f,
+	     8, pngAlpha ? PNG_COLOR_TYPE_GRAY_ALPHA : PNG_COLOR_TYPE_GRAY,
+	     resolution, bitmap);
+    writePNGData(png, bitmap);
+    finishPNG(&png, &pngInfo);
+    fclose(f);
+  } else { // RGB
+    if (!strcmp(pngRoot, "-")) {
+      f = stdout;
 #ifdef _WIN32
-	_setmode(_fileno(f), _O_BINARY);
+      _setmode(_fileno(f), _O_BINARY);
 #endif
-      } else {
-	pngFile = GString::format("{0:s}-{1:06d}.png", pngRoot, pg);
-	if (!(f = fopen(pngFile->getCString(), "wb"))) {
-	  exit(2);
-	}
-	delete pngFile;
+    } else {
+      pngFile = GString::format("{0:s}-{1:06d}.png", pngRoot, pg);
+      if (!(f = fopen(pngFile->getCString(), "wb"))) {
+	exit(2);
       }
-      setupPNG(&png, &pngInfo, f,
-	       8, pngAlpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
-	       resolution, splashOut->getBitmap());
-      writePNGData(png, splashOut->getBitmap());
-      finishPNG(&png, &pngInfo);
-      fclose(f);
+      delete pngFile;
     }
+    setupPNG(&png, &pngInfo, f,
+	     8, pngAlpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+	     resolution, bitmap);
+    writePNGData(png, bitmap);
+    finishPNG(&png, &pngInfo);
+    fclose(f);
   }
-  delete splashOut;
-
-  exitCode = 0;
-
-  // clean up
- err1:
-  delete doc;
-  delete globalParams;
- err0:
-
-  // check for memory leaks
-  Object::memCheck(stderr);
-  gMemReport(stderr);
-
-  return exitCode;
 }
 
 static void setupPNG(png_structp *png, png_infop *pngInfo, FILE *f,
@@ -358,3 +403,97 @@ static void finishPNG(png_structp *png, png_infop *pngInfo) {
   png_write_end(*png, *pngInfo);
   png_destroy_write_struct(png, pngInfo);
 }
+
+#if MULTITHREADED
+
+//------------------------------------------------------------------------
+// parallel rendering
+//------------------------------------------------------------------------
+
+// Each worker thread owns a SplashOutputDev and shares the PDFDoc.
+// Pages are handed out in increasing order, and each finished page is
+// held until all earlier pages have been written, so output comes out
+// in page order.
+
+struct RenderPool {
+  PDFDoc *doc;
+  char *pngRoot;
+  int nextPage;			// next page to be rendered
+  int nextWritePage;		// next page to be written
+  SplashGlyphCache *glyphCache;	// glyph cache shared by all workers
+  GMutex mutex;
+  GCondition writeCond;		// signalled whenever nextWritePage
+				//   is incremented
+};
+
+static GThreadReturn renderThread(void *arg) {
+  RenderPool *pool = (RenderPool *)arg;
+  SplashOutputDev *splashOut;
+  int pg;
+
+  splashOut = makeOutputDev(pool->doc, pool->glyphCache);
+  while (1) {
+    gLockMutex(&pool->mutex);
+    pg = pool->nextPage;
+    if (pg <= lastPage) {
+      ++pool->nextPage;
+    }
+    gUnlockMutex(&pool->mutex);
+    if (pg > lastPage) {
+      break;
+    }
+    pool->doc->displayPage(splashOut, pg, resolution, resolution, 0,
+			   gFalse, gTrue, gFalse);
+    gLockMutex(&pool->mutex);
+    while (pool->nextWritePage != pg) {
+      gClearCondition(&pool->writeCond);
+      gWaitCondition(&pool->writeCond, &pool->mutex);
+    }
+    gUnlockMutex(&pool->mutex);
+    writePage(splashOut, pool->pngRoot, pg);
+    gLockMutex(&pool->mutex);
+    ++pool->nextWritePage;
+    gSignalCondition(&pool->writeCond);
+    gUnlockMutex(&pool->mutex);
+  }
+  delete splashOut;
+  return 0;
+}
+
+static void renderPagesParallel(PDFDoc *doc, char *pngRoot) {
+  RenderPool pool;
+  GThreadID *threads;
+  int n, i;
+
+  n = nThreads;
+  if (n > lastPage - firstPage + 1) {
+    n = lastPage - firstPage + 1;
+  }
+  pool.doc = doc;
+  pool.pngRoot = pngRoot;
+  pool.nextPage = firstPage;
+  pool.nextWritePage = firstPage;
+  if (globalParams->getGlyphCacheSize() > 0) {
+    pool.glyphCache =
+        new SplashGlyphCache(globalParams->getGlyphCacheSize());
+  } else {
+    pool.glyphCache = NULL;
+  }
+  gInitMutex(&pool.mutex);
+  gInitCondition(&pool.writeCond);
+  threads = (GThreadID *)gmallocn(n, sizeof(GThreadID));
+  for (i = 0; i < n; ++i) {
+    gCreateThread(&threads[i], &renderThread, &pool);
+  }
+  for (i = 0; i < n; ++i) {
+    gJoinThread(threads[i]);
+  }
+  gfree(threads);
+  if (pool.glyphCache) {
+    delete pool.glyphCache;
+  }
+  gDestroyCondition(&pool.writeCond);
+  gDestroyMutex(&pool.mutex);
+}
+
+#endif // MULTITHREADED
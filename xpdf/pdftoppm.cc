@@ -8,6 +8,7 @@
 
 #include <aconf.h>
 #include <stdio.h>
+#include <string.h>
 #ifdef _WIN32
 #  include <io.h>
 #  include <fcntl.h>
@@ -18,6 +19,9 @@
 #endif
 #include "gmem.h"
 #include "gmempp.h"
+#if MULTITHREADED
+#include "GThread.h"
+#endif
 #include "parseargs.h"
 #include "GString.h"
 #include "GlobalParams.h"
@@ -26,6 +30,8 @@
 #include "SplashBitmap.h"
 #include "Splash.h"
 #include "SplashOutputDev.h"
+#include "SplashGlyphCache.h"
+#include "GfxProfiler.h"
 #include "config.h"
 
 static int firstPage = 1;
@@ -41,6 +47,10 @@ static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
+#if MULTITHREADED
+static int nThreads = 1;
+#endif
+static char profileFileName[256] = "";
 static GBool quiet = gFalse;
 static char cfgFileName[256] = "";
 static GBool printVersion = gFalse;
@@ -73,6 +83,12 @@ static ArgDesc argDesc[] = {
    "owner password (for encrypted files)"},
   {"-upw",    argString,   userPassword,   sizeof(userPassword),
    "user password (for encrypted files)"},
+#if MULTITHREADED
+  {"-j",      argInt,      &nThreads,      0,
+   "number of pages to render in parallel (default is 1)"},
+#endif
+  {"-profile", argString,  profileFileName, sizeof(profileFileName),
+   "write operator timing statistics to this file"},
   {"-q",      argFlag,     &quiet,         0,
    "don't print any messages or errors"},
   {"-cfg",        argString,      cfgFileName,    sizeof(cfgFileName),
@@ -90,13 +106,19 @@ static ArgDesc argDesc[] = {
   {NULL}
 };
 
+static SplashOutputDev *makeOutputDev(PDFDoc *doc,
+				      SplashGlyphCache *glyphCache);
+static void writePage(SplashOutputDev *splashOut, char *ppmRoot,
+		      int pg, const char *ext);
+#if MULTITHREADED
+static void renderPagesParallel(PDFDoc *doc, char *ppmRoot, const char *ext);
+#endif
+
 int main(int argc, char *argv[]) {
   PDFDoc *doc;
   GString *fileName;
   char *ppmRoot;
-  GString *ppmFile;
   GString *ownerPW, *userPW;
-  SplashColor paperColor;
   SplashOutputDev *splashOut;
   GBool ok;
   int exitCode;
@@ -163,6 +185,13 @@ int main(int argc, char *argv[]) {
   if (quiet) {
     globalParams->setErrQuiet(quiet);
   }
+  if (profileFileName[0]) {
+    globalParams->setProfileCommands(gTrue);
+    n = (int)strlen(profileFileName);
+    if (n > 5 && !strcmp(profileFileName + n - 5, ".json")) {
+      globalParams->getProfiler()->setTracing(gTrue);
+    }
+  }
 
   // open PDF file
   if (ownerPassword[0]) {
@@ -208,6 +237,53 @@ int main(int argc, char *argv[]) {
 
 
   // write PPM files
+#if MULTITHREADED
+  if (nThreads > 1 && lastPage > firstPage) {
+    renderPagesParallel(doc, ppmRoot, ext);
+  } else {
+#endif
+    splashOut = makeOutputDev(doc, NULL);
+    for (pg = firstPage; pg <= lastPage; ++pg) {
+      doc->displayPage(splashOut, pg, resolution, resolution, 0,
+		       gFalse, gTrue, gFalse);
+      writePage(splashOut, ppmRoot, pg, ext);
+    }
+    delete splashOut;
+#if MULTITHREADED
+  }
+#endif
+
+  // write the profile
+  if (profileFileName[0]) {
+    if (!globalParams->getProfiler()->writeFile(profileFileName)) {
+      fprintf(stderr, "Couldn't write profile file '%s'\n",
+	      profileFileName);
+    }
+  }
+
+  exitCode = 0;
+
+  // clean up
+ err1:
+  delete doc;
+  delete globalParams;
+ err0:
+
+  // check for memory leaks
+  Object::memCheck(stderr);
+  gMemReport(stderr);
+
+  return exitCode;
+}
+
+// Create a SplashOutputDev for the selected output mode, and attach
+// it to [doc].  If [glyphCache] is non-NULL, it is shared with the
+// SplashOutputDev; otherwise the SplashOutputDev creates its own.
+static SplashOutputDev *makeOutputDev(PDFDoc *doc,
+				      SplashGlyphCache *glyphCache) {
+  SplashColor paperColor;
+  SplashOutputDev *splashOut;
+
   if (mono) {
     paperColor[0] = 0xff;
     splashOut = new SplashOutputDev(splashModeMono1, 1, gFalse, paperColor);
@@ -223,34 +299,123 @@ int main(int argc, char *argv[]) {
     paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
     splashOut = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
   }
+  if (glyphCache) {
+    splashOut->setGlyphCache(glyphCache);
+  }
   splashOut->startDoc(doc->getXRef());
-  for (pg = firstPage; pg <= lastPage; ++pg) {
-    doc->displayPage(splashOut, pg, resolution, resolution, 0,
-		     gFalse, gTrue, gFalse);
-    if (!strcmp(ppmRoot, "-")) {
+  return splashOut;
+}
+
+static void writePage(SplashOutputDev *splashOut, char *ppmRoot,
+		      int pg, const char *ext) {
+  GString *ppmFile;
+
+  if (!strcmp(ppmRoot, "-")) {
 #ifdef _WIN32
-      _setmode(_fileno(stdout), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
 #endif
-      splashOut->getBitmap()->writePNMFile(stdout);
-    } else {
-      ppmFile = GString::format("{0:s}-{1:06d}.{2:s}", ppmRoot, pg, ext);
-      splashOut->getBitmap()->writePNMFile(ppmFile->getCString());
-      delete ppmFile;
-    }
+    splashOut->getBitmap()->writePNMFile(stdout);
+  } else {
+    ppmFile = GString::format("{0:s}-{1:06d}.{2:s}", ppmRoot, pg, ext);
+    splashOut->getBitmap()->writePNMFile(ppmFile->getCString());
+    delete ppmFile;
   }
-  delete splashOut;
+}
 
-  exitCode = 0;
+#if MULTITHREADED
 
-  // clean up
- err1:
-  delete doc;
-  delete globalParams;
- err0:
+//------------------------------------------------------------------------
+// parallel rendering
+//------------------------------------------------------------------------
 
-  // check for memory leaks
-  Object::memCheck(stderr);
-  gMemReport(stderr);
+// Each worker thread owns a SplashOutputDev (and therefore its own
+// Gfx/Splash state and font engine), and shares the PDFDoc/XRef.
+// Pages are handed out in increasing order; a worker that finishes a
+// page waits until all earlier pages have been written, so output
+// files (and stdout) are produced in page order, and at most nThreads
+// page bitmaps are in memory at any time.
 
-  return exitCode;
+struct RenderPool {
+  PDFDoc *doc;
+  char *ppmRoot;
+  const char *ext;
+  int nextPage;			// next page to be rendered
+  int nextWritePage;		// next page to be written
+  SplashGlyphCache *glyphCache;	// glyph cache shared by all workers
+  GMutex mutex;
+  GCondition writeCond;		// signalled whenever nextWritePage
+				//   is incremented
+};
+
+static GThreadReturn renderThread(void *arg) {
+  RenderPool *pool = (RenderPool *)arg;
+  SplashOutputDev *splashOut;
+  int pg;
+
+  splashOut = makeOutputDev(pool->doc, pool->glyphCache);
+  while (1) {
+    gLockMutex(&pool->mutex);
+    pg = pool->nextPage;
+    if (pg <= lastPage) {
+      ++pool->nextPage;
+    }
+    gUnlockMutex(&pool->mutex);
+    if (pg > lastPage) {
+      break;
+    }
+    pool->doc->displayPage(splashOut, pg, resolution, resolution, 0,
+			   gFalse, gTrue, gFalse);
+    gLockMutex(&pool->mutex);
+    while (pool->nextWritePage != pg) {
+      gClearCondition(&pool->writeCond);
+      gWaitCondition(&pool->writeCond, &pool->mutex);
+    }
+    gUnlockMutex(&pool->mutex);
+    writePage(splashOut, pool->ppmRoot, pg, pool->ext);
+    gLockMutex(&pool->mutex);
+    ++pool->nextWritePage;
+    gSignalCondition(&pool->writeCond);
+    gUnlockMutex(&pool->mutex);
+  }
+  delete splashOut;
+  return 0;
 }
+
+static void renderPagesParallel(PDFDoc *doc, char *ppmRoot, const char *ext) {
+  RenderPool pool;
+  GThreadID *threads;
+  int n, i;
+
+  n = nThreads;
+  if (n > lastPage - firstPage + 1) {
+    n = lastPage - firstPage + 1;
+  }
+  pool.doc = doc;
+  pool.ppmRoot = ppmRoot;
+  pool.ext = ext;
+  pool.nextPage = firstPage;
+  pool.nextWritePage = firstPage;
+  if (globalParams->getGlyphCacheSize() > 0) {
+    pool.glyphCache =
+        new SplashGlyphCache(globalParams->getGlyphCacheSize());
+  } else {
+    pool.glyphCache = NULL;
+  }
+  gInitMutex(&pool.mutex);
+  gInitCondition(&pool.writeCond);
+  threads = (GThreadID *)gmallocn(n, sizeof(GThreadID));
+  for (i = 0; i < n; ++i) {
+    gCreateThread(&threads[i], &renderThread, &pool);
+  }
+  for (i = 0; i < n; ++i) {
+    gJoinThread(threads[i]);
+  }
+  gfree(threads);
+  if (pool.glyphCache) {
+    delete pool.glyphCache;
+  }
+  gDestroyCondition(&pool.writeCond);
+  gDestroyMutex(&pool.mutex);
+}
+
+#endif // MULTITHREADED
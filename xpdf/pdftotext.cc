@@ -17,6 +17,9 @@
 #endif
 #include "gmem.h"
 #include "gmempp.h"
+#if MULTITHREADED
+#include "GThread.h"
+#endif
 #include "parseargs.h"
 #include "GString.h"
 #include "GlobalParams.h"
@@ -33,6 +36,7 @@
 #include "UnicodeMap.h"
 #include "TextString.h"
 #include "Error.h"
+#include "GfxProfiler.h"
 #include "config.h"
 
 static int firstPage = 1;
@@ -52,6 +56,10 @@ static GBool noPageBreaks = gFalse;
 static GBool insertBOM = gFalse;
 static char ownerPassword[33] = "\001";
 static char userPassword[33] = "\001";
+#if MULTITHREADED
+static int nThreads = 1;
+#endif
+static char profileFileName[256] = "";
 static GBool quiet = gFalse;
 static char cfgFileName[256] = "";
 static GBool printVersion = gFalse;
@@ -92,6 +100,12 @@ static ArgDesc argDesc[] = {
    "owner password (for encrypted files)"},
   {"-upw",     argString,   userPassword,   sizeof(userPassword),
    "user password (for encrypted files)"},
+#if MULTITHREADED
+  {"-j",       argInt,      &nThreads,      0,
+   "number of pages to convert in parallel (default is 1)"},
+#endif
+  {"-profile", argString,   profileFileName, sizeof(profileFileName),
+   "write operator timing statistics to this file"},
   {"-q",       argFlag,     &quiet,         0,
    "don't print any messages or errors"},
   {"-cfg",     argString,   cfgFileName,    sizeof(cfgFileName),
@@ -109,6 +123,11 @@ static ArgDesc argDesc[] = {
   {NULL}
 };
 
+#if MULTITHREADED
+static void convertPagesParallel(PDFDoc *doc, TextOutputDev *textOut,
+				 TextOutputControl *textOutControl);
+#endif
+
 int main(int argc, char *argv[]) {
   PDFDoc *doc;
   GString *fileName;
@@ -120,7 +139,7 @@ int main(int argc, char *argv[]) {
   Object info;
   GBool ok;
   char *p;
-  int exitCode;
+  int exitCode, n;
 
 #ifdef DEBUG_FP_LINUX
   // enable exceptions on floating point div-by-zero
@@ -167,6 +186,13 @@ int main(int argc, char *argv[]) {
   if (quiet) {
     globalParams->setErrQuiet(quiet);
   }
+  if (profileFileName[0]) {
+    globalParams->setProfileCommands(gTrue);
+    n = (int)strlen(profileFileName);
+    if (n > 5 && !strcmp(profileFileName + n - 5, ".json")) {
+      globalParams->getProfiler()->setTracing(gTrue);
+    }
+  }
 
   // get mapping to output encoding
   if (!(uMap = globalParams->getTextEncoding())) {
@@ -252,8 +278,16 @@ int main(int argc, char *argv[]) {
   textOut = new TextOutputDev(textFileName->getCString(), &textOutControl,
 			      gFalse);
   if (textOut->isOk()) {
-    doc->displayPages(textOut, firstPage, lastPage, 72, 72, 0,
-		      gFalse, gTrue, gFalse);
+#if MULTITHREADED
+    if (nThreads > 1 && lastPage > firstPage) {
+      convertPagesParallel(doc, textOut, &textOutControl);
+    } else {
+#endif
+      doc->displayPages(textOut, firstPage, lastPage, 72, 72, 0,
+			gFalse, gTrue, gFalse);
+#if MULTITHREADED
+    }
+#endif
   } else {
     delete textOut;
     exitCode = 2;
@@ -261,6 +295,14 @@ int main(int argc, char *argv[]) {
   }
   delete textOut;
 
+  // write the profile
+  if (profileFileName[0]) {
+    if (!globalParams->getProfiler()->writeFile(profileFileName)) {
+      error(errIO, -1, "Couldn't write profile file '{0:s}'",
+	    profileFileName);
+    }
+  }
+
   exitCode = 0;
 
   // clean up
@@ -279,3 +321,104 @@ int main(int argc, char *argv[]) {
 
   return exitCode;
 }
+
+#if MULTITHREADED
+
+//------------------------------------------------------------------------
+// parallel conversion
+//------------------------------------------------------------------------
+
+// Each worker thread owns a TextOutputDev (and therefore its own
+// TextPage), and shares the PDFDoc/XRef.  A worker's TextOutputDev
+// writes each page's text into a memory buffer; when all earlier pages
+// have been written, the buffer is copied to the real output file.
+// This produces exactly the same output as the serial code, with at
+// most nThreads pages of text in memory at any time.
+
+struct ConvertPool {
+  PDFDoc *doc;
+  TextOutputDev *textOut;	// writes to the output file
+  TextOutputControl *textOutControl;
+  int nextPage;			// next page to be converted
+  int nextWritePage;		// next page to be written
+  GMutex mutex;
+  GCondition writeCond;		// signalled whenever nextWritePage
+				//   is incremented
+};
+
+static void outputToGString(void *stream, const char *text, int len) {
+  ((GString *)stream)->append(text, len);
+}
+
+static GThreadReturn convertThread(void *arg) {
+  ConvertPool *pool = (ConvertPool *)arg;
+  TextOutputControl control;
+  TextOutputDev *textOut;
+  GString *buf;
+  int pg;
+
+  // the BOM (if any) was written by the main TextOutputDev
+  control = *pool->textOutControl;
+  control.insertBOM = gFalse;
+  buf = new GString();
+  textOut = new TextOutputDev(&outputToGString, buf, &control);
+  while (1) {
+    gLockMutex(&pool->mutex);
+    pg = pool->nextPage;
+    if (pg <= lastPage) {
+      ++pool->nextPage;
+    }
+    gUnlockMutex(&pool->mutex);
+    if (pg > lastPage) {
+      break;
+    }
+    buf->clear();
+    pool->doc->displayPage(textOut, pg, 72, 72, 0, gFalse, gTrue, gFalse);
+    pool->doc->getCatalog()->doneWithPage(pg);
+    gLockMutex(&pool->mutex);
+    while (pool->nextWritePage != pg) {
+      gClearCondition(&pool->writeCond);
+      gWaitCondition(&pool->writeCond, &pool->mutex);
+    }
+    gUnlockMutex(&pool->mutex);
+    pool->textOut->writeText(buf->getCString(), buf->getLength());
+    gLockMutex(&pool->mutex);
+    ++pool->nextWritePage;
+    gSignalCondition(&pool->writeCond);
+    gUnlockMutex(&pool->mutex);
+  }
+  delete textOut;
+  delete buf;
+  return 0;
+}
+
+static void convertPagesParallel(PDFDoc *doc, TextOutputDev *textOut,
+				 TextOutputControl *textOutControl) {
+  ConvertPool pool;
+  GThreadID *threads;
+  int n, i;
+
+  n = nThreads;
+  if (n > lastPage - firstPage + 1) {
+    n = lastPage - firstPage + 1;
+  }
+  pool.doc = doc;
+  pool.textOut = textOut;
+  pool.textOutControl = textOutControl;
+  pool.nextPage = firstPage;
+  pool.nextWritePage = firstPage;
+  gInitMutex(&pool.mutex);
+  gInitCondition(&pool.writeCond);
+  threads = (GThreadID *)gmallocn(n, sizeof(GThreadID));
+  for (i = 0; i < n; ++i) {
+    gCreateThread(&threads[i], &convertThread, &pool);
+  }
+  for (i = 0; i < n; ++i) {
+    gJoinThread(threads[i]);
+  }
+  gfree(threads);
+  gDestroyCondition(&pool.writeCond);
+  gDestroyMutex(&pool.mutex);
+}
+
+#endif // MULTITHREADED